@@ -12,7 +12,10 @@
    [OPTIONAL] #define TSF_NO_STDIO to remove stdio dependency
    [OPTIONAL] #define TSF_MALLOC, TSF_REALLOC, and TSF_FREE to avoid stdlib.h
    [OPTIONAL] #define TSF_MEMCPY, TSF_MEMSET to avoid string.h
-   [OPTIONAL] #define TSF_POW, TSF_POWF, TSF_EXPF, TSF_LOG, TSF_TAN, TSF_LOG10, TSF_SQRT to avoid math.h
+   [OPTIONAL] #define TSF_POW, TSF_POWF, TSF_EXPF, TSF_LOG, TSF_LOG10, TSF_SQRT to avoid math.h
+   [OPTIONAL] #define TSF_NO_SIMD to only build the scalar voice render kernel
+   [OPTIONAL] #define TSF_NO_FASTMATH to always use math.h instead of the fast 2^x approximations
+   [OPTIONAL] #define TSF_ATOMIC_INC, TSF_ATOMIC_DEC for the shared soundfont reference count of tsf_copy
 
    NOT YET IMPLEMENTED
      - Support for ChorusEffectsSend and ReverbEffectsSend generators
@@ -92,7 +95,9 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream);
 // Copy a tsf instance from an existing one, use tsf_close to close it as well.
 // All copied tsf instances and their original instance are linked, and share the underlying soundfont.
 // This allows loading a soundfont only once, but using it for multiple independent playbacks.
-// (This function isn't thread-safe without locking.)
+// The reference count is atomic (see TSF_ATOMIC_INC), so copies of an instance that was copied
+// at least once before can be created and closed on any thread, as long as the instance copied
+// from stays open meanwhile. The very first copy of an instance isn't thread-safe without locking.
 TSFDEF tsf* tsf_copy(tsf* f);
 
 // Free the memory related to this tsf instance
@@ -101,6 +106,20 @@ TSFDEF void tsf_close(tsf* f);
 // Stop all playing notes immediately and reset all channel parameters
 TSFDEF void tsf_reset(tsf* f);
 
+// Save the playback state (voices with their envelopes, LFOs and filters, and the channels) into a
+// buffer and continue from it later, rendering exactly what would have been rendered after the save.
+// A snapshot can be restored into the instance it was taken from or into a tsf_copy of it, it holds
+// pointers into the soundfont so it is only valid while that is loaded (and not across processes).
+// The one-shot cache isn't part of it: restored voices read their recordings if the instance still
+// has them, otherwise they render on their own, which matches to float rounding.
+// Neither function allocates unless the target has fewer voices or channels than the snapshot.
+//   buffer: target buffer of at least size bytes (tsf_snapshot with size 0 only returns the size)
+//   (tsf_snapshot returns the size of the snapshot in bytes, written to buffer if size is large enough)
+//   (tsf_restore returns 0 if buffer holds no snapshot of this soundfont at the same output sample rate
+//    or allocating voices or channels failed, otherwise 1)
+TSFDEF int tsf_snapshot(const tsf* f, void* buffer, int size);
+TSFDEF int tsf_restore(tsf* f, const void* buffer, int size);
+
 // Returns the preset index from a bank and preset number, or -1 if it does not exist in the loaded SoundFont
 TSFDEF int tsf_get_presetindex(const tsf* f, int bank, int preset_number);
 
@@ -131,14 +150,12 @@ enum TSFOutputMode
 // Your audio output which calls the tsf_render* functions will most likely
 // run on a different thread than where the playback tsf_note* functions
 // are called. In which case some sort of concurrency control like a
-// mutex needs to be used so they are not called at the same time.
-// Alternatively, you can pre-allocate a maximum number of voices that can
-// play simultaneously by calling tsf_set_max_voices after loading.
-// That way memory re-allocation will not happen during tsf_note_on and
-// TSF should become mostly thread safe.
-// There is a theoretical chance that ending notes would negatively influence
-// a voice that is rendering at the time but it is hard to say.
-// Also be aware, this has not been tested much.
+// mutex needs to be used so they are not called at the same time, or the
+// note calls are queued and applied by the thread that renders (like the
+// command queue of tsf_bridge.cpp does).
+// To keep tsf_note_on from re-allocating the voices on the render thread,
+// pre-allocate a maximum number of voices that can play simultaneously by
+// calling tsf_set_max_voices after loading.
 //
 // 2. Channels:
 //
@@ -160,10 +177,75 @@ TSFDEF void tsf_set_volume(tsf* f, float global_gain);
 // Set the maximum number of voices to play simultaneously
 // Depending on the soundfond, one note can cause many new voices to be started,
 // so don't keep this number too low or otherwise sounds may not play.
+// When the limit is reached, a new note steals the least important voice of a channel with the
+// same or lower priority (see tsf_channel_set_priority): quiet voices, voices in their release and
+// older notes go first. Stolen voices fade out over TSF_FASTRELEASETIME in one of TSF_STEALRESERVE
+// extra voices allocated for that, so they don't click. If every voice belongs to a channel with
+// a higher priority, the new note isn't played.
 //   max_voices: maximum number to pre-allocate and set the limit to
 //   (tsf_set_max_voices returns 0 if allocation failed, otherwise 1)
 TSFDEF int tsf_set_max_voices(tsf* f, int max_voices);
 
+// Select the kernel used for resampling and mixing voices
+// By default the fastest kernel supported by the CPU is picked at load time
+// (SSE2/AVX2 on x86, NEON on ARM64, SIMD128 on WebAssembly) with a scalar fallback.
+// The SIMD kernels step the sample position several output samples at a time so
+// their output differs from the scalar kernel by rounding only (see TSF_SIMD_TOLERANCE).
+//   flag_simd: 0 to force the portable scalar kernel, otherwise pick the fastest available
+//   (returns the name of the selected kernel, i.e. "scalar", "sse2", "avx2", "neon" or "simd128")
+TSFDEF const char* tsf_set_render_kernel(tsf* f, int flag_simd);
+
+// Select the math used for the pitch, volume, filter cutoff and envelope updates while rendering
+// By default fast approximations of 2^x replace pow, powf and expf from math.h in the render loop
+// with a relative error below TSF_FASTMATH_TOLERANCE. Define TSF_NO_FASTMATH to remove them.
+//   flag_fast_math: 0 to use math.h, otherwise use the fast approximations
+//   (returns 1 if the fast approximations are used, otherwise 0)
+TSFDEF int tsf_set_fast_math(tsf* f, int flag_fast_math);
+
+// Shortcuts for tsf_set_render_quality
+enum TSFRenderQuality
+{
+	// Keep low-pass filter cutoffs modulated by an LFO or the modulation envelope where the note started
+	TSF_QUALITY_STATIC_FILTER = 1,
+	// Resample by picking the nearest source sample instead of interpolating linearly
+	TSF_QUALITY_NEAREST = 2,
+	// Skip the low-pass filters, their state is primed from the preceding samples when they are turned back on
+	TSF_QUALITY_NO_FILTER = 4
+};
+
+// Trade render quality for CPU time, e.g. when rendering can't keep up with real time
+// Changes apply from the next render call on, full quality is the default.
+//   effect_blocks: update pitch, volume, filter cutoff, envelopes and LFOs every effect_blocks *
+//                  TSF_RENDER_EFFECTSAMPLEBLOCK samples (1 to TSF_RENDER_EFFECTBLOCKS_MAX)
+//   flags: combination of TSF_QUALITY_* values, 0 for none
+TSFDEF void tsf_set_render_quality(tsf* f, int effect_blocks, int flags);
+
+// Fade out the least important voices until at most max_voices are sounding (see tsf_set_max_voices
+// for the order voices are stolen in), e.g. to shed load when rendering falls behind
+//   (tsf_cull_voices returns the number of voices faded out)
+TSFDEF int tsf_cull_voices(tsf* f, int max_voices);
+
+// Stop rendering voices quieter than threshold_db (e.g. -90) relative to full scale, 0 turns it off (default)
+// The level of a voice is its amplitude envelope times note and channel gain, checked on every update
+// of the effects. Quiet voices keep their envelopes, LFOs and sample positions moving without being
+// resampled, filtered or mixed, so they come back seamlessly when they get louder (e.g. when the
+// channel volume rises). Released voices that would stay below the threshold even at full channel
+// volume are freed.
+TSFDEF void tsf_set_voice_virtualization(tsf* f, float threshold_db);
+
+// Cache the samples of one-shot percussion notes so repeated hits are mixed instead of rendered
+// Notes of presets in the percussion banks (128 and up) qualify with regions that don't loop and have
+// no pitch or filter cutoff modulation. The first hit of a region at a pitch is rendered as usual and
+// recorded after resampling and filtering, before the envelope and gains. Later hits at the same
+// pitch and render settings read the recording and only run their envelopes, so velocity, volume, pan
+// and note off apply as before. A pitch change while a hit plays switches it back to rendering from
+// where it is. The budget is allocated here in pages of TSF_ONESHOT_PAGE samples, so playing notes
+// never allocates; the least recently hit recordings are dropped when a new one needs pages. Changing
+// the budget clears the cache. Instances made with tsf_copy start without a cache.
+//   max_bytes: memory the recordings may take, 0 turns the cache off (default)
+//   (returns 0 if the cache could not be allocated, otherwise 1)
+TSFDEF int tsf_set_oneshot_cache(tsf* f, int max_bytes);
+
 // Start playing a note
 //   preset_index: preset index >= 0 and < tsf_get_presetcount()
 //   key: note value between 0 and 127 (60 being middle C)
@@ -195,6 +277,33 @@ TSFDEF int tsf_active_voice_count(tsf* f);
 TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing CPP_DEFAULT0);
 TSFDEF void tsf_render_float(tsf* f, float* buffer, int samples, int flag_mixing CPP_DEFAULT0);
 
+// Render the voices of each channel into a separate buffer (bus, e.g. for stems) in a single pass
+// over the voices, like tsf_render_float per bus with only the voices of that bus
+//   buffers: bus_count target buffers like tsf_render_float, bus_count at most TSF_MAX_BUSES
+//   channel_bus: bus index for each of the first channel_count channels, voices of other channels
+//                and of notes started without a channel (tsf_note_on) go to bus 0
+//   flags_active: array of bus_count flags, set to 1 for buses with voices playing and to 0 for
+//                 buses that received no samples (and only got cleared unless flag_mixing is set)
+#define TSF_MAX_BUSES 16
+TSFDEF void tsf_render_float_buses(tsf* f, float** buffers, int bus_count, const int* channel_bus, int channel_count, int samples, int flag_mixing, unsigned char* flags_active);
+
+// Lower level rendering of a subset of the voices, for example to spread the voices over multiple threads
+// tsf_render_voices_float only touches the state of the given voices so different voices can be
+// rendered concurrently. All other functions must not run at the same time, voices that finished
+// rendering stay allocated until they are freed with tsf_release_voice.
+//   voice_indices: target array for the indices of the currently playing voices (tsf_get_active_voices)
+//                  or indices of playing voices to render (tsf_render_voices_float)
+//   max_indices: size of voice_indices
+//   count: number of voices in voice_indices to render
+//   buffer: target buffer like tsf_render_float with flag_mixing set
+//   flags_finished: array of count flags, set to 1 for voices that finished playing and need to be released
+//   voice_index: index of a finished voice
+//   (tsf_get_active_voices returns the number of indices written)
+//   (tsf_render_voices_float returns the number of voices that finished playing)
+TSFDEF int tsf_get_active_voices(tsf* f, int* voice_indices, int max_indices);
+TSFDEF int tsf_render_voices_float(tsf* f, const int* voice_indices, int count, float* buffer, int samples, unsigned char* flags_finished);
+TSFDEF void tsf_release_voice(tsf* f, int voice_index);
+
 // Higher level channel based functions, set up channel parameters
 //   channel: channel number
 //   preset_index: preset index >= 0 and < tsf_get_presetcount()
@@ -220,6 +329,13 @@ TSFDEF int tsf_channel_set_pitchrange(tsf* f, int channel, float pitch_range);
 TSFDEF int tsf_channel_set_tuning(tsf* f, int channel, float tuning);
 TSFDEF int tsf_channel_set_sustain(tsf* f, int channel, int flag_sustain);
 
+// Limit the number of voices sounding at once on a channel, and set the priority of its voices
+// when voices are stolen. Notes over the limit steal a voice of the same channel (see tsf_set_max_voices).
+//   max_voices: maximum number of voices, 0 for no limit (default)
+//   priority: 0 (stolen first) to 127 (stolen last), default 64 (e.g. drums and lead above pads)
+TSFDEF int tsf_channel_set_polyphony(tsf* f, int channel, int max_voices);
+TSFDEF int tsf_channel_set_priority(tsf* f, int channel, int priority);
+
 // Start or stop playing notes on a channel (needs channel preset to be set)
 //   channel: channel number
 //   key: note value between 0 and 127 (60 being middle C)
@@ -243,6 +359,18 @@ TSFDEF float tsf_channel_get_volume(tsf* f, int channel);
 TSFDEF int tsf_channel_get_pitchwheel(tsf* f, int channel);
 TSFDEF float tsf_channel_get_pitchrange(tsf* f, int channel);
 TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
+TSFDEF int tsf_channel_get_polyphony(tsf* f, int channel);
+TSFDEF int tsf_channel_get_priority(tsf* f, int channel);
+
+// Save all parameters of a channel (preset, controllers, pitch, volume, pan and voice limits) and set
+// them on a channel of the same instance or of a tsf_copy, e.g. to compare or duplicate channel setups.
+// Voices already playing on the target channel keep their pitch, volume and pan.
+//   buffer: target buffer of at least size bytes (tsf_channel_get_state with size 0 only returns the size)
+//   (tsf_channel_get_state returns the size of the state in bytes, channels never set have their defaults)
+//   (tsf_channel_set_state returns 0 if buffer holds no channel state of this soundfont or a new channel
+//    needed allocation and that failed, otherwise 1)
+TSFDEF int tsf_channel_get_state(tsf* f, int channel, void* buffer, int size);
+TSFDEF int tsf_channel_set_state(tsf* f, int channel, const void* buffer, int size);
 
 #ifdef __cplusplus
 #  undef CPP_DEFAULT0
@@ -263,6 +391,15 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #define TSF_RENDER_EFFECTSAMPLEBLOCK 64
 #endif
 
+// Most effect blocks tsf_set_render_quality can combine into one update of the effects
+#define TSF_RENDER_EFFECTBLOCKS_MAX 8
+
+// Most samples a low-pass filter is run over before a virtual voice comes back, enough for a
+// resonant cutoff around 30 Hz to settle to -80 dB (see tsf_set_voice_virtualization)
+#ifndef TSF_LOWPASS_PRIMESAMPLES_MAX
+#define TSF_LOWPASS_PRIMESAMPLES_MAX 16384
+#endif
+
 // When using tsf_render_short, to do the conversion a buffer of a fixed size is
 // allocated on the stack. On low memory platforms this could be made smaller.
 // Increasing this above 512 should not have a significant impact on performance.
@@ -271,9 +408,18 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #define TSF_RENDER_SHORTBUFFERBLOCK 512
 #endif
 
+// Number of voices rendered side by side so their low-pass filters can run in lockstep (SIMD width)
+#define TSF_VOICE_LANES 4
+
 // Grace release time for quick voice off (avoid clicking noise)
 #define TSF_FASTRELEASETIME 0.01f
 
+// Voices allocated by tsf_set_max_voices on top of max_voices for stolen voices to fade out in
+#define TSF_STEALRESERVE(max_voices) ((max_voices) / 4 + 4)
+
+// Priority of channels that don't set one and of notes played without channels
+#define TSF_DEFAULTPRIORITY 64
+
 #if !defined(TSF_MALLOC) || !defined(TSF_FREE) || !defined(TSF_REALLOC)
 #  include <stdlib.h>
 #  define TSF_MALLOC  malloc
@@ -287,7 +433,7 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #  define TSF_MEMSET  memset
 #endif
 
-#if !defined(TSF_POW) || !defined(TSF_POWF) || !defined(TSF_EXPF) || !defined(TSF_LOG) || !defined(TSF_TAN) || !defined(TSF_LOG10) || !defined(TSF_SQRT)
+#if !defined(TSF_POW) || !defined(TSF_POWF) || !defined(TSF_EXPF) || !defined(TSF_LOG) || !defined(TSF_LOG10) || !defined(TSF_SQRT)
 #  include <math.h>
 #  if !defined(__cplusplus) && !defined(NAN) && !defined(powf) && !defined(expf) && !defined(sqrtf)
 #    define powf (float)pow // deal with old math.h
@@ -298,7 +444,6 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #  define TSF_POWF    powf
 #  define TSF_EXPF    expf
 #  define TSF_LOG     log
-#  define TSF_TAN     tan
 #  define TSF_LOG10   log10
 #  define TSF_SQRTF   sqrtf
 #endif
@@ -307,6 +452,50 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #  include <stdio.h>
 #endif
 
+// Increment or decrement an int atomically and evaluate to the new value
+#if !defined(TSF_ATOMIC_INC) || !defined(TSF_ATOMIC_DEC)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define TSF_ATOMIC_INC(p) _InterlockedIncrement((long volatile*)(p))
+#    define TSF_ATOMIC_DEC(p) _InterlockedDecrement((long volatile*)(p))
+#  elif defined(__GNUC__) || defined(__clang__)
+#    define TSF_ATOMIC_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+#    define TSF_ATOMIC_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#  else
+#    define TSF_ATOMIC_INC(p) (++*(p))
+#    define TSF_ATOMIC_DEC(p) (--*(p))
+#  endif
+#endif
+
+// Output of the SIMD render kernels differs from the scalar kernel by at most this
+// much per output sample per voice (full scale is 1.0). The only source of difference
+// is the sample position being stepped by n * pitch instead of n additions of pitch.
+#define TSF_SIMD_TOLERANCE 1e-5f
+
+// Maximum relative error of the fast 2^x approximations (see tsf_set_fast_math). In pitch this
+// is at most 0.0004 cents, in volume 0.000002 dB and in filter cutoff 0.0004 cents.
+#define TSF_FASTMATH_TOLERANCE 2.5e-7f
+
+#ifndef TSF_NO_SIMD
+#  if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define TSF_SIMD_SSE2
+#    define TSF_SIMD_AVX2
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#      include <intrin.h>
+#      define TSF_TARGET_AVX2
+#    else
+#      define TSF_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#  elif defined(__aarch64__) || defined(_M_ARM64)
+#    define TSF_SIMD_NEON
+#    include <arm_neon.h>
+#  elif defined(__wasm_simd128__)
+#    define TSF_SIMD_WASM
+#    include <wasm_simd128.h>
+#  endif
+#endif
+
 #define TSF_TRUE 1
 #define TSF_FALSE 0
 #define TSF_BOOL unsigned char
@@ -327,22 +516,35 @@ typedef char tsf_char20[20];
 
 #define TSF_FourCCEquals(value1, value2) (value1[0] == value2[0] && value1[1] == value2[1] && value1[2] == value2[2] && value1[3] == value2[3])
 
+// Bucket counts of the voice indexes by (channel, key), by channel and by (preset, exclusive class), must be powers of 2
+#define TSF_VOICE_KEYBUCKETS 2048
+#define TSF_VOICE_CHANNELBUCKETS 64
+#define TSF_VOICE_GROUPBUCKETS 64
+
 struct tsf
 {
 	struct tsf_preset* presets;
 	float* fontSamples;
 	struct tsf_voice* voices;
+	struct tsf_voice_note* voiceNotes;
 	struct tsf_channels* channels;
 
 	int presetNum;
 	int voiceNum;
 	int maxVoiceNum;
+	int activeVoiceNum, activeVoiceFirst, freeVoiceFirst;
+	int keyVoiceFirst[TSF_VOICE_KEYBUCKETS], channelVoiceFirst[TSF_VOICE_CHANNELBUCKETS], groupVoiceFirst[TSF_VOICE_GROUPBUCKETS];
 	unsigned int voicePlayIndex;
 
 	enum TSFOutputMode outputmode;
 	float outSampleRate;
 	float globalGainDB;
 	int* refCount;
+	const struct tsf_voice_kernel* kernel;
+	TSF_BOOL fastMath;
+	int effectBlocks, qualityFlags;
+	float virtualGain;
+	struct tsf_oneshots* oneshots;
 };
 
 #ifndef TSF_NO_STDIO
@@ -384,6 +586,8 @@ TSFDEF tsf* tsf_load_memory(const void* buffer, int size)
 
 enum { TSF_LOOPMODE_NONE, TSF_LOOPMODE_CONTINUOUS, TSF_LOOPMODE_SUSTAIN };
 
+enum { TSF_VOICE_INDEX_KEY, TSF_VOICE_INDEX_CHANNEL, TSF_VOICE_INDEX_GROUP, TSF_VOICE_INDEX_COUNT };
+
 enum { TSF_SEGMENT_NONE, TSF_SEGMENT_DELAY, TSF_SEGMENT_ATTACK, TSF_SEGMENT_HOLD, TSF_SEGMENT_DECAY, TSF_SEGMENT_SUSTAIN, TSF_SEGMENT_RELEASE, TSF_SEGMENT_DONE };
 
 struct tsf_hydra
@@ -419,8 +623,9 @@ static void tsf_hydra_read_shdr(struct tsf_hydra_shdr* i, struct tsf_stream* str
 
 struct tsf_riffchunk { tsf_fourcc id; tsf_u32 size; };
 struct tsf_envelope { float delay, attack, hold, decay, sustain, release, keynumToHold, keynumToDecay; };
-struct tsf_voice_envelope { unsigned char segment, segmentIsExponential : 1, isAmpEnv : 1; short midiVelocity; float level, slope; int samplesUntilNextSegment; struct tsf_envelope parameters; };
-struct tsf_voice_lowpass { double QInv, a0, a1, b1, b2, z1, z2; TSF_BOOL active; };
+// slope is added to level per sample, on exponential segments level is multiplied by e^slope per sample
+struct tsf_voice_envelope { float level, slope; int samplesUntilNextSegment; unsigned char segment, segmentIsExponential, isAmpEnv; short midiVelocity; };
+struct tsf_voice_lowpass { float QInv, a1, a2, a3, ic1, ic2; TSF_BOOL active, stale; }; // stale: state was dropped, see tsf_voice_lowpass_prime
 struct tsf_voice_lfo { int samplesUntil; float level, delta; };
 
 struct tsf_region
@@ -448,22 +653,90 @@ struct tsf_preset
 	int regionNum;
 };
 
+// The voice pool is split in two parallel arrays of the same length. tsf_voice holds
+// only the state touched by tsf_voice_render_block on every block, so a render pass over all
+// voices streams through as few cache lines as possible. tsf_voice_note holds the data
+// only needed when notes start, stop or get looked up by key and channel, including
+// the full envelope parameters which are read just on envelope segment changes.
+// Playing voices are linked in an active list (listPrev/listNext are array indices so
+// they survive growing the arrays), unused voices in a free list through listNext,
+// which keeps rendering, counting and allocating voices O(active voices).
+// Additionally each playing voice is linked into hashed bucket lists by (channel, key),
+// by channel and by (preset, exclusive class) so note off, channel updates and choke
+// groups only touch the voices involved.
 struct tsf_voice
 {
-	int playingPreset, playingKey, playingChannel, heldSustain;
+	int playingPreset, listPrev, listNext;
+	unsigned int loopStart, loopEnd;
 	struct tsf_region* region;
-	double pitchInputTimecents, pitchOutputFactor;
 	double sourceSamplePosition;
+	double pitchInputTimecents, pitchOutputFactor;
 	float  noteGainDB, panFactorLeft, panFactorRight;
-	unsigned int playIndex, loopStart, loopEnd;
 	struct tsf_voice_envelope ampenv, modenv;
 	struct tsf_voice_lowpass lowpass;
 	struct tsf_voice_lfo modlfo, viblfo;
+	struct tsf_oneshot* oneshot; // Recording of the one-shot cache the voice is attached to, see tsf_voice_oneshot_attach
+	struct tsf_oneshot_page* oneshotPage; // Page of oneshot holding frame oneshotFrame
+	int oneshotFrame; // Frames of oneshot played, -1 once the voice renders on its own
+};
+
+// Samples per page of the one-shot cache, recordings are chains of pages preallocated by tsf_set_oneshot_cache
+#define TSF_ONESHOT_PAGE 1024
+
+struct tsf_oneshot_page
+{
+	struct tsf_oneshot_page* next;
+	float samples[TSF_ONESHOT_PAGE];
+};
+
+// One-shot cache entry: the samples of a non-looping region at one pitch, resampled and filtered but
+// before the envelope and gains, recorded by the first voice that played it. Voices attached to it
+// read it while it lasts. Once the recorder stops early, the sample position and filter state at its
+// end let a voice that gets there continue rendering exactly where the recording left off.
+struct tsf_oneshot
+{
+	struct tsf_oneshot* next;
+	struct tsf_oneshot *newer, *older; // Least recently hit list of the entries no voice is attached to, older links free entries
+	struct tsf_oneshot_page *first, *last;
+	const struct tsf_region* region;
+	double pitchRatio, position;
+	int (*resample)(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd);
+	float outSampleRate, ic1, ic2;
+	TSF_BOOL filter, complete; // complete: recorded up to the end of the sample
+	int recorder, refs, length, capacity; // recorder: index of the voice recording, -1 if none
+};
+
+// Bucket count of the one-shot cache entries by (region, pitch), must be a power of 2
+#define TSF_ONESHOT_BUCKETS 64
+
+// Followed by the entries and pages in the same allocation, an entry per page as each recording takes one at least
+struct tsf_oneshots
+{
+	int pageNum, freePageNum;
+	struct tsf_oneshot_page* freePages;
+	struct tsf_oneshot* freeEntries;
+	struct tsf_oneshot *newest, *oldest;
+	struct tsf_oneshot* buckets[TSF_ONESHOT_BUCKETS];
+};
+
+struct tsf_voice_link { int prev, next; };
+
+struct tsf_voice_note
+{
+	int playingKey, playingChannel, heldSustain;
+	unsigned int playIndex;
+	struct tsf_envelope ampenv, modenv;
+	struct tsf_voice_link links[TSF_VOICE_INDEX_COUNT];
+	// Key of the one-shot cache recording the voice was attached to, by which tsf_restore finds it again
+	double oneshotPitchRatio;
+	int (*oneshotResample)(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd);
+	TSF_BOOL oneshotFilter;
 };
 
 struct tsf_channel
 {
 	unsigned short presetIndex, bank, pitchWheel, midiPan, midiVolume, midiExpression, midiRPN, midiData : 14, sustain : 1;
+	unsigned short maxVoices, priority;
 	float panOffset, gainDB, pitchRange, tuning;
 };
 
@@ -480,6 +753,76 @@ static float tsf_cents2Hertz(float cents) { return 8.176f * TSF_POWF(2.0f, cents
 static float tsf_decibelsToGain(float db) { return (db > -100.f ? TSF_POWF(10.0f, db * 0.05f) : 0); }
 static float tsf_gainToDecibels(float gain) { return (gain <= .00001f ? -100.f : (float)(20.0 * TSF_LOG10(gain))); }
 
+#ifndef TSF_NO_FASTMATH
+// Fast approximations of 2^x used in the render loop instead of pow, powf and expf (see tsf_set_fast_math).
+// x is split into an integer i and a remainder r in [-0.5, 0.5], 2^i is built directly as the float
+// exponent bits and 2^r comes from a minimax polynomial (degree 5 for float with a relative error of
+// 7.5e-8, degree 6 for double with 1.9e-9). Including the rounding of the float evaluation the error
+// stays below TSF_FASTMATH_TOLERANCE. Results below 2^-126 are flushed to 0, x is clamped at 127.
+static float tsf_fast_exp2f(float x)
+{
+	union { float f; tsf_u32 u; } scale;
+	int biased;
+	if (x < -126.0f) return 0.0f;
+	if (x > 127.0f) x = 127.0f;
+	biased = (int)(x + 127.5f); // i + 127 with i rounded to nearest, the sum is positive so truncation works as floor
+	x -= (float)(biased - 127);
+	scale.u = (tsf_u32)biased << 23;
+	return scale.f * (1.00000007f + x * (0.693146967f + x * (0.240221197f + x * (0.0555071327f + x * (0.00967554133f + x * 0.0013276472f)))));
+}
+
+static double tsf_fast_exp2d(double x)
+{
+	union { float f; tsf_u32 u; } scale;
+	int biased;
+	if (x < -126.0) return 0.0;
+	if (x > 127.0) x = 127.0;
+	biased = (int)(x + 127.5);
+	x -= (double)(biased - 127);
+	scale.u = (tsf_u32)biased << 23;
+	return scale.f * (1.0000000005541665 + x * (0.6931472057372673 + x * (0.24022646890634405 + x * (0.055503287769656406 + x * (0.009618488957102513 + x * (0.0013399931219124377 + x * 0.00015345812004000534))))));
+}
+#endif
+
+// Conversions done for every effect block, they use the fast approximations if enabled
+static double tsf_render_timecents2Secsd(TSF_BOOL fastMath, double timecents)
+{
+	#ifndef TSF_NO_FASTMATH
+	if (fastMath) return tsf_fast_exp2d(timecents * (1.0 / 1200.0));
+	#endif
+	(void)fastMath;
+	return tsf_timecents2Secsd(timecents);
+}
+
+static float tsf_render_cents2Hertz(TSF_BOOL fastMath, float cents)
+{
+	#ifndef TSF_NO_FASTMATH
+	if (fastMath) return 8.176f * tsf_fast_exp2f(cents * (1.0f / 1200.0f));
+	#endif
+	(void)fastMath;
+	return tsf_cents2Hertz(cents);
+}
+
+static float tsf_render_decibelsToGain(TSF_BOOL fastMath, float db)
+{
+	#ifndef TSF_NO_FASTMATH
+	// 10^(db/20) = 2^(db * log2(10)/20)
+	if (fastMath) return (db > -100.f ? tsf_fast_exp2f(db * 0.166096405f) : 0);
+	#endif
+	(void)fastMath;
+	return tsf_decibelsToGain(db);
+}
+
+// e^x for the exponential envelope segments
+static float tsf_render_expf(TSF_BOOL fastMath, float x)
+{
+	#ifndef TSF_NO_FASTMATH
+	if (fastMath) return tsf_fast_exp2f(x * 1.44269504f);
+	#endif
+	(void)fastMath;
+	return TSF_EXPF(x);
+}
+
 static TSF_BOOL tsf_riffchunk_read(struct tsf_riffchunk* parent, struct tsf_riffchunk* chunk, struct tsf_stream* stream)
 {
 	TSF_BOOL IsRiff, IsList;
@@ -1002,17 +1345,17 @@ static int tsf_load_samples(void** pRawBuffer, float** pFloatBuffer, unsigned in
 	#endif
 }
 
-static int tsf_voice_envelope_release_samples(struct tsf_voice_envelope* e, float outSampleRate)
+static int tsf_voice_envelope_release_samples(const struct tsf_envelope* p, float outSampleRate)
 {
-	return (int)((e->parameters.release <= 0 ? TSF_FASTRELEASETIME : e->parameters.release) * outSampleRate);
+	return (int)((p->release <= 0 ? TSF_FASTRELEASETIME : p->release) * outSampleRate);
 }
 
-static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short active_segment, float outSampleRate)
+static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, const struct tsf_envelope* p, short active_segment, float outSampleRate)
 {
 	switch (active_segment)
 	{
 		case TSF_SEGMENT_NONE:
-			e->samplesUntilNextSegment = (int)(e->parameters.delay * outSampleRate);
+			e->samplesUntilNextSegment = (int)(p->delay * outSampleRate);
 			if (e->samplesUntilNextSegment > 0)
 			{
 				e->segment = TSF_SEGMENT_DELAY;
@@ -1023,13 +1366,13 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 			}
 			/* fall through */
 		case TSF_SEGMENT_DELAY:
-			e->samplesUntilNextSegment = (int)(e->parameters.attack * outSampleRate);
+			e->samplesUntilNextSegment = (int)(p->attack * outSampleRate);
 			if (e->samplesUntilNextSegment > 0)
 			{
 				if (!e->isAmpEnv)
 				{
 					//mod env attack duration scales with velocity (velocity of 1 is full duration, max velocity is 0.125 times duration)
-					e->samplesUntilNextSegment = (int)(e->parameters.attack * ((145 - e->midiVelocity) / 144.0f) * outSampleRate);
+					e->samplesUntilNextSegment = (int)(p->attack * ((145 - e->midiVelocity) / 144.0f) * outSampleRate);
 				}
 				e->segment = TSF_SEGMENT_ATTACK;
 				e->segmentIsExponential = TSF_FALSE;
@@ -1039,7 +1382,7 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 			}
 			/* fall through */
 		case TSF_SEGMENT_ATTACK:
-			e->samplesUntilNextSegment = (int)(e->parameters.hold * outSampleRate);
+			e->samplesUntilNextSegment = (int)(p->hold * outSampleRate);
 			if (e->samplesUntilNextSegment > 0)
 			{
 				e->segment = TSF_SEGMENT_HOLD;
@@ -1050,7 +1393,7 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 			}
 			/* fall through */
 		case TSF_SEGMENT_HOLD:
-			e->samplesUntilNextSegment = (int)(e->parameters.decay * outSampleRate);
+			e->samplesUntilNextSegment = (int)(p->decay * outSampleRate);
 			if (e->samplesUntilNextSegment > 0)
 			{
 				e->segment = TSF_SEGMENT_DECAY;
@@ -1059,22 +1402,22 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 				{
 					// I don't truly understand this; just following what LinuxSampler does.
 					float mysterySlope = -9.226f / e->samplesUntilNextSegment;
-					e->slope = TSF_EXPF(mysterySlope);
+					e->slope = mysterySlope;
 					e->segmentIsExponential = TSF_TRUE;
-					if (e->parameters.sustain > 0.0f)
+					if (p->sustain > 0.0f)
 					{
 						// Again, this is following LinuxSampler's example, which is similar to
 						// SF2-style decay, where "decay" specifies the time it would take to
 						// get to zero, not to the sustain level.  The SFZ spec is not that
 						// specific about what "decay" means, so perhaps it's really supposed
 						// to specify the time to reach the sustain level.
-						e->samplesUntilNextSegment = (int)(TSF_LOG(e->parameters.sustain) / mysterySlope);
+						e->samplesUntilNextSegment = (int)(TSF_LOG(p->sustain) / mysterySlope);
 					}
 				}
 				else
 				{
 					e->slope = -1.0f / e->samplesUntilNextSegment;
-					e->samplesUntilNextSegment = (int)(e->parameters.decay * (1.0f - e->parameters.sustain) * outSampleRate);
+					e->samplesUntilNextSegment = (int)(p->decay * (1.0f - p->sustain) * outSampleRate);
 					e->segmentIsExponential = TSF_FALSE;
 				}
 				return;
@@ -1082,19 +1425,19 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 			/* fall through */
 		case TSF_SEGMENT_DECAY:
 			e->segment = TSF_SEGMENT_SUSTAIN;
-			e->level = e->parameters.sustain;
+			e->level = p->sustain;
 			e->slope = 0.0f;
 			e->samplesUntilNextSegment = 0x7FFFFFFF;
 			e->segmentIsExponential = TSF_FALSE;
 			return;
 		case TSF_SEGMENT_SUSTAIN:
 			e->segment = TSF_SEGMENT_RELEASE;
-			e->samplesUntilNextSegment = tsf_voice_envelope_release_samples(e, outSampleRate);
+			e->samplesUntilNextSegment = tsf_voice_envelope_release_samples(p, outSampleRate);
 			if (e->isAmpEnv)
 			{
 				// I don't truly understand this; just following what LinuxSampler does.
 				float mysterySlope = -9.226f / e->samplesUntilNextSegment;
-				e->slope = TSF_EXPF(mysterySlope);
+				e->slope = mysterySlope;
 				e->segmentIsExponential = TSF_TRUE;
 			}
 			else
@@ -1112,49 +1455,67 @@ static void tsf_voice_envelope_nextsegment(struct tsf_voice_envelope* e, short a
 	}
 }
 
-static void tsf_voice_envelope_setup(struct tsf_voice_envelope* e, struct tsf_envelope* new_parameters, int midiNoteNumber, short midiVelocity, TSF_BOOL isAmpEnv, float outSampleRate)
+static void tsf_voice_envelope_setup(struct tsf_voice_envelope* e, struct tsf_envelope* p, struct tsf_envelope* new_parameters, int midiNoteNumber, short midiVelocity, TSF_BOOL isAmpEnv, float outSampleRate)
 {
-	e->parameters = *new_parameters;
-	if (e->parameters.keynumToHold)
+	*p = *new_parameters;
+	if (p->keynumToHold)
 	{
-		e->parameters.hold += e->parameters.keynumToHold * (60.0f - midiNoteNumber);
-		e->parameters.hold = (e->parameters.hold < -10000.0f ? 0.0f : tsf_timecents2Secsf(e->parameters.hold));
+		p->hold += p->keynumToHold * (60.0f - midiNoteNumber);
+		p->hold = (p->hold < -10000.0f ? 0.0f : tsf_timecents2Secsf(p->hold));
 	}
-	if (e->parameters.keynumToDecay)
+	if (p->keynumToDecay)
 	{
-		e->parameters.decay += e->parameters.keynumToDecay * (60.0f - midiNoteNumber);
-		e->parameters.decay = (e->parameters.decay < -10000.0f ? 0.0f : tsf_timecents2Secsf(e->parameters.decay));
+		p->decay += p->keynumToDecay * (60.0f - midiNoteNumber);
+		p->decay = (p->decay < -10000.0f ? 0.0f : tsf_timecents2Secsf(p->decay));
 	}
 	e->midiVelocity = midiVelocity;
-	e->isAmpEnv = isAmpEnv;
-	tsf_voice_envelope_nextsegment(e, TSF_SEGMENT_NONE, outSampleRate);
+	e->isAmpEnv = (unsigned char)isAmpEnv;
+	tsf_voice_envelope_nextsegment(e, p, TSF_SEGMENT_NONE, outSampleRate);
 }
 
-static void tsf_voice_envelope_process(struct tsf_voice_envelope* e, int numSamples, float outSampleRate)
+static void tsf_voice_envelope_process(struct tsf_voice_envelope* e, const struct tsf_envelope* p, int numSamples, float outSampleRate, TSF_BOOL fastMath)
 {
 	if (e->slope)
 	{
-		if (e->segmentIsExponential) e->level *= TSF_POWF(e->slope, (float)numSamples);
+		if (e->segmentIsExponential) e->level *= tsf_render_expf(fastMath, e->slope * numSamples);
 		else e->level += (e->slope * numSamples);
 	}
 	if ((e->samplesUntilNextSegment -= numSamples) <= 0)
-		tsf_voice_envelope_nextsegment(e, e->segment, outSampleRate);
+		tsf_voice_envelope_nextsegment(e, p, e->segment, outSampleRate);
+}
+
+// sin(pi * x) for 0 <= x <= 0.5 by its Taylor series up to x^11 (relative error below 6e-8)
+static float tsf_sinpi(float x)
+{
+	float xx = x * x;
+	return x * (3.14159265f + xx * (-5.16771278f + xx * (2.55016404f + xx * (-0.599264529f + xx * (0.0821458866f + xx * -0.00737043095f)))));
 }
 
 static void tsf_voice_lowpass_setup(struct tsf_voice_lowpass* e, float Fc)
 {
-	// Lowpass filter from http://www.earlevel.com/main/2012/11/26/biquad-c-source-code/
-	double K = TSF_TAN(TSF_PI * Fc), KK = K * K;
-	double norm = 1 / (1 + K * e->QInv + KK);
-	e->a0 = KK * norm;
-	e->a1 = 2 * e->a0;
-	e->b1 = 2 * (KK - 1) * norm;
-	e->b2 = (1 - K * e->QInv + KK) * norm;
+	// Lowpass filter as trapezoidal state variable filter from https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+	// It has the same response as the bilinear biquad from http://www.earlevel.com/main/2012/11/26/biquad-c-source-code/
+	// but stays accurate in single precision for low cutoffs and high resonance where the biquad coefficients don't.
+	// With g = tan(pi*Fc) = s/c expanded, a1 = 1/(1+g*(g+QInv)) becomes c*c/(1+s*c*QInv) so no tan() call is needed.
+	float s = tsf_sinpi(Fc), c = tsf_sinpi(0.5f - Fc), norm = 1.0f / (1.0f + s * c * e->QInv);
+	e->a1 = c * c * norm;
+	e->a2 = s * c * norm;
+	e->a3 = s * s * norm;
+}
+
+static float tsf_voice_lowpass_process(struct tsf_voice_lowpass* e, float In)
+{
+	float v3 = In - e->ic2, v1 = e->a1 * e->ic1 + e->a2 * v3, v2 = e->ic2 + e->a2 * e->ic1 + e->a3 * v3;
+	e->ic1 = 2.0f * v1 - e->ic1; e->ic2 = 2.0f * v2 - e->ic2; return v2;
 }
 
-static float tsf_voice_lowpass_process(struct tsf_voice_lowpass* e, double In)
+static void tsf_voice_lowpass_process_block(struct tsf_voice_lowpass* e, float* block, int count)
 {
-	double Out = In * e->a0 + e->z1; e->z1 = In * e->a1 + e->z2 - e->b1 * Out; e->z2 = In * e->a0 - e->b2 * Out; return (float)Out;
+	struct tsf_voice_lowpass tmp = *e;
+	int i;
+	for (i = 0; i != count; i++) block[i] = tsf_voice_lowpass_process(&tmp, block[i]);
+	e->ic1 = tmp.ic1;
+	e->ic2 = tmp.ic2;
 }
 
 static void tsf_voice_lfo_setup(struct tsf_voice_lfo* e, float delay, int freqCents, float outSampleRate)
@@ -1167,277 +1528,1259 @@ static void tsf_voice_lfo_setup(struct tsf_voice_lfo* e, float delay, int freqCe
 static void tsf_voice_lfo_process(struct tsf_voice_lfo* e, int blockSamples)
 {
 	if (e->samplesUntil > blockSamples) { e->samplesUntil -= blockSamples; return; }
+	// Keeps counting below 0 once the delay is over so tsf_voice_lfo_rewind finds the block it ended in
+	if (e->samplesUntil > -0x40000000) e->samplesUntil -= blockSamples;
 	e->level += e->delta * blockSamples;
 	if      (e->level >  1.0f) { e->delta = -e->delta; e->level =  2.0f - e->level; }
 	else if (e->level < -1.0f) { e->delta = -e->delta; e->level = -2.0f - e->level; }
 }
 
-static void tsf_voice_kill(struct tsf_voice* v)
+// Undo tsf_voice_lfo_process, an LFO still in its delay was delayed longer before
+static void tsf_voice_lfo_rewind(struct tsf_voice_lfo* e, int blockSamples)
 {
-	v->playingPreset = -1;
+	e->samplesUntil += blockSamples;
+	if (e->samplesUntil > blockSamples) return;
+	e->level -= e->delta * blockSamples;
+	if      (e->level >  1.0f) { e->delta = -e->delta; e->level =  2.0f - e->level; }
+	else if (e->level < -1.0f) { e->delta = -e->delta; e->level = -2.0f - e->level; }
 }
 
-static void tsf_voice_end(tsf* f, struct tsf_voice* v)
+static struct tsf_voice_note* tsf_voice_note(tsf* f, struct tsf_voice* v)
+{
+	return &f->voiceNotes[v - f->voices];
+}
+
+static void tsf_voice_index_clear(tsf* f)
+{
+	int i;
+	for (i = 0; i != TSF_VOICE_KEYBUCKETS; i++) f->keyVoiceFirst[i] = -1;
+	for (i = 0; i != TSF_VOICE_CHANNELBUCKETS; i++) f->channelVoiceFirst[i] = -1;
+	for (i = 0; i != TSF_VOICE_GROUPBUCKETS; i++) f->groupVoiceFirst[i] = -1;
+}
+
+static int* tsf_voice_key_bucket(tsf* f, int channel, int key)
+{
+	// Keys are 0 to 127 so the 16 MIDI channels hash without colliding with each other. Voices without a channel
+	// (channel -1) share the buckets of channel 15 and higher channels wrap around, so lookups compare channel and key.
+	return &f->keyVoiceFirst[((unsigned int)channel * 128 + (unsigned int)key) & (TSF_VOICE_KEYBUCKETS - 1)];
+}
+
+static int* tsf_voice_channel_bucket(tsf* f, int channel)
+{
+	return &f->channelVoiceFirst[(unsigned int)(channel + 1) & (TSF_VOICE_CHANNELBUCKETS - 1)];
+}
+
+static int* tsf_voice_group_bucket(tsf* f, int preset_index, unsigned int group)
 {
-	// if maxVoiceNum is set, assume that voice rendering and note queuing are on separate threads
-	// so to minimize the chance that voice rendering would advance the segment at the same time
-	// we just do it twice here and hope that it sticks
-	int repeats = (f->maxVoiceNum ? 2 : 1);
-	while (repeats--)
+	return &f->groupVoiceFirst[((unsigned int)preset_index * 31 + group) & (TSF_VOICE_GROUPBUCKETS - 1)];
+}
+
+static int* tsf_voice_index_bucket(tsf* f, int list, int i)
+{
+	struct tsf_voice_note* n = &f->voiceNotes[i];
+	switch (list)
 	{
-		tsf_voice_envelope_nextsegment(&v->ampenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
-		tsf_voice_envelope_nextsegment(&v->modenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
-		if (v->region->loop_mode == TSF_LOOPMODE_SUSTAIN)
-		{
-			// Continue playing, but stop looping.
-			v->loopEnd = v->loopStart;
-		}
+		case TSF_VOICE_INDEX_KEY: return tsf_voice_key_bucket(f, n->playingChannel, n->playingKey);
+		case TSF_VOICE_INDEX_CHANNEL: return tsf_voice_channel_bucket(f, n->playingChannel);
+		default: return (f->voices[i].region->group ? tsf_voice_group_bucket(f, f->voices[i].playingPreset, f->voices[i].region->group) : TSF_NULL);
 	}
 }
 
-static void tsf_voice_endquick(tsf* f, struct tsf_voice* v)
+static void tsf_voice_index_insert(tsf* f, int i)
 {
-	// if maxVoiceNum is set, assume that voice rendering and note queuing are on separate threads
-	// so to minimize the chance that voice rendering would advance the segment at the same time
-	// we just do it twice here and hope that it sticks
-	int repeats = (f->maxVoiceNum ? 2 : 1);
-	while (repeats--)
+	// Link a newly started voice at the front of its bucket in each index
+	int list, *first;
+	for (list = 0; list != TSF_VOICE_INDEX_COUNT; list++)
 	{
-		v->ampenv.parameters.release = 0.0f; tsf_voice_envelope_nextsegment(&v->ampenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
-		v->modenv.parameters.release = 0.0f; tsf_voice_envelope_nextsegment(&v->modenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+		struct tsf_voice_link* l = &f->voiceNotes[i].links[list];
+		if (!(first = tsf_voice_index_bucket(f, list, i))) continue;
+		l->prev = -1;
+		l->next = *first;
+		if (*first != -1) f->voiceNotes[*first].links[list].prev = i;
+		*first = i;
 	}
 }
 
-static void tsf_voice_calcpitchratio(struct tsf_voice* v, float pitchShift, float outSampleRate)
+static void tsf_voice_index_remove(tsf* f, int i)
 {
-	double note = v->playingKey + v->region->transpose + v->region->tune / 100.0;
-	double adjustedPitch = v->region->pitch_keycenter + (note - v->region->pitch_keycenter) * (v->region->pitch_keytrack / 100.0);
-	if (pitchShift) adjustedPitch += pitchShift;
-	v->pitchInputTimecents = adjustedPitch * 100.0;
-	v->pitchOutputFactor = v->region->sample_rate / (tsf_timecents2Secsd(v->region->pitch_keycenter * 100.0) * outSampleRate);
+	int list, *first;
+	for (list = 0; list != TSF_VOICE_INDEX_COUNT; list++)
+	{
+		struct tsf_voice_link* l = &f->voiceNotes[i].links[list];
+		if (!(first = tsf_voice_index_bucket(f, list, i))) continue;
+		if (l->prev != -1) f->voiceNotes[l->prev].links[list].next = l->next;
+		else *first = l->next;
+		if (l->next != -1) f->voiceNotes[l->next].links[list].prev = l->prev;
+	}
 }
 
-static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, int numSamples)
+static struct tsf_voice* tsf_voice_alloc(tsf* f)
 {
-	struct tsf_region* region = v->region;
-	float* input = f->fontSamples;
-	float* outL = outputBuffer;
-	float* outR = (f->outputmode == TSF_STEREO_UNWEAVED ? outL + numSamples : TSF_NULL);
+	// Move a voice from the free list to the front of the active list
+	int i = f->freeVoiceFirst;
+	struct tsf_voice* v;
+	if (i == -1) return TSF_NULL;
+	v = &f->voices[i];
+	f->freeVoiceFirst = v->listNext;
+	v->listPrev = -1;
+	v->listNext = f->activeVoiceFirst;
+	if (f->activeVoiceFirst != -1) f->voices[f->activeVoiceFirst].listPrev = i;
+	f->activeVoiceFirst = i;
+	f->activeVoiceNum++;
+	return v;
+}
 
-	// Cache some values, to give them at least some chance of ending up in registers.
-	TSF_BOOL updateModEnv = (region->modEnvToPitch || region->modEnvToFilterFc);
-	TSF_BOOL updateModLFO = (v->modlfo.delta && (region->modLfoToPitch || region->modLfoToFilterFc || region->modLfoToVolume));
-	TSF_BOOL updateVibLFO = (v->viblfo.delta && (region->vibLfoToPitch));
-	TSF_BOOL isLooping    = (v->loopStart < v->loopEnd);
-	unsigned int tmpLoopStart = v->loopStart, tmpLoopEnd = v->loopEnd;
-	double tmpSampleEndDbl = (double)region->end, tmpLoopEndDbl = (double)tmpLoopEnd + 1.0;
-	double tmpSourceSamplePosition = v->sourceSamplePosition;
-	struct tsf_voice_lowpass tmpLowpass = v->lowpass;
+static struct tsf_oneshot** tsf_oneshot_bucket(struct tsf_oneshots* c, const struct tsf_region* region, double pitchRatio)
+{
+	// Regions of different keys mostly start at different sample offsets
+	return &c->buckets[(region->offset * 31u + (unsigned int)(pitchRatio * 4096.0)) & (TSF_ONESHOT_BUCKETS - 1)];
+}
 
-	TSF_BOOL dynamicLowpass = (region->modLfoToFilterFc || region->modEnvToFilterFc);
-	float tmpSampleRate = f->outSampleRate, tmpInitialFilterFc, tmpModLfoToFilterFc, tmpModEnvToFilterFc;
+static void tsf_oneshot_link(struct tsf_oneshots* c, struct tsf_oneshot* e)
+{
+	e->newer = TSF_NULL;
+	e->older = c->newest;
+	if (c->newest) c->newest->newer = e;
+	else c->oldest = e;
+	c->newest = e;
+}
 
-	TSF_BOOL dynamicPitchRatio = (region->modLfoToPitch || region->modEnvToPitch || region->vibLfoToPitch);
-	double pitchRatio;
-	float tmpModLfoToPitch, tmpVibLfoToPitch, tmpModEnvToPitch;
+static void tsf_oneshot_unlink(struct tsf_oneshots* c, struct tsf_oneshot* e)
+{
+	if (e->newer) e->newer->older = e->older;
+	else c->newest = e->older;
+	if (e->older) e->older->newer = e->newer;
+	else c->oldest = e->newer;
+}
 
-	TSF_BOOL dynamicGain = (region->modLfoToVolume != 0);
-	float noteGain = 0, tmpModLfoToVolume;
+// Return an entry that is not in the least recently hit list and its pages to the free lists
+static void tsf_oneshot_free(struct tsf_oneshots* c, struct tsf_oneshot* e)
+{
+	struct tsf_oneshot** link = tsf_oneshot_bucket(c, e->region, e->pitchRatio);
+	while (*link != e) link = &(*link)->next;
+	*link = e->next;
+	e->last->next = c->freePages;
+	c->freePages = e->first;
+	c->freePageNum += (e->capacity + TSF_ONESHOT_PAGE - 1) / TSF_ONESHOT_PAGE;
+	e->region = TSF_NULL;
+	e->older = c->freeEntries;
+	c->freeEntries = e;
+}
 
-	if (dynamicLowpass) tmpInitialFilterFc = (float)region->initialFilterFc, tmpModLfoToFilterFc = (float)region->modLfoToFilterFc, tmpModEnvToFilterFc = (float)region->modEnvToFilterFc;
-	else tmpInitialFilterFc = 0, tmpModLfoToFilterFc = 0, tmpModEnvToFilterFc = 0;
+// Stop reading and recording the one-shot cache, the voice renders on its own from here
+static void tsf_voice_oneshot_stop(tsf* f, struct tsf_voice* v)
+{
+	if (v->oneshot->recorder == (int)(v - f->voices)) v->oneshot->recorder = -1;
+	v->oneshotFrame = -1;
+}
 
-	if (dynamicPitchRatio) pitchRatio = 0, tmpModLfoToPitch = (float)region->modLfoToPitch, tmpVibLfoToPitch = (float)region->vibLfoToPitch, tmpModEnvToPitch = (float)region->modEnvToPitch;
-	else pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents) * v->pitchOutputFactor, tmpModLfoToPitch = 0, tmpVibLfoToPitch = 0, tmpModEnvToPitch = 0;
+static void tsf_voice_oneshot_release(tsf* f, struct tsf_voice* v)
+{
+	struct tsf_oneshot* e = v->oneshot;
+	if (!e) return;
+	tsf_voice_oneshot_stop(f, v);
+	v->oneshot = TSF_NULL;
+	if (--e->refs) return;
+	// A recording stopped before its first block is of no use to anyone
+	if (e->length) tsf_oneshot_link(f->oneshots, e);
+	else tsf_oneshot_free(f->oneshots, e);
+}
 
-	if (dynamicGain) tmpModLfoToVolume = (float)region->modLfoToVolume * 0.1f;
-	else noteGain = tsf_decibelsToGain(v->noteGainDB), tmpModLfoToVolume = 0;
+static void tsf_voice_kill(tsf* f, struct tsf_voice* v)
+{
+	// Unlink the voice from the active list and return it to the free list
+	int i = (int)(v - f->voices);
+	if (v->playingPreset == -1) return;
+	tsf_voice_oneshot_release(f, v);
+	tsf_voice_index_remove(f, i);
+	v->playingPreset = -1;
+	if (v->listPrev != -1) f->voices[v->listPrev].listNext = v->listNext;
+	else f->activeVoiceFirst = v->listNext;
+	if (v->listNext != -1) f->voices[v->listNext].listPrev = v->listPrev;
+	v->listNext = f->freeVoiceFirst;
+	f->freeVoiceFirst = i;
+	f->activeVoiceNum--;
+}
 
-	while (numSamples)
+static void tsf_voice_end(tsf* f, struct tsf_voice* v)
+{
+	struct tsf_voice_note* n = tsf_voice_note(f, v);
+	tsf_voice_envelope_nextsegment(&v->ampenv, &n->ampenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+	tsf_voice_envelope_nextsegment(&v->modenv, &n->modenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+	if (v->region->loop_mode == TSF_LOOPMODE_SUSTAIN)
 	{
-		float gainMono, gainLeft, gainRight;
-		int blockSamples = (numSamples > TSF_RENDER_EFFECTSAMPLEBLOCK ? TSF_RENDER_EFFECTSAMPLEBLOCK : numSamples);
-		numSamples -= blockSamples;
-
-		if (dynamicLowpass)
-		{
-			float fres = tmpInitialFilterFc + v->modlfo.level * tmpModLfoToFilterFc + v->modenv.level * tmpModEnvToFilterFc;
-			float lowpassFc = (fres <= 13500 ? tsf_cents2Hertz(fres) / tmpSampleRate : 1.0f);
-			tmpLowpass.active = (lowpassFc < 0.499f);
-			if (tmpLowpass.active) tsf_voice_lowpass_setup(&tmpLowpass, lowpassFc);
-		}
+		// Continue playing, but stop looping.
+		v->loopEnd = v->loopStart;
+	}
+}
 
-		if (dynamicPitchRatio)
-			pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents + (v->modlfo.level * tmpModLfoToPitch + v->viblfo.level * tmpVibLfoToPitch + v->modenv.level * tmpModEnvToPitch)) * v->pitchOutputFactor;
+static void tsf_voice_endquick(tsf* f, struct tsf_voice* v)
+{
+	struct tsf_voice_note* n = tsf_voice_note(f, v);
+	n->ampenv.release = 0.0f; tsf_voice_envelope_nextsegment(&v->ampenv, &n->ampenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+	n->modenv.release = 0.0f; tsf_voice_envelope_nextsegment(&v->modenv, &n->modenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+}
 
-		if (dynamicGain)
-			noteGain = tsf_decibelsToGain(v->noteGainDB + (v->modlfo.level * tmpModLfoToVolume));
+// Voice stealing picks the voice with the lowest priority, and among those the lowest score: its
+// current level in dB, lowered for voices in their release and for every note started after it
+#define TSF_STEAL_RELEASE_DB 24.0f
+#define TSF_STEAL_AGE_DB 1.0f
+#define TSF_STEAL_AGE_MAX 32
 
-		gainMono = noteGain * v->ampenv.level;
+// Fading voices were already stolen (or ended) with a release time of zero, they don't count as sounding
+static TSF_BOOL tsf_voice_isfading(tsf* f, int i)
+{
+	return (TSF_BOOL)(f->voices[i].ampenv.segment >= TSF_SEGMENT_RELEASE && f->voiceNotes[i].ampenv.release <= 0.0f);
+}
 
-		// Update EG.
-		tsf_voice_envelope_process(&v->ampenv, blockSamples, tmpSampleRate);
-		if (updateModEnv) tsf_voice_envelope_process(&v->modenv, blockSamples, tmpSampleRate);
+static int tsf_voice_priority(tsf* f, int i)
+{
+	int channel = f->voiceNotes[i].playingChannel;
+	return (f->channels && channel >= 0 && channel < f->channels->channelNum ? f->channels->channels[channel].priority : TSF_DEFAULTPRIORITY);
+}
 
-		// Update LFOs.
-		if (updateModLFO) tsf_voice_lfo_process(&v->modlfo, blockSamples);
-		if (updateVibLFO) tsf_voice_lfo_process(&v->viblfo, blockSamples);
+static float tsf_voice_steal_score(tsf* f, int i)
+{
+	struct tsf_voice* v = &f->voices[i];
+	unsigned int age = f->voicePlayIndex - f->voiceNotes[i].playIndex;
+	// Before the attack ends the envelope level doesn't tell how loud the voice gets
+	float score = v->noteGainDB + (v->ampenv.segment < TSF_SEGMENT_HOLD ? 0.0f : tsf_gainToDecibels(v->ampenv.level));
+	if (v->ampenv.segment >= TSF_SEGMENT_RELEASE) score -= TSF_STEAL_RELEASE_DB;
+	return score - TSF_STEAL_AGE_DB * (float)(age > TSF_STEAL_AGE_MAX ? TSF_STEAL_AGE_MAX : age);
+}
 
-		switch (f->outputmode)
+// Counts the sounding voices on channel (-1 = all voices) into sounding and returns the voice to
+// steal among them, or -1 if there is none with at most priority. Voices of the note being started
+// (play_index) count but aren't stolen.
+static int tsf_voice_steal_find(tsf* f, int channel, int priority, unsigned int play_index, int* sounding)
+{
+	int i, best = -1, bestPriority = 0;
+	float bestScore = 0.0f;
+	*sounding = 0;
+	for (i = (channel >= 0 ? *tsf_voice_channel_bucket(f, channel) : f->activeVoiceFirst); i != -1;
+		i = (channel >= 0 ? f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next : f->voices[i].listNext))
+	{
+		int voicePriority; float score;
+		if (channel >= 0 && f->voiceNotes[i].playingChannel != channel) continue;
+		if (tsf_voice_isfading(f, i)) continue;
+		(*sounding)++;
+		if (f->voiceNotes[i].playIndex == play_index) continue;
+		voicePriority = tsf_voice_priority(f, i);
+		if (voicePriority > priority) continue;
+		score = tsf_voice_steal_score(f, i);
+		if (best == -1 || voicePriority < bestPriority || (voicePriority == bestPriority && score < bestScore))
 		{
-			case TSF_STEREO_INTERLEAVED:
-				gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+			best = i;
+			bestPriority = voicePriority;
+			bestScore = score;
+		}
+	}
+	return best;
+}
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+// The fading voice furthest into its fade, to cut off when all reserve voices are in use
+static int tsf_voice_fading_quietest(tsf* f)
+{
+	int i, best = -1;
+	float bestLevel = 0.0f;
+	for (i = f->activeVoiceFirst; i != -1; i = f->voices[i].listNext)
+	{
+		if (!tsf_voice_isfading(f, i)) continue;
+		if (best == -1 || f->voices[i].ampenv.level < bestLevel)
+		{
+			best = i;
+			bestLevel = f->voices[i].ampenv.level;
+		}
+	}
+	return best;
+}
 
-					// Low-pass filter.
-					if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+static void tsf_voice_calcpitchratio(struct tsf_voice* v, int key, float pitchShift, float outSampleRate)
+{
+	double note = key + v->region->transpose + v->region->tune / 100.0;
+	double adjustedPitch = v->region->pitch_keycenter + (note - v->region->pitch_keycenter) * (v->region->pitch_keytrack / 100.0);
+	if (pitchShift) adjustedPitch += pitchShift;
+	v->pitchInputTimecents = adjustedPitch * 100.0;
+	v->pitchOutputFactor = v->region->sample_rate / (tsf_timecents2Secsd(v->region->pitch_keycenter * 100.0) * outSampleRate);
+}
 
-					*outL++ += val * gainLeft;
-					*outL++ += val * gainRight;
+// Voice render kernels
+// tsf_voice_render_lanes renders each effect block in three passes over a small buffer:
+// resampling the source by linear interpolation, the optional low-pass filter and
+// mixing into the output with the voice gains. All passes are done by one of the kernels
+// below. The low-pass filter is recursive so instead of vectorizing over samples the
+// filters of TSF_VOICE_LANES voices are run in lockstep, one voice per SIMD lane.
+struct tsf_voice_kernel
+{
+	const char* name;
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				break;
+	// Resample up to count samples into out, returns the number of samples written (less when the sample end is reached)
+	int (*resample)(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd);
 
-			case TSF_STEREO_UNWEAVED:
-				gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+	// Add count samples from in to the output buffer, scaled by the gains
+	void (*mix_interleaved)(float* out, const float* in, int count, float gainLeft, float gainRight);
+	void (*mix_unweaved)(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight);
+	void (*mix_mono)(float* out, const float* in, int count, float gain);
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+	// Run count samples of TSF_VOICE_LANES blocks through their low-pass filters
+	void (*lowpass_lanes)(struct tsf_voice_lowpass* const* lanes, float* const* blocks, int count);
+};
 
-					// Low-pass filter.
-					if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+// Single resampling step shared by all kernels, also used by the SIMD kernels around loop points
+#define TSF_RESAMPLE_STEP() \
+	{ \
+		unsigned int pos = (unsigned int)p, nextPos = (pos >= loopEnd && isLooping ? loopStart : pos + 1); \
+		float alpha = (float)(p - pos); \
+		out[n++] = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha); \
+		p += pitchRatio; \
+		if (p >= loopEndDbl && isLooping) p -= loopLength; \
+	}
 
-					*outL++ += val * gainLeft;
-					*outR++ += val * gainRight;
+// The SIMD kernels process a group of samples at once as long as the whole group lies before the loop end
+// (or sample end) so all lanes can read the next source sample without wrapping around to the loop start.
+#define TSF_RESAMPLE_SETUP() \
+	int n = 0; \
+	double p = *position, loopEndDbl = (double)loopEnd + 1.0, loopLength = (loopEnd - loopStart + 1.0); \
+	double groupLimit = (isLooping && (double)loopEnd < sampleEnd ? (double)loopEnd : sampleEnd);
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				break;
+static int tsf_kernel_resample_scalar(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	TSF_RESAMPLE_SETUP()
+	(void)groupLimit;
+	while (n < count && p < sampleEnd) TSF_RESAMPLE_STEP()
+	*position = p;
+	return n;
+}
 
-			case TSF_MONO:
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+static void tsf_kernel_mix_interleaved_scalar(float* out, const float* in, int count, float gainLeft, float gainRight)
+{
+	for (; count--; in++) { *out++ += *in * gainLeft; *out++ += *in * gainRight; }
+}
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+static void tsf_kernel_mix_unweaved_scalar(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight)
+{
+	for (; count--; in++) { *outL++ += *in * gainLeft; *outR++ += *in * gainRight; }
+}
 
-					// Low-pass filter.
-					if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+static void tsf_kernel_mix_mono_scalar(float* out, const float* in, int count, float gain)
+{
+	while (count--) *out++ += *in++ * gain;
+}
 
-					*outL++ += val * gainMono;
+static void tsf_kernel_lowpass_lanes_scalar(struct tsf_voice_lowpass* const* lanes, float* const* blocks, int count)
+{
+	// Interleaving the independent filters lets the CPU overlap their dependency chains
+	struct tsf_voice_lowpass tmp[TSF_VOICE_LANES];
+	int i, n;
+	for (i = 0; i != TSF_VOICE_LANES; i++) tmp[i] = *lanes[i];
+	for (n = 0; n != count; n++)
+		for (i = 0; i != TSF_VOICE_LANES; i++)
+			blocks[i][n] = tsf_voice_lowpass_process(&tmp[i], blocks[i][n]);
+	for (i = 0; i != TSF_VOICE_LANES; i++) lanes[i]->ic1 = tmp[i].ic1, lanes[i]->ic2 = tmp[i].ic2;
+}
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				break;
-		}
+static const struct tsf_voice_kernel tsf_kernel_scalar = { "scalar", tsf_kernel_resample_scalar, tsf_kernel_mix_interleaved_scalar, tsf_kernel_mix_unweaved_scalar, tsf_kernel_mix_mono_scalar, tsf_kernel_lowpass_lanes_scalar };
 
-		if (tmpSourceSamplePosition >= tmpSampleEndDbl || v->ampenv.segment == TSF_SEGMENT_DONE)
+#ifdef TSF_SIMD_SSE2
+static int tsf_kernel_resample_sse2(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	TSF_RESAMPLE_SETUP()
+	const __m128d step01 = _mm_set_pd(pitchRatio, 0.0), step23 = _mm_set_pd(pitchRatio * 3.0, pitchRatio * 2.0);
+	const __m128 one = _mm_set1_ps(1.0f);
+	while (n < count && p < sampleEnd)
+	{
+		for (; n + 4 <= count && p + pitchRatio * 3.0 < groupLimit; n += 4, p += pitchRatio * 4.0)
 		{
-			tsf_voice_kill(v);
-			return;
+			__m128d p01 = _mm_add_pd(_mm_set1_pd(p), step01), p23 = _mm_add_pd(_mm_set1_pd(p), step23);
+			__m128i i01 = _mm_cvttpd_epi32(p01), i23 = _mm_cvttpd_epi32(p23);
+			__m128 alpha = _mm_movelh_ps(_mm_cvtpd_ps(_mm_sub_pd(p01, _mm_cvtepi32_pd(i01))), _mm_cvtpd_ps(_mm_sub_pd(p23, _mm_cvtepi32_pd(i23))));
+			unsigned int i0 = (unsigned int)_mm_cvtsi128_si32(i01), i1 = (unsigned int)_mm_cvtsi128_si32(_mm_shuffle_epi32(i01, 1));
+			unsigned int i2 = (unsigned int)_mm_cvtsi128_si32(i23), i3 = (unsigned int)_mm_cvtsi128_si32(_mm_shuffle_epi32(i23, 1));
+			__m128 a = _mm_set_ps(input[i3], input[i2], input[i1], input[i0]), b = _mm_set_ps(input[i3 + 1], input[i2 + 1], input[i1 + 1], input[i0 + 1]);
+			_mm_storeu_ps(out + n, _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(one, alpha)), _mm_mul_ps(b, alpha)));
 		}
+		if (p >= loopEndDbl && isLooping) p -= loopLength;
+		if (n < count && p < sampleEnd) TSF_RESAMPLE_STEP()
 	}
-
-	v->sourceSamplePosition = tmpSourceSamplePosition;
-	if (tmpLowpass.active || dynamicLowpass) v->lowpass = tmpLowpass;
+	*position = p;
+	return n;
 }
 
-TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+static void tsf_kernel_mix_interleaved_sse2(float* out, const float* in, int count, float gainLeft, float gainRight)
 {
-	tsf* res = TSF_NULL;
-	struct tsf_riffchunk chunkHead;
-	struct tsf_riffchunk chunkList;
-	struct tsf_hydra hydra;
-	void* rawBuffer = TSF_NULL;
-	float* floatBuffer = TSF_NULL;
-	tsf_u32 smplCount = 0;
+	const __m128 gl = _mm_set1_ps(gainLeft), gr = _mm_set1_ps(gainRight);
+	for (; count >= 4; count -= 4, in += 4, out += 8)
+	{
+		__m128 v = _mm_loadu_ps(in), l = _mm_mul_ps(v, gl), r = _mm_mul_ps(v, gr);
+		_mm_storeu_ps(out,     _mm_add_ps(_mm_loadu_ps(out),     _mm_unpacklo_ps(l, r)));
+		_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_unpackhi_ps(l, r)));
+	}
+	tsf_kernel_mix_interleaved_scalar(out, in, count, gainLeft, gainRight);
+}
 
-	if (!tsf_riffchunk_read(TSF_NULL, &chunkHead, stream) || !TSF_FourCCEquals(chunkHead.id, "sfbk"))
+static void tsf_kernel_mix_unweaved_sse2(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight)
+{
+	const __m128 gl = _mm_set1_ps(gainLeft), gr = _mm_set1_ps(gainRight);
+	for (; count >= 4; count -= 4, in += 4, outL += 4, outR += 4)
 	{
-		//if (e) *e = TSF_INVALID_NOSF2HEADER;
-		return res;
+		__m128 v = _mm_loadu_ps(in);
+		_mm_storeu_ps(outL, _mm_add_ps(_mm_loadu_ps(outL), _mm_mul_ps(v, gl)));
+		_mm_storeu_ps(outR, _mm_add_ps(_mm_loadu_ps(outR), _mm_mul_ps(v, gr)));
 	}
+	tsf_kernel_mix_unweaved_scalar(outL, outR, in, count, gainLeft, gainRight);
+}
 
-	// Read hydra and locate sample data.
-	TSF_MEMSET(&hydra, 0, sizeof(hydra));
-	while (tsf_riffchunk_read(&chunkHead, &chunkList, stream))
+static void tsf_kernel_mix_mono_sse2(float* out, const float* in, int count, float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	for (; count >= 4; count -= 4, in += 4, out += 4)
+		_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_loadu_ps(in), g)));
+	tsf_kernel_mix_mono_scalar(out, in, count, gain);
+}
+
+// Four samples of each lane are transposed so every step filters one sample of all four lanes,
+// the remaining samples (count not a multiple of 4) are filtered lane by lane with the scalar code.
+static void tsf_kernel_lowpass_lanes_sse2(struct tsf_voice_lowpass* const* lanes, float* const* blocks, int count)
+{
+	struct tsf_voice_lowpass *e0 = lanes[0], *e1 = lanes[1], *e2 = lanes[2], *e3 = lanes[3];
+	float *b0 = blocks[0], *b1 = blocks[1], *b2 = blocks[2], *b3 = blocks[3];
+	const __m128 a1 = _mm_set_ps(e3->a1, e2->a1, e1->a1, e0->a1), a2 = _mm_set_ps(e3->a2, e2->a2, e1->a2, e0->a2), a3 = _mm_set_ps(e3->a3, e2->a3, e1->a3, e0->a3);
+	__m128 ic1 = _mm_set_ps(e3->ic1, e2->ic1, e1->ic1, e0->ic1), ic2 = _mm_set_ps(e3->ic2, e2->ic2, e1->ic2, e0->ic2), r[4];
+	float tmp[4];
+	int n, k, i;
+	for (n = 0; n + 4 <= count; n += 4)
 	{
-		struct tsf_riffchunk chunk;
-		if (TSF_FourCCEquals(chunkList.id, "pdta"))
+		r[0] = _mm_loadu_ps(b0 + n); r[1] = _mm_loadu_ps(b1 + n); r[2] = _mm_loadu_ps(b2 + n); r[3] = _mm_loadu_ps(b3 + n);
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (k = 0; k != 4; k++)
 		{
-			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
-			{
-				#define HandleChunk(chunkName) (TSF_FourCCEquals(chunk.id, #chunkName) && !(chunk.size % chunkName##SizeInFile)) \
-					{ \
-						int num = chunk.size / chunkName##SizeInFile, i; \
-						hydra.chunkName##Num = num; \
-						hydra.chunkName##s = (struct tsf_hydra_##chunkName*)TSF_MALLOC(num * sizeof(struct tsf_hydra_##chunkName)); \
-						if (!hydra.chunkName##s) goto out_of_memory; \
-						for (i = 0; i < num; ++i) tsf_hydra_read_##chunkName(&hydra.chunkName##s[i], stream); \
-					}
-				enum
-				{
-					phdrSizeInFile = 38, pbagSizeInFile =  4, pmodSizeInFile = 10,
-					pgenSizeInFile =  4, instSizeInFile = 22, ibagSizeInFile =  4,
-					imodSizeInFile = 10, igenSizeInFile =  4, shdrSizeInFile = 46
-				};
-				if      HandleChunk(phdr) else if HandleChunk(pbag) else if HandleChunk(pmod)
-				else if HandleChunk(pgen) else if HandleChunk(inst) else if HandleChunk(ibag)
-				else if HandleChunk(imod) else if HandleChunk(igen) else if HandleChunk(shdr)
-				else stream->skip(stream->data, chunk.size);
-				#undef HandleChunk
-			}
+			__m128 v3 = _mm_sub_ps(r[k], ic2), v1 = _mm_add_ps(_mm_mul_ps(a1, ic1), _mm_mul_ps(a2, v3));
+			__m128 v2 = _mm_add_ps(_mm_add_ps(ic2, _mm_mul_ps(a2, ic1)), _mm_mul_ps(a3, v3));
+			ic1 = _mm_sub_ps(_mm_add_ps(v1, v1), ic1);
+			ic2 = _mm_sub_ps(_mm_add_ps(v2, v2), ic2);
+			r[k] = v2;
 		}
-		else if (TSF_FourCCEquals(chunkList.id, "sdta"))
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		_mm_storeu_ps(b0 + n, r[0]); _mm_storeu_ps(b1 + n, r[1]); _mm_storeu_ps(b2 + n, r[2]); _mm_storeu_ps(b3 + n, r[3]);
+	}
+	_mm_storeu_ps(tmp, ic1); for (i = 0; i != 4; i++) lanes[i]->ic1 = tmp[i];
+	_mm_storeu_ps(tmp, ic2); for (i = 0; i != 4; i++) lanes[i]->ic2 = tmp[i];
+	if (n != count) for (i = 0; i != 4; i++) tsf_voice_lowpass_process_block(lanes[i], blocks[i] + n, count - n);
+}
+
+static const struct tsf_voice_kernel tsf_kernel_sse2 = { "sse2", tsf_kernel_resample_sse2, tsf_kernel_mix_interleaved_sse2, tsf_kernel_mix_unweaved_sse2, tsf_kernel_mix_mono_sse2, tsf_kernel_lowpass_lanes_sse2 };
+#endif
+
+#ifdef TSF_SIMD_AVX2
+TSF_TARGET_AVX2 static int tsf_kernel_resample_avx2(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	TSF_RESAMPLE_SETUP()
+	const __m256d stepLo = _mm256_set_pd(pitchRatio * 3.0, pitchRatio * 2.0, pitchRatio, 0.0), stepHi = _mm256_add_pd(stepLo, _mm256_set1_pd(pitchRatio * 4.0));
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i next = _mm256_set1_epi32(1);
+	while (n < count && p < sampleEnd)
+	{
+		for (; n + 8 <= count && p + pitchRatio * 7.0 < groupLimit; n += 8, p += pitchRatio * 8.0)
 		{
-			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
-			{
-				if ((TSF_FourCCEquals(chunk.id, "smpl")
-						#ifdef STB_VORBIS_INCLUDE_STB_VORBIS_H
-						|| TSF_FourCCEquals(chunk.id, "smpo")
-						#endif
-					) && !rawBuffer && !floatBuffer && chunk.size >= sizeof(short))
-				{
-					if (!tsf_load_samples(&rawBuffer, &floatBuffer, &smplCount, &chunk, stream)) goto out_of_memory;
-				}
-				else stream->skip(stream->data, chunk.size);
-			}
+			__m256d pLo = _mm256_add_pd(_mm256_set1_pd(p), stepLo), pHi = _mm256_add_pd(_mm256_set1_pd(p), stepHi);
+			__m128i iLo = _mm256_cvttpd_epi32(pLo), iHi = _mm256_cvttpd_epi32(pHi);
+			__m256 alpha = _mm256_set_m128(_mm256_cvtpd_ps(_mm256_sub_pd(pHi, _mm256_cvtepi32_pd(iHi))), _mm256_cvtpd_ps(_mm256_sub_pd(pLo, _mm256_cvtepi32_pd(iLo))));
+			__m256i idx = _mm256_set_m128i(iHi, iLo);
+			__m256 a = _mm256_i32gather_ps(input, idx, 4), b = _mm256_i32gather_ps(input, _mm256_add_epi32(idx, next), 4);
+			_mm256_storeu_ps(out + n, _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(one, alpha)), _mm256_mul_ps(b, alpha)));
 		}
-		else stream->skip(stream->data, chunkList.size);
+		if (p >= loopEndDbl && isLooping) p -= loopLength;
+		if (n < count && p < sampleEnd) TSF_RESAMPLE_STEP()
 	}
-	if (!hydra.phdrs || !hydra.pbags || !hydra.pmods || !hydra.pgens || !hydra.insts || !hydra.ibags || !hydra.imods || !hydra.igens || !hydra.shdrs)
+	*position = p;
+	return n;
+}
+
+TSF_TARGET_AVX2 static void tsf_kernel_mix_interleaved_avx2(float* out, const float* in, int count, float gainLeft, float gainRight)
+{
+	const __m256 gl = _mm256_set1_ps(gainLeft), gr = _mm256_set1_ps(gainRight);
+	for (; count >= 8; count -= 8, in += 8, out += 16)
 	{
-		//if (e) *e = TSF_INVALID_INCOMPLETE;
+		__m256 v = _mm256_loadu_ps(in), l = _mm256_mul_ps(v, gl), r = _mm256_mul_ps(v, gr);
+		__m256 lo = _mm256_unpacklo_ps(l, r), hi = _mm256_unpackhi_ps(l, r);
+		_mm256_storeu_ps(out,     _mm256_add_ps(_mm256_loadu_ps(out),     _mm256_permute2f128_ps(lo, hi, 0x20)));
+		_mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_loadu_ps(out + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
 	}
-	else if (!rawBuffer && !floatBuffer)
+	tsf_kernel_mix_interleaved_scalar(out, in, count, gainLeft, gainRight);
+}
+
+TSF_TARGET_AVX2 static void tsf_kernel_mix_unweaved_avx2(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight)
+{
+	const __m256 gl = _mm256_set1_ps(gainLeft), gr = _mm256_set1_ps(gainRight);
+	for (; count >= 8; count -= 8, in += 8, outL += 8, outR += 8)
 	{
-		//if (e) *e = TSF_INVALID_NOSAMPLEDATA;
+		__m256 v = _mm256_loadu_ps(in);
+		_mm256_storeu_ps(outL, _mm256_add_ps(_mm256_loadu_ps(outL), _mm256_mul_ps(v, gl)));
+		_mm256_storeu_ps(outR, _mm256_add_ps(_mm256_loadu_ps(outR), _mm256_mul_ps(v, gr)));
 	}
-	else
-	{
-		#ifdef STB_VORBIS_INCLUDE_STB_VORBIS_H
-		if (!floatBuffer && !tsf_decode_sf3_samples(rawBuffer, &floatBuffer, &smplCount, &hydra)) goto out_of_memory;
-		#endif
-		res = (tsf*)TSF_MALLOC(sizeof(tsf));
-		if (res) TSF_MEMSET(res, 0, sizeof(tsf));
+	tsf_kernel_mix_unweaved_scalar(outL, outR, in, count, gainLeft, gainRight);
+}
+
+TSF_TARGET_AVX2 static void tsf_kernel_mix_mono_avx2(float* out, const float* in, int count, float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	for (; count >= 8; count -= 8, in += 8, out += 8)
+		_mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out), _mm256_mul_ps(_mm256_loadu_ps(in), g)));
+	tsf_kernel_mix_mono_scalar(out, in, count, gain);
+}
+
+static const struct tsf_voice_kernel tsf_kernel_avx2 = { "avx2", tsf_kernel_resample_avx2, tsf_kernel_mix_interleaved_avx2, tsf_kernel_mix_unweaved_avx2, tsf_kernel_mix_mono_avx2, tsf_kernel_lowpass_lanes_sse2 };
+
+static TSF_BOOL tsf_cpu_has_avx2(void)
+{
+	#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return TSF_FALSE;
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return TSF_FALSE; // OSXSAVE and AVX
+	if ((_xgetbv(0) & 6) != 6) return TSF_FALSE; // OS saves the YMM registers
+	__cpuidex(info, 7, 0);
+	return (TSF_BOOL)((info[1] & (1 << 5)) != 0);
+	#else
+	__builtin_cpu_init();
+	return (TSF_BOOL)(__builtin_cpu_supports("avx2") != 0);
+	#endif
+}
+#endif
+
+#ifdef TSF_SIMD_NEON
+static int tsf_kernel_resample_neon(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	TSF_RESAMPLE_SETUP()
+	const double steps[4] = { 0.0, pitchRatio, pitchRatio * 2.0, pitchRatio * 3.0 };
+	const float64x2_t step01 = vld1q_f64(steps), step23 = vld1q_f64(steps + 2);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	float ab[8];
+	while (n < count && p < sampleEnd)
+	{
+		for (; n + 4 <= count && p + pitchRatio * 3.0 < groupLimit; n += 4, p += pitchRatio * 4.0)
+		{
+			float64x2_t p01 = vaddq_f64(vdupq_n_f64(p), step01), p23 = vaddq_f64(vdupq_n_f64(p), step23);
+			float64x2_t f01 = vrndq_f64(p01), f23 = vrndq_f64(p23);
+			float32x4_t alpha = vcombine_f32(vcvt_f32_f64(vsubq_f64(p01, f01)), vcvt_f32_f64(vsubq_f64(p23, f23)));
+			unsigned int i0 = (unsigned int)vgetq_lane_f64(f01, 0), i1 = (unsigned int)vgetq_lane_f64(f01, 1);
+			unsigned int i2 = (unsigned int)vgetq_lane_f64(f23, 0), i3 = (unsigned int)vgetq_lane_f64(f23, 1);
+			float32x4_t a, b;
+			ab[0] = input[i0]; ab[1] = input[i1]; ab[2] = input[i2]; ab[3] = input[i3];
+			ab[4] = input[i0 + 1]; ab[5] = input[i1 + 1]; ab[6] = input[i2 + 1]; ab[7] = input[i3 + 1];
+			a = vld1q_f32(ab), b = vld1q_f32(ab + 4);
+			vst1q_f32(out + n, vaddq_f32(vmulq_f32(a, vsubq_f32(one, alpha)), vmulq_f32(b, alpha)));
+		}
+		if (p >= loopEndDbl && isLooping) p -= loopLength;
+		if (n < count && p < sampleEnd) TSF_RESAMPLE_STEP()
+	}
+	*position = p;
+	return n;
+}
+
+static void tsf_kernel_mix_interleaved_neon(float* out, const float* in, int count, float gainLeft, float gainRight)
+{
+	for (; count >= 4; count -= 4, in += 4, out += 8)
+	{
+		float32x4_t v = vld1q_f32(in);
+		float32x4x2_t lr = vld2q_f32(out);
+		lr.val[0] = vaddq_f32(lr.val[0], vmulq_n_f32(v, gainLeft));
+		lr.val[1] = vaddq_f32(lr.val[1], vmulq_n_f32(v, gainRight));
+		vst2q_f32(out, lr);
+	}
+	tsf_kernel_mix_interleaved_scalar(out, in, count, gainLeft, gainRight);
+}
+
+static void tsf_kernel_mix_unweaved_neon(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight)
+{
+	for (; count >= 4; count -= 4, in += 4, outL += 4, outR += 4)
+	{
+		float32x4_t v = vld1q_f32(in);
+		vst1q_f32(outL, vaddq_f32(vld1q_f32(outL), vmulq_n_f32(v, gainLeft)));
+		vst1q_f32(outR, vaddq_f32(vld1q_f32(outR), vmulq_n_f32(v, gainRight)));
+	}
+	tsf_kernel_mix_unweaved_scalar(outL, outR, in, count, gainLeft, gainRight);
+}
+
+static void tsf_kernel_mix_mono_neon(float* out, const float* in, int count, float gain)
+{
+	for (; count >= 4; count -= 4, in += 4, out += 4)
+		vst1q_f32(out, vaddq_f32(vld1q_f32(out), vmulq_n_f32(vld1q_f32(in), gain)));
+	tsf_kernel_mix_mono_scalar(out, in, count, gain);
+}
+
+static void tsf_kernel_transpose4_neon(float32x4_t* r)
+{
+	float32x4x2_t t01 = vtrnq_f32(r[0], r[1]), t23 = vtrnq_f32(r[2], r[3]);
+	r[0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+	r[1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+	r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+	r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+static float32x4_t tsf_kernel_make4_neon(float x0, float x1, float x2, float x3)
+{
+	float v[4];
+	v[0] = x0; v[1] = x1; v[2] = x2; v[3] = x3;
+	return vld1q_f32(v);
+}
+
+static void tsf_kernel_lowpass_lanes_neon(struct tsf_voice_lowpass* const* lanes, float* const* blocks, int count)
+{
+	struct tsf_voice_lowpass *e0 = lanes[0], *e1 = lanes[1], *e2 = lanes[2], *e3 = lanes[3];
+	const float32x4_t a1 = tsf_kernel_make4_neon(e0->a1, e1->a1, e2->a1, e3->a1), a2 = tsf_kernel_make4_neon(e0->a2, e1->a2, e2->a2, e3->a2), a3 = tsf_kernel_make4_neon(e0->a3, e1->a3, e2->a3, e3->a3);
+	float32x4_t ic1 = tsf_kernel_make4_neon(e0->ic1, e1->ic1, e2->ic1, e3->ic1), ic2 = tsf_kernel_make4_neon(e0->ic2, e1->ic2, e2->ic2, e3->ic2), r[4];
+	float tmp[4];
+	int n, k, i;
+	for (n = 0; n + 4 <= count; n += 4)
+	{
+		for (i = 0; i != 4; i++) r[i] = vld1q_f32(blocks[i] + n);
+		tsf_kernel_transpose4_neon(r);
+		for (k = 0; k != 4; k++)
+		{
+			float32x4_t v3 = vsubq_f32(r[k], ic2), v1 = vaddq_f32(vmulq_f32(a1, ic1), vmulq_f32(a2, v3));
+			float32x4_t v2 = vaddq_f32(vaddq_f32(ic2, vmulq_f32(a2, ic1)), vmulq_f32(a3, v3));
+			ic1 = vsubq_f32(vaddq_f32(v1, v1), ic1);
+			ic2 = vsubq_f32(vaddq_f32(v2, v2), ic2);
+			r[k] = v2;
+		}
+		tsf_kernel_transpose4_neon(r);
+		for (i = 0; i != 4; i++) vst1q_f32(blocks[i] + n, r[i]);
+	}
+	vst1q_f32(tmp, ic1); for (i = 0; i != 4; i++) lanes[i]->ic1 = tmp[i];
+	vst1q_f32(tmp, ic2); for (i = 0; i != 4; i++) lanes[i]->ic2 = tmp[i];
+	if (n != count) for (i = 0; i != 4; i++) tsf_voice_lowpass_process_block(lanes[i], blocks[i] + n, count - n);
+}
+
+static const struct tsf_voice_kernel tsf_kernel_neon = { "neon", tsf_kernel_resample_neon, tsf_kernel_mix_interleaved_neon, tsf_kernel_mix_unweaved_neon, tsf_kernel_mix_mono_neon, tsf_kernel_lowpass_lanes_neon };
+#endif
+
+#ifdef TSF_SIMD_WASM
+static int tsf_kernel_resample_wasm(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	TSF_RESAMPLE_SETUP()
+	const v128_t step01 = wasm_f64x2_make(0.0, pitchRatio), step23 = wasm_f64x2_make(pitchRatio * 2.0, pitchRatio * 3.0);
+	const v128_t one = wasm_f32x4_splat(1.0f);
+	while (n < count && p < sampleEnd)
+	{
+		for (; n + 4 <= count && p + pitchRatio * 3.0 < groupLimit; n += 4, p += pitchRatio * 4.0)
+		{
+			v128_t p01 = wasm_f64x2_add(wasm_f64x2_splat(p), step01), p23 = wasm_f64x2_add(wasm_f64x2_splat(p), step23);
+			v128_t f01 = wasm_f64x2_trunc(p01), f23 = wasm_f64x2_trunc(p23);
+			v128_t alpha = wasm_i32x4_shuffle(wasm_f32x4_demote_f64x2_zero(wasm_f64x2_sub(p01, f01)), wasm_f32x4_demote_f64x2_zero(wasm_f64x2_sub(p23, f23)), 0, 1, 4, 5);
+			unsigned int i0 = (unsigned int)wasm_f64x2_extract_lane(f01, 0), i1 = (unsigned int)wasm_f64x2_extract_lane(f01, 1);
+			unsigned int i2 = (unsigned int)wasm_f64x2_extract_lane(f23, 0), i3 = (unsigned int)wasm_f64x2_extract_lane(f23, 1);
+			v128_t a = wasm_f32x4_make(input[i0], input[i1], input[i2], input[i3]), b = wasm_f32x4_make(input[i0 + 1], input[i1 + 1], input[i2 + 1], input[i3 + 1]);
+			wasm_v128_store(out + n, wasm_f32x4_add(wasm_f32x4_mul(a, wasm_f32x4_sub(one, alpha)), wasm_f32x4_mul(b, alpha)));
+		}
+		if (p >= loopEndDbl && isLooping) p -= loopLength;
+		if (n < count && p < sampleEnd) TSF_RESAMPLE_STEP()
+	}
+	*position = p;
+	return n;
+}
+
+static void tsf_kernel_mix_interleaved_wasm(float* out, const float* in, int count, float gainLeft, float gainRight)
+{
+	const v128_t gl = wasm_f32x4_splat(gainLeft), gr = wasm_f32x4_splat(gainRight);
+	for (; count >= 4; count -= 4, in += 4, out += 8)
+	{
+		v128_t v = wasm_v128_load(in), l = wasm_f32x4_mul(v, gl), r = wasm_f32x4_mul(v, gr);
+		wasm_v128_store(out,     wasm_f32x4_add(wasm_v128_load(out),     wasm_i32x4_shuffle(l, r, 0, 4, 1, 5)));
+		wasm_v128_store(out + 4, wasm_f32x4_add(wasm_v128_load(out + 4), wasm_i32x4_shuffle(l, r, 2, 6, 3, 7)));
+	}
+	tsf_kernel_mix_interleaved_scalar(out, in, count, gainLeft, gainRight);
+}
+
+static void tsf_kernel_mix_unweaved_wasm(float* outL, float* outR, const float* in, int count, float gainLeft, float gainRight)
+{
+	const v128_t gl = wasm_f32x4_splat(gainLeft), gr = wasm_f32x4_splat(gainRight);
+	for (; count >= 4; count -= 4, in += 4, outL += 4, outR += 4)
+	{
+		v128_t v = wasm_v128_load(in);
+		wasm_v128_store(outL, wasm_f32x4_add(wasm_v128_load(outL), wasm_f32x4_mul(v, gl)));
+		wasm_v128_store(outR, wasm_f32x4_add(wasm_v128_load(outR), wasm_f32x4_mul(v, gr)));
+	}
+	tsf_kernel_mix_unweaved_scalar(outL, outR, in, count, gainLeft, gainRight);
+}
+
+static void tsf_kernel_mix_mono_wasm(float* out, const float* in, int count, float gain)
+{
+	const v128_t g = wasm_f32x4_splat(gain);
+	for (; count >= 4; count -= 4, in += 4, out += 4)
+		wasm_v128_store(out, wasm_f32x4_add(wasm_v128_load(out), wasm_f32x4_mul(wasm_v128_load(in), g)));
+	tsf_kernel_mix_mono_scalar(out, in, count, gain);
+}
+
+static void tsf_kernel_transpose4_wasm(v128_t* r)
+{
+	v128_t t0 = wasm_i32x4_shuffle(r[0], r[1], 0, 4, 1, 5), t1 = wasm_i32x4_shuffle(r[0], r[1], 2, 6, 3, 7);
+	v128_t t2 = wasm_i32x4_shuffle(r[2], r[3], 0, 4, 1, 5), t3 = wasm_i32x4_shuffle(r[2], r[3], 2, 6, 3, 7);
+	r[0] = wasm_i32x4_shuffle(t0, t2, 0, 1, 4, 5);
+	r[1] = wasm_i32x4_shuffle(t0, t2, 2, 3, 6, 7);
+	r[2] = wasm_i32x4_shuffle(t1, t3, 0, 1, 4, 5);
+	r[3] = wasm_i32x4_shuffle(t1, t3, 2, 3, 6, 7);
+}
+
+static void tsf_kernel_lowpass_lanes_wasm(struct tsf_voice_lowpass* const* lanes, float* const* blocks, int count)
+{
+	struct tsf_voice_lowpass *e0 = lanes[0], *e1 = lanes[1], *e2 = lanes[2], *e3 = lanes[3];
+	const v128_t a1 = wasm_f32x4_make(e0->a1, e1->a1, e2->a1, e3->a1), a2 = wasm_f32x4_make(e0->a2, e1->a2, e2->a2, e3->a2), a3 = wasm_f32x4_make(e0->a3, e1->a3, e2->a3, e3->a3);
+	v128_t ic1 = wasm_f32x4_make(e0->ic1, e1->ic1, e2->ic1, e3->ic1), ic2 = wasm_f32x4_make(e0->ic2, e1->ic2, e2->ic2, e3->ic2), r[4];
+	int n, k, i;
+	for (n = 0; n + 4 <= count; n += 4)
+	{
+		for (i = 0; i != 4; i++) r[i] = wasm_v128_load(blocks[i] + n);
+		tsf_kernel_transpose4_wasm(r);
+		for (k = 0; k != 4; k++)
+		{
+			v128_t v3 = wasm_f32x4_sub(r[k], ic2), v1 = wasm_f32x4_add(wasm_f32x4_mul(a1, ic1), wasm_f32x4_mul(a2, v3));
+			v128_t v2 = wasm_f32x4_add(wasm_f32x4_add(ic2, wasm_f32x4_mul(a2, ic1)), wasm_f32x4_mul(a3, v3));
+			ic1 = wasm_f32x4_sub(wasm_f32x4_add(v1, v1), ic1);
+			ic2 = wasm_f32x4_sub(wasm_f32x4_add(v2, v2), ic2);
+			r[k] = v2;
+		}
+		tsf_kernel_transpose4_wasm(r);
+		for (i = 0; i != 4; i++) wasm_v128_store(blocks[i] + n, r[i]);
+	}
+	e0->ic1 = wasm_f32x4_extract_lane(ic1, 0); e1->ic1 = wasm_f32x4_extract_lane(ic1, 1); e2->ic1 = wasm_f32x4_extract_lane(ic1, 2); e3->ic1 = wasm_f32x4_extract_lane(ic1, 3);
+	e0->ic2 = wasm_f32x4_extract_lane(ic2, 0); e1->ic2 = wasm_f32x4_extract_lane(ic2, 1); e2->ic2 = wasm_f32x4_extract_lane(ic2, 2); e3->ic2 = wasm_f32x4_extract_lane(ic2, 3);
+	if (n != count) for (i = 0; i != 4; i++) tsf_voice_lowpass_process_block(lanes[i], blocks[i] + n, count - n);
+}
+
+static const struct tsf_voice_kernel tsf_kernel_wasm = { "simd128", tsf_kernel_resample_wasm, tsf_kernel_mix_interleaved_wasm, tsf_kernel_mix_unweaved_wasm, tsf_kernel_mix_mono_wasm, tsf_kernel_lowpass_lanes_wasm };
+#endif
+
+#undef TSF_RESAMPLE_SETUP
+#undef TSF_RESAMPLE_STEP
+
+// Resampling without interpolation for TSF_QUALITY_NEAREST, the same for all kernels
+// Between loop points the position steps in 32.32 fixed point, which is cheaper than the
+// interpolation of the SIMD kernels. Past the loop end the nearest sample is the loop start.
+static int tsf_voice_resample_nearest(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	int n = 0, run;
+	double p = *position, loopEndDbl = (double)loopEnd + 1.0, loopLength = (loopEnd - loopStart + 1.0);
+	double runLimit = (isLooping && loopEndDbl - 0.5 < sampleEnd ? loopEndDbl - 0.5 : sampleEnd);
+	while (n < count && p < sampleEnd)
+	{
+		if (p < runLimit)
+		{
+			// All positions of the run round to a sample before the loop wraps
+			unsigned long long fixedPos = (unsigned long long)((p + 0.5) * 4294967296.0), fixedStep = (unsigned long long)(pitchRatio * 4294967296.0);
+			run = (int)((runLimit - p) / pitchRatio);
+			if (run > count - n) run = count - n;
+			if (run < 1) run = 1;
+			p += pitchRatio * run;
+			for (run += n; n != run; fixedPos += fixedStep) out[n++] = input[fixedPos >> 32];
+		}
+		else
+		{
+			unsigned int pos = (unsigned int)(p + 0.5);
+			out[n++] = input[(pos > loopEnd && isLooping ? loopStart : pos)];
+			p += pitchRatio;
+		}
+		if (p >= loopEndDbl && isLooping) p -= loopLength;
+	}
+	*position = p;
+	return n;
+}
+
+static const struct tsf_voice_kernel* tsf_voice_kernel_select(TSF_BOOL allowSIMD)
+{
+	if (!allowSIMD) return &tsf_kernel_scalar;
+	#ifdef TSF_SIMD_AVX2
+	if (tsf_cpu_has_avx2()) return &tsf_kernel_avx2;
+	#endif
+	#if defined(TSF_SIMD_SSE2)
+	return &tsf_kernel_sse2;
+	#elif defined(TSF_SIMD_NEON)
+	return &tsf_kernel_neon;
+	#elif defined(TSF_SIMD_WASM)
+	return &tsf_kernel_wasm;
+	#else
+	return &tsf_kernel_scalar;
+	#endif
+}
+
+// Pitch ratio of a voice with pitch modulated by the given LFO states and its modulation envelope
+static double tsf_voice_pitchratio(tsf* f, const struct tsf_voice* v, const struct tsf_voice_lfo* modlfo, const struct tsf_voice_lfo* viblfo)
+{
+	const struct tsf_region* region = v->region;
+	return tsf_render_timecents2Secsd(f->fastMath, v->pitchInputTimecents + (modlfo->level * (float)region->modLfoToPitch + viblfo->level * (float)region->vibLfoToPitch + v->modenv.level * (float)region->modEnvToPitch)) * v->pitchOutputFactor;
+}
+
+// Set up the low-pass filter of a voice for a cutoff modulated by the given LFO state and its modulation envelope
+static void tsf_voice_lowpass_update(tsf* f, struct tsf_voice* v, const struct tsf_voice_lfo* modlfo)
+{
+	const struct tsf_region* region = v->region;
+	float fres = (float)region->initialFilterFc + modlfo->level * (float)region->modLfoToFilterFc + v->modenv.level * (float)region->modEnvToFilterFc;
+	float lowpassFc = (fres <= 13500 ? tsf_render_cents2Hertz(f->fastMath, fres) / f->outSampleRate : 1.0f);
+	v->lowpass.active = (lowpassFc < 0.499f);
+	if (v->lowpass.active) tsf_voice_lowpass_setup(&v->lowpass, lowpassFc);
+}
+
+// Per voice state of tsf_voice_render_lanes, set up once per render call
+struct tsf_voice_render_state
+{
+	struct tsf_voice* v;
+	const struct tsf_voice_note* note;
+	TSF_BOOL updateModEnv, updateModLFO, updateVibLFO, isLooping, dynamicLowpass, dynamicPitchRatio, dynamicGain, filter, isVirtual;
+	TSF_BOOL cached; // cached: input is already filtered, it was read from the one-shot cache
+	const float* input; // samples of the block to mix
+	double pitchRatio;
+	float noteGain, gainMono, virtualGain; // virtualGain: gainMono below which the voice is virtual, 0 = never
+	int count, effectSamples; // effectSamples: samples left until the next update of the effects
+	int (*resample)(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd);
+};
+
+static void tsf_voice_render_begin(tsf* f, struct tsf_voice_render_state* s, struct tsf_voice* v)
+{
+	struct tsf_region* region = v->region;
+	s->v = v;
+	s->note = tsf_voice_note(f, v);
+	s->updateModEnv = (region->modEnvToPitch || region->modEnvToFilterFc);
+	s->updateModLFO = (v->modlfo.delta && (region->modLfoToPitch || region->modLfoToFilterFc || region->modLfoToVolume));
+	s->updateVibLFO = (v->viblfo.delta && (region->vibLfoToPitch));
+	s->isLooping = (v->loopStart < v->loopEnd);
+	s->dynamicLowpass = ((region->modLfoToFilterFc || region->modEnvToFilterFc) && !(f->qualityFlags & (TSF_QUALITY_STATIC_FILTER | TSF_QUALITY_NO_FILTER)));
+	s->filter = !(f->qualityFlags & TSF_QUALITY_NO_FILTER);
+	if (!s->filter) v->lowpass.ic1 = v->lowpass.ic2 = 0, v->lowpass.stale = TSF_TRUE;
+	s->dynamicPitchRatio = (region->modLfoToPitch || region->modEnvToPitch || region->vibLfoToPitch);
+	s->dynamicGain = (region->modLfoToVolume != 0);
+	s->pitchRatio = (s->dynamicPitchRatio ? 0 : tsf_render_timecents2Secsd(f->fastMath, v->pitchInputTimecents) * v->pitchOutputFactor);
+	s->noteGain = (s->dynamicGain ? 0 : tsf_render_decibelsToGain(f->fastMath, v->noteGainDB));
+	s->effectSamples = 0;
+	s->resample = (f->qualityFlags & TSF_QUALITY_NEAREST ? tsf_voice_resample_nearest : f->kernel->resample);
+	// A resonant filter can raise the level by about its Q in dB
+	s->virtualGain = (f->virtualGain && s->filter && region->initialFilterQ > 0 ? f->virtualGain * tsf_render_decibelsToGain(f->fastMath, region->initialFilterQ * -0.1f) : f->virtualGain);
+	s->isVirtual = TSF_FALSE;
+}
+
+// Move the sample position of a virtual voice like resampling count samples would
+static void tsf_voice_advance(double* position, int count, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd)
+{
+	double p = *position + pitchRatio * count, loopEndDbl = (double)loopEnd + 1.0, loopLength = (loopEnd - loopStart + 1.0);
+	if (isLooping && p >= loopEndDbl && loopEndDbl < sampleEnd) p -= loopLength * (double)(1 + (long long)((p - loopEndDbl) / loopLength));
+	*position = p;
+}
+
+// Samples it takes a low-pass filter to forget its state down to the threshold (-80 dB if virtualization
+// is off), from its largest pole radius r. With g = tan(pi * Fc) = a2 / a1 and k = 1 / Q the bilinear
+// transform puts the poles at z = (1 - g * m) / (1 + g * m) for m = k / 2 -+ sqrt(k^2 / 4 - 1),
+// for complex m (k < 2) their radius is sqrt((1 + g^2 - g * k) / (1 + g^2 + g * k)).
+static int tsf_voice_lowpass_settle_samples(tsf* f, const struct tsf_voice_lowpass* e)
+{
+	double g = (double)e->a2 / e->a1, k = e->QInv, r, z, d, decay = (f->virtualGain > 0 ? -TSF_LOG(f->virtualGain) : 9.21);
+	if (k < 2.0) r = TSF_SQRTF((float)((1.0 + g * g - g * k) / (1.0 + g * g + g * k)));
+	else
+	{
+		d = TSF_SQRTF((float)(k * k * 0.25 - 1.0));
+		r = (1.0 - g * (k * 0.5 - d)) / (1.0 + g * (k * 0.5 - d));
+		z = (1.0 - g * (k * 0.5 + d)) / (1.0 + g * (k * 0.5 + d));
+		if (r < 0) r = -r;
+		if (z < 0) z = -z;
+		if (z > r) r = z;
+	}
+	return (r < 1.0 && decay < -TSF_LOG(r) * TSF_LOWPASS_PRIMESAMPLES_MAX ? (int)(decay / -TSF_LOG(r)) + 1 : TSF_LOWPASS_PRIMESAMPLES_MAX);
+}
+
+// Run a filter whose state was dropped (for a virtual voice or while filters were off) over the
+// samples before the voice position, so it continues close to where it would be had it been
+// filtering all along instead of starting over from silence, which would thump at full level.
+// The position steps back one block at a time with the pitch of the LFOs run backwards, then the
+// blocks are resampled and filtered forward again like they were rendered, with their cutoff.
+static void tsf_voice_lowpass_prime(tsf* f, struct tsf_voice_render_state* s, float* block, double sampleEnd)
+{
+	struct tsf_voice* v = s->v;
+	struct tsf_voice_lfo modlfo = v->modlfo, viblfo = v->viblfo;
+	TSF_BOOL inLoop = (s->isLooping && v->sourceSamplePosition >= v->loopStart);
+	double p = v->sourceSamplePosition, pitchRatio = s->pitchRatio, loopLength = (v->loopEnd - v->loopStart + 1.0);
+	int blocks = tsf_voice_lowpass_settle_samples(f, &v->lowpass) / TSF_RENDER_EFFECTSAMPLEBLOCK + 1, i, n;
+	v->lowpass.stale = TSF_FALSE;
+	for (i = 0; i != blocks; i++)
+	{
+		tsf_voice_lfo_rewind(&modlfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+		tsf_voice_lfo_rewind(&viblfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+		if (s->dynamicPitchRatio) pitchRatio = tsf_voice_pitchratio(f, v, &modlfo, &viblfo);
+		if (!inLoop && p - pitchRatio * TSF_RENDER_EFFECTSAMPLEBLOCK < (double)v->region->offset)
+		{
+			// Not before the start of the sample, the filter started there from silence too
+			tsf_voice_lfo_process(&modlfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+			tsf_voice_lfo_process(&viblfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+			break;
+		}
+		p -= pitchRatio * TSF_RENDER_EFFECTSAMPLEBLOCK;
+		// Within the loop, the preceding samples wrap around to its end
+		if (inLoop && p < v->loopStart) p += loopLength * (double)(1 + (long long)((v->loopStart - p) / loopLength));
+	}
+	for (; i; i--)
+	{
+		if (s->dynamicPitchRatio) pitchRatio = tsf_voice_pitchratio(f, v, &modlfo, &viblfo);
+		if (s->dynamicLowpass) tsf_voice_lowpass_update(f, v, &modlfo);
+		n = s->resample(f->fontSamples, block, TSF_RENDER_EFFECTSAMPLEBLOCK, &p, pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+		if (v->lowpass.active) tsf_voice_lowpass_process_block(&v->lowpass, block, n);
+		tsf_voice_lfo_process(&modlfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+		tsf_voice_lfo_process(&viblfo, TSF_RENDER_EFFECTSAMPLEBLOCK);
+	}
+	if (s->dynamicLowpass) tsf_voice_lowpass_update(f, v, &v->modlfo);
+}
+
+// Whether a virtual voice stays below the threshold for good: in the release the amplitude envelope
+// only falls, so the voice could only get louder by raising its channel to full volume or by the LFO.
+// Held notes stay, freeing them would change which voice the next note off of their key ends.
+static TSF_BOOL tsf_voice_inaudible(tsf* f, const struct tsf_voice_render_state* s)
+{
+	const struct tsf_voice* v = s->v;
+	float headroomDB = (float)(v->region->modLfoToVolume < 0 ? -v->region->modLfoToVolume : v->region->modLfoToVolume) * 0.1f;
+	if (v->ampenv.segment < TSF_SEGMENT_RELEASE) return TSF_FALSE;
+	if (f->channels && f->channels->channels[s->note->playingChannel].gainDB < 0) headroomDB -= f->channels->channels[s->note->playingChannel].gainDB;
+	return (TSF_BOOL)(v->ampenv.level * tsf_render_decibelsToGain(f->fastMath, v->noteGainDB + headroomDB) < s->virtualGain);
+}
+
+// Whether the next samples of a voice come from the one-shot cache
+static TSF_BOOL tsf_voice_oneshot_reading(const struct tsf_voice* v)
+{
+	return (TSF_BOOL)(v->oneshotFrame >= 0 && v->oneshotFrame < v->oneshot->length);
+}
+
+// A voice leaves the one-shot cache once its pitch or the render settings differ from the recording.
+// If it was reading the recording, its filter is primed from the samples it played at the old pitch.
+static void tsf_voice_oneshot_check(tsf* f, struct tsf_voice_render_state* s, float* block, double sampleEnd)
+{
+	struct tsf_voice* v = s->v;
+	const struct tsf_oneshot* e = v->oneshot;
+	double pitchRatio = s->pitchRatio;
+	if (pitchRatio == e->pitchRatio && s->resample == e->resample && s->filter == e->filter && f->outSampleRate == e->outSampleRate) return;
+	if (tsf_voice_oneshot_reading(v) && v->lowpass.active && s->filter)
+	{
+		s->pitchRatio = e->pitchRatio;
+		tsf_voice_lowpass_prime(f, s, block, sampleEnd);
+		s->pitchRatio = pitchRatio;
+	}
+	tsf_voice_oneshot_stop(f, v);
+}
+
+// Return count samples of the one-shot recording of a voice from its frame on and move past them,
+// copied into block if they reach the end of a page
+static const float* tsf_voice_oneshot_take(struct tsf_voice* v, float* block, int count)
+{
+	int offset = v->oneshotFrame % TSF_ONESHOT_PAGE, n;
+	float* out = block;
+	v->oneshotFrame += count;
+	if (offset + count < TSF_ONESHOT_PAGE) return v->oneshotPage->samples + offset;
+	for (; count; count -= n, out += n, offset = 0)
+	{
+		n = (TSF_ONESHOT_PAGE - offset < count ? TSF_ONESHOT_PAGE - offset : count);
+		TSF_MEMCPY(out, v->oneshotPage->samples + offset, n * sizeof(float));
+		if (offset + n == TSF_ONESHOT_PAGE) v->oneshotPage = v->oneshotPage->next;
+	}
+	return block;
+}
+
+// Append count filtered samples of the recorder of a one-shot cache entry to its recording
+static void tsf_voice_oneshot_record(tsf* f, struct tsf_voice* v, const float* block, int count)
+{
+	struct tsf_oneshot* e = v->oneshot;
+	int offset, n;
+	if (e->length + count > e->capacity) { tsf_voice_oneshot_stop(f, v); return; }
+	for (e->length += count; count; count -= n, block += n)
+	{
+		offset = v->oneshotFrame % TSF_ONESHOT_PAGE;
+		n = (TSF_ONESHOT_PAGE - offset < count ? TSF_ONESHOT_PAGE - offset : count);
+		TSF_MEMCPY(v->oneshotPage->samples + offset, block, n * sizeof(float));
+		v->oneshotFrame += n;
+		if (offset + n == TSF_ONESHOT_PAGE) v->oneshotPage = v->oneshotPage->next;
+	}
+	e->position = v->sourceSamplePosition;
+	e->ic1 = v->lowpass.ic1;
+	e->ic2 = v->lowpass.ic2;
+	if (v->sourceSamplePosition < (double)v->region->end) return;
+	e->complete = TSF_TRUE;
+	tsf_voice_oneshot_stop(f, v);
+}
+
+// Read a block of a voice from its one-shot cache entry (sets count, input and cached). At the end of
+// a recording that stopped early the voice takes over its sample position and filter state and renders
+// the rest of the block on its own, which its recorder adds to the recording.
+static void tsf_voice_oneshot_read(tsf* f, struct tsf_voice_render_state* s, float* block, int blockSamples, double sampleEnd)
+{
+	struct tsf_voice* v = s->v;
+	struct tsf_oneshot* e = v->oneshot;
+	int n = e->length - v->oneshotFrame, rest;
+	if (n > blockSamples) n = blockSamples;
+	s->cached = TSF_TRUE;
+	s->input = tsf_voice_oneshot_take(v, block, n);
+	s->count = n;
+	if (v->oneshotFrame < e->length)
+	{
+		tsf_voice_advance(&v->sourceSamplePosition, n, s->pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+		return;
+	}
+	if (e->complete)
+	{
+		v->sourceSamplePosition = sampleEnd;
+		tsf_voice_oneshot_stop(f, v);
+		return;
+	}
+	v->sourceSamplePosition = e->position;
+	v->lowpass.ic1 = e->ic1;
+	v->lowpass.ic2 = e->ic2;
+	v->lowpass.stale = TSF_FALSE;
+	if (e->recorder != (int)(v - f->voices) || s->isVirtual) tsf_voice_oneshot_stop(f, v);
+	if (n == blockSamples) return;
+	if (s->input != block) TSF_MEMCPY(block, s->input, n * sizeof(float));
+	s->input = block;
+	if (s->isVirtual)
+	{
+		v->lowpass.ic1 = v->lowpass.ic2 = 0;
+		v->lowpass.stale = TSF_TRUE;
+		tsf_voice_advance(&v->sourceSamplePosition, blockSamples - n, s->pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+		return;
+	}
+	rest = s->resample(f->fontSamples, block + n, blockSamples - n, &v->sourceSamplePosition, s->pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+	if (v->lowpass.active && s->filter) tsf_voice_lowpass_process_block(&v->lowpass, block + n, rest);
+	if (v->oneshotFrame >= 0) tsf_voice_oneshot_record(f, v, block + n, rest);
+	s->count = n + rest;
+}
+
+// Update the effects if they are due and resample the voice into block (sets count, input and gainMono)
+// The effects are updated once for up to f->effectBlocks blocks of the samples left to render.
+// Returns TSF_FALSE if the voice finished playing with this block
+static TSF_BOOL tsf_voice_render_block(tsf* f, struct tsf_voice_render_state* s, float* block, int blockSamples, int samplesLeft)
+{
+	struct tsf_voice* v = s->v;
+	struct tsf_region* region = v->region;
+	float tmpSampleRate = f->outSampleRate;
+	double sampleEnd = (double)region->end;
+	int effectSamples;
+
+	if (s->effectSamples > 0) goto resample;
+	effectSamples = f->effectBlocks * TSF_RENDER_EFFECTSAMPLEBLOCK;
+	if (effectSamples > samplesLeft) effectSamples = samplesLeft;
+	s->effectSamples = effectSamples;
+
+	if (v->oneshotFrame >= 0)
+		tsf_voice_oneshot_check(f, s, block, sampleEnd);
+
+	if (s->dynamicLowpass)
+		tsf_voice_lowpass_update(f, v, &v->modlfo);
+
+	if (s->dynamicPitchRatio)
+		s->pitchRatio = tsf_voice_pitchratio(f, v, &v->modlfo, &v->viblfo);
+
+	if (s->dynamicGain)
+		s->noteGain = tsf_render_decibelsToGain(f->fastMath, v->noteGainDB + (v->modlfo.level * ((float)region->modLfoToVolume * 0.1f)));
+
+	s->gainMono = s->noteGain * v->ampenv.level;
+	// Voices in their delay or attack are about to get louder and stay real
+	if (s->gainMono < s->virtualGain && v->ampenv.segment >= TSF_SEGMENT_HOLD)
+	{
+		// A virtual voice doesn't render samples it could record, but can keep reading its recording
+		if (v->oneshotFrame >= 0 && !tsf_voice_oneshot_reading(v)) tsf_voice_oneshot_stop(f, v);
+		v->lowpass.ic1 = v->lowpass.ic2 = 0;
+		v->lowpass.stale = TSF_TRUE;
+		s->isVirtual = TSF_TRUE;
+		if (tsf_voice_inaudible(f, s)) { s->count = 0; return TSF_FALSE; }
+	}
+	else
+	{
+		s->isVirtual = TSF_FALSE;
+		if (v->lowpass.stale && v->lowpass.active && s->filter && !tsf_voice_oneshot_reading(v)) tsf_voice_lowpass_prime(f, s, block, sampleEnd);
+	}
+
+	// Update EG.
+	tsf_voice_envelope_process(&v->ampenv, &s->note->ampenv, effectSamples, tmpSampleRate, f->fastMath);
+	if (s->updateModEnv) tsf_voice_envelope_process(&v->modenv, &s->note->modenv, effectSamples, tmpSampleRate, f->fastMath);
+
+	// Update LFOs.
+	if (s->updateModLFO) tsf_voice_lfo_process(&v->modlfo, effectSamples);
+	if (s->updateVibLFO) tsf_voice_lfo_process(&v->viblfo, effectSamples);
+
+	resample:
+	s->effectSamples -= blockSamples;
+	s->cached = TSF_FALSE;
+	s->input = block;
+	if (tsf_voice_oneshot_reading(v)) tsf_voice_oneshot_read(f, s, block, blockSamples, sampleEnd);
+	else if (s->isVirtual)
+	{
+		s->count = 0;
+		tsf_voice_advance(&v->sourceSamplePosition, blockSamples, s->pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+	}
+	else s->count = s->resample(f->fontSamples, block, blockSamples, &v->sourceSamplePosition, s->pitchRatio, v->loopStart, v->loopEnd, s->isLooping, sampleEnd);
+	// An envelope that ended keeps playing until the blocks of its last update are rendered
+	return (TSF_BOOL)(v->sourceSamplePosition < sampleEnd && (v->ampenv.segment != TSF_SEGMENT_DONE || s->effectSamples > 0));
+}
+
+// Render up to TSF_VOICE_LANES voices side by side, one effect block at a time, so the low-pass
+// filters of all voices in a block can run in lockstep. The voices are mixed into the output in
+// the given order, the result is the same as rendering them one after another.
+// Returns a bit mask of the voices that finished playing, the caller returns them to the free list.
+static int tsf_voice_render_lanes(tsf* f, struct tsf_voice* const* voices, int count, float* outputBuffer, int numSamples)
+{
+	const struct tsf_voice_kernel* kernel = f->kernel;
+	struct tsf_voice_render_state states[TSF_VOICE_LANES];
+	float blocks[TSF_VOICE_LANES][TSF_RENDER_EFFECTSAMPLEBLOCK], idleBlock[TSF_RENDER_EFFECTSAMPLEBLOCK];
+	struct tsf_voice_lowpass* filterLanes[TSF_VOICE_LANES];
+	float* filterBlocks[TSF_VOICE_LANES];
+	struct tsf_voice_lowpass idleLowpass;
+	TSF_BOOL idleReady = TSF_FALSE;
+	int i, filterNum, finished = 0, playing = (1 << count) - 1;
+	float* outL = outputBuffer;
+	float* outR = (f->outputmode == TSF_STEREO_UNWEAVED ? outL + numSamples : TSF_NULL);
+
+	for (i = 0; i != count; i++) tsf_voice_render_begin(f, &states[i], voices[i]);
+
+	while (numSamples && playing)
+	{
+		int blockSamples = (numSamples > TSF_RENDER_EFFECTSAMPLEBLOCK ? TSF_RENDER_EFFECTSAMPLEBLOCK : numSamples);
+
+		// Resample
+		for (i = 0, filterNum = 0; i != count; i++)
+		{
+			struct tsf_voice_render_state* s = &states[i];
+			if (!(playing & (1 << i))) continue;
+			if (!tsf_voice_render_block(f, s, blocks[i], blockSamples, numSamples)) finished |= (1 << i);
+			if (!s->v->lowpass.active || !s->filter || s->isVirtual || s->cached) continue;
+			if (s->count != blockSamples) TSF_MEMSET(blocks[i] + s->count, 0, sizeof(float) * (blockSamples - s->count));
+			filterLanes[filterNum] = &s->v->lowpass;
+			filterBlocks[filterNum++] = blocks[i];
+		}
+
+		// Filter, with unused lanes running on an idle filter over silence
+		if (filterNum == 1)
+			tsf_voice_lowpass_process_block(filterLanes[0], filterBlocks[0], blockSamples);
+		else if (filterNum)
+		{
+			if (!idleReady)
+			{
+				TSF_MEMSET(&idleLowpass, 0, sizeof(idleLowpass));
+				TSF_MEMSET(idleBlock, 0, sizeof(idleBlock));
+				idleReady = TSF_TRUE;
+			}
+			for (; filterNum != TSF_VOICE_LANES; filterNum++) filterLanes[filterNum] = &idleLowpass, filterBlocks[filterNum] = idleBlock;
+			kernel->lowpass_lanes(filterLanes, filterBlocks, blockSamples);
+		}
+		numSamples -= blockSamples;
+
+		// Mix
+		for (i = 0; i != count; i++)
+		{
+			const struct tsf_voice_render_state* s = &states[i];
+			struct tsf_voice* v = s->v;
+			if (!(playing & (1 << i)) || s->isVirtual) continue;
+			// The recorder of a one-shot cache entry adds its filtered block to the recording
+			if (v->oneshotFrame >= 0 && !s->cached) tsf_voice_oneshot_record(f, v, blocks[i], s->count);
+			switch (f->outputmode)
+			{
+				case TSF_STEREO_INTERLEAVED:
+					kernel->mix_interleaved(outL, s->input, s->count, s->gainMono * v->panFactorLeft, s->gainMono * v->panFactorRight);
+					break;
+
+				case TSF_STEREO_UNWEAVED:
+					kernel->mix_unweaved(outL, outR, s->input, s->count, s->gainMono * v->panFactorLeft, s->gainMono * v->panFactorRight);
+					break;
+
+				case TSF_MONO:
+					kernel->mix_mono(outL, s->input, s->count, s->gainMono);
+					break;
+			}
+		}
+		playing &= ~finished;
+		if (f->outputmode == TSF_STEREO_INTERLEAVED) outL += blockSamples * 2;
+		else { outL += blockSamples; if (outR) outR += blockSamples; }
+	}
+	return finished;
+}
+
+TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+{
+	tsf* res = TSF_NULL;
+	struct tsf_riffchunk chunkHead;
+	struct tsf_riffchunk chunkList;
+	struct tsf_hydra hydra;
+	void* rawBuffer = TSF_NULL;
+	float* floatBuffer = TSF_NULL;
+	tsf_u32 smplCount = 0;
+
+	if (!tsf_riffchunk_read(TSF_NULL, &chunkHead, stream) || !TSF_FourCCEquals(chunkHead.id, "sfbk"))
+	{
+		//if (e) *e = TSF_INVALID_NOSF2HEADER;
+		return res;
+	}
+
+	// Read hydra and locate sample data.
+	TSF_MEMSET(&hydra, 0, sizeof(hydra));
+	while (tsf_riffchunk_read(&chunkHead, &chunkList, stream))
+	{
+		struct tsf_riffchunk chunk;
+		if (TSF_FourCCEquals(chunkList.id, "pdta"))
+		{
+			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
+			{
+				#define HandleChunk(chunkName) (TSF_FourCCEquals(chunk.id, #chunkName) && !(chunk.size % chunkName##SizeInFile)) \
+					{ \
+						int num = chunk.size / chunkName##SizeInFile, i; \
+						hydra.chunkName##Num = num; \
+						hydra.chunkName##s = (struct tsf_hydra_##chunkName*)TSF_MALLOC(num * sizeof(struct tsf_hydra_##chunkName)); \
+						if (!hydra.chunkName##s) goto out_of_memory; \
+						for (i = 0; i < num; ++i) tsf_hydra_read_##chunkName(&hydra.chunkName##s[i], stream); \
+					}
+				enum
+				{
+					phdrSizeInFile = 38, pbagSizeInFile =  4, pmodSizeInFile = 10,
+					pgenSizeInFile =  4, instSizeInFile = 22, ibagSizeInFile =  4,
+					imodSizeInFile = 10, igenSizeInFile =  4, shdrSizeInFile = 46
+				};
+				if      HandleChunk(phdr) else if HandleChunk(pbag) else if HandleChunk(pmod)
+				else if HandleChunk(pgen) else if HandleChunk(inst) else if HandleChunk(ibag)
+				else if HandleChunk(imod) else if HandleChunk(igen) else if HandleChunk(shdr)
+				else stream->skip(stream->data, chunk.size);
+				#undef HandleChunk
+			}
+		}
+		else if (TSF_FourCCEquals(chunkList.id, "sdta"))
+		{
+			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
+			{
+				if ((TSF_FourCCEquals(chunk.id, "smpl")
+						#ifdef STB_VORBIS_INCLUDE_STB_VORBIS_H
+						|| TSF_FourCCEquals(chunk.id, "smpo")
+						#endif
+					) && !rawBuffer && !floatBuffer && chunk.size >= sizeof(short))
+				{
+					if (!tsf_load_samples(&rawBuffer, &floatBuffer, &smplCount, &chunk, stream)) goto out_of_memory;
+				}
+				else stream->skip(stream->data, chunk.size);
+			}
+		}
+		else stream->skip(stream->data, chunkList.size);
+	}
+	if (!hydra.phdrs || !hydra.pbags || !hydra.pmods || !hydra.pgens || !hydra.insts || !hydra.ibags || !hydra.imods || !hydra.igens || !hydra.shdrs)
+	{
+		//if (e) *e = TSF_INVALID_INCOMPLETE;
+	}
+	else if (!rawBuffer && !floatBuffer)
+	{
+		//if (e) *e = TSF_INVALID_NOSAMPLEDATA;
+	}
+	else
+	{
+		#ifdef STB_VORBIS_INCLUDE_STB_VORBIS_H
+		if (!floatBuffer && !tsf_decode_sf3_samples(rawBuffer, &floatBuffer, &smplCount, &hydra)) goto out_of_memory;
+		#endif
+		res = (tsf*)TSF_MALLOC(sizeof(tsf));
+		if (res) TSF_MEMSET(res, 0, sizeof(tsf));
 		if (!res || !tsf_load_presets(res, &hydra, smplCount)) goto out_of_memory;
 		res->outSampleRate = 44100.0f;
+		res->activeVoiceFirst = res->freeVoiceFirst = -1;
+		tsf_voice_index_clear(res);
+		res->kernel = tsf_voice_kernel_select(TSF_TRUE);
+		#ifndef TSF_NO_FASTMATH
+		res->fastMath = TSF_TRUE;
+		#endif
+		res->effectBlocks = 1;
 		res->fontSamples = floatBuffer;
 		floatBuffer = TSF_NULL; // don't free below
 	}
@@ -1455,6 +2798,17 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 	return res;
 }
 
+static void tsf_oneshots_free(tsf* f)
+{
+	struct tsf_voice* v;
+	int i;
+	if (!f->oneshots) return;
+	// Voices reading a recording continue on their own, their filter state is primed
+	for (i = f->activeVoiceFirst; i != -1; i = v->listNext) tsf_voice_oneshot_release(f, (v = &f->voices[i]));
+	TSF_FREE(f->oneshots);
+	f->oneshots = TSF_NULL;
+}
+
 TSFDEF tsf* tsf_copy(tsf* f)
 {
 	tsf* res;
@@ -1469,16 +2823,22 @@ TSFDEF tsf* tsf_copy(tsf* f)
 	if (!res) return TSF_NULL;
 	TSF_MEMCPY(res, f, sizeof(tsf));
 	res->voices = TSF_NULL;
-	res->voiceNum = 0;
+	res->voiceNotes = TSF_NULL;
+	res->voiceNum = res->activeVoiceNum = 0;
+	res->activeVoiceFirst = res->freeVoiceFirst = -1;
+	tsf_voice_index_clear(res);
 	res->channels = TSF_NULL;
-	(*res->refCount)++;
+	res->oneshots = TSF_NULL;
+	TSF_ATOMIC_INC(res->refCount);
 	return res;
 }
 
 TSFDEF void tsf_close(tsf* f)
 {
 	if (!f) return;
-	if (!f->refCount || !--(*f->refCount))
+	// Detaching the voices reads their regions and samples, so before those are freed
+	tsf_oneshots_free(f);
+	if (!f->refCount || !TSF_ATOMIC_DEC(f->refCount))
 	{
 		struct tsf_preset *preset = f->presets, *presetEnd = preset + f->presetNum;
 		for (; preset != presetEnd; preset++) TSF_FREE(preset->regions);
@@ -1488,15 +2848,20 @@ TSFDEF void tsf_close(tsf* f)
 	}
 	TSF_FREE(f->channels);
 	TSF_FREE(f->voices);
+	TSF_FREE(f->voiceNotes);
 	TSF_FREE(f);
 }
 
 TSFDEF void tsf_reset(tsf* f)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1 && (v->ampenv.segment < TSF_SEGMENT_RELEASE || v->ampenv.parameters.release))
+	struct tsf_voice *v;
+	int i;
+	for (i = f->activeVoiceFirst; i != -1; i = v->listNext)
+	{
+		v = &f->voices[i];
+		if (v->ampenv.segment < TSF_SEGMENT_RELEASE || f->voiceNotes[i].ampenv.release)
 			tsf_voice_endquick(f, v);
+	}
 	if (f->channels) { TSF_FREE(f->channels); f->channels = TSF_NULL; }
 }
 
@@ -1537,85 +2902,262 @@ TSFDEF void tsf_set_volume(tsf* f, float global_volume)
 	f->globalGainDB = (global_volume == 1.0f ? 0 : -tsf_gainToDecibels(1.0f / global_volume));
 }
 
-TSFDEF int tsf_set_max_voices(tsf* f, int max_voices)
+static int tsf_voices_resize(tsf* f, int newVoiceNum)
 {
-	int i = f->voiceNum;
-	int newVoiceNum = (f->voiceNum > max_voices ? f->voiceNum : max_voices);
+	// Both parallel voice arrays are always kept at the same length, added voices go to the free list
 	struct tsf_voice *newVoices = (struct tsf_voice*)TSF_REALLOC(f->voices, newVoiceNum * sizeof(struct tsf_voice));
+	struct tsf_voice_note *newVoiceNotes;
+	int i;
 	if (!newVoices) return 0;
 	f->voices = newVoices;
-	f->voiceNum = f->maxVoiceNum = newVoiceNum;
-	for (; i < max_voices; i++)
+	newVoiceNotes = (struct tsf_voice_note*)TSF_REALLOC(f->voiceNotes, newVoiceNum * sizeof(struct tsf_voice_note));
+	if (!newVoiceNotes) return 0;
+	f->voiceNotes = newVoiceNotes;
+	for (i = newVoiceNum - 1; i >= f->voiceNum; i--)
+	{
 		f->voices[i].playingPreset = -1;
+		f->voices[i].listNext = f->freeVoiceFirst;
+		f->freeVoiceFirst = i;
+	}
+	f->voiceNum = newVoiceNum;
 	return 1;
 }
 
+TSFDEF int tsf_set_max_voices(tsf* f, int max_voices)
+{
+	int voiceNum = max_voices + TSF_STEALRESERVE(max_voices);
+	if (max_voices <= 0) return 0;
+	if (!tsf_voices_resize(f, (f->voiceNum > voiceNum ? f->voiceNum : voiceNum))) return 0;
+	f->maxVoiceNum = max_voices;
+	return 1;
+}
+
+TSFDEF const char* tsf_set_render_kernel(tsf* f, int flag_simd)
+{
+	f->kernel = tsf_voice_kernel_select((TSF_BOOL)(flag_simd != 0));
+	return f->kernel->name;
+}
+
+TSFDEF int tsf_set_fast_math(tsf* f, int flag_fast_math)
+{
+	#ifndef TSF_NO_FASTMATH
+	f->fastMath = (TSF_BOOL)(flag_fast_math != 0);
+	#else
+	(void)flag_fast_math;
+	#endif
+	return f->fastMath;
+}
+
+TSFDEF void tsf_set_render_quality(tsf* f, int effect_blocks, int flags)
+{
+	f->effectBlocks = (effect_blocks < 1 ? 1 : (effect_blocks > TSF_RENDER_EFFECTBLOCKS_MAX ? TSF_RENDER_EFFECTBLOCKS_MAX : effect_blocks));
+	f->qualityFlags = flags & (TSF_QUALITY_STATIC_FILTER | TSF_QUALITY_NEAREST | TSF_QUALITY_NO_FILTER);
+}
+
+TSFDEF int tsf_cull_voices(tsf* f, int max_voices)
+{
+	int sounding, steal, culled = 0;
+	if (max_voices < 0) max_voices = 0;
+	// No voice was started with the next play index, so all voices are candidates
+	while ((steal = tsf_voice_steal_find(f, -1, 0x7FFF, f->voicePlayIndex, &sounding)) != -1 && sounding > max_voices)
+	{
+		tsf_voice_endquick(f, &f->voices[steal]);
+		culled++;
+	}
+	return culled;
+}
+
+TSFDEF void tsf_set_voice_virtualization(tsf* f, float threshold_db)
+{
+	f->virtualGain = (threshold_db < 0 ? tsf_decibelsToGain(threshold_db) : 0.0f);
+}
+
+TSFDEF int tsf_set_oneshot_cache(tsf* f, int max_bytes)
+{
+	struct tsf_oneshots* c;
+	struct tsf_oneshot* entries;
+	struct tsf_oneshot_page* pages;
+	int pageNum = (max_bytes > 0 ? max_bytes / (int)sizeof(struct tsf_oneshot_page) : 0), i;
+	tsf_oneshots_free(f);
+	if (!pageNum) return 1;
+	c = (struct tsf_oneshots*)TSF_MALLOC(sizeof(struct tsf_oneshots) + (size_t)pageNum * (sizeof(struct tsf_oneshot) + sizeof(struct tsf_oneshot_page)));
+	if (!c) return 0;
+	TSF_MEMSET(c, 0, sizeof(struct tsf_oneshots));
+	entries = (struct tsf_oneshot*)(c + 1);
+	pages = (struct tsf_oneshot_page*)(entries + pageNum);
+	for (i = 0; i != pageNum; i++)
+	{
+		entries[i].region = TSF_NULL;
+		entries[i].older = (i + 1 != pageNum ? &entries[i + 1] : TSF_NULL);
+		pages[i].next = (i + 1 != pageNum ? &pages[i + 1] : TSF_NULL);
+	}
+	c->pageNum = c->freePageNum = pageNum;
+	c->freeEntries = entries;
+	c->freePages = pages;
+	f->oneshots = c;
+	return 1;
+}
+
+// Attach a voice that just started to the one-shot cache, if its notes qualify (see tsf_set_oneshot_cache).
+// It reads the recording of its region and pitch, or records it as the first voice to play it. A voice
+// can also pick up a recording that stopped early and no one reads to continue it. Voices starting
+// while another one records render on their own, so only the recorder ever writes to an entry.
+static void tsf_voice_oneshot_attach(tsf* f, struct tsf_voice* v)
+{
+	struct tsf_oneshots* c = f->oneshots;
+	const struct tsf_region* region = v->region;
+	struct tsf_oneshot *e, **bucket;
+	int (*resample)(const float* input, float* out, int count, double* position, double pitchRatio, unsigned int loopStart, unsigned int loopEnd, TSF_BOOL isLooping, double sampleEnd);
+	TSF_BOOL filter = !(f->qualityFlags & TSF_QUALITY_NO_FILTER);
+	double pitchRatio, frames;
+	int pageNum, channel, i;
+
+	if (f->presets[v->playingPreset].bank < 128 || v->loopStart < v->loopEnd || region->end <= region->offset) return;
+	// Percussion plays at the pitch of its key, a bent or retuned channel would only fill the cache with one-off pitches
+	channel = tsf_voice_note(f, v)->playingChannel;
+	if (channel >= 0 && (f->channels->channels[channel].pitchWheel != 8192 || f->channels->channels[channel].tuning != 0.0f)) return;
+	if (region->modEnvToPitch || region->modLfoToPitch || region->vibLfoToPitch || region->modEnvToFilterFc || region->modLfoToFilterFc) return;
+	resample = (f->qualityFlags & TSF_QUALITY_NEAREST ? tsf_voice_resample_nearest : f->kernel->resample);
+	pitchRatio = tsf_render_timecents2Secsd(f->fastMath, v->pitchInputTimecents) * v->pitchOutputFactor;
+	if (!(pitchRatio > 0.0)) return;
+
+	bucket = tsf_oneshot_bucket(c, region, pitchRatio);
+	for (e = *bucket; e; e = e->next)
+		if (e->region == region && e->pitchRatio == pitchRatio && e->resample == resample && e->filter == filter && e->outSampleRate == f->outSampleRate) break;
+	if (e)
+	{
+		if (e->recorder != -1) return;
+		if (!e->refs) tsf_oneshot_unlink(c, e);
+		// Without other voices attached, or with nothing recorded yet, the voice continues the recording
+		if (!e->complete && (!e->refs || !e->length)) e->recorder = (int)(v - f->voices);
+	}
+	else
+	{
+		// Room for all samples the resampling produces up to the sample end
+		frames = (region->end - region->offset) / pitchRatio + 2.0;
+		if (frames > (double)c->pageNum * TSF_ONESHOT_PAGE) return;
+		pageNum = ((int)frames + TSF_ONESHOT_PAGE - 1) / TSF_ONESHOT_PAGE;
+		while (c->freePageNum < pageNum)
+		{
+			// Drop the least recently hit recording no voice is attached to, every entry holds a page at least
+			if (!(e = c->oldest)) return;
+			tsf_oneshot_unlink(c, e);
+			tsf_oneshot_free(c, e);
+		}
+		e = c->freeEntries;
+		c->freeEntries = e->older;
+		e->first = c->freePages;
+		for (e->last = e->first, i = 1; i != pageNum; i++) e->last = e->last->next;
+		c->freePages = e->last->next;
+		c->freePageNum -= pageNum;
+		e->last->next = TSF_NULL;
+		e->region = region;
+		e->pitchRatio = pitchRatio;
+		e->position = region->offset;
+		e->resample = resample;
+		e->outSampleRate = f->outSampleRate;
+		e->ic1 = e->ic2 = 0;
+		e->filter = filter;
+		e->complete = TSF_FALSE;
+		e->recorder = (int)(v - f->voices);
+		e->refs = e->length = 0;
+		e->capacity = (int)frames;
+		e->next = *bucket;
+		*bucket = e;
+	}
+	e->refs++;
+	v->oneshot = e;
+	v->oneshotPage = e->first;
+	v->oneshotFrame = 0;
+	tsf_voice_note(f, v)->oneshotPitchRatio = pitchRatio;
+	tsf_voice_note(f, v)->oneshotResample = resample;
+	tsf_voice_note(f, v)->oneshotFilter = filter;
+	// Reading the recording leaves the filter without state, it is set up again if the voice leaves early
+	if (e->length) v->lowpass.stale = TSF_TRUE;
+}
+
 TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel)
 {
 	short midiVelocity = (short)(vel * 127);
 	unsigned int voicePlayIndex;
 	struct tsf_region *region, *regionEnd;
+	int channel = -1, channelMaxVoices = 0, priority = TSF_DEFAULTPRIORITY;
 
 	if (preset_index < 0 || preset_index >= f->presetNum) return 1;
 	if (vel <= 0.0f) { tsf_note_off(f, preset_index, key); return 1; }
 
+	// Voices get set up for the active channel (see tsf_channel_setup_voice)
+	if (f->channels && f->channels->activeChannel < f->channels->channelNum)
+	{
+		channel = f->channels->activeChannel;
+		channelMaxVoices = f->channels->channels[channel].maxVoices;
+		priority = f->channels->channels[channel].priority;
+	}
+
 	// Play all matching regions.
 	voicePlayIndex = f->voicePlayIndex++;
 	for (region = f->presets[preset_index].regions, regionEnd = region + f->presets[preset_index].regionNum; region != regionEnd; region++)
 	{
-		struct tsf_voice *voice, *v, *vEnd; TSF_BOOL doLoop; float lowpassFilterQDB, lowpassFc;
+		struct tsf_voice *voice, *v; struct tsf_voice_note* note; TSF_BOOL doLoop; float lowpassFilterQDB, lowpassFc; int i;
 		if (key < region->lokey || key > region->hikey || midiVelocity < region->lovel || midiVelocity > region->hivel) continue;
 
-		voice = TSF_NULL, v = f->voices, vEnd = v + f->voiceNum;
+		voice = TSF_NULL;
 		if (region->group)
 		{
-			for (; v != vEnd; v++)
+			for (i = *tsf_voice_group_bucket(f, preset_index, region->group); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_GROUP].next)
+			{
+				v = &f->voices[i];
 				if (v->playingPreset == preset_index && v->region->group == region->group) tsf_voice_endquick(f, v);
-				else if (v->playingPreset == -1 && !voice) voice = v;
+			}
+		}
+
+		if (channelMaxVoices)
+		{
+			// The channel is limited, fade out its least important voice to make room
+			int sounding, steal = tsf_voice_steal_find(f, channel, 0x7FFF, voicePlayIndex, &sounding);
+			if (sounding >= channelMaxVoices)
+			{
+				if (steal == -1) continue; // The note itself fills the channel
+				tsf_voice_endquick(f, &f->voices[steal]);
+			}
+		}
+
+		if (f->maxVoiceNum && f->activeVoiceNum >= f->maxVoiceNum)
+		{
+			// Voices have been pre-allocated and limited to a maximum, fade out the least important voice
+			// of the same or lower priority, or drop the note if all sounding voices are more important
+			int sounding, steal = tsf_voice_steal_find(f, -1, priority, voicePlayIndex, &sounding);
+			if (sounding >= f->maxVoiceNum)
+			{
+				if (steal == -1) continue;
+				tsf_voice_endquick(f, &f->voices[steal]);
+			}
 		}
-		else for (; v != vEnd; v++) if (v->playingPreset == -1) { voice = v; break; }
 
-		if (!voice)
+		if (f->freeVoiceFirst == -1)
 		{
 			if (f->maxVoiceNum)
 			{
-				// Voices have been pre-allocated and limited to a maximum, try to kill a voice off in its release envelope
-				int bestKillReleaseSamplePos = -999999999;
-				for (v = f->voices; v != vEnd; v++)
-				{
-					if (v->ampenv.segment == TSF_SEGMENT_RELEASE)
-					{
-						// We're looking for the voice furthest into its release
-						int releaseSamplesDone = tsf_voice_envelope_release_samples(&v->ampenv, f->outSampleRate) - v->ampenv.samplesUntilNextSegment;
-						if (releaseSamplesDone > bestKillReleaseSamplePos)
-						{
-							bestKillReleaseSamplePos = releaseSamplesDone;
-							voice = v;
-						}
-					}
-				}
-				if (!voice)
-					continue;
-				tsf_voice_kill(voice);
+				// All reserve voices are still fading out, cut off the one furthest along
+				i = tsf_voice_fading_quietest(f);
+				if (i == -1) continue;
+				tsf_voice_kill(f, &f->voices[i]);
 			}
 			else
 			{
-				// Allocate more voices so we don't need to kill one off.
-				struct tsf_voice* newVoices;
-				f->voiceNum += 4;
-				newVoices = (struct tsf_voice*)TSF_REALLOC(f->voices, f->voiceNum * sizeof(struct tsf_voice));
-				if (!newVoices) return 0;
-				f->voices = newVoices;
-				voice = &f->voices[f->voiceNum - 4];
-				voice[1].playingPreset = voice[2].playingPreset = voice[3].playingPreset = -1;
+				// Allocate more voices so we don't need to kill one off, growing geometrically to keep bursts cheap.
+				if (!tsf_voices_resize(f, (f->voiceNum ? f->voiceNum * 2 : 8))) return 0;
 			}
 		}
+		voice = tsf_voice_alloc(f);
 
+		note = tsf_voice_note(f, voice);
 		voice->region = region;
 		voice->playingPreset = preset_index;
-		voice->playingKey = key;
-		voice->playIndex = voicePlayIndex;
-		voice->heldSustain = 0;
+		note->playingKey = key;
+		note->playingChannel = -1;
+		note->playIndex = voicePlayIndex;
+		note->heldSustain = 0;
 		voice->noteGainDB = f->globalGainDB - region->attenuation - tsf_gainToDecibels(1.0f / vel);
 
 		if (f->channels)
@@ -1624,7 +3166,7 @@ TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel)
 		}
 		else
 		{
-			tsf_voice_calcpitchratio(voice, 0, f->outSampleRate);
+			tsf_voice_calcpitchratio(voice, key, 0, f->outSampleRate);
 			// The SFZ spec is silent about the pan curve, but a 3dB pan law seems common. This sqrt() curve matches what Dimension LE does; Alchemy Free seems closer to sin(adjustedPan * pi/2).
 			voice->panFactorLeft  = TSF_SQRTF(0.5f - region->pan);
 			voice->panFactorRight = TSF_SQRTF(0.5f + region->pan);
@@ -1639,20 +3181,28 @@ TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel)
 		voice->loopEnd = (doLoop ? region->loop_end : 0);
 
 		// Setup envelopes.
-		tsf_voice_envelope_setup(&voice->ampenv, &region->ampenv, key, midiVelocity, TSF_TRUE, f->outSampleRate);
-		tsf_voice_envelope_setup(&voice->modenv, &region->modenv, key, midiVelocity, TSF_FALSE, f->outSampleRate);
+		tsf_voice_envelope_setup(&voice->ampenv, &note->ampenv, &region->ampenv, key, midiVelocity, TSF_TRUE, f->outSampleRate);
+		tsf_voice_envelope_setup(&voice->modenv, &note->modenv, &region->modenv, key, midiVelocity, TSF_FALSE, f->outSampleRate);
 
 		// Setup lowpass filter.
 		lowpassFc = (region->initialFilterFc <= 13500 ? tsf_cents2Hertz((float)region->initialFilterFc) / f->outSampleRate : 1.0f);
 		lowpassFilterQDB = region->initialFilterQ / 10.0f;
-		voice->lowpass.QInv = 1.0 / TSF_POW(10.0, (lowpassFilterQDB / 20.0));
-		voice->lowpass.z1 = voice->lowpass.z2 = 0;
+		voice->lowpass.QInv = (float)(1.0 / TSF_POW(10.0, (lowpassFilterQDB / 20.0)));
+		voice->lowpass.ic1 = voice->lowpass.ic2 = 0;
+		voice->lowpass.stale = TSF_FALSE;
 		voice->lowpass.active = (lowpassFc < 0.499f);
 		if (voice->lowpass.active) tsf_voice_lowpass_setup(&voice->lowpass, lowpassFc);
 
 		// Setup LFO filters.
 		tsf_voice_lfo_setup(&voice->modlfo, region->delayModLFO, region->freqModLFO, f->outSampleRate);
 		tsf_voice_lfo_setup(&voice->viblfo, region->delayVibLFO, region->freqVibLFO, f->outSampleRate);
+
+		// Hits of one-shot percussion are read from the cache
+		voice->oneshot = TSF_NULL;
+		voice->oneshotFrame = -1;
+		if (f->oneshots) tsf_voice_oneshot_attach(f, voice);
+
+		tsf_voice_index_insert(f, (int)(voice - f->voices));
 	}
 	return 1;
 }
@@ -1666,20 +3216,26 @@ TSFDEF int tsf_bank_note_on(tsf* f, int bank, int preset_number, int key, float
 
 TSFDEF void tsf_note_off(tsf* f, int preset_index, int key)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum, *vMatchFirst = TSF_NULL, *vMatchLast = TSF_NULL;
-	for (; v != vEnd; v++)
+	struct tsf_voice *v;
+	struct tsf_voice_note *n;
+	unsigned int matchPlayIndex = 0;
+	int i, first, list, matchFound = 0;
+	//Without channels all voices are in the (no channel, key) bucket, otherwise they can be on any channel
+	if (f->channels) first = f->activeVoiceFirst, list = -1;
+	else first = *tsf_voice_key_bucket(f, -1, key), list = TSF_VOICE_INDEX_KEY;
+	for (i = first; i != -1; i = (list < 0 ? v->listNext : n->links[list].next))
 	{
-		//Find the first and last entry in the voices list with matching preset, key and look up the smallest play index
-		if (v->playingPreset != preset_index || v->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE) continue;
-		else if (!vMatchFirst || v->playIndex < vMatchFirst->playIndex) vMatchFirst = vMatchLast = v;
-		else if (v->playIndex == vMatchFirst->playIndex) vMatchLast = v;
+		//Look up the smallest play index of the active voices with matching preset and key
+		v = &f->voices[i], n = &f->voiceNotes[i];
+		if (v->playingPreset != preset_index || n->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE) continue;
+		else if (!matchFound || n->playIndex < matchPlayIndex) matchFound = 1, matchPlayIndex = n->playIndex;
 	}
-	if (!vMatchFirst) return;
-	for (v = vMatchFirst; v <= vMatchLast; v++)
+	if (!matchFound) return;
+	for (i = first; i != -1; i = (list < 0 ? v->listNext : n->links[list].next))
 	{
 		//Stop all voices with matching preset, key and the smallest play index which was enumerated above
-		if (v != vMatchFirst && v != vMatchLast &&
-			(v->playIndex != vMatchFirst->playIndex || v->playingPreset != preset_index || v->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE)) continue;
+		v = &f->voices[i], n = &f->voiceNotes[i];
+		if (n->playIndex != matchPlayIndex || v->playingPreset != preset_index || n->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE) continue;
 		tsf_voice_end(f, v);
 	}
 }
@@ -1694,17 +3250,16 @@ TSFDEF int tsf_bank_note_off(tsf* f, int bank, int preset_number, int key)
 
 TSFDEF void tsf_note_off_all(tsf* f)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++) if (v->playingPreset != -1 && v->ampenv.segment < TSF_SEGMENT_RELEASE)
-		tsf_voice_end(f, v);
+	struct tsf_voice *v;
+	int i;
+	for (i = f->activeVoiceFirst; i != -1; i = v->listNext)
+		if ((v = &f->voices[i])->ampenv.segment < TSF_SEGMENT_RELEASE)
+			tsf_voice_end(f, v);
 }
 
 TSFDEF int tsf_active_voice_count(tsf* f)
 {
-	int count = 0;
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++) if (v->playingPreset != -1) count++;
-	return count;
+	return f->activeVoiceNum;
 }
 
 TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing)
@@ -1737,25 +3292,121 @@ TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing
 
 TSFDEF void tsf_render_float(tsf* f, float* buffer, int samples, int flag_mixing)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
+	struct tsf_voice* lanes[TSF_VOICE_LANES];
+	int i, next, count, finished;
 	if (!flag_mixing) TSF_MEMSET(buffer, 0, (f->outputmode == TSF_MONO ? 1 : 2) * sizeof(float) * samples);
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1)
-			tsf_voice_render(f, v, buffer, samples);
+	for (i = f->activeVoiceFirst; i != -1; i = next)
+	{
+		// Voices that finish are moved to the free list after rendering, so fetch the next one first
+		for (count = 0; i != -1 && count != TSF_VOICE_LANES; i = f->voices[i].listNext) lanes[count++] = &f->voices[i];
+		next = i;
+		finished = tsf_voice_render_lanes(f, lanes, count, buffer, samples);
+		for (count = 0; finished; count++, finished >>= 1)
+			if (finished & 1) tsf_voice_kill(f, lanes[count]);
+	}
+}
+
+static void tsf_render_bus_lanes(tsf* f, struct tsf_voice** lanes, int count, float* buffer, int samples)
+{
+	int finished = tsf_voice_render_lanes(f, lanes, count, buffer, samples);
+	for (count = 0; finished; count++, finished >>= 1)
+		if (finished & 1) tsf_voice_kill(f, lanes[count]);
+}
+
+TSFDEF void tsf_render_float_buses(tsf* f, float** buffers, int bus_count, const int* channel_bus, int channel_count, int samples, int flag_mixing, unsigned char* flags_active)
+{
+	struct tsf_voice* lanes[TSF_MAX_BUSES][TSF_VOICE_LANES];
+	int laneNum[TSF_MAX_BUSES];
+	int i, next, bus, channel;
+	if (bus_count > TSF_MAX_BUSES) bus_count = TSF_MAX_BUSES;
+	for (bus = 0; bus != bus_count; bus++)
+	{
+		if (!flag_mixing) TSF_MEMSET(buffers[bus], 0, (f->outputmode == TSF_MONO ? 1 : 2) * sizeof(float) * samples);
+		flags_active[bus] = 0;
+		laneNum[bus] = 0;
+	}
+	if (bus_count <= 0) return;
+	for (i = f->activeVoiceFirst; i != -1; i = next)
+	{
+		// Rendering a full set of lanes frees the voices that finish, which are all before this one
+		next = f->voices[i].listNext;
+		channel = f->voiceNotes[i].playingChannel;
+		bus = (channel >= 0 && channel < channel_count ? channel_bus[channel] : 0);
+		if (bus < 0 || bus >= bus_count) bus = 0;
+		flags_active[bus] = 1;
+		lanes[bus][laneNum[bus]++] = &f->voices[i];
+		if (laneNum[bus] != TSF_VOICE_LANES) continue;
+		tsf_render_bus_lanes(f, lanes[bus], TSF_VOICE_LANES, buffers[bus], samples);
+		laneNum[bus] = 0;
+	}
+	for (bus = 0; bus != bus_count; bus++)
+		if (laneNum[bus]) tsf_render_bus_lanes(f, lanes[bus], laneNum[bus], buffers[bus], samples);
+}
+
+TSFDEF int tsf_get_active_voices(tsf* f, int* voice_indices, int max_indices)
+{
+	int i, count = 0;
+	for (i = f->activeVoiceFirst; i != -1 && count < max_indices; i = f->voices[i].listNext)
+		voice_indices[count++] = i;
+	return count;
+}
+
+TSFDEF int tsf_render_voices_float(tsf* f, const int* voice_indices, int count, float* buffer, int samples, unsigned char* flags_finished)
+{
+	struct tsf_voice* lanes[TSF_VOICE_LANES];
+	int laneIndex[TSF_VOICE_LANES];
+	int i = 0, laneNum, finished, res = 0;
+	while (i < count)
+	{
+		// Voices that are not playing are skipped and not flagged as finished
+		for (laneNum = 0; i < count && laneNum != TSF_VOICE_LANES; i++)
+		{
+			flags_finished[i] = 0;
+			if (f->voices[voice_indices[i]].playingPreset == -1) continue;
+			laneIndex[laneNum] = i;
+			lanes[laneNum++] = &f->voices[voice_indices[i]];
+		}
+		if (!laneNum) break;
+		finished = tsf_voice_render_lanes(f, lanes, laneNum, buffer, samples);
+		for (laneNum = 0; finished; laneNum++, finished >>= 1)
+			if (finished & 1) { flags_finished[laneIndex[laneNum]] = 1; res++; }
+	}
+	return res;
+}
+
+TSFDEF void tsf_release_voice(tsf* f, int voice_index)
+{
+	tsf_voice_kill(f, &f->voices[voice_index]);
 }
 
 static void tsf_channel_setup_voice(tsf* f, struct tsf_voice* v)
 {
 	struct tsf_channel* c = &f->channels->channels[f->channels->activeChannel];
 	float newpan = v->region->pan + c->panOffset;
-	v->playingChannel = f->channels->activeChannel;
+	struct tsf_voice_note* n = tsf_voice_note(f, v);
+	n->playingChannel = f->channels->activeChannel;
 	v->noteGainDB += c->gainDB;
-	tsf_voice_calcpitchratio(v, (c->pitchWheel == 8192 ? c->tuning : ((c->pitchWheel / 16383.0f * c->pitchRange * 2.0f) - c->pitchRange + c->tuning)), f->outSampleRate);
+	tsf_voice_calcpitchratio(v, n->playingKey, (c->pitchWheel == 8192 ? c->tuning : ((c->pitchWheel / 16383.0f * c->pitchRange * 2.0f) - c->pitchRange + c->tuning)), f->outSampleRate);
 	if      (newpan <= -0.5f) { v->panFactorLeft = 1.0f; v->panFactorRight = 0.0f; }
 	else if (newpan >=  0.5f) { v->panFactorLeft = 0.0f; v->panFactorRight = 1.0f; }
 	else { v->panFactorLeft = TSF_SQRTF(0.5f - newpan); v->panFactorRight = TSF_SQRTF(0.5f + newpan); }
 }
 
+static void tsf_channel_setdefaults(struct tsf_channel* c)
+{
+	c->presetIndex = c->bank = 0;
+	c->pitchWheel = c->midiPan = 8192;
+	c->midiVolume = c->midiExpression = 16383;
+	c->midiRPN = 0xFFFF;
+	c->midiData = c->sustain = 0;
+	c->maxVoices = 0;
+	c->priority = TSF_DEFAULTPRIORITY;
+	c->panOffset = 0.0f;
+	c->gainDB = 0.0f;
+	c->pitchRange = 2.0f;
+	c->tuning = 0.0f;
+}
+
 static struct tsf_channel* tsf_channel_init(tsf* f, int channel)
 {
 	int i;
@@ -1776,29 +3427,17 @@ static struct tsf_channel* tsf_channel_init(tsf* f, int channel)
 	}
 	i = f->channels->channelNum;
 	f->channels->channelNum = channel + 1;
-	for (; i <= channel; i++)
-	{
-		struct tsf_channel* c = &f->channels->channels[i];
-		c->presetIndex = c->bank = 0;
-		c->pitchWheel = c->midiPan = 8192;
-		c->midiVolume = c->midiExpression = 16383;
-		c->midiRPN = 0xFFFF;
-		c->midiData = c->sustain = 0;
-		c->panOffset = 0.0f;
-		c->gainDB = 0.0f;
-		c->pitchRange = 2.0f;
-		c->tuning = 0.0f;
-	}
+	for (; i <= channel; i++) tsf_channel_setdefaults(&f->channels->channels[i]);
 	return &f->channels->channels[channel];
 }
 
 static void tsf_channel_applypitch(tsf* f, int channel, struct tsf_channel* c)
 {
-	struct tsf_voice *v, *vEnd;
+	struct tsf_voice *v; struct tsf_voice_note* n; int i;
 	float pitchShift = (c->pitchWheel == 8192 ? c->tuning : ((c->pitchWheel / 16383.0f * c->pitchRange * 2.0f) - c->pitchRange + c->tuning));
-	for (v = f->voices, vEnd = v + f->voiceNum; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel)
-			tsf_voice_calcpitchratio(v, pitchShift, f->outSampleRate);
+	for (i = *tsf_voice_channel_bucket(f, channel); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], n = &f->voiceNotes[i])->playingChannel == channel)
+			tsf_voice_calcpitchratio(v, n->playingKey, pitchShift, f->outSampleRate);
 }
 
 TSFDEF int tsf_channel_set_presetindex(tsf* f, int channel, int preset_index)
@@ -1853,11 +3492,11 @@ TSFDEF int tsf_channel_set_bank_preset(tsf* f, int channel, int bank, int preset
 
 TSFDEF int tsf_channel_set_pan(tsf* f, int channel, float pan)
 {
-	struct tsf_voice *v, *vEnd;
+	struct tsf_voice *v; int i;
 	struct tsf_channel *c = tsf_channel_init(f, channel);
 	if (!c) return 0;
-	for (v = f->voices, vEnd = v + f->voiceNum; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel)
+	for (i = *tsf_voice_channel_bucket(f, channel); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], f->voiceNotes[i].playingChannel == channel))
 		{
 			float newpan = v->region->pan + pan - 0.5f;
 			if      (newpan <= -0.5f) { v->panFactorLeft = 1.0f; v->panFactorRight = 0.0f; }
@@ -1871,12 +3510,12 @@ TSFDEF int tsf_channel_set_pan(tsf* f, int channel, float pan)
 TSFDEF int tsf_channel_set_volume(tsf* f, int channel, float volume)
 {
 	float gainDB = tsf_gainToDecibels(volume), gainDBChange;
-	struct tsf_voice *v, *vEnd;
+	struct tsf_voice *v; int i;
 	struct tsf_channel *c = tsf_channel_init(f, channel);
 	if (!c) return 0;
 	if (gainDB == c->gainDB) return 1;
-	for (v = f->voices, vEnd = v + f->voiceNum, gainDBChange = gainDB - c->gainDB; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel)
+	for (i = *tsf_voice_channel_bucket(f, channel), gainDBChange = gainDB - c->gainDB; i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], f->voiceNotes[i].playingChannel == channel))
 			v->noteGainDB += gainDBChange;
 	c->gainDB = gainDB;
 	return 1;
@@ -1912,6 +3551,22 @@ TSFDEF int tsf_channel_set_tuning(tsf* f, int channel, float tuning)
 	return 1;
 }
 
+TSFDEF int tsf_channel_set_polyphony(tsf* f, int channel, int max_voices)
+{
+	struct tsf_channel *c = tsf_channel_init(f, channel);
+	if (!c) return 0;
+	c->maxVoices = (unsigned short)(max_voices <= 0 ? 0 : (max_voices > 0xFFFF ? 0xFFFF : max_voices));
+	return 1;
+}
+
+TSFDEF int tsf_channel_set_priority(tsf* f, int channel, int priority)
+{
+	struct tsf_channel *c = tsf_channel_init(f, channel);
+	if (!c) return 0;
+	c->priority = (unsigned short)(priority <= 0 ? 0 : (priority > 127 ? 127 : priority));
+	return 1;
+}
+
 TSFDEF int tsf_channel_set_sustain(tsf* f, int channel, int flag_sustain)
 {
 	struct tsf_channel *c = tsf_channel_init(f, channel);
@@ -1921,9 +3576,9 @@ TSFDEF int tsf_channel_set_sustain(tsf* f, int channel, int flag_sustain)
 	//Turning on sustain does no action now, just starts note_off behaving differently
 	if (flag_sustain) return 1;
 	//Turning off sustain, actually end voices that got a note_off and were set to heldSustain status
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel && v->ampenv.segment < TSF_SEGMENT_RELEASE && v->heldSustain)
+	struct tsf_voice *v; struct tsf_voice_note *n; int i;
+	for (i = *tsf_voice_channel_bucket(f, channel); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], n = &f->voiceNotes[i])->playingChannel == channel && v->ampenv.segment < TSF_SEGMENT_RELEASE && n->heldSustain)
 			tsf_voice_end(f, v);
 	return 1;
 }
@@ -1943,23 +3598,26 @@ TSFDEF int tsf_channel_note_on(tsf* f, int channel, int key, float vel)
 TSFDEF void tsf_channel_note_off(tsf* f, int channel, int key)
 {
 	unsigned sustain;
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum, *vMatchFirst = TSF_NULL, *vMatchLast = TSF_NULL;
-	for (; v != vEnd; v++)
+	struct tsf_voice *v;
+	struct tsf_voice_note *n;
+	unsigned int matchPlayIndex = 0;
+	int i, first = *tsf_voice_key_bucket(f, channel, key), matchFound = 0;
+	for (i = first; i != -1; i = n->links[TSF_VOICE_INDEX_KEY].next)
 	{
-		//Find the first and last entry in the voices list with matching channel, key and look up the smallest play index
-		if (v->playingPreset == -1 || v->playingChannel != channel || v->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE || v->heldSustain) continue;
-		else if (!vMatchFirst || v->playIndex < vMatchFirst->playIndex) vMatchFirst = vMatchLast = v;
-		else if (v->playIndex == vMatchFirst->playIndex) vMatchLast = v;
+		//Look up the smallest play index of the active voices with matching channel and key
+		v = &f->voices[i], n = &f->voiceNotes[i];
+		if (n->playingChannel != channel || n->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE || n->heldSustain) continue;
+		else if (!matchFound || n->playIndex < matchPlayIndex) matchFound = 1, matchPlayIndex = n->playIndex;
 	}
-	if (!vMatchFirst) return;
-	for (sustain = f->channels->channels[channel].sustain, v = vMatchFirst; v <= vMatchLast; v++)
+	if (!matchFound) return;
+	for (sustain = f->channels->channels[channel].sustain, i = first; i != -1; i = n->links[TSF_VOICE_INDEX_KEY].next)
 	{
 		//Stop all voices with matching channel, key and the smallest play index which was enumerated above
-		if (v != vMatchFirst && v != vMatchLast &&
-			(v->playIndex != vMatchFirst->playIndex || v->playingPreset == -1 || v->playingChannel != channel || v->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE)) continue;
+		v = &f->voices[i], n = &f->voiceNotes[i];
+		if (n->playIndex != matchPlayIndex || n->playingChannel != channel || n->playingKey != key || v->ampenv.segment >= TSF_SEGMENT_RELEASE) continue;
 		//Don't turn off if sustain is active, just mark as held by sustain so we don't forget it
 		if (sustain)
-			v->heldSustain = 1;
+			n->heldSustain = 1;
 		else
 			tsf_voice_end(f, v);
 	}
@@ -1968,17 +3626,17 @@ TSFDEF void tsf_channel_note_off(tsf* f, int channel, int key)
 TSFDEF void tsf_channel_note_off_all(tsf* f, int channel)
 {
 	//Ignore sustain channel settings, note_off_all overrides
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel && v->ampenv.segment < TSF_SEGMENT_RELEASE)
+	struct tsf_voice *v; int i;
+	for (i = *tsf_voice_channel_bucket(f, channel); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], f->voiceNotes[i].playingChannel == channel) && v->ampenv.segment < TSF_SEGMENT_RELEASE)
 			tsf_voice_end(f, v);
 }
 
 TSFDEF void tsf_channel_sounds_off_all(tsf* f, int channel)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1 && v->playingChannel == channel && (v->ampenv.segment < TSF_SEGMENT_RELEASE || v->ampenv.parameters.release))
+	struct tsf_voice *v; struct tsf_voice_note *n; int i;
+	for (i = *tsf_voice_channel_bucket(f, channel); i != -1; i = f->voiceNotes[i].links[TSF_VOICE_INDEX_CHANNEL].next)
+		if ((v = &f->voices[i], n = &f->voiceNotes[i])->playingChannel == channel && (v->ampenv.segment < TSF_SEGMENT_RELEASE || n->ampenv.release))
 			tsf_voice_endquick(f, v);
 }
 
@@ -2072,6 +3730,188 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel)
 	return (f->channels && channel < f->channels->channelNum ? f->channels->channels[channel].tuning : 0.0f);
 }
 
+TSFDEF int tsf_channel_get_polyphony(tsf* f, int channel)
+{
+	return (f->channels && channel < f->channels->channelNum ? f->channels->channels[channel].maxVoices : 0);
+}
+
+TSFDEF int tsf_channel_get_priority(tsf* f, int channel)
+{
+	return (f->channels && channel < f->channels->channelNum ? f->channels->channels[channel].priority : TSF_DEFAULTPRIORITY);
+}
+
+// Assigned field by field, so the unused bits of a cleared target stay cleared and states compare with memcmp
+static void tsf_channel_copyfields(struct tsf_channel* dst, const struct tsf_channel* src)
+{
+	dst->presetIndex = src->presetIndex;
+	dst->bank = src->bank;
+	dst->pitchWheel = src->pitchWheel;
+	dst->midiPan = src->midiPan;
+	dst->midiVolume = src->midiVolume;
+	dst->midiExpression = src->midiExpression;
+	dst->midiRPN = src->midiRPN;
+	dst->midiData = src->midiData;
+	dst->sustain = src->sustain;
+	dst->maxVoices = src->maxVoices;
+	dst->priority = src->priority;
+	dst->panOffset = src->panOffset;
+	dst->gainDB = src->gainDB;
+	dst->pitchRange = src->pitchRange;
+	dst->tuning = src->tuning;
+}
+
+TSFDEF int tsf_channel_get_state(tsf* f, int channel, void* buffer, int size)
+{
+	struct tsf_channel c;
+	if (!buffer || size < (int)sizeof(c)) return (int)sizeof(c);
+	TSF_MEMSET(&c, 0, sizeof(c));
+	if (f->channels && channel < f->channels->channelNum) tsf_channel_copyfields(&c, &f->channels->channels[channel]);
+	else tsf_channel_setdefaults(&c);
+	TSF_MEMCPY(buffer, &c, sizeof(c));
+	return (int)sizeof(c);
+}
+
+TSFDEF int tsf_channel_set_state(tsf* f, int channel, const void* buffer, int size)
+{
+	struct tsf_channel c, *dst;
+	if (!buffer || size != (int)sizeof(c)) return 0;
+	TSF_MEMCPY(&c, buffer, sizeof(c));
+	if (c.presetIndex >= f->presetNum) return 0;
+	if (!(dst = tsf_channel_init(f, channel))) return 0;
+	tsf_channel_copyfields(dst, &c);
+	return 1;
+}
+
+// Fixed part of a snapshot, followed by the tsf_voice and tsf_voice_note arrays and the channels
+struct tsf_snapshot_header
+{
+	int size;
+	const float* fontSamples;
+	float outSampleRate;
+	int voiceNum, activeVoiceNum, activeVoiceFirst, freeVoiceFirst, channelNum, activeChannel;
+	int keyVoiceFirst[TSF_VOICE_KEYBUCKETS], channelVoiceFirst[TSF_VOICE_CHANNELBUCKETS], groupVoiceFirst[TSF_VOICE_GROUPBUCKETS];
+	unsigned int voicePlayIndex;
+};
+
+static int tsf_snapshot_size(int voiceNum, int channelNum)
+{
+	return (int)(sizeof(struct tsf_snapshot_header) + voiceNum * (sizeof(struct tsf_voice) + sizeof(struct tsf_voice_note)) + channelNum * sizeof(struct tsf_channel));
+}
+
+TSFDEF int tsf_snapshot(const tsf* f, void* buffer, int size)
+{
+	struct tsf_snapshot_header h;
+	char* out = (char*)buffer;
+	int channelNum = (f->channels ? f->channels->channelNum : 0);
+	int total = tsf_snapshot_size(f->voiceNum, channelNum);
+	if (!buffer || size < total) return total;
+
+	// Voices keep their region pointers, which stay valid for every instance sharing the soundfont
+	TSF_MEMSET(&h, 0, sizeof(h));
+	h.size = total;
+	h.fontSamples = f->fontSamples;
+	h.outSampleRate = f->outSampleRate;
+	h.voiceNum = f->voiceNum;
+	h.activeVoiceNum = f->activeVoiceNum;
+	h.activeVoiceFirst = f->activeVoiceFirst;
+	h.freeVoiceFirst = f->freeVoiceFirst;
+	h.channelNum = channelNum;
+	h.activeChannel = (f->channels ? f->channels->activeChannel : 0);
+	TSF_MEMCPY(h.keyVoiceFirst, f->keyVoiceFirst, sizeof(h.keyVoiceFirst));
+	TSF_MEMCPY(h.channelVoiceFirst, f->channelVoiceFirst, sizeof(h.channelVoiceFirst));
+	TSF_MEMCPY(h.groupVoiceFirst, f->groupVoiceFirst, sizeof(h.groupVoiceFirst));
+	h.voicePlayIndex = f->voicePlayIndex;
+	TSF_MEMCPY(out, &h, sizeof(h));
+	out += sizeof(h);
+	if (f->voiceNum)
+	{
+		TSF_MEMCPY(out, f->voices, f->voiceNum * sizeof(struct tsf_voice));
+		out += f->voiceNum * sizeof(struct tsf_voice);
+		TSF_MEMCPY(out, f->voiceNotes, f->voiceNum * sizeof(struct tsf_voice_note));
+		out += f->voiceNum * sizeof(struct tsf_voice_note);
+	}
+	if (channelNum) TSF_MEMCPY(out, f->channels->channels, channelNum * sizeof(struct tsf_channel));
+	return total;
+}
+
+// Attach a restored voice again to the one-shot cache entry it was attached to in the snapshot, if this
+// instance still holds a recording of the same key with the frames the voice is yet to read. Recordings
+// are the same for the same key, so one evicted and recorded again since will do. Otherwise the voice
+// renders on its own, with its filter primed if it was reading (which may differ in rounding).
+static void tsf_voice_oneshot_restore(tsf* f, struct tsf_voice* v)
+{
+	struct tsf_oneshots* c = f->oneshots;
+	struct tsf_oneshot* e = v->oneshot;
+	const struct tsf_voice_note* n = tsf_voice_note(f, v);
+	int frame = v->oneshotFrame, i;
+	v->oneshot = TSF_NULL;
+	v->oneshotFrame = -1;
+	if (!c || !e || e < (struct tsf_oneshot*)(c + 1) || e >= (struct tsf_oneshot*)(c + 1) + c->pageNum) return;
+	if (e->region != v->region || e->pitchRatio != n->oneshotPitchRatio || e->resample != n->oneshotResample || e->filter != n->oneshotFilter) return;
+	// At the end of the recording the voice can only go on as its recorder, which has a filter state of its own
+	if (frame > e->length || (frame == e->length && (e->complete || e->recorder != -1 || v->lowpass.stale))) frame = -1;
+	if (!e->refs) tsf_oneshot_unlink(c, e);
+	if (frame != -1 && frame == e->length) e->recorder = (int)(v - f->voices);
+	e->refs++;
+	v->oneshot = e;
+	v->oneshotFrame = frame;
+	for (v->oneshotPage = e->first, i = (frame > 0 ? frame / TSF_ONESHOT_PAGE : 0); i; i--) v->oneshotPage = v->oneshotPage->next;
+}
+
+TSFDEF int tsf_restore(tsf* f, const void* buffer, int size)
+{
+	struct tsf_snapshot_header h;
+	const char* in = (const char*)buffer;
+	int i;
+	if (!buffer || size < (int)sizeof(h)) return 0;
+	TSF_MEMCPY(&h, in, sizeof(h));
+	in += sizeof(h);
+	if (h.fontSamples != f->fontSamples || h.outSampleRate != f->outSampleRate) return 0;
+	if (h.voiceNum < 0 || h.voiceNum > (size - (int)sizeof(h)) / (int)(sizeof(struct tsf_voice) + sizeof(struct tsf_voice_note))) return 0;
+	if (h.channelNum < 0 || h.channelNum > (size - (int)sizeof(h)) / (int)sizeof(struct tsf_channel)) return 0;
+	if (h.size != tsf_snapshot_size(h.voiceNum, h.channelNum) || size < h.size) return 0;
+	if (h.voiceNum > f->voiceNum && !tsf_voices_resize(f, h.voiceNum)) return 0;
+	if (h.channelNum && !tsf_channel_init(f, h.channelNum - 1)) return 0;
+
+	// The voices let go of their one-shot cache entries, restored voices take theirs again below
+	for (i = f->activeVoiceFirst; i != -1; i = f->voices[i].listNext) tsf_voice_oneshot_release(f, &f->voices[i]);
+	if (h.voiceNum)
+	{
+		TSF_MEMCPY(f->voices, in, h.voiceNum * sizeof(struct tsf_voice));
+		in += h.voiceNum * sizeof(struct tsf_voice);
+		TSF_MEMCPY(f->voiceNotes, in, h.voiceNum * sizeof(struct tsf_voice_note));
+		in += h.voiceNum * sizeof(struct tsf_voice_note);
+	}
+	for (i = 0; i != h.voiceNum; i++)
+	{
+		if (f->voices[i].playingPreset != -1) tsf_voice_oneshot_restore(f, &f->voices[i]);
+		else f->voices[i].oneshot = TSF_NULL, f->voices[i].oneshotFrame = -1;
+	}
+	// Voices added after the snapshot was taken go to the free list
+	f->freeVoiceFirst = h.freeVoiceFirst;
+	for (i = f->voiceNum - 1; i >= h.voiceNum; i--)
+	{
+		f->voices[i].playingPreset = -1;
+		f->voices[i].listNext = f->freeVoiceFirst;
+		f->freeVoiceFirst = i;
+	}
+	f->activeVoiceNum = h.activeVoiceNum;
+	f->activeVoiceFirst = h.activeVoiceFirst;
+	TSF_MEMCPY(f->keyVoiceFirst, h.keyVoiceFirst, sizeof(h.keyVoiceFirst));
+	TSF_MEMCPY(f->channelVoiceFirst, h.channelVoiceFirst, sizeof(h.channelVoiceFirst));
+	TSF_MEMCPY(f->groupVoiceFirst, h.groupVoiceFirst, sizeof(h.groupVoiceFirst));
+	f->voicePlayIndex = h.voicePlayIndex;
+
+	if (h.channelNum)
+	{
+		TSF_MEMCPY(f->channels->channels, in, h.channelNum * sizeof(struct tsf_channel));
+		f->channels->channelNum = h.channelNum;
+		f->channels->activeChannel = h.activeChannel;
+	}
+	else if (f->channels) { TSF_FREE(f->channels); f->channels = TSF_NULL; }
+	return 1;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,422 @@
+// tsf_bench.cpp
+// Render benchmarks of the bridge and tsf.h
+//
+// Build (next to tsf_bridge.cpp, which it includes to reach the tsf.h internals it measures):
+//   g++ -O3 -std=c++11 tsf_bench.cpp -o tsf_bench -lpthread
+//   cl /O2 /EHsc tsf_bench.cpp
+//
+// Usage: tsf_bench [options] font.sf2 [threads] [voices] [math]
+//   -s SECONDS   Audio rendered per measurement (default 10)
+//   -r RATE      Sample rate (default 44100)
+//   -v VOICES    Voices kept playing by threads and math (default 256)
+//   -j THREADS   Highest thread count of the sweep (default 16)
+//   -p PRESET    Bank 0 preset the notes play (default 0)
+//
+// threads  Renders the same notes serially and with 1 to 16 render threads
+//          (tsf_bridge_set_render_threads) and prints the speed of every thread count relative
+//          to real time and to 1 thread. The output of every thread count must match 1 thread
+//          bit for bit, a mismatch fails the run.
+// voices   Renders 64, 256 and 1024 voices serially and prints the time per voice and frame, the
+//          bytes of render state per voice and, on Linux, the L1 data cache and last level cache
+//          misses per voice and block read from the CPU's counters (perf_event_open). Where the
+//          kernel doesn't grant the counters (perf_event_paranoid, virtual machines) they print n/a.
+// math     Measures the largest relative error of the fast 2^x approximations of tsf.h
+//          (tsf_set_fast_math) over their whole input range, times them against math.h for the
+//          conversions the render loop makes, with the largest relative difference between the
+//          two over the inputs each conversion sees, then renders the note script with both.
+//          The run fails if an approximation's error exceeds TSF_FASTMATH_TOLERANCE.
+//
+// Every measurement renders the same note script on a fresh synth sharing the loaded SoundFont.
+// Only the tsf_bridge_render calls are timed.
+
+#include "tsf_bridge.cpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Frames per tsf_bridge_render call, one render pass of the thread pool
+#define TSF_BENCH_BLOCK 512
+
+// Notes started per block on top of the ones replacing ended voices, as a share of the voices
+#define TSF_BENCH_CHURN 32
+
+// Calls per conversion timed by the math benchmark, and distinct inputs they cycle through
+#define TSF_BENCH_MATH_CALLS 20000000
+#define TSF_BENCH_MATH_INPUTS 4096
+
+// Voice counts of the voices benchmark
+static const int BENCH_VOICE_COUNTS[] = { 64, 256, 1024 };
+
+struct BenchOptions {
+    double seconds;
+    int sampleRate;
+    int voices;
+    int maxThreads;
+    int preset;
+};
+
+// ============================================
+// Cache miss counters
+// ============================================
+
+#define TSF_BENCH_COUNTERS 2
+
+// Hardware counters of the calling thread, counting only while started
+struct BenchCounters {
+    int fds[TSF_BENCH_COUNTERS];  // L1 data cache read misses, last level cache misses, -1 if unavailable
+};
+
+static void counters_open(BenchCounters* counters) {
+    for (int i = 0; i < TSF_BENCH_COUNTERS; i++) counters->fds[i] = -1;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    for (int i = 0; i < TSF_BENCH_COUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        if (i == 0) {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        } else {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+static void counters_enable(BenchCounters* counters, bool enable) {
+#ifdef __linux__
+    for (int i = 0; i < TSF_BENCH_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) ioctl(counters->fds[i], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+#else
+    (void)counters;
+    (void)enable;
+#endif
+}
+
+// Returns -1 for a counter that isn't available
+static long long counters_read(const BenchCounters* counters, int index) {
+#ifdef __linux__
+    unsigned long long value;
+    if (counters->fds[index] >= 0 && read(counters->fds[index], &value, sizeof(value)) == (ssize_t)sizeof(value)) return (long long)value;
+#else
+    (void)counters;
+    (void)index;
+#endif
+    return -1;
+}
+
+static void counters_close(BenchCounters* counters) {
+#ifdef __linux__
+    for (int i = 0; i < TSF_BENCH_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) close(counters->fds[i]);
+    }
+#endif
+    (void)counters;
+}
+
+// ============================================
+// Note script
+// ============================================
+
+// Plays the script on synth for options.seconds and returns the render time in seconds.
+// The first block starts `voices` notes spread over the 16 channels. Every later block starts
+// voices / TSF_BENCH_CHURN more, which steal the oldest, plus one for every voice that ended.
+// All notes are picked from a counter, so every run plays the same notes.
+// counters (optional) count during the render calls, voiceFrames (optional) receives the frames
+// rendered times the voices active in them.
+static double bench_render(TSFHandle synth, const BenchOptions& options, std::vector<float>& out, BenchCounters* counters = NULL, double* voiceFrames = NULL) {
+    long long frames = (long long)(options.seconds * options.sampleRate);
+    out.resize((size_t)frames * 2);
+    for (int c = 0; c < 16; c++) tsf_bridge_set_preset(synth, c, 0, options.preset);
+
+    unsigned int counter = 0;
+    int churn = options.voices / TSF_BENCH_CHURN;
+    if (churn < 1) churn = 1;
+    double seconds = 0;
+    if (voiceFrames) *voiceFrames = 0;
+    for (long long start = 0; start < frames; start += TSF_BENCH_BLOCK) {
+        int starts = (start == 0 ? options.voices : churn + options.voices - tsf_bridge_active_voices(synth));
+        for (int i = 0; i < starts; i++, counter++) {
+            tsf_bridge_note_on(synth, counter % 16, 36 + (counter * 7) % 48, 64 + counter % 64);
+        }
+        int count = (int)(frames - start < TSF_BENCH_BLOCK ? frames - start : TSF_BENCH_BLOCK);
+        if (counters) counters_enable(counters, true);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        tsf_bridge_render(synth, out.data() + start * 2, count);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (counters) counters_enable(counters, false);
+        if (voiceFrames) *voiceFrames += (double)count * tsf_bridge_active_voices(synth);
+    }
+    return seconds;
+}
+
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    float diff = 0;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        float d = fabsf(a[i] - b[i]);
+        if (d > diff) diff = d;
+    }
+    return diff;
+}
+
+// ============================================
+// Benchmarks
+// ============================================
+
+// Creates a synth for a run, with the voices preallocated so that no run allocates while rendering
+static TSFHandle bench_synth(TSFHandle font, const BenchOptions& options) {
+    TSFHandle synth = tsf_bridge_init_copy(font);
+    if (!synth) return NULL;
+    tsf_bridge_set_output(synth, options.sampleRate, 2);
+    tsf_bridge_set_max_voices(synth, options.voices);
+    return synth;
+}
+
+// Thread scaling of tsf_bridge_set_render_threads. Runs serially (0) first, then 1 to maxThreads.
+static bool bench_threads(TSFHandle font, const BenchOptions& options) {
+    std::vector<double> seconds;
+    std::vector<float> reference, serial, out;
+    std::vector<float> differences;
+    for (int threads = 0; threads <= options.maxThreads; threads++) {
+        TSFHandle synth = bench_synth(font, options);
+        if (!synth) return false;
+        if (tsf_bridge_set_render_threads(synth, threads) != threads) {
+            tsf_bridge_close(synth);
+            break;
+        }
+        seconds.push_back(bench_render(synth, options, threads ? out : serial));
+        tsf_bridge_close(synth);
+        if (threads == 1) reference.swap(out);
+        else if (threads > 1) differences.push_back(out == reference ? 0.0f : max_difference(out, reference));
+    }
+
+    printf("threads: %d voices, %.1f s of audio per run\n", options.voices, options.seconds);
+    printf("  threads  render s  real time  vs 1 thread  output vs 1 thread\n");
+    bool identical = true;
+    for (size_t i = 0; i < seconds.size(); i++) {
+        char label[16], speedup[16], output[64];
+        if (i) snprintf(label, sizeof(label), "%d", (int)i);
+        else snprintf(label, sizeof(label), "serial");
+        if (seconds.size() > 1 && seconds[i] > 0) snprintf(speedup, sizeof(speedup), "%.2fx", seconds[1] / seconds[i]);
+        else snprintf(speedup, sizeof(speedup), "-");
+        if (i == 0) {
+            // Sums the voices in a different order than the pool, so it differs by float rounding
+            if (seconds.size() > 1) snprintf(output, sizeof(output), "max diff %g", max_difference(serial, reference));
+            else snprintf(output, sizeof(output), "-");
+        } else if (i == 1) {
+            snprintf(output, sizeof(output), "reference");
+        } else if (differences[i - 2] == 0.0f) {
+            snprintf(output, sizeof(output), "identical");
+        } else {
+            snprintf(output, sizeof(output), "DIFFERS by up to %g", differences[i - 2]);
+            identical = false;
+        }
+        printf("  %7s  %8.3f  %8.1fx  %11s  %s\n", label, seconds[i], seconds[i] > 0 ? options.seconds / seconds[i] : 0.0, speedup, output);
+    }
+    if ((int)seconds.size() <= options.maxThreads) printf("  parallel rendering is not available beyond %d thread%s\n", (int)seconds.size() - 1, seconds.size() == 2 ? "" : "s");
+    return identical;
+}
+
+// Voice count scaling of the serial renderer. A voice's render state is the tsf_voice the render
+// loop reads; the note data in tsf_voice_note (key, channel, envelope setup) is only read by note
+// commands.
+static bool bench_voices(TSFHandle font, const BenchOptions& options) {
+    printf("voices: serial, %.1f s of audio per run, render state %d bytes per voice (note data %d more)\n",
+           options.seconds, (int)sizeof(struct tsf_voice), (int)sizeof(struct tsf_voice_note));
+    printf("  voices  render s  real time  ns/voice-frame  L1d misses/voice-block  LLC misses/voice-block\n");
+    std::vector<float> out;
+    for (size_t v = 0; v < sizeof(BENCH_VOICE_COUNTS) / sizeof(BENCH_VOICE_COUNTS[0]); v++) {
+        BenchOptions run = options;
+        run.voices = BENCH_VOICE_COUNTS[v];
+        TSFHandle synth = bench_synth(font, run);
+        if (!synth) return false;
+        BenchCounters counters;
+        counters_open(&counters);
+        double voiceFrames;
+        double seconds = bench_render(synth, run, out, &counters, &voiceFrames);
+        tsf_bridge_close(synth);
+
+        // Blocks of TSF_BENCH_BLOCK frames rendered by a voice
+        double voiceBlocks = voiceFrames / TSF_BENCH_BLOCK;
+        char misses[TSF_BENCH_COUNTERS][32];
+        for (int i = 0; i < TSF_BENCH_COUNTERS; i++) {
+            long long count = counters_read(&counters, i);
+            if (count >= 0 && voiceBlocks > 0) snprintf(misses[i], sizeof(misses[i]), "%.2f", count / voiceBlocks);
+            else snprintf(misses[i], sizeof(misses[i]), "n/a");
+        }
+        counters_close(&counters);
+        printf("  %6d  %8.3f  %8.1fx  %14.2f  %22s  %22s\n", run.voices, seconds, seconds > 0 ? options.seconds / seconds : 0.0,
+               voiceFrames > 0 ? seconds * 1e9 / voiceFrames : 0.0, misses[0], misses[1]);
+    }
+    return true;
+}
+
+// A conversion of the render loop, math.h or fast by flag, and the range of inputs it gets while rendering
+struct MathConversion {
+    const char* name;
+    double (*convert)(TSF_BOOL fastMath, double x);
+    double from, to;
+};
+
+#ifndef TSF_NO_FASTMATH
+static double math_timecents(TSF_BOOL fastMath, double x) { return tsf_render_timecents2Secsd(fastMath, x); }
+static double math_cents(TSF_BOOL fastMath, double x) { return tsf_render_cents2Hertz(fastMath, (float)x); }
+static double math_decibels(TSF_BOOL fastMath, double x) { return tsf_render_decibelsToGain(fastMath, (float)x); }
+static double math_exp(TSF_BOOL fastMath, double x) { return tsf_render_expf(fastMath, (float)x); }
+
+static const MathConversion BENCH_MATH[] = {
+    // Pitch ratio of dynamic pitch voices: key, tuning, LFOs and pitch envelope in cents
+    { "pitch (timecents2Secsd)", math_timecents, -12000.0, 12000.0 },
+    // Filter cutoff of voices with a filter LFO or envelope, 1500 to 13500 cents is 20 Hz to 20 kHz
+    { "cutoff (cents2Hertz)", math_cents, 1500.0, 13500.0 },
+    // Note gain of tremolo voices
+    { "gain (decibelsToGain)", math_decibels, -99.0, 24.0 },
+    // Exponential envelope segments, slope times block length
+    { "envelope (expf)", math_exp, -16.0, 0.0 },
+};
+
+// Largest relative error of approximation against exp2 from math.h in double precision,
+// over steps inputs spread across the range the approximations cover
+template <typename T>
+static double exp2_error(T (*approximation)(T), int steps) {
+    double error = 0;
+    for (int i = 0; i <= steps; i++) {
+        T x = (T)(-126.0 + 253.0 * i / steps);
+        double exact = exp2((double)x);
+        double e = fabs((double)approximation(x) - exact) / exact;
+        if (e > error) error = e;
+    }
+    return error;
+}
+#endif
+
+// Fast math against math.h, per call and over a whole render
+static bool bench_math(TSFHandle font, const BenchOptions& options) {
+#ifdef TSF_NO_FASTMATH
+    (void)font;
+    (void)options;
+    printf("math: the fast approximations are compiled out (TSF_NO_FASTMATH)\n");
+    return true;
+#else
+    double errorf = exp2_error(tsf_fast_exp2f, 10000000), errord = exp2_error(tsf_fast_exp2d, 10000000);
+    bool ok = (errorf <= TSF_FASTMATH_TOLERANCE && errord <= TSF_FASTMATH_TOLERANCE);
+    printf("math: largest relative error of 2^x over [-126, 127] (tolerance %g)\n", TSF_FASTMATH_TOLERANCE);
+    printf("  tsf_fast_exp2f %.2e%s, tsf_fast_exp2d %.2e%s\n", errorf, errorf > TSF_FASTMATH_TOLERANCE ? " ABOVE TOLERANCE" : "",
+           errord, errord > TSF_FASTMATH_TOLERANCE ? " ABOVE TOLERANCE" : "");
+
+    // The float conversions take 2^x of a rounded float argument, which moves the result of
+    // either by up to ln(2) * |x| * 6e-8 relative, more than the approximation for large x
+    printf("  %-24s  libm ns  fast ns  speedup  max relative difference\n", "conversion");
+    std::vector<double> inputs(TSF_BENCH_MATH_INPUTS);
+    for (size_t c = 0; c < sizeof(BENCH_MATH) / sizeof(BENCH_MATH[0]); c++) {
+        const MathConversion& m = BENCH_MATH[c];
+        for (int i = 0; i < TSF_BENCH_MATH_INPUTS; i++) inputs[i] = m.from + (m.to - m.from) * i / (TSF_BENCH_MATH_INPUTS - 1);
+
+        double difference = 0;
+        for (int i = 0; i <= 1000000; i++) {
+            double x = m.from + (m.to - m.from) * i / 1000000, libm = m.convert(TSF_FALSE, x);
+            if (libm == 0) continue;
+            double d = fabs(m.convert(TSF_TRUE, x) - libm) / libm;
+            if (d > difference) difference = d;
+        }
+
+        double ns[2];
+        volatile double sink = 0;
+        for (int fast = 0; fast < 2; fast++) {
+            double sum = 0;
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < TSF_BENCH_MATH_CALLS; i++) sum += m.convert((TSF_BOOL)fast, inputs[i & (TSF_BENCH_MATH_INPUTS - 1)]);
+            ns[fast] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e9 / TSF_BENCH_MATH_CALLS;
+            sink = sink + sum;
+        }
+        (void)sink;
+        printf("  %-24s  %7.2f  %7.2f  %6.2fx  %.2e\n", m.name, ns[0], ns[1], ns[1] > 0 ? ns[0] / ns[1] : 0.0, difference);
+    }
+
+    // The note script with each, the output differs by the conversion errors only
+    std::vector<float> out[2];
+    double seconds[2];
+    for (int fast = 0; fast < 2; fast++) {
+        TSFHandle synth = bench_synth(font, options);
+        if (!synth) return false;
+        tsf_set_fast_math(((TSFSynth*)synth)->synth, fast);
+        seconds[fast] = bench_render(synth, options, out[fast]);
+        tsf_bridge_close(synth);
+    }
+    printf("  render of %d voices, %.1f s: libm %.3f s, fast %.3f s (%.2fx), max output difference %g\n", options.voices, options.seconds,
+           seconds[0], seconds[1], seconds[1] > 0 ? seconds[0] / seconds[1] : 0.0, max_difference(out[0], out[1]));
+    return ok;
+#endif
+}
+
+// ============================================
+// Main
+// ============================================
+
+static void usage() {
+    fprintf(stderr,
+        "Usage: tsf_bench [options] font.sf2 [threads] [voices] [math]\n"
+        "  -s SECONDS   Audio rendered per measurement (default 10)\n"
+        "  -r RATE      Sample rate (default 44100)\n"
+        "  -v VOICES    Voices kept playing by threads and math (default 256)\n"
+        "  -j THREADS   Highest thread count of the sweep (default 16)\n"
+        "  -p PRESET    Bank 0 preset the notes play (default 0)\n"
+        "Runs every benchmark if none is named.\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = { 10.0, 44100, 256, 16, 0 };
+    const char* fontPath = NULL;
+    std::vector<const char*> benches;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strcmp(a, "-s") && i + 1 < argc) options.seconds = atof(argv[++i]);
+        else if (!strcmp(a, "-r") && i + 1 < argc) options.sampleRate = atoi(argv[++i]);
+        else if (!strcmp(a, "-v") && i + 1 < argc) options.voices = atoi(argv[++i]);
+        else if (!strcmp(a, "-j") && i + 1 < argc) options.maxThreads = atoi(argv[++i]);
+        else if (!strcmp(a, "-p") && i + 1 < argc) options.preset = atoi(argv[++i]);
+        else if (a[0] == '-') { usage(); return 1; }
+        else if (!fontPath) fontPath = a;
+        else if (!strcmp(a, "threads") || !strcmp(a, "voices") || !strcmp(a, "math")) benches.push_back(a);
+        else { usage(); return 1; }
+    }
+    if (!fontPath || options.seconds <= 0 || options.sampleRate <= 0 || options.voices < 1 || options.maxThreads < 1) {
+        usage();
+        return 1;
+    }
+    if (options.maxThreads > 16) options.maxThreads = 16;
+    if (benches.empty()) {
+        benches.push_back("threads");
+        benches.push_back("voices");
+        benches.push_back("math");
+    }
+
+    TSFHandle font = tsf_bridge_init(fontPath);
+    if (!font) {
+        fprintf(stderr, "Failed to load SoundFont: %s\n", fontPath);
+        return 1;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < benches.size(); i++) {
+        if (!strcmp(benches[i], "threads")) ok = bench_threads(font, options) && ok;
+        else if (!strcmp(benches[i], "voices")) ok = bench_voices(font, options) && ok;
+        else if (!strcmp(benches[i], "math")) ok = bench_math(font, options) && ok;
+    }
+    tsf_bridge_close(font);
+    return ok ? 0 : 1;
+}
@@ -11,155 +11,3488 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Emscripten builds without -pthread can't start threads, render on the calling thread there
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__) && !defined(TSF_BRIDGE_NO_THREADS)
+#define TSF_BRIDGE_NO_THREADS
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#ifndef TSF_BRIDGE_NO_THREADS
+#include <thread>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+#endif
+#endif
+
+// Parallel rendering limits (see tsf_bridge_set_render_threads)
+#define TSF_BRIDGE_MAX_RENDER_THREADS 16
+// Active voices are split into this many tasks independent of the thread count,
+// so the mix is bit-identical no matter how many threads render it
+#define TSF_BRIDGE_RENDER_TASKS 32
+// Frames rendered per parallel pass, bounds the size of the per-task buffers
+#define TSF_BRIDGE_RENDER_SLICE 512
+// Below this many active voices a pass is rendered serially on the calling thread
+#define TSF_BRIDGE_PARALLEL_MIN_VOICES 8
+// Voice limit applied when a render pool or the render thread starts without one (see tsf_bridge_set_max_voices)
+#define TSF_BRIDGE_DEFAULT_MAX_VOICES 256
+
+// Capacity of the scheduled event queue (see tsf_bridge_schedule_event)
+#ifndef TSF_BRIDGE_EVENT_QUEUE_SIZE
+#define TSF_BRIDGE_EVENT_QUEUE_SIZE 4096
+#endif
+
+// Capacity of the command ring between control threads and the render thread, a power of 2
+#ifndef TSF_BRIDGE_COMMAND_QUEUE_SIZE
+#define TSF_BRIDGE_COMMAND_QUEUE_SIZE 4096
+#endif
+
+// Commands that aren't MIDI events, numbered after the TSF_BRIDGE_EVENT_* status bytes
+#define TSF_BRIDGE_COMMAND_NOTE_OFF_ALL        0x100
+#define TSF_BRIDGE_COMMAND_CHANNEL_VOLUME      0x101
+#define TSF_BRIDGE_COMMAND_CLEAR_EVENTS        0x102
+#define TSF_BRIDGE_COMMAND_SEQUENCE_START      0x103
+#define TSF_BRIDGE_COMMAND_SEQUENCE_STOP       0x104
+#define TSF_BRIDGE_COMMAND_SEQUENCE_LOOP       0x105
+#define TSF_BRIDGE_COMMAND_SEQUENCE_TEMPO      0x106
+#define TSF_BRIDGE_COMMAND_CHANNEL_TUNING      0x107
+#define TSF_BRIDGE_COMMAND_CHANNEL_PITCH_WHEEL 0x108
+#define TSF_BRIDGE_COMMAND_CHANNEL_POLYPHONY   0x109
+#define TSF_BRIDGE_COMMAND_CHANNEL_PRIORITY    0x10A
+#define TSF_BRIDGE_COMMAND_CPU_BUDGET          0x10B
+#define TSF_BRIDGE_COMMAND_VIRTUALIZATION      0x10C
+#define TSF_BRIDGE_COMMAND_PHRASE_PLAY         0x10D
+#define TSF_BRIDGE_COMMAND_PHRASE_RELEASE      0x10E
+
+// CPU budget governor (see tsf_bridge_set_cpu_budget)
+#define TSF_BRIDGE_GOVERNOR_WINDOW 1024      // Frames timed at least before each decision
+#define TSF_BRIDGE_GOVERNOR_SMOOTHING 0.25f  // Weight of a new window in the average load
+#define TSF_BRIDGE_GOVERNOR_RESTORE 0.6f     // The average load has to stay below this fraction of the budget
+#define TSF_BRIDGE_GOVERNOR_HOLD 1.0         // for this many seconds of audio before a level is restored
+
+// Phrase cache (see tsf_bridge_set_phrase_cache)
+#define TSF_BRIDGE_PHRASE_PLAYERS 8          // Phrases playing at once, more are scheduled on the synth's voices
+#define TSF_BRIDGE_PHRASE_MAX_TAIL 10        // Seconds of release tail recorded at most after the end of a phrase
+#define TSF_BRIDGE_PHRASE_PAGE_FLOATS 1024   // Floats per page of the cache, recordings and their keys are chains of pages
+#define TSF_BRIDGE_PHRASE_CATCHUP_RATE 4     // Frames replayed per frame rendered while diverged plays catch up with their recordings
+#define TSF_BRIDGE_PHRASE_PENDING 64         // Channel changes a play holds back while catching up
+
+// Frames each instance renders at a time in tsf_bridge_render_mix, sets the size of its stack buffer.
+// Passes end a multiple of it after the last event split, like the slices of a parallel render.
+#define TSF_BRIDGE_MIX_BLOCK TSF_BRIDGE_RENDER_SLICE
+
+// Frames of float output rendered per pass when converting to int16 or planar output or mixing
+// instances are a multiple of this, so the passes keep the effect block (TSF_RENDER_EFFECTSAMPLEBLOCK) boundaries
+#define TSF_BRIDGE_CONVERT_ALIGN 64
+
+// Stream defaults (see tsf_bridge_stream_start)
+#define TSF_BRIDGE_STREAM_BLOCK 256
+#define TSF_BRIDGE_STREAM_MIN_CAPACITY 1024
+
+// Output gain in dB, leaves headroom for many voices playing at once
+#ifndef TSF_BRIDGE_GAIN_DB
+#define TSF_BRIDGE_GAIN_DB -6.0f
+#endif
+
+struct TSFRenderPool;
+struct TSFStream;
+struct TSFSynth;
+struct TSFFont;
+
+#ifndef TSF_BRIDGE_NO_THREADS
+static void tsf_bridge_render_float(TSFSynth* synth, float* out, int sample_count);
+#endif
+static void tsf_bridge_governor_reset(TSFSynth* synth, float budget);
+static void tsf_bridge_phrase_stop_all(TSFSynth* synth);
+static void tsf_bridge_phrase_free_all(TSFSynth* synth);
+
+// When a command takes effect
+enum TSFCommandTiming {
+    TSF_BRIDGE_NOW,         // At the start of the next render
+    TSF_BRIDGE_AT_OFFSET,   // time frames after the start of the next render
+    TSF_BRIDGE_AT_TIME      // At sample time time
+};
+
+// Note, controller or other channel change sent to the render thread
+struct TSFCommand {
+    int type;               // TSF_BRIDGE_EVENT_* or TSF_BRIDGE_COMMAND_*
+    int channel;
+    int data1;
+    int data2;
+    double value;           // Channel volume, sequencer start beat or tempo
+    TSFCommandTiming timing;
+    long long time;         // Sample time once the command is in the event queue
+};
+
+// Haxe and JavaScript write TSFBridgeEvent arrays byte by byte
+static_assert(sizeof(TSFBridgeEvent) == 12, "TSFBridgeEvent must be packed into 12 bytes");
+static_assert(TSF_BRIDGE_MAX_BUSES <= TSF_MAX_BUSES, "tsf_render_float_buses renders at most TSF_MAX_BUSES buses");
+static_assert(sizeof(TSFBridgeMidiHeader) == 24, "TSFBridgeMidiHeader must be packed into 24 bytes");
+static_assert(sizeof(TSFBridgeMidiEvent) == 12, "TSFBridgeMidiEvent must be packed into 12 bytes");
+static_assert(sizeof(TSFBridgeNote) == 24, "TSFBridgeNote must be packed into 24 bytes");
+static_assert(sizeof(TSFBridgeMidiCheckpoint) == 400, "TSFBridgeMidiCheckpoint must be packed into 400 bytes");
+static_assert(sizeof(TSFBridgeMidiIndexHeader) == 24, "TSFBridgeMidiIndexHeader must be packed into 24 bytes");
+static_assert(sizeof(TSFBridgeGovernorStats) == 112, "TSFBridgeGovernorStats must be packed into 112 bytes");
+
+// Cell of the command ring, sequence tells whether it's free for the producer of a position
+// or filled for the consumer (bounded MPMC queue by Dmitry Vyukov, with a single consumer)
+struct TSFCommandCell {
+    std::atomic<unsigned int> sequence;
+    TSFCommand command;
+};
+
+// Note on or off of a loaded sequence
+struct TSFSequenceEvent {
+    double beat;
+    int order;              // Sorts events at the same beat: offs, ons, then offs of zero-length notes
+    unsigned char on;
+    unsigned char channel;
+    unsigned char note;
+    unsigned char velocity;
+};
+
+struct TSFSequence {
+    TSFSequenceEvent* events;   // Sorted by beat
+    int count;
+    double length;              // Loop length in beats
+    unsigned int generation;    // Numbers the loads of all synths, a reused address never matches an old snapshot
+};
+
+// Last generation given to a loaded sequence
+static std::atomic<unsigned int> sequenceGeneration(0);
+
+// Built-in sequencer, the render thread owns everything but the atomics
+struct TSFSequencer {
+    TSFSequence* sequence;
+    unsigned int generation;            // Of sequence, 0 without one
+    std::atomic<TSFSequence*> pending;  // Loaded but not picked up by the render thread yet
+    std::atomic<TSFSequence*> retired;  // Replaced by the render thread, freed by the next load or close
+    bool playing;
+    bool loop;
+    double bpm;
+    int next;                           // Next event to dispatch
+    long long anchorSample;             // Sample time of anchorBeat, moved on start, tempo changes and loops
+    double anchorBeat;
+    double framesPerBeat;
+    unsigned char sounding[16 * 128];   // Notes the sequence started and didn't release yet
+    std::atomic<double> beat;           // Position at the end of the last render
+    std::atomic<int> playingState;
+};
+
+// CPU budget governor state, only touched by the render thread except for the published stats
+struct TSFGovernor {
+    float budget;
+    double renderStart;         // Clock at the start of the current render
+    double windowTime;          // Render time and frames of the window measured so far
+    int windowFrames;
+    int calmFrames;             // Frames the average load stayed low enough to restore a level
+    TSFBridgeGovernorStats stats;
+    // Copy for tsf_bridge_get_governor_stats, the render thread skips publishing while a reader holds the lock
+    TSFBridgeGovernorStats published;
+    std::atomic_flag publishLock;
+};
+
+// Phrase defined with tsf_bridge_phrase_define, its events don't change once it's published
+struct TSFPhrase {
+    TSFBridgeEvent* events;     // Sorted by frame offset, ending with note offs for the notes still held
+    int count;
+    int length;                 // Frames from the start to the end of the phrase
+    unsigned int channelMask;   // Bit n set if events are on channel n
+    int id;
+    int players;                // Players playing it, only touched by the render thread like released and key
+    bool released;
+    unsigned char* key;         // Key of its latest start, allocated with the phrase
+    int keySize;
+    TSFPhrase* retiredNext;
+};
+
+// Page of the cache's preallocated memory
+struct TSFPhrasePage {
+    TSFPhrasePage* next;
+    float data[TSF_BRIDGE_PHRASE_PAGE_FLOATS];
+};
+
+#define TSF_BRIDGE_PHRASE_PAGE_BYTES (TSF_BRIDGE_PHRASE_PAGE_FLOATS * (int)sizeof(float))
+
+// Recorded phrase, an entry of the LRU list
+struct TSFPhraseEntry {
+    unsigned long long hash;
+    int keySize;                // Render settings, events and channel states the audio was rendered with
+    int frames;                 // In the output channel layout
+    int capacity;               // Frames the pages of the audio have room for
+    TSFPhrasePage* first;       // Pages of the key followed by the pages of the audio
+    TSFPhrasePage* pcm;         // First page of the audio, pages hold whole frames
+    TSFPhrasePage* last;
+    int pages;
+    int readers;                // Players mixing it, not dropped meanwhile
+    TSFPhraseEntry* newer;
+    TSFPhraseEntry* older;      // Or the next free entry
+};
+
+enum TSFPhraseMode {
+    TSF_BRIDGE_PHRASE_IDLE,
+    TSF_BRIDGE_PHRASE_CACHED,       // Mixed from entry
+    TSF_BRIDGE_PHRASE_CATCHUP,      // Mixed from entry while its voices replay the phrase up to the frame mixed
+    TSF_BRIDGE_PHRASE_RECORDING,    // Rendered by its voices and copied into entry, which isn't in the cache yet
+    TSF_BRIDGE_PHRASE_LIVE          // Rendered by its voices
+};
+
+// Plays one phrase at a time, only touched by the render thread
+struct TSFPhrasePlayer {
+    TSFPhraseMode mode;
+    TSFPhrase* phrase;
+    TSFPhraseEntry* entry;
+    TSFPhrasePage* page;        // Page of entry holding the last frame mixed or recorded
+    int read;                   // Frames mixed from entry
+    tsf* voices;                // Copy of the synth rendering the phrase unless it's cached
+    int next;                   // Next event of the phrase to apply to the voices
+    int position;               // Frames played by the voices
+    TSFCommand pending[TSF_BRIDGE_PHRASE_PENDING]; // Channel changes for the voices once they caught up
+    int pendingCount;
+};
+
+// Phrase table and cache, the render thread owns everything but the table and the published stats
+struct TSFPhraseCache {
+    std::atomic<TSFPhrase*> phrases[TSF_BRIDGE_MAX_PHRASES]; // Defined phrases by id
+    std::atomic<TSFPhrase*> retired;  // Phrases the render thread dropped, freed by the control threads
+    TSFPhrasePlayer* players;   // TSF_BRIDGE_PHRASE_PLAYERS of them, NULL while the cache is off
+    int playing;                // Players that aren't idle
+    TSFPhraseEntry* newest;
+    TSFPhraseEntry* oldest;
+    int stateSize;              // Size of a tsf_channel_get_state
+    void* arena;                // Pages and entries, allocated by tsf_bridge_set_phrase_cache
+    int pageCount;
+    TSFPhrasePage* freePages;
+    TSFPhraseEntry* freeEntries;
+    TSFBridgePhraseCacheStats stats;
+    // Copy for tsf_bridge_get_phrase_cache_stats, like the governor's
+    TSFBridgePhraseCacheStats published;
+    std::atomic_flag publishLock;
+};
+
 // Internal struct to hold synth state
 struct TSFSynth {
     tsf* synth;
+    TSFFont* font;                // Font the synth is a copy of, holds one of its references
     int sampleRate;
     int channels;
+    int format;                   // TSF_BRIDGE_FORMAT_*
+    unsigned int ditherState[4];  // xorshift32 noise per SIMD lane for TSF_BRIDGE_FORMAT_INT16_DITHER
+    int busMap[16];               // Bus of each MIDI channel for tsf_bridge_render_buses
+    int busCount;
+    TSFRenderPool* renderPool;
+    TSFStream* stream;
+    std::atomic<long long> sampleTime;  // Frames rendered since init
+    // Scheduled events sorted by sample time, pending ones are events[eventHead, eventHead + eventCount)
+    TSFCommand* events;
+    int eventHead;
+    int eventCount;
+    // Commands from any thread, drained by tsf_bridge_render so only the render thread touches the synth
+    TSFCommandCell* commands;
+    std::atomic<unsigned int> commandTail;  // Next position claimed by a producer
+    unsigned int commandHead;               // Next position read by the render thread
+    std::atomic<unsigned int> droppedCommands;
+    TSFSequencer sequencer;
+    TSFGovernor governor;
+    float virtualization;         // Threshold of tsf_bridge_set_voice_virtualization, for the phrase voices
+    TSFPhraseCache phrases;
 };
 
-TSFHandle tsf_bridge_init(const char* path) {
+#ifndef TSF_BRIDGE_NO_THREADS
+// Minimal counting semaphore used to wake the render workers without taking a lock
+#if defined(_WIN32)
+typedef HANDLE tsf_bridge_sem;
+static bool tsf_bridge_sem_init(tsf_bridge_sem* s) { *s = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL); return *s != NULL; }
+static void tsf_bridge_sem_destroy(tsf_bridge_sem* s) { CloseHandle(*s); }
+static void tsf_bridge_sem_post(tsf_bridge_sem* s) { ReleaseSemaphore(*s, 1, NULL); }
+static void tsf_bridge_sem_wait(tsf_bridge_sem* s) { WaitForSingleObject(*s, INFINITE); }
+#elif defined(__APPLE__)
+typedef dispatch_semaphore_t tsf_bridge_sem;
+static bool tsf_bridge_sem_init(tsf_bridge_sem* s) { *s = dispatch_semaphore_create(0); return *s != NULL; }
+static void tsf_bridge_sem_destroy(tsf_bridge_sem* s) { dispatch_release(*s); }
+static void tsf_bridge_sem_post(tsf_bridge_sem* s) { dispatch_semaphore_signal(*s); }
+static void tsf_bridge_sem_wait(tsf_bridge_sem* s) { dispatch_semaphore_wait(*s, DISPATCH_TIME_FOREVER); }
+#else
+typedef sem_t tsf_bridge_sem;
+static bool tsf_bridge_sem_init(tsf_bridge_sem* s) { return sem_init(s, 0, 0) == 0; }
+static void tsf_bridge_sem_destroy(tsf_bridge_sem* s) { sem_destroy(s); }
+static void tsf_bridge_sem_post(tsf_bridge_sem* s) { sem_post(s); }
+static void tsf_bridge_sem_wait(tsf_bridge_sem* s) { while (sem_wait(s) != 0) {} }
+#endif
+
+// Each worker owns a contiguous range of the tasks of a pass and claims them from
+// the front, once its own range is used up it steals from the other workers' ranges.
+// Worker 0 is the thread calling tsf_bridge_render.
+struct TSFRenderWorker {
+    std::atomic<int> nextTask;
+    int endTask;
+    int index;
+    TSFRenderPool* pool;
+    tsf_bridge_sem wake;
+    std::thread thread;
+    char padding[64]; // keep the task counters of different workers on separate cache lines
+};
+
+struct TSFRenderPool {
+    tsf* synth;
+    int threadCount;
+    std::atomic<int> pending;
+    std::atomic<bool> quit;
+
+    // Current pass, written by the calling thread before the workers are woken
+    int voiceCount, taskCount, frames, floatsPerFrame;
+    int voiceCapacity;
+    int* voiceIndices;
+    unsigned char* voiceFinished;
+    float* taskBuffers;
+
+    TSFRenderWorker workers[TSF_BRIDGE_MAX_RENDER_THREADS];
+};
+
+static void tsf_bridge_render_task(TSFRenderPool* pool, int task) {
+    // Render the voices of one task into the task's own buffer
+    int first = (int)((long long)task * pool->voiceCount / pool->taskCount);
+    int last = (int)((long long)(task + 1) * pool->voiceCount / pool->taskCount);
+    float* buffer = pool->taskBuffers + (size_t)task * TSF_BRIDGE_RENDER_SLICE * 2;
+    memset(buffer, 0, sizeof(float) * pool->frames * pool->floatsPerFrame);
+    tsf_render_voices_float(pool->synth, pool->voiceIndices + first, last - first, buffer, pool->frames, pool->voiceFinished + first);
+}
+
+static void tsf_bridge_run_tasks(TSFRenderPool* pool, int worker) {
+    for (int k = 0; k < pool->threadCount; k++) {
+        TSFRenderWorker* victim = &pool->workers[(worker + k) % pool->threadCount];
+        for (;;) {
+            int task = victim->nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (task >= victim->endTask) break;
+            tsf_bridge_render_task(pool, task);
+        }
+    }
+}
+
+static void tsf_bridge_worker_main(TSFRenderWorker* w) {
+    TSFRenderPool* pool = w->pool;
+    for (;;) {
+        tsf_bridge_sem_wait(&w->wake);
+        if (pool->quit.load(std::memory_order_acquire)) break;
+        tsf_bridge_run_tasks(pool, w->index);
+        pool->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+static void tsf_bridge_pool_destroy(TSFRenderPool* pool) {
+    if (!pool) return;
+    pool->quit.store(true, std::memory_order_release);
+    for (int i = 1; i < pool->threadCount; i++) {
+        tsf_bridge_sem_post(&pool->workers[i].wake);
+        pool->workers[i].thread.join();
+        tsf_bridge_sem_destroy(&pool->workers[i].wake);
+    }
+    free(pool->voiceIndices);
+    free(pool->voiceFinished);
+    free(pool->taskBuffers);
+    delete pool;
+}
+
+static TSFRenderPool* tsf_bridge_pool_create(tsf* synth, int threadCount) {
+    TSFRenderPool* pool = new (std::nothrow) TSFRenderPool();
+    if (!pool) return NULL;
+    pool->synth = synth;
+    pool->threadCount = 1;
+    pool->pending.store(0);
+    pool->quit.store(false);
+    pool->voiceCapacity = 256;
+    pool->voiceIndices = (int*)malloc(sizeof(int) * pool->voiceCapacity);
+    pool->voiceFinished = (unsigned char*)malloc(pool->voiceCapacity);
+    pool->taskBuffers = (float*)malloc(sizeof(float) * TSF_BRIDGE_RENDER_TASKS * TSF_BRIDGE_RENDER_SLICE * 2);
+    if (!pool->voiceIndices || !pool->voiceFinished || !pool->taskBuffers) {
+        tsf_bridge_pool_destroy(pool);
+        return NULL;
+    }
+    pool->workers[0].index = 0;
+    pool->workers[0].pool = pool;
+    for (int i = 1; i < threadCount; i++) {
+        TSFRenderWorker* w = &pool->workers[i];
+        w->index = i;
+        w->pool = pool;
+        if (!tsf_bridge_sem_init(&w->wake)) break;
+        try {
+            w->thread = std::thread(tsf_bridge_worker_main, w);
+        } catch (...) {
+            tsf_bridge_sem_destroy(&w->wake);
+            break;
+        }
+        pool->threadCount = i + 1;
+    }
+    if (pool->threadCount != threadCount)
+        fprintf(stderr, "Only started %d of %d render threads\n", pool->threadCount, threadCount);
+    return pool;
+}
+
+static bool tsf_bridge_pool_reserve(TSFRenderPool* pool, int voiceCount) {
+    // Called while the voices are preallocated, never on the render thread
+    if (voiceCount <= pool->voiceCapacity) return true;
+    int capacity = pool->voiceCapacity;
+    while (capacity < voiceCount) capacity *= 2;
+    int* indices = (int*)realloc(pool->voiceIndices, sizeof(int) * capacity);
+    if (!indices) return false;
+    pool->voiceIndices = indices;
+    unsigned char* finished = (unsigned char*)realloc(pool->voiceFinished, capacity);
+    if (!finished) return false;
+    pool->voiceFinished = finished;
+    pool->voiceCapacity = capacity;
+    return true;
+}
+
+static void tsf_bridge_render_parallel(TSFSynth* synth, float* out, int frames) {
+    TSFRenderPool* pool = synth->renderPool;
+    tsf* f = synth->synth;
+    int floatsPerFrame = (synth->channels == 1 ? 1 : 2);
+    while (frames > 0) {
+        int sliceFrames = (frames > TSF_BRIDGE_RENDER_SLICE ? TSF_BRIDGE_RENDER_SLICE : frames);
+        int voiceCount = tsf_active_voice_count(f);
+        if (voiceCount < TSF_BRIDGE_PARALLEL_MIN_VOICES || voiceCount > pool->voiceCapacity) {
+            tsf_render_float(f, out, sliceFrames, 0);
+        } else {
+            pool->voiceCount = tsf_get_active_voices(f, pool->voiceIndices, pool->voiceCapacity);
+            pool->taskCount = (pool->voiceCount < TSF_BRIDGE_RENDER_TASKS ? pool->voiceCount : TSF_BRIDGE_RENDER_TASKS);
+            pool->frames = sliceFrames;
+            pool->floatsPerFrame = floatsPerFrame;
+            for (int w = 0; w < pool->threadCount; w++) {
+                pool->workers[w].nextTask.store(w * pool->taskCount / pool->threadCount, std::memory_order_relaxed);
+                pool->workers[w].endTask = (w + 1) * pool->taskCount / pool->threadCount;
+            }
+            pool->pending.store(pool->threadCount - 1, std::memory_order_relaxed);
+            for (int w = 1; w < pool->threadCount; w++) tsf_bridge_sem_post(&pool->workers[w].wake);
+            tsf_bridge_run_tasks(pool, 0);
+            while (pool->pending.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+
+            // Sum the task buffers in task order, so the result doesn't depend on which thread rendered what
+            int floats = sliceFrames * floatsPerFrame;
+            memcpy(out, pool->taskBuffers, sizeof(float) * floats);
+            for (int t = 1; t < pool->taskCount; t++) {
+                const float* in = pool->taskBuffers + (size_t)t * TSF_BRIDGE_RENDER_SLICE * 2;
+                for (int i = 0; i < floats; i++) out[i] += in[i];
+            }
+            for (int i = 0; i < pool->voiceCount; i++)
+                if (pool->voiceFinished[i]) tsf_release_voice(f, pool->voiceIndices[i]);
+        }
+        out += sliceFrames * floatsPerFrame;
+        frames -= sliceFrames;
+    }
+}
+
+// Render thread filling a ring of frames up to the target latency, read by tsf_bridge_stream_read.
+// Single producer (the render thread) and single consumer (the host audio callback),
+// positions count frames and only grow, the ring index is the position modulo capacity.
+struct TSFStream {
+    TSFSynth* synth;
+    std::thread thread;
+    tsf_bridge_sem wake;
+    std::atomic<bool> quit;
+    float* ring;
+    int capacity;        // Frames, a power of 2
+    int floatsPerFrame;
+    int blockFrames;
+    std::atomic<int> targetLatency;
+    std::atomic<unsigned int> writePos;
+    char padding[64];    // keep the producer and consumer positions on separate cache lines
+    std::atomic<unsigned int> readPos;
+    std::atomic<unsigned int> underruns;
+    std::atomic<unsigned int> overruns;
+};
+
+// Best effort, without the permission for real-time scheduling the thread keeps its priority
+static void tsf_bridge_raise_thread_priority(std::thread& thread) {
+#if defined(_WIN32)
+    SetThreadPriority(thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+#endif
+}
+
+static void tsf_bridge_stream_main(TSFStream* st) {
+    while (!st->quit.load(std::memory_order_acquire)) {
+        unsigned int w = st->writePos.load(std::memory_order_relaxed);
+        int fill = (int)(w - st->readPos.load(std::memory_order_acquire));
+        if (fill >= st->targetLatency.load(std::memory_order_relaxed)) {
+            // Filled to the watermark, wait for the host to read
+            tsf_bridge_sem_wait(&st->wake);
+            continue;
+        }
+        int offset = (int)(w & (st->capacity - 1));
+        int frames = st->blockFrames;
+        if (frames > st->capacity - fill) frames = st->capacity - fill;
+        if (frames > st->capacity - offset) frames = st->capacity - offset;
+        // The ring holds float frames, tsf_bridge_stream_read converts them to the output format
+        tsf_bridge_render_float(st->synth, st->ring + (size_t)offset * st->floatsPerFrame, frames);
+        st->writePos.store(w + frames, std::memory_order_release);
+    }
+}
+
+static void tsf_bridge_stream_destroy(TSFStream* st) {
+    if (!st) return;
+    if (st->thread.joinable()) {
+        st->quit.store(true, std::memory_order_release);
+        tsf_bridge_sem_post(&st->wake);
+        st->thread.join();
+    }
+    tsf_bridge_sem_destroy(&st->wake);
+    free(st->ring);
+    delete st;
+}
+
+static TSFStream* tsf_bridge_stream_create(TSFSynth* synth, int targetLatency, int blockFrames) {
+    if (blockFrames <= 0) blockFrames = TSF_BRIDGE_STREAM_BLOCK;
+    if (targetLatency < blockFrames) targetLatency = blockFrames;
+    
+    // Room for twice the target latency, so it can be raised without restarting the stream
+    int capacity = TSF_BRIDGE_STREAM_MIN_CAPACITY;
+    while (capacity < 2 * targetLatency + blockFrames) capacity *= 2;
+    
+    TSFStream* st = new (std::nothrow) TSFStream();
+    if (!st) return NULL;
+    st->synth = synth;
+    st->capacity = capacity;
+    st->floatsPerFrame = (synth->channels == 1 ? 1 : 2);
+    st->blockFrames = blockFrames;
+    st->targetLatency.store(targetLatency, std::memory_order_relaxed);
+    st->ring = (float*)malloc(sizeof(float) * capacity * st->floatsPerFrame);
+    if (!st->ring) {
+        delete st;
+        return NULL;
+    }
+    if (!tsf_bridge_sem_init(&st->wake)) {
+        free(st->ring);
+        delete st;
+        return NULL;
+    }
+    try {
+        st->thread = std::thread(tsf_bridge_stream_main, st);
+    } catch (...) {
+        tsf_bridge_stream_destroy(st);
+        return NULL;
+    }
+    tsf_bridge_raise_thread_priority(st->thread);
+    return st;
+}
+
+// The stream thread renders with the output settings and the render pool, so it's stopped
+// while they change and started again with the same latency afterwards
+struct TSFStreamPause {
+    int targetLatency;
+    int blockFrames;
+};
+
+static TSFStreamPause tsf_bridge_stream_pause(TSFSynth* synth) {
+    TSFStreamPause pause = { 0, 0 };
+    if (synth->stream) {
+        pause.targetLatency = synth->stream->targetLatency.load(std::memory_order_relaxed);
+        pause.blockFrames = synth->stream->blockFrames;
+        tsf_bridge_stream_destroy(synth->stream);
+        synth->stream = NULL;
+    }
+    return pause;
+}
+
+static void tsf_bridge_stream_resume(TSFSynth* synth, TSFStreamPause pause) {
+    if (pause.targetLatency) synth->stream = tsf_bridge_stream_create(synth, pause.targetLatency, pause.blockFrames);
+}
+#else
+struct TSFStreamPause {};
+static void tsf_bridge_pool_destroy(TSFRenderPool*) {}
+static void tsf_bridge_stream_destroy(TSFStream*) {}
+static TSFStreamPause tsf_bridge_stream_pause(TSFSynth*) { return TSFStreamPause(); }
+static void tsf_bridge_stream_resume(TSFSynth*, TSFStreamPause) {}
+#endif
+
+// ============================================
+// Font registry
+// ============================================
+
+// Loaded SoundFont, the synth instances playing it are tsf_copy of master
+struct TSFFont {
+    tsf* master;    // Never renders, only copied
+    int refs;       // Font handles and instances using the font, guarded by the registry lock
+    char* name;     // NULL if not registered
+    TSFFont* next;
+};
+
+// Registered fonts, only touched while holding the lock. Loading happens outside of the lock.
+static std::atomic_flag fontRegistryLock = ATOMIC_FLAG_INIT;
+static TSFFont* fontRegistry = NULL;
+
+static void tsf_bridge_font_lock() {
+    while (fontRegistryLock.test_and_set(std::memory_order_acquire)) {}
+}
+
+static void tsf_bridge_font_unlock() {
+    fontRegistryLock.clear(std::memory_order_release);
+}
+
+// Takes a reference to the font registered under name, the caller holds the lock
+static TSFFont* tsf_bridge_font_lookup(const char* name) {
+    for (TSFFont* font = fontRegistry; font; font = font->next) {
+        if (font->name && !strcmp(font->name, name)) {
+            font->refs++;
+            return font;
+        }
+    }
+    return NULL;
+}
+
+static void tsf_bridge_font_free(TSFFont* font) {
+    tsf_close(font->master);
+    free(font->name);
+    delete font;
+}
+
+static void tsf_bridge_font_unref(TSFFont* font) {
+    tsf_bridge_font_lock();
+    bool last = (--font->refs == 0);
+    if (last) {
+        for (TSFFont** link = &fontRegistry; *link; link = &(*link)->next) {
+            if (*link == font) {
+                *link = font->next;
+                break;
+            }
+        }
+    }
+    tsf_bridge_font_unlock();
+    if (last) tsf_bridge_font_free(font);
+}
+
+// Registers a freshly loaded SoundFont under name (NULL = unregistered), takes ownership of master
+// If another thread registered the same name meanwhile, master is dropped and its font is returned
+static TSFFont* tsf_bridge_font_add(const char* name, tsf* master) {
+    // tsf_copy allocates the shared reference count on the first copy, doing that here means
+    // instances are only ever copied from a master that already has it, which is thread-safe
+    tsf_close(tsf_copy(master));
+    
+    TSFFont* font = new (std::nothrow) TSFFont;
+    char* fontName = name ? (char*)malloc(strlen(name) + 1) : NULL;
+    if (!font || (name && !fontName)) {
+        delete font;
+        free(fontName);
+        tsf_close(master);
+        return NULL;
+    }
+    if (fontName) strcpy(fontName, name);
+    font->master = master;
+    font->refs = 1;
+    font->name = fontName;
+    font->next = NULL;
+    if (!name) return font;
+    
+    tsf_bridge_font_lock();
+    TSFFont* existing = tsf_bridge_font_lookup(name);
+    if (!existing) {
+        font->next = fontRegistry;
+        fontRegistry = font;
+    }
+    tsf_bridge_font_unlock();
+    if (existing) {
+        tsf_bridge_font_free(font);
+        return existing;
+    }
+    return font;
+}
+
+TSFFontHandle tsf_bridge_font_find(const char* name) {
+    if (!name) return NULL;
+    
+    tsf_bridge_font_lock();
+    TSFFont* font = tsf_bridge_font_lookup(name);
+    tsf_bridge_font_unlock();
+    return (TSFFontHandle)font;
+}
+
+TSFFontHandle tsf_bridge_font_load(const char* path) {
     if (!path) return NULL;
     
-    tsf* synth = tsf_load_filename(path);
-    if (!synth) {
+    TSFFontHandle font = tsf_bridge_font_find(path);
+    if (font) return font;
+    
+    tsf* master = tsf_load_filename(path);
+    if (!master) {
         fprintf(stderr, "Failed to load SoundFont: %s\n", path);
         return NULL;
     }
+    return (TSFFontHandle)tsf_bridge_font_add(path, master);
+}
+
+TSFFontHandle tsf_bridge_font_load_memory(const char* name, const void* buffer, int size) {
+    TSFFontHandle font = tsf_bridge_font_find(name);
+    if (font) return font;
+    if (!buffer || size <= 0) return NULL;
     
-    TSFSynth* handle = (TSFSynth*)malloc(sizeof(TSFSynth));
-    if (!handle) {
-        tsf_close(synth);
+    tsf* master = tsf_load_memory(buffer, size);
+    if (!master) {
+        fprintf(stderr, "Failed to load SoundFont from memory\n");
         return NULL;
     }
+    return (TSFFontHandle)tsf_bridge_font_add(name, master);
+}
+
+void tsf_bridge_font_release(TSFFontHandle font) {
+    if (!font) return;
     
-    handle->synth = synth;
+    tsf_bridge_font_unref((TSFFont*)font);
+}
+
+static void tsf_bridge_sequence_free(TSFSequence* sequence) {
+    if (!sequence) return;
+    free(sequence->events);
+    free(sequence);
+}
+
+static void tsf_bridge_destroy(TSFSynth* synth) {
+    tsf_bridge_stream_destroy(synth->stream);
+    tsf_bridge_pool_destroy(synth->renderPool);
+    free(synth->events);
+    free(synth->commands);
+    tsf_bridge_sequence_free(synth->sequencer.sequence);
+    tsf_bridge_sequence_free(synth->sequencer.pending.load(std::memory_order_acquire));
+    tsf_bridge_sequence_free(synth->sequencer.retired.load(std::memory_order_acquire));
+    tsf_bridge_phrase_free_all(synth);
+    if (synth->synth) {
+        tsf_close(synth->synth);
+    }
+    if (synth->font) {
+        tsf_bridge_font_unref(synth->font);
+    }
+    delete synth;
+}
+
+// Creates all 16 channels with their defaults, so commands on the render thread never grow them
+static bool tsf_bridge_init_channels(tsf* f) {
+    return tsf_channel_set_pitchwheel(f, 15, 8192) != 0;
+}
+
+static TSFSynth* tsf_bridge_create(tsf* synth) {
+    TSFSynth* handle = new (std::nothrow) TSFSynth;
+    if (!handle) return NULL;
+    
+    handle->synth = NULL;
+    handle->font = NULL;
     handle->sampleRate = 44100;
     handle->channels = 2;
+    handle->format = TSF_BRIDGE_FORMAT_FLOAT;
+    for (int i = 0; i < 4; i++) handle->ditherState[i] = 0x9E3779B9u * (unsigned int)(i + 1);
+    for (int i = 0; i < 16; i++) handle->busMap[i] = i;
+    handle->busCount = 16;
+    handle->renderPool = NULL;
+    handle->stream = NULL;
+    handle->sampleTime.store(0, std::memory_order_relaxed);
+    handle->eventHead = 0;
+    handle->eventCount = 0;
+    handle->commandTail.store(0, std::memory_order_relaxed);
+    handle->commandHead = 0;
+    handle->droppedCommands.store(0, std::memory_order_relaxed);
+    
+    TSFSequencer* sq = &handle->sequencer;
+    sq->sequence = NULL;
+    sq->generation = 0;
+    sq->pending.store(NULL, std::memory_order_relaxed);
+    sq->retired.store(NULL, std::memory_order_relaxed);
+    sq->playing = false;
+    sq->loop = false;
+    sq->bpm = 120.0;
+    sq->next = 0;
+    sq->anchorSample = 0;
+    sq->anchorBeat = 0.0;
+    sq->framesPerBeat = handle->sampleRate * 60.0 / sq->bpm;
+    memset(sq->sounding, 0, sizeof(sq->sounding));
+    sq->beat.store(0.0, std::memory_order_relaxed);
+    sq->playingState.store(0, std::memory_order_relaxed);
+    
+    handle->virtualization = 0.0f;
+    TSFPhraseCache* pc = &handle->phrases;
+    for (int i = 0; i < TSF_BRIDGE_MAX_PHRASES; i++) pc->phrases[i].store(NULL, std::memory_order_relaxed);
+    pc->retired.store(NULL, std::memory_order_relaxed);
+    pc->players = NULL;
+    pc->playing = 0;
+    pc->newest = pc->oldest = NULL;
+    pc->stateSize = 0;
+    pc->arena = NULL;
+    pc->pageCount = 0;
+    pc->freePages = NULL;
+    pc->freeEntries = NULL;
+    memset(&pc->stats, 0, sizeof(pc->stats));
+    pc->published = pc->stats;
+    pc->publishLock.clear();
+    
+    // Both queues are allocated up front, so neither producers nor the render thread allocate
+    handle->events = (TSFCommand*)malloc(TSF_BRIDGE_EVENT_QUEUE_SIZE * sizeof(TSFCommand));
+    handle->commands = (TSFCommandCell*)malloc(TSF_BRIDGE_COMMAND_QUEUE_SIZE * sizeof(TSFCommandCell));
+    if (!handle->events || !handle->commands) {
+        tsf_bridge_destroy(handle);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < TSF_BRIDGE_COMMAND_QUEUE_SIZE; i++) {
+        new (&handle->commands[i].sequence) std::atomic<unsigned int>(i);
+    }
+    
+    handle->synth = synth;
+    handle->governor.publishLock.clear();
+    tsf_bridge_governor_reset(handle, 0.0f);
+    return handle;
+}
+
+TSFHandle tsf_bridge_init_font(TSFFontHandle font) {
+    if (!font) return NULL;
+    
+    // Shares the font data, but starts without voices and channels
+    TSFFont* shared = (TSFFont*)font;
+    tsf* synth = tsf_copy(shared->master);
+    if (!synth) return NULL;
+    
+    TSFSynth* handle = tsf_bridge_create(synth);
+    if (!handle) {
+        tsf_close(synth);
+        return NULL;
+    }
+    tsf_bridge_font_lock();
+    shared->refs++;
+    tsf_bridge_font_unlock();
+    handle->font = shared;
+    
+    // Set default output to stereo, 44.1kHz, -6dB gain to prevent clipping
+    tsf_set_output(synth, TSF_STEREO_INTERLEAVED, 44100, TSF_BRIDGE_GAIN_DB);
+    
+    // Initialize channel 0 to use preset 0 (piano in most SoundFonts)
+    tsf_channel_set_bank_preset(synth, 0, 0, 0);
+    if (!tsf_bridge_init_channels(synth)) {
+        tsf_bridge_destroy(handle);
+        return NULL;
+    }
+    
+    return (TSFHandle)handle;
+}
+
+TSFHandle tsf_bridge_init(const char* path) {
+    TSFFontHandle font = tsf_bridge_font_load(path);
+    TSFHandle handle = tsf_bridge_init_font(font);
+    tsf_bridge_font_release(font);
+    return handle;
+}
+
+TSFHandle tsf_bridge_init_memory(const void* buffer, int size) {
+    TSFFontHandle font = tsf_bridge_font_load_memory(NULL, buffer, size);
+    TSFHandle handle = tsf_bridge_init_font(font);
+    tsf_bridge_font_release(font);
+    return handle;
+}
+
+TSFHandle tsf_bridge_init_copy(TSFHandle source) {
+    if (!source) return NULL;
+    
+    return tsf_bridge_init_font((TSFFontHandle)((TSFSynth*)source)->font);
+}
+
+void tsf_bridge_close(TSFHandle handle) {
+    if (!handle) return;
+    
+    tsf_bridge_destroy((TSFSynth*)handle);
+}
+
+void tsf_bridge_set_output(TSFHandle handle, int sample_rate, int channels) {
+    tsf_bridge_set_output_format(handle, sample_rate, channels, TSF_BRIDGE_FORMAT_FLOAT);
+}
+
+void tsf_bridge_set_output_format(TSFHandle handle, int sample_rate, int channels, int format) {
+    if (!handle) return;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFStreamPause pause = tsf_bridge_stream_pause(synth);
+    synth->sampleRate = sample_rate;
+    synth->channels = channels;
+    if (format < TSF_BRIDGE_FORMAT_FLOAT || format > TSF_BRIDGE_FORMAT_INT16_DITHER) format = TSF_BRIDGE_FORMAT_FLOAT;
+    // Planar mono is laid out like interleaved mono
+    if (channels == 1 && format == TSF_BRIDGE_FORMAT_FLOAT_PLANAR) format = TSF_BRIDGE_FORMAT_FLOAT;
+    synth->format = format;
+    
+    enum TSFOutputMode mode = (channels == 1) ? TSF_MONO : TSF_STEREO_INTERLEAVED;
+    tsf_set_output(synth->synth, mode, sample_rate, TSF_BRIDGE_GAIN_DB);
+    // Phrases playing were rendered or recorded in the previous format
+    tsf_bridge_phrase_stop_all(synth);
+    tsf_bridge_stream_resume(synth, pause);
+}
+
+// Claims the next cell of the command ring, any number of threads can push at once
+static bool tsf_bridge_push_command(TSFSynth* synth, const TSFCommand& command) {
+    unsigned int pos = synth->commandTail.load(std::memory_order_relaxed);
+    for (;;) {
+        TSFCommandCell* cell = &synth->commands[pos & (TSF_BRIDGE_COMMAND_QUEUE_SIZE - 1)];
+        int diff = (int)(cell->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (synth->commandTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell->command = command;
+                cell->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The render thread hasn't drained this cell yet, the ring is full
+            synth->droppedCommands.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = synth->commandTail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static bool tsf_bridge_send(TSFHandle handle, int type, int channel, int data1, int data2) {
+    if (!handle) return false;
+    
+    TSFCommand command = { type, channel, data1, data2, 0.0f, TSF_BRIDGE_NOW, 0 };
+    return tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+void tsf_bridge_note_on(TSFHandle handle, int channel, int note, int velocity) {
+    tsf_bridge_send(handle, TSF_BRIDGE_EVENT_NOTE_ON, channel, note, velocity);
+}
+
+void tsf_bridge_note_off(TSFHandle handle, int channel, int note) {
+    tsf_bridge_send(handle, TSF_BRIDGE_EVENT_NOTE_OFF, channel, note, 0);
+}
+
+void tsf_bridge_set_preset(TSFHandle handle, int channel, int bank, int preset) {
+    tsf_bridge_send(handle, TSF_BRIDGE_EVENT_PROGRAM_CHANGE, channel, preset, bank);
+}
+
+void tsf_bridge_pitch_bend(TSFHandle handle, int channel, int pitch_wheel) {
+    tsf_bridge_send(handle, TSF_BRIDGE_EVENT_PITCH_BEND, channel, pitch_wheel, 0);
+}
+
+void tsf_bridge_control_change(TSFHandle handle, int channel, int controller, int value) {
+    tsf_bridge_send(handle, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, controller, value);
+}
+
+static void tsf_bridge_sequence_command(TSFSynth* synth, const TSFCommand* c);
+static void tsf_bridge_phrase_command(TSFSynth* synth, const TSFCommand* c);
+static void tsf_bridge_phrase_forward(TSFSynth* synth, const TSFCommand* c);
+
+// Applies a note or channel change to a synth, the bridge's own or the voices of a phrase
+static void tsf_bridge_apply_channel(tsf* f, const TSFCommand* c) {
+    switch (c->type) {
+        case TSF_BRIDGE_EVENT_NOTE_OFF:
+            tsf_channel_note_off(f, c->channel, c->data1);
+            break;
+        case TSF_BRIDGE_EVENT_NOTE_ON:
+            // Convert MIDI velocity (0-127) to float (0.0-1.0)
+            tsf_channel_note_on(f, c->channel, c->data1, c->data2 / 127.0f);
+            break;
+        case TSF_BRIDGE_EVENT_CONTROL_CHANGE:
+            tsf_channel_midi_control(f, c->channel, c->data1, c->data2);
+            break;
+        case TSF_BRIDGE_EVENT_PROGRAM_CHANGE:
+            tsf_channel_set_bank_preset(f, c->channel, c->data2, c->data1);
+            break;
+        case TSF_BRIDGE_EVENT_PITCH_BEND:
+            // TinySoundFont expects pitch wheel as -8192 to +8191
+            tsf_channel_set_pitchwheel(f, c->channel, c->data1 - 8192);
+            break;
+        case TSF_BRIDGE_COMMAND_NOTE_OFF_ALL:
+            tsf_note_off_all(f);
+            break;
+        case TSF_BRIDGE_COMMAND_CHANNEL_VOLUME:
+            tsf_channel_set_volume(f, c->channel, c->value);
+            break;
+        case TSF_BRIDGE_COMMAND_CHANNEL_TUNING:
+            tsf_channel_set_tuning(f, c->channel, (float)c->value);
+            break;
+        case TSF_BRIDGE_COMMAND_CHANNEL_PITCH_WHEEL:
+            tsf_channel_set_pitchwheel(f, c->channel, c->data1);
+            break;
+        case TSF_BRIDGE_COMMAND_CHANNEL_POLYPHONY:
+            tsf_channel_set_polyphony(f, c->channel, c->data1);
+            break;
+        case TSF_BRIDGE_COMMAND_CHANNEL_PRIORITY:
+            tsf_channel_set_priority(f, c->channel, c->data1);
+            break;
+    }
+}
+
+// Only called on the render thread
+static void tsf_bridge_apply_command(TSFSynth* synth, const TSFCommand* c) {
+    tsf* f = synth->synth;
+    switch (c->type) {
+        case TSF_BRIDGE_EVENT_NOTE_OFF:
+        case TSF_BRIDGE_EVENT_NOTE_ON:
+            tsf_bridge_apply_channel(f, c);
+            break;
+        case TSF_BRIDGE_EVENT_CONTROL_CHANGE:
+        case TSF_BRIDGE_EVENT_PROGRAM_CHANGE:
+        case TSF_BRIDGE_EVENT_PITCH_BEND:
+        case TSF_BRIDGE_COMMAND_NOTE_OFF_ALL:
+        case TSF_BRIDGE_COMMAND_CHANNEL_VOLUME:
+        case TSF_BRIDGE_COMMAND_CHANNEL_TUNING:
+        case TSF_BRIDGE_COMMAND_CHANNEL_PITCH_WHEEL:
+        case TSF_BRIDGE_COMMAND_CHANNEL_POLYPHONY:
+        case TSF_BRIDGE_COMMAND_CHANNEL_PRIORITY:
+            // Phrases playing on the channel follow it
+            if (synth->phrases.playing) tsf_bridge_phrase_forward(synth, c);
+            else tsf_bridge_apply_channel(f, c);
+            break;
+        case TSF_BRIDGE_COMMAND_CPU_BUDGET:
+            tsf_bridge_governor_reset(synth, (float)c->value);
+            break;
+        case TSF_BRIDGE_COMMAND_VIRTUALIZATION:
+            synth->virtualization = (float)c->value;
+            tsf_set_voice_virtualization(f, synth->virtualization);
+            break;
+        case TSF_BRIDGE_COMMAND_PHRASE_PLAY:
+        case TSF_BRIDGE_COMMAND_PHRASE_RELEASE:
+            tsf_bridge_phrase_command(synth, c);
+            break;
+        case TSF_BRIDGE_COMMAND_CLEAR_EVENTS:
+            synth->eventHead = 0;
+            synth->eventCount = 0;
+            break;
+        case TSF_BRIDGE_COMMAND_SEQUENCE_START:
+        case TSF_BRIDGE_COMMAND_SEQUENCE_STOP:
+        case TSF_BRIDGE_COMMAND_SEQUENCE_LOOP:
+        case TSF_BRIDGE_COMMAND_SEQUENCE_TEMPO:
+            tsf_bridge_sequence_command(synth, c);
+            break;
+    }
+}
+
+// Inserts into the sorted event queue, from the back since events mostly arrive in order
+static void tsf_bridge_queue_event(TSFSynth* synth, const TSFCommand* c) {
+    if (synth->eventCount == TSF_BRIDGE_EVENT_QUEUE_SIZE) {
+        synth->droppedCommands.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (synth->eventHead + synth->eventCount == TSF_BRIDGE_EVENT_QUEUE_SIZE) {
+        memmove(synth->events, synth->events + synth->eventHead, synth->eventCount * sizeof(TSFCommand));
+        synth->eventHead = 0;
+    }
+    
+    TSFCommand* first = synth->events + synth->eventHead;
+    TSFCommand* e = first + synth->eventCount;
+    for (; e != first && e[-1].time > c->time; e--) *e = e[-1];
+    *e = *c;
+    synth->eventCount++;
+}
+
+// Applies the commands pushed so far, scheduled ones go to the event queue
+static void tsf_bridge_drain_commands(TSFSynth* synth, long long now) {
+    // Bounded, so producers that keep pushing can't stall the render
+    for (int n = 0; n < TSF_BRIDGE_COMMAND_QUEUE_SIZE; n++) {
+        TSFCommandCell* cell = &synth->commands[synth->commandHead & (TSF_BRIDGE_COMMAND_QUEUE_SIZE - 1)];
+        if (cell->sequence.load(std::memory_order_acquire) != synth->commandHead + 1) break;
+        TSFCommand c = cell->command;
+        cell->sequence.store(synth->commandHead + TSF_BRIDGE_COMMAND_QUEUE_SIZE, std::memory_order_release);
+        synth->commandHead++;
+        
+        if (c.timing == TSF_BRIDGE_NOW) {
+            tsf_bridge_apply_command(synth, &c);
+            continue;
+        }
+        if (c.timing == TSF_BRIDGE_AT_OFFSET) c.time += now;
+        if (c.time < now) c.time = now;
+        tsf_bridge_queue_event(synth, &c);
+    }
+}
+
+// ============================================
+// Sequencer
+// ============================================
+
+static int tsf_bridge_sequence_compare(const void* a, const void* b) {
+    const TSFSequenceEvent* x = (const TSFSequenceEvent*)a;
+    const TSFSequenceEvent* y = (const TSFSequenceEvent*)b;
+    if (x->beat != y->beat) return x->beat < y->beat ? -1 : 1;
+    return x->order - y->order;
+}
+
+int tsf_bridge_sequence_load(TSFHandle handle, const TSFBridgeNote* notes, int count, double length_beats) {
+    if (!handle || count < 0 || (count && !notes)) return 0;
+    
+    TSFSequence* sequence = (TSFSequence*)malloc(sizeof(TSFSequence));
+    if (!sequence) return 0;
+    sequence->events = (TSFSequenceEvent*)malloc(sizeof(TSFSequenceEvent) * (count ? count * 2 : 1));
+    if (!sequence->events) {
+        free(sequence);
+        return 0;
+    }
+    
+    // Each note becomes an on and an off event; at the same beat offs go first so a note can be
+    // restarted, except for the offs of zero-length notes which have to follow their own on
+    int n = 0;
+    double end = 0.0;
+    for (int i = 0; i < count; i++) {
+        const TSFBridgeNote* note = &notes[i];
+        if (!note->velocity || note->channel > 15 || note->note > 127 || !(note->start >= 0.0)) continue;
+        double duration = (note->duration > 0.0) ? note->duration : 0.0;
+        TSFSequenceEvent on = { note->start, 2 * count + i, 1, note->channel, note->note, (unsigned char)(note->velocity > 127 ? 127 : note->velocity) };
+        TSFSequenceEvent off = { note->start + duration, (duration > 0.0 ? 0 : 4 * count) + i, 0, note->channel, note->note, 0 };
+        sequence->events[n++] = on;
+        sequence->events[n++] = off;
+        if (off.beat > end) end = off.beat;
+    }
+    qsort(sequence->events, n, sizeof(TSFSequenceEvent), tsf_bridge_sequence_compare);
+    sequence->count = n;
+    sequence->length = (length_beats > 0.0) ? length_beats : end;
+    // Skips 0 when the counter wraps around, it stands for no sequence
+    do sequence->generation = sequenceGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+    while (!sequence->generation);
+    
+    // The render thread picks it up at its next render; a sequence it didn't pick up yet and
+    // one it replaced earlier can be freed here
+    TSFSequencer* sq = &((TSFSynth*)handle)->sequencer;
+    tsf_bridge_sequence_free(sq->pending.exchange(sequence, std::memory_order_acq_rel));
+    tsf_bridge_sequence_free(sq->retired.exchange(NULL, std::memory_order_acq_rel));
+    return n / 2;
+}
+
+void tsf_bridge_sequence_start(TSFHandle handle, double start_beat) {
+    if (!handle) return;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_SEQUENCE_START, 0, 0, 0, start_beat > 0.0 ? start_beat : 0.0, TSF_BRIDGE_NOW, 0 };
+    tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+void tsf_bridge_sequence_stop(TSFHandle handle) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_SEQUENCE_STOP, 0, 0, 0);
+}
+
+void tsf_bridge_sequence_set_loop(TSFHandle handle, int loop) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_SEQUENCE_LOOP, 0, loop != 0, 0);
+}
+
+void tsf_bridge_sequence_set_tempo(TSFHandle handle, double bpm) {
+    if (!handle || !(bpm > 0.0)) return;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_SEQUENCE_TEMPO, 0, 0, 0, bpm, TSF_BRIDGE_NOW, 0 };
+    tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+double tsf_bridge_sequence_get_beat(TSFHandle handle) {
+    if (!handle) return 0.0;
+    return ((TSFSynth*)handle)->sequencer.beat.load(std::memory_order_relaxed);
+}
+
+int tsf_bridge_sequence_playing(TSFHandle handle) {
+    if (!handle) return 0;
+    return ((TSFSynth*)handle)->sequencer.playingState.load(std::memory_order_relaxed);
+}
+
+static long long tsf_bridge_sequence_sample(const TSFSequencer* sq, double beat) {
+    return sq->anchorSample + (long long)floor((beat - sq->anchorBeat) * sq->framesPerBeat + 0.5);
+}
+
+// Moves the anchor to sample time now and applies the current tempo and sample rate from there
+static void tsf_bridge_sequence_retime(TSFSynth* synth, long long now) {
+    TSFSequencer* sq = &synth->sequencer;
+    sq->anchorBeat += (now - sq->anchorSample) / sq->framesPerBeat;
+    sq->anchorSample = now;
+    sq->framesPerBeat = synth->sampleRate * 60.0 / sq->bpm;
+}
+
+// Queues note-offs at sample time for all notes the sequence left sounding, one per start of a key
+// as a note-off ends a single voice. Note-offs that don't fit in the event queue are applied now.
+static void tsf_bridge_sequence_release(TSFSynth* synth, long long time) {
+    TSFSequencer* sq = &synth->sequencer;
+    for (int i = 0; i < 16 * 128; i++) {
+        for (; sq->sounding[i]; sq->sounding[i]--) {
+            TSFCommand c = { TSF_BRIDGE_EVENT_NOTE_OFF, i >> 7, i & 127, 0, 0.0, TSF_BRIDGE_AT_TIME, time };
+            if (synth->eventCount == TSF_BRIDGE_EVENT_QUEUE_SIZE) tsf_bridge_apply_command(synth, &c);
+            else tsf_bridge_queue_event(synth, &c);
+        }
+    }
+}
+
+// Start, stop, loop and tempo commands, applied at the start of a render
+static void tsf_bridge_sequence_command(TSFSynth* synth, const TSFCommand* c) {
+    TSFSequencer* sq = &synth->sequencer;
+    long long now = synth->sampleTime.load(std::memory_order_relaxed);
+    switch (c->type) {
+        case TSF_BRIDGE_COMMAND_SEQUENCE_START: {
+            if (!sq->sequence) break;
+            tsf_bridge_sequence_release(synth, now);
+            double start = c->value;
+            if (sq->loop && sq->sequence->length > 0.0 && start >= sq->sequence->length) start = fmod(start, sq->sequence->length);
+            sq->anchorSample = now;
+            sq->anchorBeat = start;
+            sq->framesPerBeat = synth->sampleRate * 60.0 / sq->bpm;
+            sq->next = 0;
+            while (sq->next < sq->sequence->count && sq->sequence->events[sq->next].beat < start) sq->next++;
+            sq->playing = true;
+            break;
+        }
+        case TSF_BRIDGE_COMMAND_SEQUENCE_STOP:
+            tsf_bridge_sequence_release(synth, now);
+            sq->playing = false;
+            break;
+        case TSF_BRIDGE_COMMAND_SEQUENCE_LOOP:
+            sq->loop = c->data1 != 0;
+            break;
+        case TSF_BRIDGE_COMMAND_SEQUENCE_TEMPO:
+            if (sq->playing) tsf_bridge_sequence_retime(synth, now);
+            sq->bpm = c->value;
+            sq->framesPerBeat = synth->sampleRate * 60.0 / sq->bpm;
+            break;
+    }
+}
+
+// Switches to a sequence loaded since the last render, before its commands are applied
+static void tsf_bridge_sequence_update(TSFSynth* synth, long long now) {
+    TSFSequencer* sq = &synth->sequencer;
+    TSFSequence* loaded = sq->pending.exchange(NULL, std::memory_order_acq_rel);
+    if (!loaded) return;
+    
+    tsf_bridge_sequence_release(synth, now);
+    // Normally freed by the next load, only two loads without a render in between get here
+    tsf_bridge_sequence_free(sq->retired.exchange(sq->sequence, std::memory_order_acq_rel));
+    sq->sequence = loaded;
+    sq->generation = loaded->generation;
+    sq->playing = false;
+    sq->next = 0;
+    sq->anchorBeat = 0.0;
+    sq->beat.store(0.0, std::memory_order_relaxed);
+    sq->playingState.store(0, std::memory_order_relaxed);
+}
+
+// Queues the sequence events of the next frames frames, so tsf_bridge_render_events applies them on their frame
+static void tsf_bridge_sequence_dispatch(TSFSynth* synth, long long now, int frames) {
+    TSFSequencer* sq = &synth->sequencer;
+    if (!sq->playing) {
+        sq->playingState.store(0, std::memory_order_relaxed);
+        return;
+    }
+    
+    if (sq->framesPerBeat != synth->sampleRate * 60.0 / sq->bpm) tsf_bridge_sequence_retime(synth, now);
+    const TSFSequence* s = sq->sequence;
+    long long end = now + frames;
+    // A loop has to last at least a frame
+    bool loop = sq->loop && s->length * sq->framesPerBeat >= 1.0;
+    for (;;) {
+        if (sq->next < s->count && (!loop || s->events[sq->next].beat < s->length)) {
+            const TSFSequenceEvent* e = &s->events[sq->next];
+            long long time = tsf_bridge_sequence_sample(sq, e->beat);
+            if (time >= end) break;
+            // Event queue full, the rest is dispatched (late) by the next render
+            if (synth->eventCount == TSF_BRIDGE_EVENT_QUEUE_SIZE) break;
+            sq->next++;
+            
+            unsigned char* sounding = &sq->sounding[e->channel * 128 + e->note];
+            if (e->on) {
+                if (*sounding < 255) (*sounding)++;
+            } else {
+                // Notes started before the start beat weren't played
+                if (!*sounding) continue;
+                (*sounding)--;
+            }
+            TSFCommand c = { e->on ? TSF_BRIDGE_EVENT_NOTE_ON : TSF_BRIDGE_EVENT_NOTE_OFF, e->channel, e->note, e->velocity,
+                             0.0, TSF_BRIDGE_AT_TIME, time < now ? now : time };
+            tsf_bridge_queue_event(synth, &c);
+            continue;
+        }
+        if (loop) {
+            // Back to the start, notes still sounding end at the loop point
+            long long time = tsf_bridge_sequence_sample(sq, s->length);
+            if (time >= end) break;
+            tsf_bridge_sequence_release(synth, time);
+            sq->anchorSample = time;
+            sq->anchorBeat = 0.0;
+            sq->next = 0;
+            continue;
+        }
+        // All events dispatched
+        sq->playing = false;
+        break;
+    }
+    
+    sq->beat.store(sq->anchorBeat + (end - sq->anchorSample) / sq->framesPerBeat, std::memory_order_relaxed);
+    sq->playingState.store(sq->playing ? 1 : 0, std::memory_order_relaxed);
+}
+
+// ============================================
+// Phrase cache
+// ============================================
+
+// Int32 render settings at the start of a phrase key: sample rate, channels, effect blocks, quality flags,
+// virtualization threshold bits, max voices, phrase length, event count and channel mask
+#define TSF_BRIDGE_PHRASE_HEADER (9 * (int)sizeof(int))
+
+static void tsf_bridge_phrase_free(TSFPhrase* phrase) {
+    free(phrase->events);
+    free(phrase->key);
+    free(phrase);
+}
+
+// Frees the phrases the render thread dropped, called on the control threads
+static void tsf_bridge_phrase_reap(TSFPhraseCache* pc) {
+    TSFPhrase* phrase = pc->retired.exchange(NULL, std::memory_order_acquire);
+    while (phrase) {
+        TSFPhrase* next = phrase->retiredNext;
+        tsf_bridge_phrase_free(phrase);
+        phrase = next;
+    }
+}
+
+int tsf_bridge_phrase_define(TSFHandle handle, const TSFBridgeEvent* events, int count, int length_frames) {
+    if (!handle || !events || count <= 0) return -1;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    tsf_bridge_phrase_reap(&synth->phrases);
+    int length = length_frames;
+    if (length <= 0) {
+        length = 0;
+        for (int i = 0; i < count; i++) if (events[i].frame_offset > length) length = events[i].frame_offset;
+    }
+    
+    // Room for a note off of each note on, for the notes still held at the end
+    TSFPhrase* phrase = (TSFPhrase*)malloc(sizeof(TSFPhrase));
+    TSFBridgeEvent* sorted = (TSFBridgeEvent*)malloc((size_t)count * 2 * sizeof(TSFBridgeEvent));
+    if (!phrase || !sorted) {
+        free(phrase);
+        free(sorted);
+        return -1;
+    }
+    
+    // Insertion sort from the back, phrases are mostly in order already and equal offsets keep their order
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        TSFBridgeEvent e = events[i];
+        if (e.frame_offset < 0) e.frame_offset = 0;
+        if (e.frame_offset > length || e.channel > 15) continue;
+        e.reserved = 0;
+        int j = n++;
+        for (; j > 0 && sorted[j - 1].frame_offset > e.frame_offset; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = e;
+    }
+    
+    unsigned char held[16 * 128];
+    memset(held, 0, sizeof(held));
+    unsigned int mask = 0;
+    int channels = 0;
+    for (int i = 0; i < n; i++) {
+        const TSFBridgeEvent* e = &sorted[i];
+        if (!(mask & (1u << e->channel))) channels++;
+        mask |= 1u << e->channel;
+        if (e->data1 > 127) continue;
+        if (e->type == TSF_BRIDGE_EVENT_NOTE_ON) held[e->channel * 128 + e->data1] = (e->data2 > 0);
+        else if (e->type == TSF_BRIDGE_EVENT_NOTE_OFF) held[e->channel * 128 + e->data1] = 0;
+    }
+    for (int key = 0; key < 16 * 128; key++) {
+        if (!held[key]) continue;
+        TSFBridgeEvent off = { length, TSF_BRIDGE_EVENT_NOTE_OFF, (unsigned char)(key >> 7), (unsigned short)(key & 0x7F), 0, 0 };
+        sorted[n++] = off;
+    }
+    // The key is built on every start, so the render thread never allocates it
+    size_t keySize = TSF_BRIDGE_PHRASE_HEADER + (size_t)n * sizeof(TSFBridgeEvent) +
+                     (size_t)channels * tsf_channel_get_state(synth->synth, 0, NULL, 0);
+    phrase->key = n ? (unsigned char*)malloc(keySize) : NULL;
+    if (!phrase->key) {
+        free(phrase);
+        free(sorted);
+        return -1;
+    }
+    
+    phrase->events = sorted;
+    phrase->count = n;
+    phrase->length = length;
+    phrase->channelMask = mask;
+    phrase->players = 0;
+    phrase->released = false;
+    phrase->keySize = (int)keySize;
+    phrase->retiredNext = NULL;
+    
+    TSFPhraseCache* pc = &synth->phrases;
+    for (int id = 0; id < TSF_BRIDGE_MAX_PHRASES; id++) {
+        TSFPhrase* expected = NULL;
+        phrase->id = id;
+        if (pc->phrases[id].compare_exchange_strong(expected, phrase, std::memory_order_release, std::memory_order_relaxed)) return id;
+    }
+    tsf_bridge_phrase_free(phrase);
+    return -1;
+}
+
+void tsf_bridge_phrase_release(TSFHandle handle, int phrase) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_PHRASE_RELEASE, 0, phrase, 0);
+}
+
+int tsf_bridge_phrase_play(TSFHandle handle, int phrase, int frame_offset) {
+    if (!handle) return 0;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_PHRASE_PLAY, 0, phrase, 0, 0.0,
+                           frame_offset < 0 ? TSF_BRIDGE_NOW : TSF_BRIDGE_AT_OFFSET,
+                           frame_offset < 0 ? 0 : frame_offset };
+    return tsf_bridge_push_command((TSFSynth*)handle, command) ? 1 : 0;
+}
+
+// Takes a phrase out of the table, it's freed by the next tsf_bridge_phrase_reap
+static void tsf_bridge_phrase_drop(TSFPhraseCache* pc, TSFPhrase* phrase) {
+    pc->phrases[phrase->id].store(NULL, std::memory_order_release);
+    TSFPhrase* head = pc->retired.load(std::memory_order_relaxed);
+    do {
+        phrase->retiredNext = head;
+    } while (!pc->retired.compare_exchange_weak(head, phrase, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// Returns the pages and the entry to the free lists
+static void tsf_bridge_phrase_entry_free(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    if (e->first) {
+        e->last->next = pc->freePages;
+        pc->freePages = e->first;
+    }
+    e->older = pc->freeEntries;
+    pc->freeEntries = e;
+}
+
+static void tsf_bridge_phrase_unlink(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    if (e->newer) e->newer->older = e->older;
+    else pc->newest = e->older;
+    if (e->older) e->older->newer = e->newer;
+    else pc->oldest = e->newer;
+    e->newer = e->older = NULL;
+}
+
+static void tsf_bridge_phrase_link(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    e->newer = NULL;
+    e->older = pc->newest;
+    if (pc->newest) pc->newest->newer = e;
+    else pc->oldest = e;
+    pc->newest = e;
+}
+
+static void tsf_bridge_phrase_evict(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    tsf_bridge_phrase_unlink(pc, e);
+    pc->stats.bytes -= e->pages * (int)sizeof(TSFPhrasePage);
+    pc->stats.entries--;
+    tsf_bridge_phrase_entry_free(pc, e);
+}
+
+// Drops all cached phrases, entries being mixed or recorded are owned by their players
+static void tsf_bridge_phrase_clear(TSFPhraseCache* pc) {
+    while (pc->oldest) tsf_bridge_phrase_evict(pc, pc->oldest);
+    pc->stats.bytes = 0;
+    pc->stats.entries = 0;
+}
+
+// Appends a free page to an entry, freeing the least recently played phrase that isn't being mixed if there's none
+// Every entry holds a page at least, so one eviction is enough
+static TSFPhrasePage* tsf_bridge_phrase_grow(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    if (!pc->freePages) {
+        TSFPhraseEntry* old = pc->oldest;
+        while (old && old->readers) old = old->newer;
+        if (!old) return NULL;
+        tsf_bridge_phrase_evict(pc, old);
+        pc->stats.evictions++;
+    }
+    TSFPhrasePage* page = pc->freePages;
+    pc->freePages = page->next;
+    page->next = NULL;
+    if (e->last) e->last->next = page;
+    else e->first = page;
+    e->last = page;
+    e->pages++;
+    return page;
+}
+
+// Adds a finished recording to the cache, its pages are taken already
+static void tsf_bridge_phrase_store(TSFPhraseCache* pc, TSFPhraseEntry* e) {
+    tsf_bridge_phrase_link(pc, e);
+    pc->stats.bytes += e->pages * (int)sizeof(TSFPhrasePage);
+    pc->stats.entries++;
+    pc->stats.stored++;
+}
+
+// Copies size bytes at offset of the key an entry was recorded with
+static void tsf_bridge_phrase_key_read(const TSFPhraseEntry* e, int offset, unsigned char* dst, int size) {
+    const TSFPhrasePage* page = e->first;
+    for (; offset >= TSF_BRIDGE_PHRASE_PAGE_BYTES; offset -= TSF_BRIDGE_PHRASE_PAGE_BYTES) page = page->next;
+    for (; size > 0; page = page->next, offset = 0) {
+        int n = TSF_BRIDGE_PHRASE_PAGE_BYTES - offset;
+        if (n > size) n = size;
+        memcpy(dst, (const unsigned char*)page->data + offset, n);
+        dst += n;
+        size -= n;
+    }
+}
+
+static bool tsf_bridge_phrase_key_equal(const TSFPhraseEntry* e, const TSFPhrase* phrase) {
+    if (e->keySize != phrase->keySize) return false;
+    const TSFPhrasePage* page = e->first;
+    for (int done = 0; done < e->keySize; done += TSF_BRIDGE_PHRASE_PAGE_BYTES, page = page->next) {
+        int n = e->keySize - done;
+        if (n > TSF_BRIDGE_PHRASE_PAGE_BYTES) n = TSF_BRIDGE_PHRASE_PAGE_BYTES;
+        if (memcmp(page->data, phrase->key + done, n)) return false;
+    }
+    return true;
+}
+
+// Bus all channels of a phrase are mapped to, -1 if they're on several
+static int tsf_bridge_phrase_bus(const TSFSynth* synth, unsigned int mask) {
+    int bus = -1;
+    for (int channel = 0; channel < 16; channel++) {
+        if (!(mask & (1u << channel))) continue;
+        if (bus >= 0 && synth->busMap[channel] != bus) return -1;
+        bus = synth->busMap[channel];
+    }
+    return bus;
+}
+
+// Readies the voices of a player to render its phrase from the start, with the render settings
+// of the synth and the channel states of a key
+static void tsf_bridge_phrase_setup(TSFSynth* synth, TSFPhrasePlayer* p, const unsigned char* states) {
+    const TSFPhrase* phrase = p->phrase;
+    tsf* voices = p->voices;
+    int stateSize = synth->phrases.stateSize;
+    tsf_set_output(voices, (synth->channels == 1) ? TSF_MONO : TSF_STEREO_INTERLEAVED, synth->sampleRate, TSF_BRIDGE_GAIN_DB);
+    tsf_set_render_quality(voices, synth->synth->effectBlocks, synth->synth->qualityFlags);
+    tsf_set_voice_virtualization(voices, synth->virtualization);
+    
+    for (int channel = 0; channel < 16; channel++) {
+        if (!(phrase->channelMask & (1u << channel))) continue;
+        tsf_channel_set_state(voices, channel, states, stateSize);
+        states += stateSize;
+    }
+    p->next = 0;
+    p->position = 0;
+}
+
+// Applies the events of a player's phrase that are due, returns the frames up to its next event
+static int tsf_bridge_phrase_events(TSFPhrasePlayer* p, int frames) {
+    const TSFPhrase* phrase = p->phrase;
+    while (p->next < phrase->count && phrase->events[p->next].frame_offset <= p->position) {
+        const TSFBridgeEvent* e = &phrase->events[p->next++];
+        TSFCommand c = { e->type, e->channel, e->data1, e->data2, 0.0, TSF_BRIDGE_NOW, 0 };
+        tsf_bridge_apply_channel(p->voices, &c);
+    }
+    if (p->next < phrase->count && phrase->events[p->next].frame_offset - p->position < frames)
+        frames = phrase->events[p->next].frame_offset - p->position;
+    return frames;
+}
+
+// Renders frames of a player's voices into out, splitting at the events of its phrase
+static void tsf_bridge_phrase_run(TSFSynth* synth, TSFPhrasePlayer* p, float* out, int frames, int flag_mixing) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    for (int done = 0; done < frames;) {
+        int n = tsf_bridge_phrase_events(p, frames - done);
+        tsf_render_float(p->voices, out + (size_t)done * stride, n, flag_mixing);
+        p->position += n;
+        done += n;
+    }
+}
+
+// Mixes frames of a player's voices into the bus blocks of tsf_bridge_render_buses, returns the mask of active buses
+static int tsf_bridge_phrase_run_buses(TSFSynth* synth, TSFPhrasePlayer* p, float* out, int bus_frames, int offset, int frames) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    int mask = 0;
+    for (int done = 0; done < frames;) {
+        int n = tsf_bridge_phrase_events(p, frames - done);
+        float* buses[TSF_BRIDGE_MAX_BUSES];
+        unsigned char active[TSF_BRIDGE_MAX_BUSES];
+        for (int b = 0; b < synth->busCount; b++) buses[b] = out + ((size_t)b * bus_frames + offset + done) * stride;
+        tsf_render_float_buses(p->voices, buses, synth->busCount, synth->busMap, 16, n, 1, active);
+        for (int b = 0; b < synth->busCount; b++) if (active[b]) mask |= 1 << b;
+        p->position += n;
+        done += n;
+    }
+    return mask;
+}
+
+// Adds up to frames of the recording a player mixes to dst
+static void tsf_bridge_phrase_mix(TSFSynth* synth, TSFPhrasePlayer* p, float* dst, int frames) {
+    const TSFPhraseEntry* e = p->entry;
+    int stride = (synth->channels == 1) ? 1 : 2;
+    int pageFrames = TSF_BRIDGE_PHRASE_PAGE_FLOATS / stride;
+    for (int done = 0; done < frames && p->read < e->frames;) {
+        int offset = p->read % pageFrames;
+        if (!offset && p->read) p->page = p->page->next;
+        int n = pageFrames - offset;
+        if (n > frames - done) n = frames - done;
+        if (n > e->frames - p->read) n = e->frames - p->read;
+        const float* src = p->page->data + (size_t)offset * stride;
+        float* out = dst + (size_t)done * stride;
+        for (int s = 0; s < n * stride; s++) out[s] += src[s];
+        p->read += n;
+        done += n;
+    }
+}
+
+// Switches a player to rendering its phrase on its voices
+// diverged: a channel change reached the phrase, rather than a restriction of the cache
+// A recording is dropped and its voices go on, a cached play goes on mixing its recording until its voices
+// caught up with it (see tsf_bridge_phrase_catch_up), so no render replays more than a bounded part of it
+static void tsf_bridge_phrase_go_live(TSFSynth* synth, TSFPhrasePlayer* p, bool diverged) {
+    TSFPhraseCache* pc = &synth->phrases;
+    if (diverged) pc->stats.divergences++;
+    if (p->mode == TSF_BRIDGE_PHRASE_RECORDING) {
+        tsf_bridge_phrase_entry_free(pc, p->entry);
+        p->entry = NULL;
+        p->mode = TSF_BRIDGE_PHRASE_LIVE;
+    } else if (p->mode == TSF_BRIDGE_PHRASE_CACHED) {
+        // Same start, same events, same audio
+        const TSFPhrase* phrase = p->phrase;
+        unsigned char states[16 * sizeof(struct tsf_channel)];
+        int channels = (int)((phrase->keySize - TSF_BRIDGE_PHRASE_HEADER - (size_t)phrase->count * sizeof(TSFBridgeEvent)) / pc->stateSize);
+        tsf_bridge_phrase_key_read(p->entry, phrase->keySize - channels * pc->stateSize, states, channels * pc->stateSize);
+        tsf_bridge_phrase_setup(synth, p, states);
+        p->pendingCount = 0;
+        p->mode = TSF_BRIDGE_PHRASE_CATCHUP;
+    }
+}
+
+// Replays the phrase of a catching up player on its voices, *budget frames at most, they take over
+// from the recording once they reached the frame it's mixed up to
+static void tsf_bridge_phrase_catch_up(TSFSynth* synth, TSFPhrasePlayer* p, int* budget) {
+    float scratch[TSF_BRIDGE_MIX_BLOCK * 2];
+    while (p->position < p->read && *budget > 0) {
+        int frames = p->read - p->position;
+        if (frames > *budget) frames = *budget;
+        if (frames > TSF_BRIDGE_MIX_BLOCK) frames = TSF_BRIDGE_MIX_BLOCK;
+        tsf_bridge_phrase_run(synth, p, scratch, frames, 0);
+        *budget -= frames;
+    }
+    if (p->position < p->read) return;
+    
+    // The changes held back take effect from here, later than on the synth by the time catching up took
+    for (int i = 0; i < p->pendingCount; i++) tsf_bridge_apply_channel(p->voices, &p->pending[i]);
+    p->pendingCount = 0;
+    p->entry->readers--;
+    p->entry = NULL;
+    p->page = NULL;
+    p->mode = TSF_BRIDGE_PHRASE_LIVE;
+}
+
+// Records frames of a player's voices into its entry and adds them to dst, returns the frames done before it had
+// to stop recording: too long a tail, or the cache is full of phrases being mixed or recorded
+static int tsf_bridge_phrase_record(TSFSynth* synth, TSFPhrasePlayer* p, float* dst, int frames) {
+    TSFPhraseCache* pc = &synth->phrases;
+    TSFPhraseEntry* e = p->entry;
+    if (p->position - p->phrase->length > synth->sampleRate * TSF_BRIDGE_PHRASE_MAX_TAIL) {
+        tsf_bridge_phrase_go_live(synth, p, false);
+        return 0;
+    }
+    int stride = (synth->channels == 1) ? 1 : 2;
+    int pageFrames = TSF_BRIDGE_PHRASE_PAGE_FLOATS / stride;
+    float scratch[TSF_BRIDGE_MIX_BLOCK * 2];
+    int done = 0;
+    while (done < frames) {
+        // Split at the events like tsf_bridge_phrase_run and in blocks that keep the effect block boundaries,
+        // pages are taken first so the voices go on from the same frame if there's no room
+        int n = tsf_bridge_phrase_events(p, frames - done);
+        for (int end = done + n; done < end;) {
+            int block = end - done;
+            if (block > TSF_BRIDGE_MIX_BLOCK) block = TSF_BRIDGE_MIX_BLOCK;
+            while (e->capacity < e->frames + block) {
+                TSFPhrasePage* page = tsf_bridge_phrase_grow(pc, e);
+                if (!page) {
+                    tsf_bridge_phrase_go_live(synth, p, false);
+                    return done;
+                }
+                if (!e->pcm) e->pcm = page;
+                e->capacity += pageFrames;
+            }
+            tsf_render_float(p->voices, scratch, block, 0);
+            p->position += block;
+            for (int copied = 0; copied < block;) {
+                int offset = e->frames % pageFrames;
+                if (!offset) p->page = e->frames ? p->page->next : e->pcm;
+                int m = pageFrames - offset;
+                if (m > block - copied) m = block - copied;
+                memcpy(p->page->data + (size_t)offset * stride, scratch + (size_t)copied * stride, (size_t)m * stride * sizeof(float));
+                e->frames += m;
+                copied += m;
+            }
+            float* out = dst + (size_t)done * stride;
+            for (int s = 0; s < block * stride; s++) out[s] += scratch[s];
+            done += block;
+        }
+    }
+    return done;
+}
+
+// Ends the play of a player, a complete recording goes to the cache
+static void tsf_bridge_phrase_finish(TSFSynth* synth, TSFPhrasePlayer* p, bool complete) {
+    TSFPhraseCache* pc = &synth->phrases;
+    if (p->mode == TSF_BRIDGE_PHRASE_CACHED || p->mode == TSF_BRIDGE_PHRASE_CATCHUP) {
+        p->entry->readers--;
+    } else if (p->mode == TSF_BRIDGE_PHRASE_RECORDING) {
+        if (complete) tsf_bridge_phrase_store(pc, p->entry);
+        else tsf_bridge_phrase_entry_free(pc, p->entry);
+    }
+    TSFPhrase* phrase = p->phrase;
+    if (!--phrase->players && phrase->released) tsf_bridge_phrase_drop(pc, phrase);
+    p->mode = TSF_BRIDGE_PHRASE_IDLE;
+    p->phrase = NULL;
+    p->entry = NULL;
+    p->page = NULL;
+    p->pendingCount = 0;
+    pc->playing--;
+}
+
+static void tsf_bridge_phrase_silence(tsf* f) {
+    int voices[64];
+    for (int n; (n = tsf_get_active_voices(f, voices, 64)) > 0;)
+        for (int i = 0; i < n; i++) tsf_release_voice(f, voices[i]);
+}
+
+static void tsf_bridge_phrase_stop_all(TSFSynth* synth) {
+    TSFPhraseCache* pc = &synth->phrases;
+    if (!pc->players) return;
+    for (int i = 0; i < TSF_BRIDGE_PHRASE_PLAYERS; i++) {
+        TSFPhrasePlayer* p = &pc->players[i];
+        if (p->mode == TSF_BRIDGE_PHRASE_IDLE) continue;
+        tsf_bridge_phrase_silence(p->voices);
+        tsf_bridge_phrase_finish(synth, p, false);
+    }
+}
+
+static void tsf_bridge_phrase_free_players(TSFPhraseCache* pc) {
+    if (!pc->players) return;
+    for (int i = 0; i < TSF_BRIDGE_PHRASE_PLAYERS; i++) tsf_close(pc->players[i].voices);
+    free(pc->players);
+    pc->players = NULL;
+}
+
+static void tsf_bridge_phrase_free_arena(TSFPhraseCache* pc) {
+    free(pc->arena);
+    pc->arena = NULL;
+    pc->pageCount = 0;
+    pc->freePages = NULL;
+    pc->freeEntries = NULL;
+}
+
+static void tsf_bridge_phrase_free_all(TSFSynth* synth) {
+    TSFPhraseCache* pc = &synth->phrases;
+    tsf_bridge_phrase_stop_all(synth);
+    tsf_bridge_phrase_free_players(pc);
+    tsf_bridge_phrase_clear(pc);
+    tsf_bridge_phrase_free_arena(pc);
+    for (int id = 0; id < TSF_BRIDGE_MAX_PHRASES; id++) {
+        TSFPhrase* phrase = pc->phrases[id].load(std::memory_order_acquire);
+        if (phrase) tsf_bridge_phrase_drop(pc, phrase);
+    }
+    tsf_bridge_phrase_reap(pc);
+}
+
+// Builds the key of a phrase starting now in phrase->key
+static void tsf_bridge_phrase_key(TSFSynth* synth, TSFPhrase* phrase) {
+    TSFPhraseCache* pc = &synth->phrases;
+    int header[9] = { synth->sampleRate, synth->channels, synth->synth->effectBlocks, synth->synth->qualityFlags, 0,
+                      synth->synth->maxVoiceNum, phrase->length, phrase->count, (int)phrase->channelMask };
+    memcpy(&header[4], &synth->virtualization, sizeof(float));
+    unsigned char* k = phrase->key;
+    memcpy(k, header, TSF_BRIDGE_PHRASE_HEADER);
+    k += TSF_BRIDGE_PHRASE_HEADER;
+    memcpy(k, phrase->events, (size_t)phrase->count * sizeof(TSFBridgeEvent));
+    k += (size_t)phrase->count * sizeof(TSFBridgeEvent);
+    for (int channel = 0; channel < 16; channel++) {
+        if (!(phrase->channelMask & (1u << channel))) continue;
+        tsf_channel_get_state(synth->synth, channel, k, pc->stateSize);
+        k += pc->stateSize;
+    }
+}
+
+// FNV-1a
+static unsigned long long tsf_bridge_phrase_hash(const unsigned char* key, int size) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int i = 0; i < size; i++) hash = (hash ^ key[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static TSFPhraseEntry* tsf_bridge_phrase_lookup(TSFPhraseCache* pc, unsigned long long hash, const TSFPhrase* phrase) {
+    for (TSFPhraseEntry* e = pc->newest; e; e = e->older)
+        if (e->hash == hash && tsf_bridge_phrase_key_equal(e, phrase)) return e;
+    return NULL;
+}
+
+// Starts a phrase at sample time time (now or, for plays scheduled without the cache, later)
+static void tsf_bridge_phrase_start(TSFSynth* synth, TSFPhrase* phrase, long long time) {
+    TSFPhraseCache* pc = &synth->phrases;
+    TSFPhrasePlayer* p = NULL;
+    for (int i = 0; pc->players && i < TSF_BRIDGE_PHRASE_PLAYERS && !p; i++)
+        if (pc->players[i].mode == TSF_BRIDGE_PHRASE_IDLE) p = &pc->players[i];
+    if (!p) {
+        // The events go to the synth like scheduled events
+        if (pc->players) pc->stats.overflows++;
+        for (int i = 0; i < phrase->count; i++) {
+            const TSFBridgeEvent* e = &phrase->events[i];
+            TSFCommand c = { e->type, e->channel, e->data1, e->data2, 0.0, TSF_BRIDGE_AT_TIME, time + e->frame_offset };
+            tsf_bridge_queue_event(synth, &c);
+        }
+        return;
+    }
+    
+    p->phrase = phrase;
+    phrase->players++;
+    pc->playing++;
+    tsf_bridge_phrase_key(synth, phrase);
+    unsigned long long hash = tsf_bridge_phrase_hash(phrase->key, phrase->keySize);
+    TSFPhraseEntry* e = tsf_bridge_phrase_lookup(pc, hash, phrase);
+    if (e) {
+        tsf_bridge_phrase_unlink(pc, e);
+        tsf_bridge_phrase_link(pc, e);
+        e->readers++;
+        p->entry = e;
+        p->page = e->pcm;
+        p->read = 0;
+        p->mode = TSF_BRIDGE_PHRASE_CACHED;
+        pc->stats.hits++;
+        return;
+    }
+    
+    pc->stats.misses++;
+    tsf_bridge_phrase_setup(synth, p, phrase->key + TSF_BRIDGE_PHRASE_HEADER + (size_t)phrase->count * sizeof(TSFBridgeEvent));
+    p->entry = NULL;
+    p->mode = TSF_BRIDGE_PHRASE_LIVE;
+    
+    // Recorded unless another player records it already or it can't fit into the cache
+    for (int i = 0; i < TSF_BRIDGE_PHRASE_PLAYERS; i++) {
+        const TSFPhrasePlayer* other = &pc->players[i];
+        if (other->mode == TSF_BRIDGE_PHRASE_RECORDING && other->entry->hash == hash && tsf_bridge_phrase_key_equal(other->entry, phrase)) return;
+    }
+    int pageFrames = TSF_BRIDGE_PHRASE_PAGE_FLOATS / ((synth->channels == 1) ? 1 : 2);
+    int keyPages = (phrase->keySize + TSF_BRIDGE_PHRASE_PAGE_BYTES - 1) / TSF_BRIDGE_PHRASE_PAGE_BYTES;
+    if (keyPages + (phrase->length + pageFrames - 1) / pageFrames > pc->pageCount || !pc->freeEntries) return;
+    
+    e = pc->freeEntries;
+    pc->freeEntries = e->older;
+    e->hash = hash;
+    e->keySize = phrase->keySize;
+    e->frames = 0;
+    e->capacity = 0;
+    e->first = e->pcm = e->last = NULL;
+    e->pages = 0;
+    e->readers = 0;
+    e->newer = e->older = NULL;
+    for (int done = 0; done < phrase->keySize; done += TSF_BRIDGE_PHRASE_PAGE_BYTES) {
+        TSFPhrasePage* page = tsf_bridge_phrase_grow(pc, e);
+        if (!page) {
+            tsf_bridge_phrase_entry_free(pc, e);
+            return;
+        }
+        int n = phrase->keySize - done;
+        memcpy(page->data, phrase->key + done, n < TSF_BRIDGE_PHRASE_PAGE_BYTES ? n : TSF_BRIDGE_PHRASE_PAGE_BYTES);
+    }
+    p->entry = e;
+    p->mode = TSF_BRIDGE_PHRASE_RECORDING;
+}
+
+static void tsf_bridge_phrase_command(TSFSynth* synth, const TSFCommand* c) {
+    TSFPhraseCache* pc = &synth->phrases;
+    if (c->data1 < 0 || c->data1 >= TSF_BRIDGE_MAX_PHRASES) return;
+    TSFPhrase* phrase = pc->phrases[c->data1].load(std::memory_order_acquire);
+    if (!phrase || phrase->released) return;
+    
+    if (c->type == TSF_BRIDGE_COMMAND_PHRASE_RELEASE) {
+        phrase->released = true;
+        if (!phrase->players) tsf_bridge_phrase_drop(pc, phrase);
+        return;
+    }
+    // Applied at its time, from the command queue or the event queue
+    long long time = (c->timing == TSF_BRIDGE_NOW) ? synth->sampleTime.load(std::memory_order_relaxed) : c->time;
+    tsf_bridge_phrase_start(synth, phrase, time);
+}
+
+// Applies a channel change to the synth and passes it on to the phrases playing on the channel,
+// unless it left the channel as it was (note off all reaches all phrases)
+static void tsf_bridge_phrase_forward(TSFSynth* synth, const TSFCommand* c) {
+    TSFPhraseCache* pc = &synth->phrases;
+    bool all = (c->type == TSF_BRIDGE_COMMAND_NOTE_OFF_ALL);
+    if (!all && (c->channel < 0 || c->channel > 15)) {
+        tsf_bridge_apply_channel(synth->synth, c);
+        return;
+    }
+    unsigned char before[64], after[64];
+    bool compare = (!all && pc->stateSize > 0 && pc->stateSize <= (int)sizeof(before));
+    if (compare) tsf_channel_get_state(synth->synth, c->channel, before, pc->stateSize);
+    tsf_bridge_apply_channel(synth->synth, c);
+    if (compare) {
+        tsf_channel_get_state(synth->synth, c->channel, after, pc->stateSize);
+        if (!memcmp(before, after, pc->stateSize)) return;
+    }
+    
+    for (int i = 0; i < TSF_BRIDGE_PHRASE_PLAYERS; i++) {
+        TSFPhrasePlayer* p = &pc->players[i];
+        if (p->mode == TSF_BRIDGE_PHRASE_IDLE) continue;
+        if (!all && !(p->phrase->channelMask & (1u << c->channel))) continue;
+        if (p->mode == TSF_BRIDGE_PHRASE_CACHED || p->mode == TSF_BRIDGE_PHRASE_RECORDING) tsf_bridge_phrase_go_live(synth, p, true);
+        // Held back until the voices caught up, a change that doesn't fit any more applies at once
+        if (p->mode == TSF_BRIDGE_PHRASE_CATCHUP && p->pendingCount < TSF_BRIDGE_PHRASE_PENDING) p->pending[p->pendingCount++] = *c;
+        else tsf_bridge_apply_channel(p->voices, c);
+    }
+}
+
+// Adds the phrases playing to frames of output at frame offset, out and bus_frames as in tsf_bridge_render_events
+// Returns the mask of buses with phrases playing
+static int tsf_bridge_phrase_render(TSFSynth* synth, float* out, int bus_frames, int offset, int frames) {
+    TSFPhraseCache* pc = &synth->phrases;
+    int stride = (synth->channels == 1) ? 1 : 2;
+    int activeBuses = 0;
+    int budget = frames * TSF_BRIDGE_PHRASE_CATCHUP_RATE;
+    for (int i = 0; i < TSF_BRIDGE_PHRASE_PLAYERS; i++) {
+        TSFPhrasePlayer* p = &pc->players[i];
+        if (p->mode == TSF_BRIDGE_PHRASE_IDLE) continue;
+        
+        // Phrases spread over several buses are rendered by channel
+        int bus = bus_frames ? tsf_bridge_phrase_bus(synth, p->phrase->channelMask) : 0;
+        if (bus < 0 && (p->mode == TSF_BRIDGE_PHRASE_CACHED || p->mode == TSF_BRIDGE_PHRASE_RECORDING)) tsf_bridge_phrase_go_live(synth, p, false);
+        if (p->mode == TSF_BRIDGE_PHRASE_CATCHUP) tsf_bridge_phrase_catch_up(synth, p, &budget);
+        
+        float* dst = out + (size_t)offset * stride;
+        if (bus_frames) {
+            if (bus < 0 && p->mode == TSF_BRIDGE_PHRASE_LIVE) {
+                activeBuses |= tsf_bridge_phrase_run_buses(synth, p, out, bus_frames, offset, frames);
+                if (p->position >= p->phrase->length && !tsf_active_voice_count(p->voices)) tsf_bridge_phrase_finish(synth, p, true);
+                continue;
+            }
+            // Until its voices caught up, a spread phrase is mixed into the bus of its first channel
+            for (int channel = 0; bus < 0; channel++) if (p->phrase->channelMask & (1u << channel)) bus = synth->busMap[channel];
+            dst = out + ((size_t)bus * bus_frames + offset) * stride;
+            activeBuses |= 1 << bus;
+        }
+        
+        if (p->mode == TSF_BRIDGE_PHRASE_CACHED || p->mode == TSF_BRIDGE_PHRASE_CATCHUP) {
+            tsf_bridge_phrase_mix(synth, p, dst, frames);
+            if (p->read < p->entry->frames) continue;
+            // Over before the voices caught up, they're behind the audio played
+            if (p->mode == TSF_BRIDGE_PHRASE_CATCHUP) tsf_bridge_phrase_silence(p->voices);
+            tsf_bridge_phrase_finish(synth, p, true);
+            continue;
+        }
+        int done = 0;
+        if (p->mode == TSF_BRIDGE_PHRASE_RECORDING) done = tsf_bridge_phrase_record(synth, p, dst, frames);
+        if (p->mode == TSF_BRIDGE_PHRASE_LIVE) tsf_bridge_phrase_run(synth, p, dst + (size_t)done * stride, frames - done, 1);
+        if (p->position >= p->phrase->length && !tsf_active_voice_count(p->voices)) tsf_bridge_phrase_finish(synth, p, true);
+    }
+    return activeBuses;
+}
+
+static void tsf_bridge_phrase_publish(TSFPhraseCache* pc) {
+    pc->stats.playing = pc->playing;
+    if (pc->publishLock.test_and_set(std::memory_order_acquire)) return;
+    pc->published = pc->stats;
+    pc->publishLock.clear(std::memory_order_release);
+}
+
+int tsf_bridge_set_phrase_cache(TSFHandle handle, int max_bytes) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFPhraseCache* pc = &synth->phrases;
+    TSFStreamPause pause = tsf_bridge_stream_pause(synth);
+    tsf_bridge_phrase_stop_all(synth);
+    tsf_bridge_phrase_clear(pc);
+    tsf_bridge_phrase_free_arena(pc);
+    tsf_bridge_phrase_reap(pc);
+    
+    int result = 1;
+    if (max_bytes > 0 && !pc->players) {
+        // Zeroed players are idle
+        pc->players = (TSFPhrasePlayer*)calloc(TSF_BRIDGE_PHRASE_PLAYERS, sizeof(TSFPhrasePlayer));
+        result = (pc->players != NULL);
+        int maxVoices = synth->synth->maxVoiceNum;
+        for (int i = 0; result && i < TSF_BRIDGE_PHRASE_PLAYERS; i++) {
+            tsf* voices = tsf_copy(synth->synth);
+            pc->players[i].voices = voices;
+            // Preallocated voices don't grow, so the players need theirs as well
+            if (!voices || !tsf_bridge_init_channels(voices) || (maxVoices && !tsf_set_max_voices(voices, maxVoices))) result = 0;
+        }
+        pc->stateSize = tsf_channel_get_state(synth->synth, 0, NULL, 0);
+    }
+    // All the memory recordings take is allocated here, the pages followed by an entry for each of them
+    int pages = (max_bytes > 0) ? max_bytes / (int)sizeof(TSFPhrasePage) : 0;
+    if (result && pages) {
+        pc->arena = malloc((size_t)pages * (sizeof(TSFPhrasePage) + sizeof(TSFPhraseEntry)));
+        result = (pc->arena != NULL);
+    }
+    if (pc->arena) {
+        TSFPhrasePage* page = (TSFPhrasePage*)pc->arena;
+        TSFPhraseEntry* entry = (TSFPhraseEntry*)(page + pages);
+        for (int i = 0; i < pages; i++) {
+            page[i].next = (i + 1 < pages) ? &page[i + 1] : NULL;
+            entry[i].older = (i + 1 < pages) ? &entry[i + 1] : NULL;
+        }
+        pc->pageCount = pages;
+        pc->freePages = page;
+        pc->freeEntries = entry;
+    }
+    if (max_bytes <= 0 || !result) {
+        tsf_bridge_phrase_free_players(pc);
+        tsf_bridge_phrase_free_arena(pc);
+    }
+    
+    memset(&pc->stats, 0, sizeof(pc->stats));
+    pc->stats.budget = pc->players ? max_bytes : 0;
+    tsf_bridge_phrase_publish(pc);
+    tsf_bridge_stream_resume(synth, pause);
+    return result;
+}
+
+int tsf_bridge_get_phrase_cache_stats(TSFHandle handle, TSFBridgePhraseCacheStats* stats) {
+    if (!handle) return 0;
+    
+    TSFPhraseCache* pc = &((TSFSynth*)handle)->phrases;
+    while (pc->publishLock.test_and_set(std::memory_order_acquire)) {}
+    TSFBridgePhraseCacheStats copy = pc->published;
+    pc->publishLock.clear(std::memory_order_release);
+    if (stats) *stats = copy;
+    return copy.bytes;
+}
+
+// ============================================
+// CPU budget governor
+// ============================================
+
+// Render quality of each governor level, the last one culls voices as well
+static const struct { int effectBlocks, flags; } tsfGovernorLevels[TSF_BRIDGE_GOVERNOR_LEVELS] = {
+    { 1, 0 },
+    { 2, 0 },
+    { 4, TSF_QUALITY_STATIC_FILTER },
+    { 8, TSF_QUALITY_STATIC_FILTER | TSF_QUALITY_NEAREST },
+    { 8, TSF_QUALITY_STATIC_FILTER | TSF_QUALITY_NEAREST | TSF_QUALITY_NO_FILTER },
+    { 8, TSF_QUALITY_STATIC_FILTER | TSF_QUALITY_NEAREST | TSF_QUALITY_NO_FILTER },
+};
+
+static double tsf_bridge_clock() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void tsf_bridge_governor_publish(TSFGovernor* g) {
+    if (g->publishLock.test_and_set(std::memory_order_acquire)) return;
+    g->published = g->stats;
+    g->publishLock.clear(std::memory_order_release);
+}
+
+static void tsf_bridge_governor_set_level(TSFSynth* synth, int level) {
+    TSFBridgeGovernorStats* st = &synth->governor.stats;
+    st->level = level;
+    if (level > st->max_level) st->max_level = level;
+    st->effect_blocks = tsfGovernorLevels[level].effectBlocks;
+    st->quality_flags = tsfGovernorLevels[level].flags;
+    tsf_set_render_quality(synth->synth, st->effect_blocks, st->quality_flags);
+}
+
+static void tsf_bridge_governor_reset(TSFSynth* synth, float budget) {
+    TSFGovernor* g = &synth->governor;
+    g->budget = (budget > 0.0f ? budget : 0.0f);
+    g->renderStart = tsf_bridge_clock();
+    g->windowTime = 0.0;
+    g->windowFrames = 0;
+    g->calmFrames = 0;
+    memset(&g->stats, 0, sizeof(g->stats));
+    g->stats.budget = g->budget;
+    g->stats.last_change_time = -1.0;
+    tsf_bridge_governor_set_level(synth, 0);
+    tsf_bridge_governor_publish(g);
+}
+
+// Times the render that ends here and steps the quality down or up once a window is complete
+static void tsf_bridge_end_render(TSFSynth* synth, int frames) {
+    if (synth->phrases.players) tsf_bridge_phrase_publish(&synth->phrases);
+    TSFGovernor* g = &synth->governor;
+    if (!(g->budget > 0.0f)) return;
+    
+    TSFBridgeGovernorStats* st = &g->stats;
+    g->windowTime += tsf_bridge_clock() - g->renderStart;
+    g->windowFrames += frames;
+    st->seconds_at_level[st->level] += (double)frames / synth->sampleRate;
+    if (g->windowFrames >= TSF_BRIDGE_GOVERNOR_WINDOW) {
+        float load = (float)(g->windowTime * synth->sampleRate / g->windowFrames);
+        st->average_load = (st->average_load > 0.0f ? st->average_load + (load - st->average_load) * TSF_BRIDGE_GOVERNOR_SMOOTHING : load);
+        st->load = load;
+        if (load > st->peak_load) st->peak_load = load;
+        if (load > 1.0f) st->overruns++;
+        
+        int level = st->level;
+        if (load > g->budget) {
+            st->over_budget++;
+            g->calmFrames = 0;
+            if (level < TSF_BRIDGE_GOVERNOR_LEVELS - 1) level++;
+            if (level == TSF_BRIDGE_GOVERNOR_LEVELS - 1) {
+                int active = tsf_active_voice_count(synth->synth);
+                st->culled_voices += (unsigned int)tsf_cull_voices(synth->synth, active - (active + 3) / 4);
+            }
+        } else if (level && st->average_load < g->budget * TSF_BRIDGE_GOVERNOR_RESTORE) {
+            g->calmFrames += g->windowFrames;
+            if (g->calmFrames >= synth->sampleRate * TSF_BRIDGE_GOVERNOR_HOLD) {
+                g->calmFrames = 0;
+                level--;
+            }
+        } else {
+            g->calmFrames = 0;
+        }
+        if (level != st->level) {
+            if (level > st->level) st->degrades++;
+            else st->restores++;
+            st->last_change_time = (double)synth->sampleTime.load(std::memory_order_relaxed);
+            st->last_change_load = load;
+            tsf_bridge_governor_set_level(synth, level);
+        }
+        g->windowTime = 0.0;
+        g->windowFrames = 0;
+    }
+    tsf_bridge_governor_publish(g);
+}
+
+// Applies what changed since the last render and queues its sequencer events
+static void tsf_bridge_begin_render(TSFSynth* synth, int frames) {
+    if (synth->governor.budget > 0.0f) synth->governor.renderStart = tsf_bridge_clock();
+    long long now = synth->sampleTime.load(std::memory_order_relaxed);
+    tsf_bridge_sequence_update(synth, now);
+    tsf_bridge_drain_commands(synth, now);
+    tsf_bridge_sequence_dispatch(synth, now, frames);
+}
+
+// Renders one run of frames without events in between
+static void tsf_bridge_render_run(TSFSynth* synth, float* out, int frames) {
+#ifndef TSF_BRIDGE_NO_THREADS
+    if (synth->renderPool) {
+        tsf_bridge_render_parallel(synth, out, frames);
+        return;
+    }
+#endif
+
+    // Clear buffer first (flag_mixing = 0)
+    tsf_render_float(synth->synth, out, frames, 0);
+}
+
+// Renders one run of frames into the bus blocks of bus_frames frames in out, starting at frame offset
+// Returns the mask of buses with voices playing
+static int tsf_bridge_render_bus_run(TSFSynth* synth, float* out, int bus_frames, int offset, int frames) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    float* buses[TSF_BRIDGE_MAX_BUSES];
+    unsigned char active[TSF_BRIDGE_MAX_BUSES];
+    for (int b = 0; b < synth->busCount; b++) buses[b] = out + ((size_t)b * bus_frames + offset) * stride;
+    tsf_render_float_buses(synth->synth, buses, synth->busCount, synth->busMap, 16, frames, 0, active);
+    
+    int mask = 0;
+    for (int b = 0; b < synth->busCount; b++) if (active[b]) mask |= 1 << b;
+    return mask;
+}
+
+// Renders frames of float output, splitting at scheduled events so each one takes effect on its exact frame
+// With bus_frames > 0, out holds the bus blocks of tsf_bridge_render_buses and the mask of buses
+// with voices playing is returned
+static int tsf_bridge_render_events(TSFSynth* synth, float* out, int sample_count, int bus_frames) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    long long now = synth->sampleTime.load(std::memory_order_relaxed);
+    int activeBuses = 0;
+    
+    for (int done = 0; done < sample_count;) {
+        while (synth->eventCount && synth->events[synth->eventHead].time <= now) {
+            // Taken off the queue first, a phrase played without the cache queues its events
+            TSFCommand c = synth->events[synth->eventHead];
+            synth->eventHead++;
+            synth->eventCount--;
+            tsf_bridge_apply_command(synth, &c);
+        }
+        if (!synth->eventCount) synth->eventHead = 0;
+        
+        int frames = sample_count - done;
+        if (synth->eventCount && synth->events[synth->eventHead].time - now < frames)
+            frames = (int)(synth->events[synth->eventHead].time - now);
+        
+        if (bus_frames)
+            activeBuses |= tsf_bridge_render_bus_run(synth, out, bus_frames, done, frames);
+        else
+            tsf_bridge_render_run(synth, out + (size_t)done * stride, frames);
+        if (synth->phrases.playing) activeBuses |= tsf_bridge_phrase_render(synth, out, bus_frames, done, frames);
+        now += frames;
+        done += frames;
+    }
+    synth->sampleTime.store(now, std::memory_order_relaxed);
+    return activeBuses;
+}
+
+#ifndef TSF_BRIDGE_NO_THREADS
+// Renders float frames regardless of the output format
+static void tsf_bridge_render_float(TSFSynth* synth, float* out, int sample_count) {
+    tsf_bridge_begin_render(synth, sample_count);
+    tsf_bridge_render_events(synth, out, sample_count, 0);
+    tsf_bridge_end_render(synth, sample_count);
+}
+#endif
+
+// TPDF dither noise: the sum of two uniform values in [-0.5, 0.5), in LSB
+static inline float tsf_bridge_dither_uniform(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(int)(x >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+// Converts float samples to int16 (scaled by 32767, rounded to nearest, saturated), optionally
+// with TPDF dither. dst may overlap src as long as it doesn't start after it: each group of samples
+// is loaded before the (half as large) result is stored, so the conversion can run in place.
+// Sample i draws its noise from ditherState[i % 4] in every code path.
+static void tsf_bridge_convert_int16(short* dst, const float* src, int count, unsigned int* ditherState) {
+    int i = 0;
+#if defined(TSF_SIMD_SSE2)
+    const __m128 scale = _mm_set1_ps(32767.0f), lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+    const __m128 noiseScale = _mm_set1_ps(1.0f / 16777216.0f), half = _mm_set1_ps(0.5f);
+    __m128i state = ditherState ? _mm_loadu_si128((const __m128i*)ditherState) : _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        if (ditherState) {
+            __m128 noise[4];
+            for (int n = 0; n < 4; n++) {
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+                state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+                noise[n] = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), noiseScale), half);
+            }
+            a = _mm_add_ps(a, _mm_add_ps(noise[0], noise[1]));
+            b = _mm_add_ps(b, _mm_add_ps(noise[2], noise[3]));
+        }
+        a = _mm_min_ps(_mm_max_ps(a, lo), hi);
+        b = _mm_min_ps(_mm_max_ps(b, lo), hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    if (ditherState) _mm_storeu_si128((__m128i*)ditherState, state);
+#elif defined(TSF_SIMD_NEON)
+    const float32x4_t scale = vdupq_n_f32(32767.0f), lo = vdupq_n_f32(-32768.0f), hi = vdupq_n_f32(32767.0f);
+    const float32x4_t noiseScale = vdupq_n_f32(1.0f / 16777216.0f), half = vdupq_n_f32(0.5f);
+    uint32x4_t state = ditherState ? vld1q_u32(ditherState) : vdupq_n_u32(0);
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a = vmulq_f32(vld1q_f32(src + i), scale);
+        float32x4_t b = vmulq_f32(vld1q_f32(src + i + 4), scale);
+        if (ditherState) {
+            float32x4_t noise[4];
+            for (int n = 0; n < 4; n++) {
+                state = veorq_u32(state, vshlq_n_u32(state, 13));
+                state = veorq_u32(state, vshrq_n_u32(state, 17));
+                state = veorq_u32(state, vshlq_n_u32(state, 5));
+                noise[n] = vsubq_f32(vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(vshrq_n_u32(state, 8))), noiseScale), half);
+            }
+            a = vaddq_f32(a, vaddq_f32(noise[0], noise[1]));
+            b = vaddq_f32(b, vaddq_f32(noise[2], noise[3]));
+        }
+        a = vminq_f32(vmaxq_f32(a, lo), hi);
+        b = vminq_f32(vmaxq_f32(b, lo), hi);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    if (ditherState) vst1q_u32(ditherState, state);
+#elif defined(TSF_SIMD_WASM)
+    const v128_t scale = wasm_f32x4_splat(32767.0f), lo = wasm_f32x4_splat(-32768.0f), hi = wasm_f32x4_splat(32767.0f);
+    const v128_t noiseScale = wasm_f32x4_splat(1.0f / 16777216.0f), half = wasm_f32x4_splat(0.5f);
+    v128_t state = ditherState ? wasm_v128_load(ditherState) : wasm_i32x4_splat(0);
+    for (; i + 8 <= count; i += 8) {
+        v128_t a = wasm_f32x4_mul(wasm_v128_load(src + i), scale);
+        v128_t b = wasm_f32x4_mul(wasm_v128_load(src + i + 4), scale);
+        if (ditherState) {
+            v128_t noise[4];
+            for (int n = 0; n < 4; n++) {
+                state = wasm_v128_xor(state, wasm_i32x4_shl(state, 13));
+                state = wasm_v128_xor(state, wasm_u32x4_shr(state, 17));
+                state = wasm_v128_xor(state, wasm_i32x4_shl(state, 5));
+                noise[n] = wasm_f32x4_sub(wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_u32x4_shr(state, 8)), noiseScale), half);
+            }
+            a = wasm_f32x4_add(a, wasm_f32x4_add(noise[0], noise[1]));
+            b = wasm_f32x4_add(b, wasm_f32x4_add(noise[2], noise[3]));
+        }
+        a = wasm_f32x4_nearest(wasm_f32x4_min(wasm_f32x4_max(a, lo), hi));
+        b = wasm_f32x4_nearest(wasm_f32x4_min(wasm_f32x4_max(b, lo), hi));
+        wasm_v128_store(dst + i, wasm_i16x8_narrow_i32x4(wasm_i32x4_trunc_sat_f32x4(a), wasm_i32x4_trunc_sat_f32x4(b)));
+    }
+    if (ditherState) wasm_v128_store(ditherState, state);
+#endif
+    // The rest one sample at a time, through memcpy as the int16 stores may land on the float input
+    const unsigned char* in = (const unsigned char*)src;
+    unsigned char* out = (unsigned char*)dst;
+    for (; i < count; i++) {
+        float v;
+        memcpy(&v, in + (size_t)i * sizeof(float), sizeof(float));
+        v *= 32767.0f;
+        if (ditherState) {
+            float n1 = tsf_bridge_dither_uniform(&ditherState[i & 3]);
+            float n2 = tsf_bridge_dither_uniform(&ditherState[i & 3]);
+            v += n1 + n2;
+        }
+        v = (v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v));
+        short sample = (short)lrintf(v);
+        memcpy(out + (size_t)i * sizeof(short), &sample, sizeof(short));
+    }
+}
+
+// Splits interleaved stereo into a left and a right plane. right may be src itself, each group of
+// frames is loaded before its right samples are stored.
+static void tsf_bridge_deinterleave(float* left, float* right, const float* src, int frames) {
+    int i = 0;
+#if defined(TSF_SIMD_SSE2)
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(src + 2 * i), b = _mm_loadu_ps(src + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(TSF_SIMD_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(src + 2 * i);
+        vst1q_f32(left + i, lr.val[0]);
+        vst1q_f32(right + i, lr.val[1]);
+    }
+#elif defined(TSF_SIMD_WASM)
+    for (; i + 4 <= frames; i += 4) {
+        v128_t a = wasm_v128_load(src + 2 * i), b = wasm_v128_load(src + 2 * i + 4);
+        wasm_v128_store(left + i, wasm_i32x4_shuffle(a, b, 0, 2, 4, 6));
+        wasm_v128_store(right + i, wasm_i32x4_shuffle(a, b, 1, 3, 5, 7));
+    }
+#endif
+    for (; i < frames; i++) {
+        float l = src[2 * i], r = src[2 * i + 1];
+        left[i] = l;
+        right[i] = r;
+    }
+}
+
+// Writes frames of float output to frame position frame of a buffer of bufferFrames frames in the output format
+static void tsf_bridge_write_output(TSFSynth* synth, void* buffer, int bufferFrames, int frame, const float* src, int frames) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    switch (synth->format) {
+        case TSF_BRIDGE_FORMAT_INT16:
+        case TSF_BRIDGE_FORMAT_INT16_DITHER:
+            tsf_bridge_convert_int16((short*)buffer + (size_t)frame * stride, src, frames * stride,
+                                     synth->format == TSF_BRIDGE_FORMAT_INT16_DITHER ? synth->ditherState : NULL);
+            break;
+        case TSF_BRIDGE_FORMAT_FLOAT_PLANAR:
+            tsf_bridge_deinterleave((float*)buffer + frame, (float*)buffer + bufferFrames + frame, src, frames);
+            break;
+        default:
+            memmove((float*)buffer + (size_t)frame * stride, src, sizeof(float) * frames * stride);
+            break;
+    }
+}
+
+#ifndef TSF_BRIDGE_NO_THREADS
+// Writes frames of silence to frame position frame of a buffer of bufferFrames frames in the output format
+static void tsf_bridge_write_silence(TSFSynth* synth, void* buffer, int bufferFrames, int frame, int frames) {
+    int stride = (synth->channels == 1) ? 1 : 2;
+    switch (synth->format) {
+        case TSF_BRIDGE_FORMAT_INT16:
+        case TSF_BRIDGE_FORMAT_INT16_DITHER:
+            memset((short*)buffer + (size_t)frame * stride, 0, sizeof(short) * frames * stride);
+            break;
+        case TSF_BRIDGE_FORMAT_FLOAT_PLANAR:
+            memset((float*)buffer + frame, 0, sizeof(float) * frames);
+            memset((float*)buffer + bufferFrames + frame, 0, sizeof(float) * frames);
+            break;
+        default:
+            memset((float*)buffer + (size_t)frame * stride, 0, sizeof(float) * frames * stride);
+            break;
+    }
+}
+#endif
+
+// Frames of the next render pass of a buffer rendered in parts: at most max_frames, ending a multiple
+// of align (a power of 2 and a multiple of the effect block) after the last event split. The synth
+// starts its effect blocks at every render call, so the passes then process the same blocks as one
+// float render of the whole buffer.
+static int tsf_bridge_aligned_frames(TSFSynth* synth, int max_frames, int align) {
+    int frames = max_frames & ~(align - 1);
+    if (!frames) return 0;
+    
+    long long now = synth->sampleTime.load(std::memory_order_relaxed);
+    long long split = now;
+    for (int i = synth->eventHead; i < synth->eventHead + synth->eventCount; i++) {
+        if (synth->events[i].time >= now + frames) break;
+        if (synth->events[i].time > now) split = synth->events[i].time;
+    }
+    return (int)(split - now) + ((int)(now + frames - split) & ~(align - 1));
+}
+
+int tsf_bridge_render(TSFHandle handle, void* buffer, int sample_count) {
+    if (!handle || !buffer || sample_count <= 0) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    tsf_bridge_begin_render(synth, sample_count);
+    if (synth->format == TSF_BRIDGE_FORMAT_FLOAT) {
+        tsf_bridge_render_events(synth, (float*)buffer, sample_count, 0);
+        tsf_bridge_end_render(synth, sample_count);
+        return sample_count;
+    }
+    
+    // Converted formats take less room (int16) or the same room in a different layout (planar)
+    // than float frames, so each pass renders up to half of the remaining frames as float into the
+    // part of the buffer that isn't written yet and converts them in place: the int16 output starts
+    // at the float input, planar floats go from the free end of the right plane to both planes.
+    int stride = (synth->channels == 1) ? 1 : 2;
+    int done = 0;
+    for (;;) {
+        int frames = tsf_bridge_aligned_frames(synth, (sample_count - done) / 2, TSF_BRIDGE_CONVERT_ALIGN);
+        if (!frames) break;
+        float* scratch = (synth->format == TSF_BRIDGE_FORMAT_FLOAT_PLANAR)
+            ? (float*)buffer + sample_count + done
+            : (float*)((short*)buffer + (size_t)done * stride);
+        tsf_bridge_render_events(synth, scratch, frames, 0);
+        tsf_bridge_write_output(synth, buffer, sample_count, done, scratch, frames);
+        done += frames;
+    }
+    
+    // Less than two alignment blocks are left, render them on the stack
+    float tail[2 * TSF_BRIDGE_CONVERT_ALIGN * 2];
+    if (done < sample_count) {
+        tsf_bridge_render_events(synth, tail, sample_count - done, 0);
+        tsf_bridge_write_output(synth, buffer, sample_count, done, tail, sample_count - done);
+    }
+    tsf_bridge_end_render(synth, sample_count);
+    return sample_count;
+}
+
+void tsf_bridge_set_bus_map(TSFHandle handle, const unsigned char* channel_bus, int bus_count) {
+    if (!handle) return;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    if (bus_count < 1) bus_count = 1;
+    if (bus_count > TSF_BRIDGE_MAX_BUSES) bus_count = TSF_BRIDGE_MAX_BUSES;
+    synth->busCount = bus_count;
+    for (int i = 0; i < 16; i++) {
+        int bus = channel_bus ? channel_bus[i] : i;
+        synth->busMap[i] = (bus < bus_count) ? bus : 0;
+    }
+}
+
+int tsf_bridge_render_buses(TSFHandle handle, float* buffer, int sample_count) {
+    if (!handle || !buffer || sample_count <= 0) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    // The render thread owns the synth while it runs
+    if (synth->stream) return 0;
+    tsf_bridge_begin_render(synth, sample_count);
+    int activeBuses = tsf_bridge_render_events(synth, buffer, sample_count, sample_count);
+    tsf_bridge_end_render(synth, sample_count);
+    return activeBuses;
+}
+
+// Adds frames of an instance's float output to interleaved stereo with a gain per side
+static void tsf_bridge_mix_add(float* out, const float* src, int frames, int stride, float gainLeft, float gainRight) {
+    if (stride == 1) {
+        for (int i = 0; i < frames; i++) {
+            out[2 * i]     += src[i] * gainLeft;
+            out[2 * i + 1] += src[i] * gainRight;
+        }
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        out[2 * i]     += src[2 * i] * gainLeft;
+        out[2 * i + 1] += src[2 * i + 1] * gainRight;
+    }
+}
+
+int tsf_bridge_render_mix(const TSFHandle* handles, const float* gains, const float* pans, int count, float* buffer, int sample_count, int flag_mixing) {
+    if (!handles || !buffer || sample_count <= 0) return 0;
+    
+    if (!flag_mixing) memset(buffer, 0, (size_t)sample_count * 2 * sizeof(float));
+    float scratch[TSF_BRIDGE_MIX_BLOCK * 2];
+    for (int n = 0; n < count; n++) {
+        TSFSynth* synth = (TSFSynth*)handles[n];
+        // The render thread owns the synth while it runs
+        if (!synth || synth->stream) continue;
+        
+        float gain = gains ? gains[n] : 1.0f;
+        float pan = pans ? pans[n] : 0.5f;
+        if (!(pan > 0.0f)) pan = 0.0f;
+        if (pan > 1.0f) pan = 1.0f;
+        float gainLeft = gain * (pan < 0.5f ? 1.0f : 2.0f * (1.0f - pan));
+        float gainRight = gain * (pan > 0.5f ? 1.0f : 2.0f * pan);
+        int stride = (synth->channels == 1) ? 1 : 2;
+        
+        // Rendered in aligned passes like the converted formats of tsf_bridge_render, so each
+        // instance renders the same effect blocks and render slices as a single render of the whole buffer
+        tsf_bridge_begin_render(synth, sample_count);
+        for (int done = 0; done < sample_count;) {
+            int frames = sample_count - done;
+            if (frames > TSF_BRIDGE_MIX_BLOCK) frames = tsf_bridge_aligned_frames(synth, TSF_BRIDGE_MIX_BLOCK, TSF_BRIDGE_MIX_BLOCK);
+            tsf_bridge_render_events(synth, scratch, frames, 0);
+            tsf_bridge_mix_add(buffer + (size_t)done * 2, scratch, frames, stride, gainLeft, gainRight);
+            done += frames;
+        }
+        tsf_bridge_end_render(synth, sample_count);
+    }
+    return sample_count;
+}
+
+int tsf_bridge_schedule_event_at(TSFHandle handle, double sample_time, int type, int channel, int data1, int data2) {
+    if (!handle) return 0;
+    
+    // Past (or NaN) times are clamped to the start of the render that picks the event up
+    long long time = (sample_time > 0.0) ? (long long)sample_time : 0;
+    TSFCommand command = { type, channel, data1, data2, 0.0f, TSF_BRIDGE_AT_TIME, time };
+    return tsf_bridge_push_command((TSFSynth*)handle, command) ? 1 : 0;
+}
+
+int tsf_bridge_schedule_event(TSFHandle handle, int frame_offset, int type, int channel, int data1, int data2) {
+    if (!handle) return 0;
+    
+    TSFCommand command = { type, channel, data1, data2, 0.0f, TSF_BRIDGE_AT_OFFSET, frame_offset > 0 ? frame_offset : 0 };
+    return tsf_bridge_push_command((TSFSynth*)handle, command) ? 1 : 0;
+}
+
+// Claims up to count consecutive cells of the command ring with a single compare-and-swap
+// Returns: number of cells claimed from *first on, 0 if the ring is full
+static int tsf_bridge_claim_commands(TSFSynth* synth, int count, unsigned int* first) {
+    if (count > TSF_BRIDGE_COMMAND_QUEUE_SIZE) count = TSF_BRIDGE_COMMAND_QUEUE_SIZE;
+    unsigned int pos = synth->commandTail.load(std::memory_order_relaxed);
+    for (;;) {
+        // The render thread frees cells in order, so if the last cell of the range is free
+        // all cells before it are as well
+        int n = count;
+        int diff = 0;
+        while (n > 0) {
+            unsigned int last = pos + n - 1;
+            diff = (int)(synth->commands[last & (TSF_BRIDGE_COMMAND_QUEUE_SIZE - 1)].sequence.load(std::memory_order_acquire) - last);
+            if (diff >= 0) break;
+            n /= 2;
+        }
+        if (n == 0) return 0;
+        if (diff == 0 && synth->commandTail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+            *first = pos;
+            return n;
+        }
+        // Another producer got there first
+        if (diff > 0) pos = synth->commandTail.load(std::memory_order_relaxed);
+    }
+}
+
+int tsf_bridge_submit_events(TSFHandle handle, const TSFBridgeEvent* events, int count) {
+    if (!handle || !events || count <= 0) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    int queued = 0;
+    while (queued < count) {
+        unsigned int pos;
+        int n = tsf_bridge_claim_commands(synth, count - queued, &pos);
+        if (!n) {
+            synth->droppedCommands.fetch_add((unsigned int)(count - queued), std::memory_order_relaxed);
+            break;
+        }
+        for (int i = 0; i < n; i++, pos++) {
+            const TSFBridgeEvent* e = &events[queued + i];
+            TSFCommandCell* cell = &synth->commands[pos & (TSF_BRIDGE_COMMAND_QUEUE_SIZE - 1)];
+            TSFCommand command = { e->type, e->channel, e->data1, e->data2, 0.0f,
+                                   e->frame_offset < 0 ? TSF_BRIDGE_NOW : TSF_BRIDGE_AT_OFFSET,
+                                   e->frame_offset < 0 ? 0 : e->frame_offset };
+            cell->command = command;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+        }
+        queued += n;
+    }
+    return queued;
+}
+
+double tsf_bridge_get_sample_time(TSFHandle handle) {
+    if (!handle) return 0.0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    return (double)synth->sampleTime.load(std::memory_order_relaxed);
+}
+
+void tsf_bridge_clear_events(TSFHandle handle) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_CLEAR_EVENTS, 0, 0, 0);
+}
+
+int tsf_bridge_dropped_commands(TSFHandle handle) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    return (int)synth->droppedCommands.load(std::memory_order_relaxed);
+}
+
+// Preallocates the voices of the synth and its phrase players and sizes the render pool for them,
+// so note ons on the render thread steal voices instead of allocating. Called with the stream paused.
+static int tsf_bridge_apply_max_voices(TSFSynth* synth, int max_voices) {
+    int result = tsf_set_max_voices(synth->synth, max_voices);
+    TSFPhraseCache* pc = &synth->phrases;
+    for (int i = 0; result && pc->players && i < TSF_BRIDGE_PHRASE_PLAYERS; i++)
+        result = tsf_set_max_voices(pc->players[i].voices, max_voices);
+#ifndef TSF_BRIDGE_NO_THREADS
+    if (result && synth->renderPool && !tsf_bridge_pool_reserve(synth->renderPool, synth->synth->voiceNum)) result = 0;
+#endif
+    return result;
+}
+
+int tsf_bridge_set_render_threads(TSFHandle handle, int thread_count) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFStreamPause pause = tsf_bridge_stream_pause(synth);
+    tsf_bridge_pool_destroy(synth->renderPool);
+    synth->renderPool = NULL;
+#ifndef TSF_BRIDGE_NO_THREADS
+    if (thread_count > 0) {
+        if (thread_count > TSF_BRIDGE_MAX_RENDER_THREADS) thread_count = TSF_BRIDGE_MAX_RENDER_THREADS;
+        synth->renderPool = tsf_bridge_pool_create(synth->synth, thread_count);
+        if (!synth->renderPool) fprintf(stderr, "Failed to set up parallel rendering\n");
+        else if (!tsf_bridge_apply_max_voices(synth, (synth->synth->maxVoiceNum ? synth->synth->maxVoiceNum : TSF_BRIDGE_DEFAULT_MAX_VOICES)))
+            fprintf(stderr, "Failed to preallocate the voices for parallel rendering\n");
+    }
+    tsf_bridge_stream_resume(synth, pause);
+    return synth->renderPool ? synth->renderPool->threadCount : 0;
+#else
+    (void)thread_count;
+    tsf_bridge_stream_resume(synth, pause);
+    return 0;
+#endif
+}
+
+int tsf_bridge_stream_start(TSFHandle handle, int target_latency_frames, int block_frames) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    tsf_bridge_stream_destroy(synth->stream);
+    synth->stream = NULL;
+#ifndef TSF_BRIDGE_NO_THREADS
+    // The render thread plays notes with the voices allocated up to here
+    if (!synth->synth->maxVoiceNum && !tsf_bridge_apply_max_voices(synth, TSF_BRIDGE_DEFAULT_MAX_VOICES)) {
+        fprintf(stderr, "Failed to preallocate the voices for the render thread\n");
+        return 0;
+    }
+    synth->stream = tsf_bridge_stream_create(synth, target_latency_frames, block_frames);
+    if (!synth->stream) {
+        fprintf(stderr, "Failed to start the render thread\n");
+        return 0;
+    }
+    return synth->stream->targetLatency.load(std::memory_order_relaxed);
+#else
+    (void)target_latency_frames;
+    (void)block_frames;
+    return 0;
+#endif
+}
+
+void tsf_bridge_stream_stop(TSFHandle handle) {
+    if (!handle) return;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    tsf_bridge_stream_destroy(synth->stream);
+    synth->stream = NULL;
+}
+
+int tsf_bridge_stream_set_latency(TSFHandle handle, int target_latency_frames) {
+    if (!handle) return 0;
+    
+#ifndef TSF_BRIDGE_NO_THREADS
+    TSFStream* st = ((TSFSynth*)handle)->stream;
+    if (!st) return 0;
+    if (target_latency_frames < st->blockFrames) target_latency_frames = st->blockFrames;
+    if (target_latency_frames > st->capacity - st->blockFrames) target_latency_frames = st->capacity - st->blockFrames;
+    st->targetLatency.store(target_latency_frames, std::memory_order_relaxed);
+    tsf_bridge_sem_post(&st->wake);
+    return target_latency_frames;
+#else
+    (void)target_latency_frames;
+    return 0;
+#endif
+}
+
+int tsf_bridge_stream_read(TSFHandle handle, void* buffer, int sample_count) {
+    if (!handle || !buffer || sample_count <= 0) return 0;
+    
+#ifndef TSF_BRIDGE_NO_THREADS
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFStream* st = synth->stream;
+    if (st) {
+        unsigned int r = st->readPos.load(std::memory_order_relaxed);
+        int fill = (int)(st->writePos.load(std::memory_order_acquire) - r);
+        int target = st->targetLatency.load(std::memory_order_relaxed);
+        if (fill > target + st->blockFrames) {
+            // The target latency was lowered, skip the oldest frames to get down to it right away
+            r += (unsigned int)(fill - target);
+            fill = target;
+            st->overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        int frames = (sample_count < fill ? sample_count : fill);
+        int offset = (int)(r & (st->capacity - 1));
+        int first = (frames < st->capacity - offset ? frames : st->capacity - offset);
+        tsf_bridge_write_output(synth, buffer, sample_count, 0, st->ring + (size_t)offset * st->floatsPerFrame, first);
+        tsf_bridge_write_output(synth, buffer, sample_count, first, st->ring, frames - first);
+        if (frames < sample_count) {
+            // The render thread fell behind, pad with silence
+            tsf_bridge_write_silence(synth, buffer, sample_count, frames, sample_count - frames);
+            st->underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        st->readPos.store(r + frames, std::memory_order_release);
+        tsf_bridge_sem_post(&st->wake);
+        return frames;
+    }
+#endif
+    // No stream running, render on the calling thread
+    return tsf_bridge_render(handle, buffer, sample_count);
+}
+
+int tsf_bridge_stream_underruns(TSFHandle handle) {
+    if (!handle) return 0;
+    
+#ifndef TSF_BRIDGE_NO_THREADS
+    TSFStream* st = ((TSFSynth*)handle)->stream;
+    if (st) return (int)st->underruns.load(std::memory_order_relaxed);
+#endif
+    return 0;
+}
+
+int tsf_bridge_stream_overruns(TSFHandle handle) {
+    if (!handle) return 0;
+    
+#ifndef TSF_BRIDGE_NO_THREADS
+    TSFStream* st = ((TSFSynth*)handle)->stream;
+    if (st) return (int)st->overruns.load(std::memory_order_relaxed);
+#endif
+    return 0;
+}
+
+void tsf_bridge_note_off_all(TSFHandle handle) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_NOTE_OFF_ALL, 0, 0, 0);
+}
+
+int tsf_bridge_active_voices(TSFHandle handle) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    return tsf_active_voice_count(synth->synth);
+}
+// Set per-channel volume (0.0 = silent, 1.0 = full)
+void tsf_bridge_channel_set_volume(TSFHandle handle, int channel, float volume) {
+    if (!handle) return;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_CHANNEL_VOLUME, channel, 0, 0, volume, TSF_BRIDGE_NOW, 0 };
+    tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+void tsf_bridge_set_cpu_budget(TSFHandle handle, float budget) {
+    if (!handle) return;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_CPU_BUDGET, 0, 0, 0, (budget > 0.0f ? budget : 0.0f), TSF_BRIDGE_NOW, 0 };
+    tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+int tsf_bridge_get_governor_stats(TSFHandle handle, TSFBridgeGovernorStats* stats) {
+    if (!handle) return 0;
+    
+    TSFGovernor* g = &((TSFSynth*)handle)->governor;
+    while (g->publishLock.test_and_set(std::memory_order_acquire)) {}
+    TSFBridgeGovernorStats copy = g->published;
+    g->publishLock.clear(std::memory_order_release);
+    if (stats) *stats = copy;
+    return copy.level;
+}
+
+void tsf_bridge_set_voice_virtualization(TSFHandle handle, float threshold_db) {
+    if (!handle) return;
+    TSFCommand command = { TSF_BRIDGE_COMMAND_VIRTUALIZATION, 0, 0, 0, threshold_db, TSF_BRIDGE_NOW, 0 };
+    tsf_bridge_push_command((TSFSynth*)handle, command);
+}
+
+int tsf_bridge_set_oneshot_cache(TSFHandle handle, int max_bytes) {
+    if (!handle) return 0;
+    
+    // Allocates the whole budget, so it's applied here with the render thread held rather than by a command
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFStreamPause pause = tsf_bridge_stream_pause(synth);
+    int result = tsf_set_oneshot_cache(synth->synth, max_bytes);
+    tsf_bridge_stream_resume(synth, pause);
+    return result;
+}
+
+int tsf_bridge_set_max_voices(TSFHandle handle, int max_voices) {
+    if (!handle || max_voices <= 0) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    TSFStreamPause pause = tsf_bridge_stream_pause(synth);
+    int result = tsf_bridge_apply_max_voices(synth, max_voices);
+    tsf_bridge_stream_resume(synth, pause);
+    return result;
+}
+
+void tsf_bridge_channel_set_polyphony(TSFHandle handle, int channel, int max_voices) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_CHANNEL_POLYPHONY, channel, (max_voices < 0 ? 0 : (max_voices > 0xFFFF ? 0xFFFF : max_voices)), 0);
+}
+
+void tsf_bridge_channel_set_priority(TSFHandle handle, int channel, int priority) {
+    tsf_bridge_send(handle, TSF_BRIDGE_COMMAND_CHANNEL_PRIORITY, channel, (priority < 0 ? 0 : (priority > 127 ? 127 : priority)), 0);
+}
+
+// ============================================
+// Snapshots
+// ============================================
+
+// Fixed part of a snapshot, followed by the pending scheduled events and the tsf_snapshot of the synth
+struct TSFSnapshotHeader {
+    unsigned int magic;
+    int size;
+    int eventCount;
+    int synthSize;
+    long long sampleTime;
+    unsigned int ditherState[4];
+    // The sequencer position only applies to the sequence it was taken with, which isn't copied
+    unsigned int sequenceGeneration;
+    bool playing;
+    bool loop;
+    int playingState;
+    int next;
+    double bpm;
+    long long anchorSample;
+    double anchorBeat;
+    double framesPerBeat;
+    double beat;
+    unsigned char sounding[16 * 128];
+};
+
+int tsf_bridge_snapshot(TSFHandle handle, void* buffer, int size) {
+    if (!handle) return 0;
+    
+    TSFSynth* synth = (TSFSynth*)handle;
+    // The render thread owns the synth while it runs
+    if (synth->stream) return 0;
+    int synthSize = tsf_snapshot(synth->synth, NULL, 0);
+    long long total = (long long)(sizeof(TSFSnapshotHeader) + synth->eventCount * sizeof(TSFCommand)) + synthSize;
+    if (total > 0x7FFFFFFF) return 0;
+    if (!buffer || size < total) return (int)total;
+    
+    TSFSnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TSF_BRIDGE_SNAPSHOT_MAGIC;
+    h.size = (int)total;
+    h.eventCount = synth->eventCount;
+    h.synthSize = synthSize;
+    h.sampleTime = synth->sampleTime.load(std::memory_order_relaxed);
+    memcpy(h.ditherState, synth->ditherState, sizeof(h.ditherState));
+    const TSFSequencer* sq = &synth->sequencer;
+    h.sequenceGeneration = sq->generation;
+    h.playing = sq->playing;
+    h.loop = sq->loop;
+    h.playingState = sq->playingState.load(std::memory_order_relaxed);
+    h.next = sq->next;
+    h.bpm = sq->bpm;
+    h.anchorSample = sq->anchorSample;
+    h.anchorBeat = sq->anchorBeat;
+    h.framesPerBeat = sq->framesPerBeat;
+    h.beat = sq->beat.load(std::memory_order_relaxed);
+    memcpy(h.sounding, sq->sounding, sizeof(h.sounding));
+    
+    char* out = (char*)buffer;
+    memcpy(out, &h, sizeof(h));
+    out += sizeof(h);
+    if (synth->eventCount) {
+        memcpy(out, synth->events + synth->eventHead, synth->eventCount * sizeof(TSFCommand));
+        out += synth->eventCount * sizeof(TSFCommand);
+    }
+    tsf_snapshot(synth->synth, out, synthSize);
+    return (int)total;
+}
+
+int tsf_bridge_restore(TSFHandle handle, const void* buffer, int size) {
+    if (!handle || !buffer || size < (int)sizeof(TSFSnapshotHeader)) return 0;
     
-    // Set default output to stereo, 44.1kHz, -6dB gain to prevent clipping
-    tsf_set_output(synth, TSF_STEREO_INTERLEAVED, 44100, -6.0f);
+    TSFSynth* synth = (TSFSynth*)handle;
+    if (synth->stream) return 0;
+    TSFSnapshotHeader h;
+    memcpy(&h, buffer, sizeof(h));
+    if (h.magic != TSF_BRIDGE_SNAPSHOT_MAGIC || h.size > size || h.eventCount < 0 || h.eventCount > TSF_BRIDGE_EVENT_QUEUE_SIZE || h.synthSize < 0) return 0;
+    if ((long long)(sizeof(h) + h.eventCount * sizeof(TSFCommand)) + h.synthSize != h.size) return 0;
     
-    // Initialize channel 0 to use preset 0 (piano in most SoundFonts)
-    tsf_channel_set_bank_preset(synth, 0, 0, 0);
+    // The synth is checked (same font and sample rate) and restored first, so a failed restore
+    // leaves the rest alone
+    const char* in = (const char*)buffer + sizeof(h);
+    if (!tsf_restore(synth->synth, in + h.eventCount * sizeof(TSFCommand), h.synthSize)) return 0;
+    memcpy(synth->events, in, h.eventCount * sizeof(TSFCommand));
+    synth->eventHead = 0;
+    synth->eventCount = h.eventCount;
+    synth->sampleTime.store(h.sampleTime, std::memory_order_relaxed);
+    memcpy(synth->ditherState, h.ditherState, sizeof(h.ditherState));
+#ifndef TSF_BRIDGE_NO_THREADS
+    // The snapshot may have more voices than the synth had preallocated
+    if (synth->renderPool) tsf_bridge_pool_reserve(synth->renderPool, synth->synth->voiceNum);
+#endif
+    // Phrases aren't part of snapshots
+    tsf_bridge_phrase_stop_all(synth);
     
-    return (TSFHandle)handle;
+    TSFSequencer* sq = &synth->sequencer;
+    if (sq->generation && sq->generation == h.sequenceGeneration) {
+        sq->playing = h.playing;
+        sq->loop = h.loop;
+        sq->playingState.store(h.playingState, std::memory_order_relaxed);
+        sq->next = h.next;
+        sq->bpm = h.bpm;
+        sq->anchorSample = h.anchorSample;
+        sq->anchorBeat = h.anchorBeat;
+        sq->framesPerBeat = h.framesPerBeat;
+        sq->beat.store(h.beat, std::memory_order_relaxed);
+        memcpy(sq->sounding, h.sounding, sizeof(sq->sounding));
+    }
+    return 1;
 }
 
-TSFHandle tsf_bridge_init_memory(const void* buffer, int size) {
-    if (!buffer || size <= 0) return NULL;
+// ============================================
+// Standard MIDI file parsing
+// ============================================
+
+// Read position in one track of a MIDI file
+struct TSFMidiTrack {
+    const unsigned char* pos;
+    const unsigned char* end;
+    unsigned long long tick;    // Tick of the event at pos
+    unsigned char running;      // Running status
+    bool done;
+};
+
+static unsigned int tsf_bridge_midi_read_be(const unsigned char* p, int bytes) {
+    unsigned int v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+// Reads a variable-length quantity, returns false if it runs past end
+static bool tsf_bridge_midi_read_vlq(const unsigned char** p, const unsigned char* end, unsigned int* value) {
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++) {
+        if (*p >= end) return false;
+        unsigned char c = *(*p)++;
+        v = (v << 7) | (c & 0x7F);
+        if (!(c & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves the track to its next event, marks it done at the end or on malformed data
+static void tsf_bridge_midi_next(TSFMidiTrack* t) {
+    unsigned int delta;
+    if (t->pos >= t->end || !tsf_bridge_midi_read_vlq(&t->pos, t->end, &delta) || t->pos >= t->end) {
+        t->done = true;
+        return;
+    }
+    t->tick += delta;
+}
+
+// (a * b) / c without overflowing for sample times up to 32 bits
+static unsigned long long tsf_bridge_midi_scale(unsigned long long a, unsigned long long b, unsigned long long c) {
+    return (a / c) * b + (a % c) * b / c;
+}
+
+int tsf_bridge_midi_parse(const void* data, int size, int sample_rate, void* buffer, int buffer_size) {
+    if (!data || size < 14 || sample_rate <= 0) return 0;
     
-    tsf* synth = tsf_load_memory(buffer, size);
-    if (!synth) {
-        fprintf(stderr, "Failed to load SoundFont from memory\n");
-        return NULL;
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    if (memcmp(p, "MThd", 4) != 0) return 0;
+    unsigned int headerLength = tsf_bridge_midi_read_be(p + 4, 4);
+    if (headerLength < 6 || headerLength > (unsigned int)size - 8) return 0;
+    int format = (int)tsf_bridge_midi_read_be(p + 8, 2);
+    int trackCount = (int)tsf_bridge_midi_read_be(p + 10, 2);
+    unsigned int division = tsf_bridge_midi_read_be(p + 12, 2);
+    if (format > 1 || !trackCount || !division) return 0;
+    p += 8 + headerLength;
+    
+    TSFMidiTrack* tracks = (TSFMidiTrack*)malloc(sizeof(TSFMidiTrack) * trackCount);
+    if (!tracks) return 0;
+    int found = 0;
+    while (found < trackCount && end - p >= 8) {
+        unsigned int length = tsf_bridge_midi_read_be(p + 4, 4);
+        const unsigned char* chunkEnd = (length > (unsigned int)(end - p - 8)) ? end : p + 8 + length;
+        if (memcmp(p, "MTrk", 4) == 0) {
+            TSFMidiTrack* t = &tracks[found++];
+            t->pos = p + 8;
+            t->end = chunkEnd;
+            t->tick = 0;
+            t->running = 0;
+            t->done = false;
+            tsf_bridge_midi_next(t);
+        }
+        p = chunkEnd;
+    }
+    if (!found) {
+        free(tracks);
+        return 0;
     }
     
-    TSFSynth* handle = (TSFSynth*)malloc(sizeof(TSFSynth));
-    if (!handle) {
-        tsf_close(synth);
-        return NULL;
+    // Times are kept in microseconds times the division, exact across tempo changes
+    unsigned long long scaledTime = 0, lastTick = 0, ticksPerSecond = 0, maxSample = 0;
+    unsigned int tempo = 500000;
+    if (division & 0x8000) {
+        // SMPTE frames per second (negative) and ticks per frame
+        ticksPerSecond = (unsigned long long)(-(signed char)(division >> 8)) * (division & 0xFF);
+        if (!ticksPerSecond) {
+            free(tracks);
+            return 0;
+        }
     }
     
-    handle->synth = synth;
-    handle->sampleRate = 44100;
-    handle->channels = 2;
+    unsigned char bank[16] = { 0 };
+    unsigned short channels = 0;
+    unsigned long long count = 0;
+    unsigned long long capacity = (buffer && buffer_size >= (int)sizeof(TSFBridgeMidiHeader)) ?
+        (buffer_size - sizeof(TSFBridgeMidiHeader)) / sizeof(TSFBridgeMidiEvent) : 0;
+    TSFBridgeMidiEvent* events = buffer ? (TSFBridgeMidiEvent*)((TSFBridgeMidiHeader*)buffer + 1) : NULL;
+    bool valid = true;
     
-    tsf_set_output(synth, TSF_STEREO_INTERLEAVED, 44100, -6.0f);
-    tsf_channel_set_bank_preset(synth, 0, 0, 0);
+    for (;;) {
+        // Merge the tracks: the earliest event next, the lower track first at the same tick
+        TSFMidiTrack* t = NULL;
+        for (int i = 0; i < found; i++) {
+            if (!tracks[i].done && (!t || tracks[i].tick < t->tick)) t = &tracks[i];
+        }
+        if (!t) break;
+        
+        unsigned long long sample;
+        if (ticksPerSecond) {
+            sample = tsf_bridge_midi_scale(t->tick, sample_rate, ticksPerSecond);
+        } else {
+            scaledTime += (t->tick - lastTick) * tempo;
+            lastTick = t->tick;
+            sample = tsf_bridge_midi_scale(scaledTime, sample_rate, (unsigned long long)division * 1000000);
+        }
+        if (sample > 0xFFFFFFFFull) {
+            valid = false;
+            break;
+        }
+        if (sample > maxSample) maxSample = sample;
+        
+        unsigned char status = *t->pos;
+        if (status & 0x80) t->pos++;
+        else if (t->running) status = t->running;
+        else {
+            // Data byte without running status
+            t->done = true;
+            continue;
+        }
+        
+        if (status == 0xFF) {
+            // Meta event, only tempo changes and the end of the track matter
+            unsigned int length;
+            if (t->pos >= t->end) {
+                t->done = true;
+                continue;
+            }
+            unsigned char type = *t->pos++;
+            if (!tsf_bridge_midi_read_vlq(&t->pos, t->end, &length) || length > (unsigned int)(t->end - t->pos) || type == 0x2F) {
+                t->done = true;
+                continue;
+            }
+            if (type == 0x51 && length == 3) tempo = tsf_bridge_midi_read_be(t->pos, 3);
+            t->pos += length;
+        } else if (status == 0xF0 || status == 0xF7) {
+            // System exclusive
+            unsigned int length;
+            if (!tsf_bridge_midi_read_vlq(&t->pos, t->end, &length) || length > (unsigned int)(t->end - t->pos)) {
+                t->done = true;
+                continue;
+            }
+            t->pos += length;
+        } else if (status >= 0x80 && status < 0xF0) {
+            t->running = status;
+            int kind = status & 0xF0, channel = status & 0x0F;
+            int bytes = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+            if (t->end - t->pos < bytes) {
+                t->done = true;
+                continue;
+            }
+            int data1 = t->pos[0] & 0x7F, data2 = (bytes == 2) ? (t->pos[1] & 0x7F) : 0;
+            t->pos += bytes;
+            
+            TSFBridgeMidiEvent e = { (unsigned int)sample, (unsigned char)kind, (unsigned char)channel, (unsigned short)data1, (unsigned short)data2, 0 };
+            switch (kind) {
+                case 0x80:
+                    e.data2 = 0;
+                    break;
+                case 0x90:
+                    if (data2) channels |= (unsigned short)(1 << channel);
+                    else e.type = TSF_BRIDGE_EVENT_NOTE_OFF;
+                    break;
+                case 0xB0:
+                    // Bank select MSB, applied with the next program change
+                    if (data1 == 0) bank[channel] = (unsigned char)data2;
+                    break;
+                case 0xC0:
+                    e.data2 = (channel == 9) ? 128 : bank[channel];
+                    break;
+                case 0xE0:
+                    e.data1 = (unsigned short)(data1 | (data2 << 7));
+                    e.data2 = 0;
+                    break;
+                default:
+                    e.type = 0;  // Aftertouch, not supported by the synth
+                    break;
+            }
+            if (e.type) {
+                if (count < capacity) events[count] = e;
+                count++;
+            }
+        } else {
+            // System common and real-time messages don't belong in files
+            t->done = true;
+            continue;
+        }
+        tsf_bridge_midi_next(t);
+    }
+    free(tracks);
     
-    return (TSFHandle)handle;
+    unsigned long long bytes = sizeof(TSFBridgeMidiHeader) + count * sizeof(TSFBridgeMidiEvent);
+    if (!valid || bytes > 0x7FFFFFFF) return 0;
+    if (buffer && (unsigned long long)buffer_size >= bytes) {
+        TSFBridgeMidiHeader* header = (TSFBridgeMidiHeader*)buffer;
+        header->magic = TSF_BRIDGE_MIDI_MAGIC;
+        header->version = TSF_BRIDGE_MIDI_VERSION;
+        header->sample_rate = (unsigned int)sample_rate;
+        header->event_count = (unsigned int)count;
+        header->length = (unsigned int)maxSample;
+        header->channels = channels;
+        header->reserved = 0;
+    }
+    return (int)bytes;
 }
 
-void tsf_bridge_close(TSFHandle handle) {
-    if (!handle) return;
+const TSFBridgeMidiEvent* tsf_bridge_midi_events(const void* buffer, int size, int* event_count) {
+    if (!buffer || size < (int)sizeof(TSFBridgeMidiHeader)) return NULL;
     
-    TSFSynth* synth = (TSFSynth*)handle;
-    if (synth->synth) {
-        tsf_close(synth->synth);
+    const TSFBridgeMidiHeader* header = (const TSFBridgeMidiHeader*)buffer;
+    if (header->magic != TSF_BRIDGE_MIDI_MAGIC || header->version != TSF_BRIDGE_MIDI_VERSION) return NULL;
+    if (header->event_count > (size - sizeof(TSFBridgeMidiHeader)) / sizeof(TSFBridgeMidiEvent)) return NULL;
+    if (event_count) *event_count = (int)header->event_count;
+    return (const TSFBridgeMidiEvent*)(header + 1);
+}
+
+// ============================================
+// MIDI file checkpoints and seeking
+// ============================================
+
+// MIDI state of all channels while walking through a packed file
+struct TSFMidiPlayState {
+    TSFBridgeMidiChannelState channels[16];
+    unsigned char velocity[16 * 128];   // Velocity of the sounding notes, 0 = not sounding
+    unsigned char released[16 * 128];   // Key up, held by the sustain pedal
+};
+
+// Controller reset (121) like tsf_channel_midi_control, the preset and pitch wheel stay
+static void tsf_bridge_midi_state_reset_controllers(TSFBridgeMidiChannelState* c) {
+    c->volume = c->expression = 16383;
+    c->pan = 8192;
+    c->rpn = 0xFFFF;
+    c->data = 0;
+    c->pitch_range = 0;
+    c->tuning = 0.0f;
+    c->flags &= TSF_BRIDGE_MIDI_STATE_SUSTAIN | TSF_BRIDGE_MIDI_STATE_PITCH_WHEEL;
+}
+
+static void tsf_bridge_midi_state_init(TSFMidiPlayState* s) {
+    for (int i = 0; i < 16; i++) {
+        TSFBridgeMidiChannelState* c = &s->channels[i];
+        c->program = 0xFFFF;
+        c->bank = 0;
+        c->pitch_wheel = 8192;
+        c->flags = 0;
+        tsf_bridge_midi_state_reset_controllers(c);
     }
-    free(synth);
+    memset(s->velocity, 0, sizeof(s->velocity));
+    memset(s->released, 0, sizeof(s->released));
 }
 
-void tsf_bridge_set_output(TSFHandle handle, int sample_rate, int channels) {
-    if (!handle) return;
-    
-    TSFSynth* synth = (TSFSynth*)handle;
-    synth->sampleRate = sample_rate;
-    synth->channels = channels;
+static void tsf_bridge_midi_state_notes_off(TSFMidiPlayState* s, int channel, bool releasedOnly) {
+    for (int key = channel * 128; key < channel * 128 + 128; key++) {
+        if (releasedOnly && !s->released[key]) continue;
+        s->velocity[key] = 0;
+        s->released[key] = 0;
+    }
+}
+
+// Follows the controllers the way tsf_channel_midi_control combines them
+static void tsf_bridge_midi_state_control(TSFMidiPlayState* s, int channel, int controller, int value) {
+    TSFBridgeMidiChannelState* c = &s->channels[channel];
+    unsigned short v = (unsigned short)(value & 0x7F);
+    switch (controller) {
+        case 7:   c->volume     = (unsigned short)((c->volume     & 0x7F  ) | (v << 7)); return;
+        case 39:  c->volume     = (unsigned short)((c->volume     & 0x3F80) |  v);       return;
+        case 11:  c->expression = (unsigned short)((c->expression & 0x7F  ) | (v << 7)); return;
+        case 43:  c->expression = (unsigned short)((c->expression & 0x3F80) |  v);       return;
+        case 10:  c->pan        = (unsigned short)((c->pan        & 0x7F  ) | (v << 7)); c->flags |= TSF_BRIDGE_MIDI_STATE_PAN; return;
+        case 42:  c->pan        = (unsigned short)((c->pan        & 0x3F80) |  v);       c->flags |= TSF_BRIDGE_MIDI_STATE_PAN; return;
+        case 6:   c->data       = (unsigned short)((c->data       & 0x7F  ) | (v << 7)); break;
+        case 38:  c->data       = (unsigned short)((c->data       & 0x3F80) |  v);       break;
+        case 101: c->rpn = (unsigned short)(((c->rpn == 0xFFFF ? 0 : c->rpn) & 0x7F  ) | (v << 7)); return;
+        case 100: c->rpn = (unsigned short)(((c->rpn == 0xFFFF ? 0 : c->rpn) & 0x3F80) |  v);       return;
+        case 98:
+        case 99:  c->rpn = 0xFFFF; return;
+        case 64:
+            if (v >= 64) {
+                c->flags |= TSF_BRIDGE_MIDI_STATE_SUSTAIN;
+            } else if (c->flags & TSF_BRIDGE_MIDI_STATE_SUSTAIN) {
+                c->flags &= ~TSF_BRIDGE_MIDI_STATE_SUSTAIN;
+                tsf_bridge_midi_state_notes_off(s, channel, true);
+            }
+            return;
+        case 120:
+        case 123: tsf_bridge_midi_state_notes_off(s, channel, false); return;
+        case 121: tsf_bridge_midi_state_reset_controllers(c); return;
+        default: return;
+    }
     
-    enum TSFOutputMode mode = (channels == 1) ? TSF_MONO : TSF_STEREO_INTERLEAVED;
-    tsf_set_output(synth->synth, mode, sample_rate, -6.0f);
+    // Data entry
+    if (c->rpn == 0) {
+        c->pitch_range = c->data;
+        c->flags |= TSF_BRIDGE_MIDI_STATE_PITCH_RANGE;
+    } else if (c->rpn == 1) {
+        // Same float operations as the synth, whose result depends on the order of fine and coarse tuning
+        c->tuning = (int)c->tuning + ((float)c->data - 8192.0f) / 8192.0f;
+    } else if (c->rpn == 2 && controller == 6) {
+        c->tuning = ((float)v - 64.0f) + (c->tuning - (int)c->tuning);
+    }
 }
 
-void tsf_bridge_note_on(TSFHandle handle, int channel, int note, int velocity) {
-    if (!handle) return;
+static void tsf_bridge_midi_state_apply(TSFMidiPlayState* s, const TSFBridgeMidiEvent* e) {
+    if (e->channel > 15) return;
+    TSFBridgeMidiChannelState* c = &s->channels[e->channel];
+    int key = e->channel * 128 + (e->data1 & 0x7F);
+    // Velocity 0 is a note-off
+    int type = (e->type == TSF_BRIDGE_EVENT_NOTE_ON && !e->data2) ? TSF_BRIDGE_EVENT_NOTE_OFF : e->type;
+    switch (type) {
+        case TSF_BRIDGE_EVENT_NOTE_ON:
+            s->velocity[key] = (unsigned char)(e->data2 > 127 ? 127 : e->data2);
+            s->released[key] = 0;
+            break;
+        case TSF_BRIDGE_EVENT_NOTE_OFF:
+            if (!s->velocity[key]) break;
+            if (c->flags & TSF_BRIDGE_MIDI_STATE_SUSTAIN) s->released[key] = 1;
+            else s->velocity[key] = 0;
+            break;
+        case TSF_BRIDGE_EVENT_CONTROL_CHANGE:
+            tsf_bridge_midi_state_control(s, e->channel, e->data1, e->data2);
+            break;
+        case TSF_BRIDGE_EVENT_PROGRAM_CHANGE:
+            c->program = e->data1;
+            c->bank = e->data2;
+            break;
+        case TSF_BRIDGE_EVENT_PITCH_BEND:
+            c->pitch_wheel = (unsigned short)(e->data1 & 0x3FFF);
+            c->flags |= TSF_BRIDGE_MIDI_STATE_PITCH_WHEEL;
+            break;
+    }
+}
+
+static const TSFBridgeMidiIndexHeader* tsf_bridge_midi_index_check(const void* index, int index_size, unsigned int sampleRate) {
+    if (!index || index_size < (int)sizeof(TSFBridgeMidiIndexHeader)) return NULL;
+    const TSFBridgeMidiIndexHeader* header = (const TSFBridgeMidiIndexHeader*)index;
+    if (header->magic != TSF_BRIDGE_MIDI_INDEX_MAGIC || header->version != TSF_BRIDGE_MIDI_INDEX_VERSION) return NULL;
+    if (header->sample_rate != sampleRate || !header->interval || !header->checkpoint_count) return NULL;
+    unsigned long long bytes = sizeof(TSFBridgeMidiIndexHeader) + (unsigned long long)header->checkpoint_count * sizeof(TSFBridgeMidiCheckpoint) +
+                               (unsigned long long)header->note_count * sizeof(TSFBridgeMidiSoundingNote);
+    return (bytes <= (unsigned long long)index_size) ? header : NULL;
+}
+
+int tsf_bridge_midi_index(const void* buffer, int size, int interval, void* index, int index_size) {
+    int eventCount;
+    const TSFBridgeMidiEvent* events = tsf_bridge_midi_events(buffer, size, &eventCount);
+    if (!events || interval < 1) return 0;
+    const TSFBridgeMidiHeader* song = (const TSFBridgeMidiHeader*)buffer;
     
-    TSFSynth* synth = (TSFSynth*)handle;
+    TSFMidiPlayState* state = (TSFMidiPlayState*)malloc(sizeof(TSFMidiPlayState));
+    if (!state) return 0;
+    tsf_bridge_midi_state_init(state);
+    
+    // One pass over the events, counting the notes first so the size is known before writing
+    unsigned long long checkpointCount = song->length / (unsigned int)interval + 1;
+    unsigned long long noteCount = 0;
+    unsigned long long bytes = sizeof(TSFBridgeMidiIndexHeader) + checkpointCount * sizeof(TSFBridgeMidiCheckpoint);
+    bool write = index && (unsigned long long)index_size >= bytes;
+    TSFBridgeMidiCheckpoint* checkpoints = write ? (TSFBridgeMidiCheckpoint*)((TSFBridgeMidiIndexHeader*)index + 1) : NULL;
+    TSFBridgeMidiSoundingNote* notes = write ? (TSFBridgeMidiSoundingNote*)(checkpoints + checkpointCount) : NULL;
+    unsigned long long noteCapacity = write ? ((unsigned long long)index_size - bytes) / sizeof(TSFBridgeMidiSoundingNote) : 0;
     
-    // Convert MIDI velocity (0-127) to float (0.0-1.0)
-    float vel = velocity / 127.0f;
+    int next = 0;
+    for (unsigned long long k = 0; k < checkpointCount; k++) {
+        unsigned long long sample = k * (unsigned int)interval;
+        while (next < eventCount && events[next].sample < sample) tsf_bridge_midi_state_apply(state, &events[next++]);
+        if (checkpoints) {
+            TSFBridgeMidiCheckpoint* cp = &checkpoints[k];
+            cp->sample = (unsigned int)sample;
+            cp->event = (unsigned int)next;
+            cp->note_offset = (unsigned int)noteCount;
+            memcpy(cp->channels, state->channels, sizeof(cp->channels));
+        }
+        int sounding = 0;
+        for (int key = 0; key < 16 * 128; key++) {
+            if (!state->velocity[key]) continue;
+            if (noteCount + sounding < noteCapacity) {
+                TSFBridgeMidiSoundingNote n = { (unsigned char)(key >> 7), (unsigned char)(key & 0x7F), state->velocity[key], state->released[key] };
+                notes[noteCount + sounding] = n;
+            }
+            sounding++;
+        }
+        if (checkpoints) checkpoints[k].note_count = (unsigned int)sounding;
+        noteCount += sounding;
+    }
+    free(state);
     
-    tsf_channel_note_on(synth->synth, channel, note, vel);
+    bytes += noteCount * sizeof(TSFBridgeMidiSoundingNote);
+    if (bytes > 0x7FFFFFFF) return 0;
+    if (write && noteCount <= noteCapacity) {
+        TSFBridgeMidiIndexHeader* header = (TSFBridgeMidiIndexHeader*)index;
+        header->magic = TSF_BRIDGE_MIDI_INDEX_MAGIC;
+        header->version = TSF_BRIDGE_MIDI_INDEX_VERSION;
+        header->sample_rate = song->sample_rate;
+        header->interval = (unsigned int)interval;
+        header->checkpoint_count = (unsigned int)checkpointCount;
+        header->note_count = (unsigned int)noteCount;
+    }
+    return (int)bytes;
 }
 
-void tsf_bridge_note_off(TSFHandle handle, int channel, int note) {
-    if (!handle) return;
-    
-    TSFSynth* synth = (TSFSynth*)handle;
-    tsf_channel_note_off(synth->synth, channel, note);
+// Collects events and submits them in batches of a fixed size
+struct TSFMidiSeekBatch {
+    TSFHandle handle;
+    TSFBridgeEvent events[64];
+    int count;
+    bool failed;
+};
+
+static void tsf_bridge_midi_seek_flush(TSFMidiSeekBatch* b) {
+    if (b->count && tsf_bridge_submit_events(b->handle, b->events, b->count) != b->count) b->failed = true;
+    b->count = 0;
 }
 
-void tsf_bridge_set_preset(TSFHandle handle, int channel, int bank, int preset) {
-    if (!handle) return;
-    
-    TSFSynth* synth = (TSFSynth*)handle;
-    tsf_channel_set_bank_preset(synth->synth, channel, bank, preset);
+static void tsf_bridge_midi_seek_send(TSFMidiSeekBatch* b, int type, int channel, int data1, int data2) {
+    if (b->count == (int)(sizeof(b->events) / sizeof(b->events[0]))) tsf_bridge_midi_seek_flush(b);
+    TSFBridgeEvent e = { -1, (unsigned char)type, (unsigned char)channel, (unsigned short)data1, (unsigned short)data2, 0 };
+    b->events[b->count++] = e;
 }
 
-void tsf_bridge_pitch_bend(TSFHandle handle, int channel, int pitch_wheel) {
-    if (!handle) return;
-    TSFSynth* synth = (TSFSynth*)handle;
-    // TinySoundFont expects pitch wheel as -8192 to +8191
-    int bend = pitch_wheel - 8192;
-    tsf_channel_set_pitchwheel(synth->synth, channel, bend);
+// Selects an RPN and enters its 14-bit data (or only the MSB)
+static void tsf_bridge_midi_seek_rpn(TSFMidiSeekBatch* b, int channel, int rpn, int data) {
+    tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 101, rpn >> 7);
+    tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 100, rpn & 0x7F);
+    tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 6, data >> 7);
+    tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 38, data & 0x7F);
 }
 
-void tsf_bridge_control_change(TSFHandle handle, int channel, int controller, int value) {
-    if (!handle) return;
-    TSFSynth* synth = (TSFSynth*)handle;
-    tsf_channel_midi_control(synth->synth, channel, controller, value);
+// The synth ignores program changes to presets its SoundFont doesn't have, so the preset in effect
+// is the one of the last program change it has (usually the last one), or its first preset
+static void tsf_bridge_midi_seek_program(TSFMidiSeekBatch* b, tsf* f, const TSFBridgeMidiEvent* events, int next, int channel, const TSFBridgeMidiChannelState* c) {
+    if (c->program != 0xFFFF) {
+        if (tsf_get_presetindex(f, c->bank, c->program) != -1) {
+            tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_PROGRAM_CHANGE, channel, c->program, c->bank);
+            return;
+        }
+        for (int i = next - 1; i >= 0; i--) {
+            const TSFBridgeMidiEvent* e = &events[i];
+            if (e->type != TSF_BRIDGE_EVENT_PROGRAM_CHANGE || e->channel != channel || tsf_get_presetindex(f, e->data2, e->data1) == -1) continue;
+            tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_PROGRAM_CHANGE, channel, e->data1, e->data2);
+            return;
+        }
+    }
+    if (f->presetNum > 0) tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_PROGRAM_CHANGE, channel, f->presets[0].preset, f->presets[0].bank);
 }
 
-int tsf_bridge_render(TSFHandle handle, void* buffer, int sample_count) {
-    if (!handle || !buffer || sample_count <= 0) return 0;
-    
-    TSFSynth* synth = (TSFSynth*)handle;
+static void tsf_bridge_midi_seek_channel(TSFMidiSeekBatch* b, int channel, const TSFBridgeMidiChannelState* c) {
+    int cc = TSF_BRIDGE_EVENT_CONTROL_CHANGE;
+    if (c->flags & TSF_BRIDGE_MIDI_STATE_PITCH_WHEEL) {
+        tsf_bridge_midi_seek_send(b, TSF_BRIDGE_EVENT_PITCH_BEND, channel, c->pitch_wheel, 0);
+    } else {
+        // Reset controllers keeps the wheel, a channel the song never bends gets the synth's center
+        tsf_bridge_midi_seek_flush(b);
+        TSFCommand command = { TSF_BRIDGE_COMMAND_CHANNEL_PITCH_WHEEL, channel, 8192, 0, 0.0, TSF_BRIDGE_NOW, 0 };
+        if (!tsf_bridge_push_command((TSFSynth*)b->handle, command)) b->failed = true;
+    }
+    tsf_bridge_midi_seek_send(b, cc, channel, 7, c->volume >> 7);
+    tsf_bridge_midi_seek_send(b, cc, channel, 39, c->volume & 0x7F);
+    tsf_bridge_midi_seek_send(b, cc, channel, 11, c->expression >> 7);
+    tsf_bridge_midi_seek_send(b, cc, channel, 43, c->expression & 0x7F);
+    if (c->flags & TSF_BRIDGE_MIDI_STATE_PAN) {
+        tsf_bridge_midi_seek_send(b, cc, channel, 10, c->pan >> 7);
+        tsf_bridge_midi_seek_send(b, cc, channel, 42, c->pan & 0x7F);
+    }
     
-    // Clear buffer first (flag_mixing = 0)
-    tsf_render_float(synth->synth, (float*)buffer, sample_count, 0);
+    if (c->flags & TSF_BRIDGE_MIDI_STATE_PITCH_RANGE) tsf_bridge_midi_seek_rpn(b, channel, 0, c->pitch_range);
+    // The last data entry matters for entries of only the MSB or LSB that follow, it's entered
+    // for the null RPN (which changes nothing) before the selected RPN is restored
+    tsf_bridge_midi_seek_rpn(b, channel, 0x3FFF, c->data);
+    if (c->rpn == 0xFFFF) {
+        tsf_bridge_midi_seek_send(b, cc, channel, 99, 0x7F);
+    } else {
+        tsf_bridge_midi_seek_send(b, cc, channel, 101, c->rpn >> 7);
+        tsf_bridge_midi_seek_send(b, cc, channel, 100, c->rpn & 0x7F);
+    }
+    if (c->flags & TSF_BRIDGE_MIDI_STATE_SUSTAIN) tsf_bridge_midi_seek_send(b, cc, channel, 64, 127);
     
-    return sample_count;
+    // Tuning can't always be reached with RPN 1 and 2 from the reset state, it's set directly
+    if (c->tuning != 0.0f) {
+        tsf_bridge_midi_seek_flush(b);
+        TSFCommand command = { TSF_BRIDGE_COMMAND_CHANNEL_TUNING, channel, 0, 0, c->tuning, TSF_BRIDGE_NOW, 0 };
+        if (!tsf_bridge_push_command((TSFSynth*)b->handle, command)) b->failed = true;
+    }
 }
 
-void tsf_bridge_note_off_all(TSFHandle handle) {
-    if (!handle) return;
+int tsf_bridge_midi_seek(TSFHandle handle, const void* buffer, int size, const void* index, int index_size, unsigned int sample, int flags) {
+    int eventCount;
+    const TSFBridgeMidiEvent* events = tsf_bridge_midi_events(buffer, size, &eventCount);
+    if (!handle || !events) return -1;
+    const TSFBridgeMidiHeader* song = (const TSFBridgeMidiHeader*)buffer;
+    const TSFBridgeMidiIndexHeader* header = NULL;
+    if (index) {
+        header = tsf_bridge_midi_index_check(index, index_size, song->sample_rate);
+        if (!header) return -1;
+    }
     
-    TSFSynth* synth = (TSFSynth*)handle;
-    tsf_note_off_all(synth->synth);
-}
-
-int tsf_bridge_active_voices(TSFHandle handle) {
-    if (!handle) return 0;
+    TSFMidiPlayState* state = (TSFMidiPlayState*)malloc(sizeof(TSFMidiPlayState));
+    if (!state) return -1;
+    tsf_bridge_midi_state_init(state);
     
-    TSFSynth* synth = (TSFSynth*)handle;
-    return tsf_active_voice_count(synth->synth);
-}
-// Set per-channel volume (0.0 = silent, 1.0 = full)
-void tsf_bridge_channel_set_volume(TSFHandle handle, int channel, float volume) {
-    if (!handle) return;
-    TSFSynth* synth = (TSFSynth*)handle;
-    tsf_channel_set_volume(synth->synth, channel, volume);
+    // Start at the checkpoint before sample, then replay the events up to it without the notes
+    int next = 0;
+    if (header) {
+        unsigned int k = sample / header->interval;
+        if (k >= header->checkpoint_count) k = header->checkpoint_count - 1;
+        const TSFBridgeMidiCheckpoint* cp = (const TSFBridgeMidiCheckpoint*)(header + 1) + k;
+        const TSFBridgeMidiSoundingNote* notes = (const TSFBridgeMidiSoundingNote*)((const TSFBridgeMidiCheckpoint*)(header + 1) + header->checkpoint_count);
+        if (cp->event > (unsigned int)eventCount || (unsigned long long)cp->note_offset + cp->note_count > header->note_count) {
+            free(state);
+            return -1;
+        }
+        memcpy(state->channels, cp->channels, sizeof(state->channels));
+        for (unsigned int i = 0; i < cp->note_count; i++) {
+            const TSFBridgeMidiSoundingNote* n = &notes[cp->note_offset + i];
+            int key = (n->channel & 0x0F) * 128 + (n->note & 0x7F);
+            state->velocity[key] = n->velocity;
+            state->released[key] = n->released;
+        }
+        next = (int)cp->event;
+    }
+    while (next < eventCount && events[next].sample < sample) tsf_bridge_midi_state_apply(state, &events[next++]);
+    
+    TSFMidiSeekBatch batch;
+    batch.handle = handle;
+    batch.count = 0;
+    batch.failed = false;
+    tsf* f = ((TSFSynth*)handle)->synth;
+    for (int channel = 0; channel < 16; channel++) {
+        // Release what plays now and start from the synth's defaults
+        tsf_bridge_midi_seek_send(&batch, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 64, 0);
+        tsf_bridge_midi_seek_send(&batch, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 123, 0);
+        tsf_bridge_midi_seek_send(&batch, TSF_BRIDGE_EVENT_CONTROL_CHANGE, channel, 121, 0);
+        tsf_bridge_midi_seek_program(&batch, f, events, next, channel, &state->channels[channel]);
+        tsf_bridge_midi_seek_channel(&batch, channel, &state->channels[channel]);
+    }
+    if (flags & TSF_BRIDGE_SEEK_NOTES) {
+        // Notes only held by the pedal are struck and released again, the restored pedal keeps them
+        for (int key = 0; key < 16 * 128; key++) {
+            if (!state->velocity[key]) continue;
+            tsf_bridge_midi_seek_send(&batch, TSF_BRIDGE_EVENT_NOTE_ON, key >> 7, key & 0x7F, state->velocity[key]);
+            if (state->released[key]) tsf_bridge_midi_seek_send(&batch, TSF_BRIDGE_EVENT_NOTE_OFF, key >> 7, key & 0x7F, 0);
+        }
+    }
+    tsf_bridge_midi_seek_flush(&batch);
+    free(state);
+    return batch.failed ? -1 : next;
 }
 
 #ifdef HXCPP_API
@@ -194,6 +3527,13 @@ static value cffi_tsf_set_output(value vhandle, value vsr, value vch) {
 }
 DEFINE_PRIM(cffi_tsf_set_output,3);
 
+static value cffi_tsf_set_output_format(value vhandle, value vsr, value vch, value vformat) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_set_output_format(h, val_int(vsr), val_int(vch), val_int(vformat));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_set_output_format,4);
+
 static value cffi_tsf_note_on(value vhandle, value vchan, value vnote, value vvel) {
     TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
     tsf_bridge_note_on(h, val_int(vchan), val_int(vnote), val_int(vvel));
@@ -245,6 +3585,21 @@ static value cffi_tsf_render_bytes(value vhandle, value vbuf, value vsamples) {
 }
 DEFINE_PRIM(cffi_tsf_render_bytes,3);
 
+static value cffi_tsf_set_bus_map(value vhandle, value vmap, value vcount) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    const unsigned char* map = val_is_null(vmap) ? NULL : (const unsigned char*)buffer_data(val_to_buffer(vmap));
+    tsf_bridge_set_bus_map(h, map, val_int(vcount));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_set_bus_map,3);
+
+static value cffi_tsf_render_buses(value vhandle, value vbuf, value vsamples) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_int(tsf_bridge_render_buses(h, (float*)buffer_data(buf), val_int(vsamples)));
+}
+DEFINE_PRIM(cffi_tsf_render_buses,3);
+
 static value cffi_tsf_note_off_all(value vhandle) {
     TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
     tsf_bridge_note_off_all(h);
@@ -257,4 +3612,263 @@ static value cffi_tsf_active_voices(value vhandle) {
     return alloc_int(tsf_bridge_active_voices(h));
 }
 DEFINE_PRIM(cffi_tsf_active_voices,1);
+
+static value cffi_tsf_set_render_threads(value vhandle, value vthreads) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_set_render_threads(h, val_int(vthreads)));
+}
+DEFINE_PRIM(cffi_tsf_set_render_threads,2);
+
+// More than 5 arguments, CFFI passes them as an array
+static value cffi_tsf_schedule_event(value* args, int nargs) {
+    if (nargs != 6) return alloc_bool(false);
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(args[0]);
+    return alloc_bool(tsf_bridge_schedule_event(h, val_int(args[1]), val_int(args[2]), val_int(args[3]), val_int(args[4]), val_int(args[5])) != 0);
+}
+DEFINE_PRIM_MULT(cffi_tsf_schedule_event);
+
+static value cffi_tsf_schedule_event_at(value* args, int nargs) {
+    if (nargs != 6) return alloc_bool(false);
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(args[0]);
+    return alloc_bool(tsf_bridge_schedule_event_at(h, val_number(args[1]), val_int(args[2]), val_int(args[3]), val_int(args[4]), val_int(args[5])) != 0);
+}
+DEFINE_PRIM_MULT(cffi_tsf_schedule_event_at);
+
+static value cffi_tsf_submit_events(value vhandle, value vbuf, value vcount) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_int(tsf_bridge_submit_events(h, (const TSFBridgeEvent*)buffer_data(buf), val_int(vcount)));
+}
+DEFINE_PRIM(cffi_tsf_submit_events,3);
+
+static value cffi_tsf_midi_parse(value vdata, value vsize, value vrate, value vbuf, value vbufsize) {
+    const void* data = buffer_data(val_to_buffer(vdata));
+    void* buf = val_is_null(vbuf) ? NULL : buffer_data(val_to_buffer(vbuf));
+    return alloc_int(tsf_bridge_midi_parse(data, val_int(vsize), val_int(vrate), buf, buf ? val_int(vbufsize) : 0));
+}
+DEFINE_PRIM(cffi_tsf_midi_parse,5);
+
+static value cffi_tsf_get_sample_time(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_float(tsf_bridge_get_sample_time(h));
+}
+DEFINE_PRIM(cffi_tsf_get_sample_time,1);
+
+static value cffi_tsf_clear_events(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_clear_events(h);
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_clear_events,1);
+
+static value cffi_tsf_dropped_commands(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_dropped_commands(h));
+}
+DEFINE_PRIM(cffi_tsf_dropped_commands,1);
+
+static value cffi_tsf_stream_start(value vhandle, value vlatency, value vblock) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_stream_start(h, val_int(vlatency), val_int(vblock)));
+}
+DEFINE_PRIM(cffi_tsf_stream_start,3);
+
+static value cffi_tsf_stream_stop(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_stream_stop(h);
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_stream_stop,1);
+
+static value cffi_tsf_stream_set_latency(value vhandle, value vlatency) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_stream_set_latency(h, val_int(vlatency)));
+}
+DEFINE_PRIM(cffi_tsf_stream_set_latency,2);
+
+static value cffi_tsf_stream_read(value vhandle, value vbuf, value vsamples) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_int(tsf_bridge_stream_read(h, buffer_data(buf), val_int(vsamples)));
+}
+DEFINE_PRIM(cffi_tsf_stream_read,3);
+
+static value cffi_tsf_stream_underruns(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_stream_underruns(h));
+}
+DEFINE_PRIM(cffi_tsf_stream_underruns,1);
+
+static value cffi_tsf_stream_overruns(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_stream_overruns(h));
+}
+DEFINE_PRIM(cffi_tsf_stream_overruns,1);
+
+static value cffi_tsf_sequence_load(value vhandle, value vbuf, value vcount, value vlength) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_int(tsf_bridge_sequence_load(h, (const TSFBridgeNote*)buffer_data(buf), val_int(vcount), val_number(vlength)));
+}
+DEFINE_PRIM(cffi_tsf_sequence_load,4);
+
+static value cffi_tsf_sequence_start(value vhandle, value vbeat) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_sequence_start(h, val_number(vbeat));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_sequence_start,2);
+
+static value cffi_tsf_sequence_stop(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_sequence_stop(h);
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_sequence_stop,1);
+
+static value cffi_tsf_sequence_set_loop(value vhandle, value vloop) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_sequence_set_loop(h, val_bool(vloop) ? 1 : 0);
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_sequence_set_loop,2);
+
+static value cffi_tsf_sequence_set_tempo(value vhandle, value vbpm) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_sequence_set_tempo(h, val_number(vbpm));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_sequence_set_tempo,2);
+
+static value cffi_tsf_sequence_get_beat(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_float(tsf_bridge_sequence_get_beat(h));
+}
+DEFINE_PRIM(cffi_tsf_sequence_get_beat,1);
+
+static value cffi_tsf_sequence_playing(value vhandle) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_bool(tsf_bridge_sequence_playing(h) != 0);
+}
+DEFINE_PRIM(cffi_tsf_sequence_playing,1);
+
+static value cffi_tsf_midi_index(value vsong, value vsize, value vinterval, value vbuf, value vbufsize) {
+    const void* song = buffer_data(val_to_buffer(vsong));
+    void* buf = val_is_null(vbuf) ? NULL : buffer_data(val_to_buffer(vbuf));
+    return alloc_int(tsf_bridge_midi_index(song, val_int(vsize), val_int(vinterval), buf, buf ? val_int(vbufsize) : 0));
+}
+DEFINE_PRIM(cffi_tsf_midi_index,5);
+
+static value cffi_tsf_midi_seek(value* args, int nargs) {
+    if (nargs != 7) return alloc_int(-1);
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(args[0]);
+    const void* song = buffer_data(val_to_buffer(args[1]));
+    const void* index = val_is_null(args[3]) ? NULL : buffer_data(val_to_buffer(args[3]));
+    return alloc_int(tsf_bridge_midi_seek(h, song, val_int(args[2]), index, index ? val_int(args[4]) : 0, (unsigned int)val_int(args[5]), val_int(args[6])));
+}
+DEFINE_PRIM_MULT(cffi_tsf_midi_seek);
+
+static value cffi_tsf_snapshot(value vhandle, value vbuf, value vsize) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    void* buf = val_is_null(vbuf) ? NULL : buffer_data(val_to_buffer(vbuf));
+    return alloc_int(tsf_bridge_snapshot(h, buf, buf ? val_int(vsize) : 0));
+}
+DEFINE_PRIM(cffi_tsf_snapshot,3);
+
+static value cffi_tsf_restore(value vhandle, value vbuf, value vsize) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_bool(tsf_bridge_restore(h, buffer_data(buf), val_int(vsize)) != 0);
+}
+DEFINE_PRIM(cffi_tsf_restore,3);
+
+static value cffi_tsf_render_mix(value* args, int nargs) {
+    if (nargs != 7) return alloc_int(0);
+    const TSFHandle* handles = (const TSFHandle*)buffer_data(val_to_buffer(args[0]));
+    const float* gains = val_is_null(args[1]) ? NULL : (const float*)buffer_data(val_to_buffer(args[1]));
+    const float* pans = val_is_null(args[2]) ? NULL : (const float*)buffer_data(val_to_buffer(args[2]));
+    float* out = (float*)buffer_data(val_to_buffer(args[4]));
+    return alloc_int(tsf_bridge_render_mix(handles, gains, pans, val_int(args[3]), out, val_int(args[5]), val_int(args[6])));
+}
+DEFINE_PRIM_MULT(cffi_tsf_render_mix);
+
+static value cffi_tsf_set_max_voices(value vhandle, value vmax) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_bool(tsf_bridge_set_max_voices(h, val_int(vmax)) != 0);
+}
+DEFINE_PRIM(cffi_tsf_set_max_voices,2);
+
+static value cffi_tsf_channel_set_polyphony(value vhandle, value vchan, value vmax) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_channel_set_polyphony(h, val_int(vchan), val_int(vmax));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_channel_set_polyphony,3);
+
+static value cffi_tsf_channel_set_priority(value vhandle, value vchan, value vpriority) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_channel_set_priority(h, val_int(vchan), val_int(vpriority));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_channel_set_priority,3);
+
+static value cffi_tsf_set_cpu_budget(value vhandle, value vbudget) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_set_cpu_budget(h, (float)val_number(vbudget));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_set_cpu_budget,2);
+
+static value cffi_tsf_get_governor_stats(value vhandle, value vbuf) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    void* buf = val_is_null(vbuf) ? NULL : buffer_data(val_to_buffer(vbuf));
+    return alloc_int(tsf_bridge_get_governor_stats(h, (TSFBridgeGovernorStats*)buf));
+}
+DEFINE_PRIM(cffi_tsf_get_governor_stats,2);
+
+static value cffi_tsf_set_voice_virtualization(value vhandle, value vthreshold) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_set_voice_virtualization(h, (float)val_number(vthreshold));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_set_voice_virtualization,2);
+
+static value cffi_tsf_set_phrase_cache(value vhandle, value vbytes) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_set_phrase_cache(h, val_int(vbytes)));
+}
+DEFINE_PRIM(cffi_tsf_set_phrase_cache,2);
+
+static value cffi_tsf_phrase_define(value vhandle, value vbuf, value vcount, value vlength) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    buffer buf = val_to_buffer(vbuf);
+    return alloc_int(tsf_bridge_phrase_define(h, (const TSFBridgeEvent*)buffer_data(buf), val_int(vcount), val_int(vlength)));
+}
+DEFINE_PRIM(cffi_tsf_phrase_define,4);
+
+static value cffi_tsf_phrase_release(value vhandle, value vphrase) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    tsf_bridge_phrase_release(h, val_int(vphrase));
+    return alloc_null();
+}
+DEFINE_PRIM(cffi_tsf_phrase_release,2);
+
+static value cffi_tsf_phrase_play(value vhandle, value vphrase, value voffset) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_bool(tsf_bridge_phrase_play(h, val_int(vphrase), val_int(voffset)) != 0);
+}
+DEFINE_PRIM(cffi_tsf_phrase_play,3);
+
+static value cffi_tsf_get_phrase_cache_stats(value vhandle, value vbuf) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    void* buf = val_is_null(vbuf) ? NULL : buffer_data(val_to_buffer(vbuf));
+    return alloc_int(tsf_bridge_get_phrase_cache_stats(h, (TSFBridgePhraseCacheStats*)buf));
+}
+DEFINE_PRIM(cffi_tsf_get_phrase_cache_stats,2);
+
+static value cffi_tsf_set_oneshot_cache(value vhandle, value vbytes) {
+    TSFHandle h = (TSFHandle)(intptr_t)val_int(vhandle);
+    return alloc_int(tsf_bridge_set_oneshot_cache(h, val_int(vbytes)));
+}
+DEFINE_PRIM(cffi_tsf_set_oneshot_cache,2);
 #endif
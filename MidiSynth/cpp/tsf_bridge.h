@@ -12,6 +12,180 @@ extern "C" {
 // Opaque handle to the synthesizer instance
 typedef void* TSFHandle;
 
+// Opaque handle to a loaded SoundFont shared by synthesizer instances (see tsf_bridge_font_load)
+typedef void* TSFFontHandle;
+
+// Event types for tsf_bridge_schedule_event (MIDI status bytes without the channel)
+#define TSF_BRIDGE_EVENT_NOTE_OFF       0x80 // data1: note, data2: unused
+#define TSF_BRIDGE_EVENT_NOTE_ON        0x90 // data1: note, data2: velocity (0-127)
+#define TSF_BRIDGE_EVENT_CONTROL_CHANGE 0xB0 // data1: controller, data2: value (0-127)
+#define TSF_BRIDGE_EVENT_PROGRAM_CHANGE 0xC0 // data1: preset, data2: bank
+#define TSF_BRIDGE_EVENT_PITCH_BEND     0xE0 // data1: 14-bit pitch wheel (0-16383), data2: unused
+
+// Output sample formats for tsf_bridge_set_output_format
+#define TSF_BRIDGE_FORMAT_FLOAT         0 // float32, interleaved stereo (default)
+#define TSF_BRIDGE_FORMAT_FLOAT_PLANAR  1 // float32, all left samples followed by all right samples
+#define TSF_BRIDGE_FORMAT_INT16         2 // int16, interleaved stereo
+#define TSF_BRIDGE_FORMAT_INT16_DITHER  3 // int16 with triangular (TPDF) dither, interleaved stereo
+
+// Maximum number of buses for tsf_bridge_render_buses
+#define TSF_BRIDGE_MAX_BUSES 16
+
+// Packed event for tsf_bridge_submit_events, 12 bytes in native (little) endian:
+// int32 frame_offset, uint8 type, uint8 channel, uint16 data1, uint16 data2, uint16 reserved
+typedef struct TSFBridgeEvent {
+    int frame_offset;           // Frames after the start of the next render, < 0 = immediately
+    unsigned char type;         // TSF_BRIDGE_EVENT_*
+    unsigned char channel;      // MIDI channel (0-15)
+    unsigned short data1;       // See TSF_BRIDGE_EVENT_*
+    unsigned short data2;
+    unsigned short reserved;    // Set to 0
+} TSFBridgeEvent;
+
+// Packed MIDI file written by tsf_bridge_midi_parse: a TSFBridgeMidiHeader followed by
+// event_count TSFBridgeMidiEvent, in native (little) endian and without pointers, so it can be
+// saved and later memory-mapped or loaded as-is
+#define TSF_BRIDGE_MIDI_MAGIC   0x4D465354 // "TSFM"
+#define TSF_BRIDGE_MIDI_VERSION 1
+
+// 24 bytes: uint32 magic, version, sample_rate, event_count, length, uint16 channels, reserved
+typedef struct TSFBridgeMidiHeader {
+    unsigned int magic;         // TSF_BRIDGE_MIDI_MAGIC
+    unsigned int version;       // TSF_BRIDGE_MIDI_VERSION
+    unsigned int sample_rate;   // Sample rate the event times are in
+    unsigned int event_count;
+    unsigned int length;        // Sample time of the end of the longest track
+    unsigned short channels;    // Bit n set if channel n plays notes
+    unsigned short reserved;
+} TSFBridgeMidiHeader;
+
+// 12 bytes, TSFBridgeEvent with an absolute sample time in place of the frame offset:
+// uint32 sample, uint8 type, uint8 channel, uint16 data1, uint16 data2, uint16 reserved
+typedef struct TSFBridgeMidiEvent {
+    unsigned int sample;        // Sample time from the start of the file
+    unsigned char type;         // TSF_BRIDGE_EVENT_*
+    unsigned char channel;      // MIDI channel (0-15)
+    unsigned short data1;       // See TSF_BRIDGE_EVENT_*
+    unsigned short data2;
+    unsigned short reserved;
+} TSFBridgeMidiEvent;
+
+// Checkpoint index of a packed MIDI file written by tsf_bridge_midi_index: a
+// TSFBridgeMidiIndexHeader, checkpoint_count TSFBridgeMidiCheckpoint (one every interval samples,
+// the first at sample 0) and note_count TSFBridgeMidiSoundingNote, in native (little) endian
+#define TSF_BRIDGE_MIDI_INDEX_MAGIC   0x49465354 // "TSFI"
+#define TSF_BRIDGE_MIDI_INDEX_VERSION 1
+
+// Flags of TSFBridgeMidiChannelState
+#define TSF_BRIDGE_MIDI_STATE_SUSTAIN     0x1 // Sustain pedal down
+#define TSF_BRIDGE_MIDI_STATE_PITCH_RANGE 0x2 // pitch_range was set (RPN 0)
+#define TSF_BRIDGE_MIDI_STATE_PAN         0x4 // pan was set (the synth's default pan is exact center)
+#define TSF_BRIDGE_MIDI_STATE_PITCH_WHEEL 0x8 // pitch_wheel was set
+
+// 24 bytes: MIDI state of a channel, 14-bit controller values as the synth combines MSB and LSB:
+// uint16 program, bank, pitch_wheel, volume, expression, pan, rpn, data, pitch_range, flags, float32 tuning
+typedef struct TSFBridgeMidiChannelState {
+    unsigned short program;     // Preset of the last program change, 0xFFFF = none yet
+    unsigned short bank;        // Bank of the last program change
+    unsigned short pitch_wheel; // 0-16383, center 8192
+    unsigned short volume;      // Controllers 7/39
+    unsigned short expression;  // Controllers 11/43
+    unsigned short pan;         // Controllers 10/42
+    unsigned short rpn;         // Selected RPN, 0xFFFF = none or an NRPN
+    unsigned short data;        // Last data entry (controllers 6/38)
+    unsigned short pitch_range; // Data entry of RPN 0
+    unsigned short flags;       // TSF_BRIDGE_MIDI_STATE_*
+    float tuning;               // Semitones from RPN 1 and 2, combined like the synth does
+} TSFBridgeMidiChannelState;
+
+// 400 bytes: state of all channels right before sample (after all events earlier than it)
+typedef struct TSFBridgeMidiCheckpoint {
+    unsigned int sample;        // Sample time of the checkpoint
+    unsigned int event;         // First event at or after sample
+    unsigned int note_offset;   // First of the notes sounding at sample in the note list
+    unsigned int note_count;
+    TSFBridgeMidiChannelState channels[16];
+} TSFBridgeMidiCheckpoint;
+
+// 4 bytes: note held by its key or by the sustain pedal at a checkpoint
+typedef struct TSFBridgeMidiSoundingNote {
+    unsigned char channel;
+    unsigned char note;
+    unsigned char velocity;
+    unsigned char released;     // 1 if the key is up and the note only held by the sustain pedal
+} TSFBridgeMidiSoundingNote;
+
+// 24 bytes: uint32 magic, version, sample_rate, interval, checkpoint_count, note_count
+typedef struct TSFBridgeMidiIndexHeader {
+    unsigned int magic;         // TSF_BRIDGE_MIDI_INDEX_MAGIC
+    unsigned int version;       // TSF_BRIDGE_MIDI_INDEX_VERSION
+    unsigned int sample_rate;   // Sample rate of the packed file
+    unsigned int interval;      // Samples between checkpoints
+    unsigned int checkpoint_count;
+    unsigned int note_count;
+} TSFBridgeMidiIndexHeader;
+
+// Flags for tsf_bridge_midi_seek
+#define TSF_BRIDGE_SEEK_NOTES 0x1 // Restart the notes that would be sounding at the seek position
+
+// Magic number at the start of a snapshot written by tsf_bridge_snapshot
+#define TSF_BRIDGE_SNAPSHOT_MAGIC 0x53465354 // "TSFS"
+
+// Note for tsf_bridge_sequence_load, 24 bytes in native (little) endian:
+// float64 start, float64 duration, uint8 channel, uint8 note, uint8 velocity, 5 bytes reserved
+typedef struct TSFBridgeNote {
+    double start;               // Start in beats from the start of the sequence
+    double duration;            // Length in beats
+    unsigned char channel;      // MIDI channel (0-15)
+    unsigned char note;         // MIDI note (0-127)
+    unsigned char velocity;     // 1-127
+    unsigned char reserved[5];  // Set to 0
+} TSFBridgeNote;
+
+// Quality levels of the CPU budget governor, 0 = full quality (see tsf_bridge_set_cpu_budget)
+#define TSF_BRIDGE_GOVERNOR_LEVELS 6
+
+// Decisions of the CPU budget governor for tsf_bridge_get_governor_stats, 112 bytes in native (little) endian:
+// float64 last_change_time, float64 seconds_at_level[6], float32 budget, load, average_load, peak_load,
+// last_change_load, int32 level, max_level, effect_blocks, quality_flags, uint32 degrades, restores,
+// culled_voices, over_budget, overruns
+typedef struct TSFBridgeGovernorStats {
+    double last_change_time;    // Sample time of the last level change, -1 if the level never changed
+    double seconds_at_level[TSF_BRIDGE_GOVERNOR_LEVELS]; // Audio rendered at each level
+    float budget;               // Fraction of real time rendering may take, 0 = governor off
+    float load;                 // Render time / audio duration of the last measured window
+    float average_load;         // Smoothed load, quality is restored once it is well below the budget
+    float peak_load;            // Highest window load
+    float last_change_load;     // Load that caused the last level change
+    int level;                  // Current level, 0 = full quality
+    int max_level;              // Highest level reached
+    int effect_blocks;          // Effects are updated every effect_blocks * 64 frames at this level
+    int quality_flags;          // TSF_QUALITY_* flags of tsf.h at this level
+    unsigned int degrades;      // Steps to a lower quality
+    unsigned int restores;      // Steps back to a higher quality
+    unsigned int culled_voices; // Voices faded out at the last level
+    unsigned int over_budget;   // Windows that took longer than the budget
+    unsigned int overruns;      // Windows that took longer than real time, enough to drop out
+} TSFBridgeGovernorStats;
+
+// Phrases a synth can have defined at once (see tsf_bridge_phrase_define)
+#define TSF_BRIDGE_MAX_PHRASES 256
+
+// Phrase cache statistics for tsf_bridge_get_phrase_cache_stats, 40 bytes in native (little) endian:
+// int32 budget, bytes, entries, playing, uint32 hits, misses, stored, evictions, divergences, overflows
+typedef struct TSFBridgePhraseCacheStats {
+    int budget;                 // Memory budget in bytes, 0 = cache off
+    int bytes;                  // Memory used by the cached phrases, in whole pages
+    int entries;                // Phrases cached
+    int playing;                // Phrases playing, from the cache or on voices of their own
+    unsigned int hits;          // Plays mixed from the cache
+    unsigned int misses;        // Plays rendered live, most of them recorded into the cache
+    unsigned int stored;        // Recordings added to the cache
+    unsigned int evictions;     // Cached phrases dropped to stay within the budget
+    unsigned int divergences;   // Plays switched from the cache (or a recording) to live rendering
+    unsigned int overflows;     // Plays with all phrase players busy, scheduled on the synth's voices instead
+} TSFBridgePhraseCacheStats;
+
 // Initialize the synthesizer with a SoundFont file
 // Returns a handle to the synth instance, or NULL on failure
 // path: filesystem path to .sf2 file
@@ -23,6 +197,40 @@ TSFHandle tsf_bridge_init(const char* path);
 // size: size of buffer in bytes
 TSFHandle tsf_bridge_init_memory(const void* buffer, int size);
 
+// Initialize a new synthesizer sharing the SoundFont of an existing one (without loading it again)
+// Returns a handle to the synth instance in its initial state, or NULL on failure
+// source: synthesizer instance to share the SoundFont with
+TSFHandle tsf_bridge_init_copy(TSFHandle source);
+
+// Load a SoundFont file into the font registry, or take another reference to it if it's loaded already
+// Returns a font handle to release with tsf_bridge_font_release, or NULL on failure
+// path: filesystem path to .sf2 file, also the name the font is registered under
+// A font is loaded once and shared by every instance created from it (tsf_bridge_init_font), each
+// instance has its own voices and channels. The font is freed when the last reference to it is
+// released and its last instance is closed. All font functions are thread-safe.
+TSFFontHandle tsf_bridge_font_load(const char* path);
+
+// Load a SoundFont from memory into the font registry, or take another reference to it if a font
+// is registered under name already
+// Returns a font handle to release with tsf_bridge_font_release, or NULL on failure
+// name: name to register the font under (e.g. its path), NULL = don't register
+// buffer, size: SF2 data in memory, only read if the font isn't registered yet
+TSFFontHandle tsf_bridge_font_load_memory(const char* name, const void* buffer, int size);
+
+// Take another reference to a registered font, without loading anything
+// Returns a font handle to release with tsf_bridge_font_release, or NULL if no font is registered under name
+TSFFontHandle tsf_bridge_font_find(const char* name);
+
+// Release a font reference, instances created from the font keep it loaded until they are closed
+void tsf_bridge_font_release(TSFFontHandle font);
+
+// Initialize a new synthesizer playing a loaded font
+// Returns a handle to the synth instance in its initial state, or NULL on failure
+// font: font to play, the instance takes its own reference to it
+// tsf_bridge_init and tsf_bridge_init_copy create instances the same way, so instances loaded
+// from the same path share the font as well
+TSFHandle tsf_bridge_init_font(TSFFontHandle font);
+
 // Clean up and free the synthesizer
 void tsf_bridge_close(TSFHandle handle);
 
@@ -32,6 +240,21 @@ void tsf_bridge_close(TSFHandle handle);
 // channels: 1 for mono, 2 for stereo
 void tsf_bridge_set_output(TSFHandle handle, int sample_rate, int channels);
 
+// Configure audio output parameters and the sample format of tsf_bridge_render and tsf_bridge_stream_read
+// handle: synthesizer instance
+// sample_rate: samples per second (e.g., 44100)
+// channels: 1 for mono, 2 for stereo
+// format: one of the TSF_BRIDGE_FORMAT_* values, tsf_bridge_set_output selects TSF_BRIDGE_FORMAT_FLOAT
+// The synth renders float32 internally; int16 and planar output is converted inside the caller's
+// buffer (which must be 4-byte aligned), without an intermediate buffer. Mono planar is the same as
+// mono float.
+void tsf_bridge_set_output_format(TSFHandle handle, int sample_rate, int channels, int format);
+
+// Threading: note, preset, controller and event calls may come from any number of threads while
+// another thread renders. They're pushed into a lock-free command queue that tsf_bridge_render
+// drains before rendering, so all synth state is only changed on the render thread.
+// Init, close, set_output, set_bus_map, set_render_threads and set_max_voices must not run concurrently with render or stream_read.
+
 // Trigger a note on event
 // handle: synthesizer instance
 // channel: MIDI channel (0-15)
@@ -67,11 +290,127 @@ void tsf_bridge_control_change(TSFHandle handle, int channel, int controller, in
 
 // Render audio samples
 // handle: synthesizer instance
-// buffer: output buffer (float32 PCM, interleaved stereo if channels=2)
+// buffer: output buffer in the format set with tsf_bridge_set_output_format
+//         (by default float32 PCM, interleaved stereo if channels=2)
 // sample_count: number of samples to render (frames, not total floats)
 // Returns: number of samples actually rendered
 int tsf_bridge_render(TSFHandle handle, void* buffer, int sample_count);
 
+// Route MIDI channels to the buses of tsf_bridge_render_buses (by default bus n = channel n, 16 buses)
+// handle: synthesizer instance
+// channel_bus: bus (0 to bus_count - 1) of each of the 16 MIDI channels, NULL = bus n for channel n
+// bus_count: number of buses (1 to TSF_BRIDGE_MAX_BUSES)
+void tsf_bridge_set_bus_map(TSFHandle handle, const unsigned char* channel_bus, int bus_count);
+
+// Render every bus into its own part of the buffer in a single pass over the voices (stems)
+// handle: synthesizer instance
+// buffer: bus_count blocks of sample_count frames one after the other, each float32 PCM
+//         interleaved stereo if channels=2 (the output format only applies to tsf_bridge_render)
+// sample_count: number of samples to render per bus (frames, not total floats)
+// Returns: bit mask of the buses with voices playing (bit n = bus n), the other buses are silent;
+//          0 while the render thread is running (see tsf_bridge_stream_start)
+int tsf_bridge_render_buses(TSFHandle handle, float* buffer, int sample_count);
+
+// Render several synthesizer instances and mix them into one output in a single call
+// handles: count synthesizer instances, NULL entries and instances with a running render thread
+//          (see tsf_bridge_stream_start) are skipped
+// gains: linear gain per instance, NULL = 1.0 for all
+// pans: pan per instance from 0.0 (left) to 1.0 (right), NULL = 0.5 for all. Pan is a balance:
+//       at 0.5 both sides keep their level, towards one side the other side fades out linearly.
+//       Mono instances are sent to both sides.
+// buffer: float32 PCM, interleaved stereo whatever the output format of the instances
+// sample_count: number of samples to render (frames, not total floats)
+// flag_mixing: 0 to overwrite buffer, 1 to add the mix to its content
+// Each instance renders exactly what tsf_bridge_render would render into a float buffer (events,
+// sequencer and render threads included), so all instances should share the same sample rate.
+// Nothing is allocated. Must be called on the thread that renders the instances.
+// Returns: number of samples rendered
+int tsf_bridge_render_mix(const TSFHandle* handles, const float* gains, const float* pans, int count, float* buffer, int sample_count, int flag_mixing);
+
+// Render voices on multiple threads
+// handle: synthesizer instance
+// thread_count: threads rendering voices including the one calling tsf_bridge_render
+//               (1-16), 0 to render serially (default)
+// Active voices are split into fixed tasks picked up by a persistent worker pool, so the
+// output is bit-identical for any thread count >= 1. Voice rendering doesn't allocate or lock.
+// The voices are preallocated for the pool: without a limit set, 256 are (see tsf_bridge_set_max_voices).
+// Returns: number of render threads in use, 0 if parallel rendering is off or unavailable
+int tsf_bridge_set_render_threads(TSFHandle handle, int thread_count);
+
+// Schedule an event at a frame offset from the start of the next tsf_bridge_render call
+// handle: synthesizer instance
+// frame_offset: frames after the first frame of the next render (negative = as soon as possible)
+// type: one of the TSF_BRIDGE_EVENT_* values
+// channel: MIDI channel (0-15)
+// data1, data2: event parameters, see TSF_BRIDGE_EVENT_*
+// tsf_bridge_render splits its buffer at event boundaries, so events take effect on the exact
+// frame no matter how large the render buffer is. Events at the same frame keep their order.
+// Returns: 1 if the event was queued, 0 if the command queue is full
+// Events that don't fit into the event queue (TSF_BRIDGE_EVENT_QUEUE_SIZE) are dropped when
+// the render picks them up, both cases count towards tsf_bridge_dropped_commands
+int tsf_bridge_schedule_event(TSFHandle handle, int frame_offset, int type, int channel, int data1, int data2);
+
+// Schedule an event at an absolute sample time (see tsf_bridge_get_sample_time)
+// Events in the past take effect at the start of the next render.
+// Returns: 1 if the event was queued, 0 if the command queue is full
+int tsf_bridge_schedule_event_at(TSFHandle handle, double sample_time, int type, int channel, int data1, int data2);
+
+// Submit a batch of events with one call instead of one call per event
+// handle: synthesizer instance
+// events: packed array of count TSFBridgeEvent
+// count: number of events
+// Events with a negative frame_offset take effect at the start of the next render like
+// tsf_bridge_note_on and the other direct calls, the others like tsf_bridge_schedule_event.
+// The batch claims its room in the command queue at once and keeps its order.
+// Returns: number of events queued, the rest didn't fit and count towards tsf_bridge_dropped_commands
+int tsf_bridge_submit_events(TSFHandle handle, const TSFBridgeEvent* events, int count);
+
+// Get the sample clock: frames rendered since init, i.e. the sample time of the next rendered frame
+double tsf_bridge_get_sample_time(TSFHandle handle);
+
+// Drop all scheduled events that haven't taken effect yet
+void tsf_bridge_clear_events(TSFHandle handle);
+
+// Get the number of commands dropped because the command or event queue was full
+// (TSF_BRIDGE_COMMAND_QUEUE_SIZE commands sent between two renders)
+int tsf_bridge_dropped_commands(TSFHandle handle);
+
+// Start a thread that renders ahead into a ring buffer read with tsf_bridge_stream_read
+// handle: synthesizer instance
+// target_latency_frames: frames the thread keeps rendered ahead of the reader (the watermark)
+// block_frames: frames rendered per pass (0 = 256), a power of 2 keeps the passes whole
+// The host audio callback then only copies out of the ring, without locks or allocations.
+// Notes and other commands can still be sent from any thread, they take effect on the next
+// block the thread renders, i.e. up to target_latency_frames later than the audio being read.
+// tsf_bridge_render must not be called while the stream runs. Without a voice limit set, 256 voices
+// are preallocated first (see tsf_bridge_set_max_voices), so the thread never allocates.
+// Returns: target latency in use (at least block_frames), 0 if no thread could be started
+//          (always in builds without threads, where tsf_bridge_stream_read renders directly)
+int tsf_bridge_stream_start(TSFHandle handle, int target_latency_frames, int block_frames);
+
+// Stop the render thread, buffered frames are discarded
+void tsf_bridge_stream_stop(TSFHandle handle);
+
+// Change the target latency of a running stream
+// target_latency_frames: clamped to block_frames up to twice the latency the stream started with
+// Lowering it drops the frames rendered beyond the new latency on the next read (an overrun).
+// Returns: target latency in use, 0 if no stream is running
+int tsf_bridge_stream_set_latency(TSFHandle handle, int target_latency_frames);
+
+// Copy rendered audio out of the stream ring
+// handle: synthesizer instance
+// buffer: output buffer in the format set with tsf_bridge_set_output_format
+// sample_count: frames to read, missing frames are filled with silence (an underrun)
+// Without a running stream this renders on the calling thread like tsf_bridge_render.
+// Returns: number of frames that came from the ring (or were rendered)
+int tsf_bridge_stream_read(TSFHandle handle, void* buffer, int sample_count);
+
+// Get the number of reads that found fewer frames than requested since the stream started
+int tsf_bridge_stream_underruns(TSFHandle handle);
+
+// Get the number of reads that dropped frames after the target latency was lowered
+int tsf_bridge_stream_overruns(TSFHandle handle);
+
 // Stop all currently playing notes
 void tsf_bridge_note_off_all(TSFHandle handle);
 
@@ -84,6 +423,209 @@ int tsf_bridge_active_voices(TSFHandle handle);
 // volume: float 0.0 (silent) to 1.0 (full)
 void tsf_bridge_channel_set_volume(TSFHandle handle, int channel, float volume);
 
+// Limit the number of voices sounding at once and preallocate them
+// handle: synthesizer instance
+// max_voices: voice limit (> 0), a SoundFont note can start several voices
+// When the limit is reached, new notes fade out the least important voice (by channel priority,
+// then level, release and age) instead of allocating. Notes are only dropped when every voice
+// belongs to a channel with a higher priority. The limit can only be raised once set.
+// Without a limit, note ons allocate voices on the render thread as the polyphony grows.
+// Returns: 1 on success, 0 if the voices couldn't be allocated
+int tsf_bridge_set_max_voices(TSFHandle handle, int max_voices);
+
+// Keep rendering within a CPU budget by lowering the quality while renders take too long
+// handle: synthesizer instance
+// budget: fraction of real time a render may take, e.g. 0.5 = 10 ms of audio in 5 ms, 0 = off (default)
+// Every render is timed against the duration of the audio it renders, over windows of at least
+// 1024 frames. A window over budget steps one level down, each level saving more:
+//   1: effects (pitch, volume, filter cutoff, envelopes, LFOs) updated every 128 frames instead of 64
+//   2: every 256 frames, filter cutoffs no longer follow LFOs and envelopes
+//   3: every 512 frames, resampling without interpolation
+//   4: low-pass filters off
+//   5: a quarter of the voices, the least important ones (see tsf_bridge_set_max_voices), faded out
+//      for every window still over budget
+// Once the average load stays below 60% of the budget for a second of audio, one level is restored.
+// Applied at the next render, statistics start over.
+void tsf_bridge_set_cpu_budget(TSFHandle handle, float budget);
+
+// Get what the CPU budget governor measured and decided, can be called from any thread
+// handle: synthesizer instance
+// stats: receives the statistics as of the last render, may be NULL
+// Returns: current level, 0 = full quality
+int tsf_bridge_get_governor_stats(TSFHandle handle, TSFBridgeGovernorStats* stats);
+
+// Stop rendering voices that are too quiet to hear, while keeping them ready to come back
+// handle: synthesizer instance
+// threshold_db: level below which a voice is virtual, e.g. -90 (dB relative to full scale), 0 = off (default)
+// Virtual voices aren't resampled, filtered or mixed, but their envelopes, LFOs and sample positions
+// keep moving, so they continue seamlessly when they get louder, e.g. when the channel volume rises.
+// Released voices that would stay below the threshold even at full channel volume are freed, which
+// shortens long release tails.
+// Applied at the next render.
+void tsf_bridge_set_voice_virtualization(TSFHandle handle, float threshold_db);
+
+// Cache the samples of one-shot drum and percussion notes, so repeated hits are mixed instead of rendered
+// handle: synthesizer instance
+// max_bytes: memory the cached samples may take, 0 = off (default), the least recently hit notes are
+//            dropped to make room
+// Notes of the percussion banks (128 and up, e.g. channel 9 with its default preset) whose regions
+// don't loop and have no pitch or filter cutoff modulation qualify. The first hit of a note is
+// rendered and recorded before its envelope and gains, later hits at the same pitch skip resampling
+// and filtering. Velocity, volume, pan and note off apply as before, a pitch bend while a hit plays
+// switches it back to rendering. Changing the budget clears the cache. Phrases playing on voices of
+// their own (see tsf_bridge_set_phrase_cache) don't use it.
+// All of the cache's memory is allocated here, playing notes doesn't allocate.
+// Must not run concurrently with render.
+// Returns: 1 on success, 0 if the cache memory couldn't be allocated
+int tsf_bridge_set_oneshot_cache(TSFHandle handle, int max_bytes);
+
+// Cache the audio of phrases played with tsf_bridge_phrase_play, so repetitions are mixed instead of rendered
+// handle: synthesizer instance
+// max_bytes: memory the cached audio may take, 0 = off (default), the least recently played phrases
+//            are dropped to make room
+// Each phrase plays on voices of its own, starting from silence with a copy of its channels. The
+// first play of a phrase renders it live and records it including its release tail; later plays of
+// the same events with the same channel state (preset, controllers, pitch, volume, pan) and render
+// settings are mixed from the recording. A channel change while a phrase plays (controller, program,
+// pitch bend, volume, tuning or note off all) reaches the phrase as well and switches it to live
+// rendering: the recording goes on playing while the phrase's voices catch up with it, 4 frames per
+// frame rendered, and the change takes effect once they did. Changing the budget clears the cache.
+// All of the cache's memory is allocated here, recording and playing don't allocate.
+// Must not run concurrently with render.
+// Returns: 1 on success, 0 if the phrase players or the cache memory couldn't be allocated
+int tsf_bridge_set_phrase_cache(TSFHandle handle, int max_bytes);
+
+// Define a phrase to play with tsf_bridge_phrase_play, e.g. a bar of a drum pattern or a gated chord
+// handle: synthesizer instance
+// events: count events, frame_offset from the start of the phrase (any order, same offsets keep their order)
+// length_frames: frames from the start to the end of the phrase, notes still held there are released;
+//                events after it are dropped, <= 0 = ends with the last event
+// Controller, program and pitch bend events of a phrase only change the phrase's copy of the channel
+// when it plays on voices of its own, but the synth's channel when it's scheduled (see
+// tsf_bridge_phrase_play), so a phrase should leave its channels as it found them.
+// The events are copied. Can be called from any thread.
+// Returns: phrase id (0 to TSF_BRIDGE_MAX_PHRASES - 1), -1 if no event is left, all ids are in use or allocation failed
+int tsf_bridge_phrase_define(TSFHandle handle, const TSFBridgeEvent* events, int count, int length_frames);
+
+// Release a phrase id at the next render, plays of the phrase that started already play to the end
+// Its memory is freed by the next tsf_bridge_phrase_define, tsf_bridge_set_phrase_cache or tsf_bridge_close.
+void tsf_bridge_phrase_release(TSFHandle handle, int phrase);
+
+// Play a phrase at a frame offset from the start of the next render (negative = as soon as possible)
+// Without a phrase cache this is the same as scheduling the events of the phrase.
+// Returns: 1 if the play was queued, 0 if the command queue is full
+int tsf_bridge_phrase_play(TSFHandle handle, int phrase, int frame_offset);
+
+// Get the phrase cache statistics, can be called from any thread
+// handle: synthesizer instance
+// stats: receives the statistics as of the last render, may be NULL
+// Returns: memory used by the cached phrases in bytes
+int tsf_bridge_get_phrase_cache_stats(TSFHandle handle, TSFBridgePhraseCacheStats* stats);
+
+// Limit the voices of a channel, new notes over the limit fade out one of the channel's voices
+// handle: synthesizer instance
+// channel: MIDI channel (0-15)
+// max_voices: voice limit, 0 = no limit (default)
+void tsf_bridge_channel_set_polyphony(TSFHandle handle, int channel, int max_voices);
+
+// Set how important the voices of a channel are when voices are stolen
+// handle: synthesizer instance
+// channel: MIDI channel (0-15)
+// priority: 0 (stolen first) to 127 (stolen last), default 64, e.g. drums and lead above pads
+void tsf_bridge_channel_set_priority(TSFHandle handle, int channel, int priority);
+
+// Load a sequence of notes for the built-in sequencer, replacing the current one
+// handle: synthesizer instance
+// notes: count notes, in any order
+// length_beats: length of the sequence (the loop length), <= 0 = up to the end of the last note
+// The notes are copied, so the array can be reused right away. Playback of the previous sequence
+// stops (its notes are released) when the next render picks up the new one.
+// Returns: number of notes loaded, 0 if the sequence couldn't be allocated
+int tsf_bridge_sequence_load(TSFHandle handle, const TSFBridgeNote* notes, int count, double length_beats);
+
+// Start playing the loaded sequence at the next render
+// start_beat: position to start from, notes starting before it are skipped
+// Notes are dispatched inside tsf_bridge_render on their exact frame, the host doesn't need a timer.
+void tsf_bridge_sequence_start(TSFHandle handle, double start_beat);
+
+// Stop the sequence at the next render and release its notes
+void tsf_bridge_sequence_stop(TSFHandle handle);
+
+// Repeat the sequence from the start once it reaches length_beats (off by default)
+// Notes still sounding at the loop point are released there.
+void tsf_bridge_sequence_set_loop(TSFHandle handle, int loop);
+
+// Set the sequencer tempo in beats per minute (default 120), takes effect at the next render
+void tsf_bridge_sequence_set_tempo(TSFHandle handle, double bpm);
+
+// Get the sequence position in beats at the end of the last render
+double tsf_bridge_sequence_get_beat(TSFHandle handle);
+
+// Returns: 1 while the sequence plays, 0 once it was stopped or reached its end (without loop)
+int tsf_bridge_sequence_playing(TSFHandle handle);
+
+// Parse a Standard MIDI File (format 0 or 1) into a packed event array (see TSFBridgeMidiHeader)
+// data, size: contents of the .mid file
+// sample_rate: sample rate to convert the event times to
+// buffer, buffer_size: receives the packed file if it fits (buffer may be NULL to query the size)
+// Tracks are merged in time order (by track at the same time), the tempo map is applied, note-ons
+// with velocity 0 become note-offs and program changes carry the bank from controller 0
+// (128 on channel 10). Meta events, system exclusive and aftertouch are left out.
+// Returns: size of the packed file in bytes, 0 if data isn't a valid MIDI file
+int tsf_bridge_midi_parse(const void* data, int size, int sample_rate, void* buffer, int buffer_size);
+
+// Check a packed file from tsf_bridge_midi_parse (e.g. loaded from disk or memory-mapped)
+// buffer, size: the packed file
+// event_count: receives the number of events, may be NULL
+// Returns: the events right after the header in buffer, NULL if it isn't a packed file of this version
+const TSFBridgeMidiEvent* tsf_bridge_midi_events(const void* buffer, int size, int* event_count);
+
+// Build the checkpoint index of a packed file for tsf_bridge_midi_seek (see TSFBridgeMidiIndexHeader)
+// buffer, size: the packed file from tsf_bridge_midi_parse
+// interval: samples between checkpoints, e.g. 5 seconds worth
+// index, index_size: receives the index if it fits (index may be NULL to query the size)
+// Every checkpoint holds the program, bank, pitch wheel, volume, expression, pan, RPN (pitch range
+// and tuning) and sustain state of all channels and the notes sounding at its sample time.
+// Returns: size of the index in bytes, 0 if buffer isn't a packed file or interval < 1
+int tsf_bridge_midi_index(const void* buffer, int size, int interval, void* index, int index_size);
+
+// Bring the synth's channels into the state they would have when playing the packed file up to sample
+// handle: synthesizer instance
+// buffer, size: the packed file
+// index, index_size: its index from tsf_bridge_midi_index, NULL = replay the state from the start
+// sample: sample time in the file to continue playback at
+// flags: TSF_BRIDGE_SEEK_* values
+// Starts from the checkpoint before sample and replays the events between it and sample without
+// playing notes, so the cost doesn't depend on the position in the file. Notes playing on the synth
+// are released first. The state is sent like tsf_bridge_submit_events, taking effect on the next render.
+// Returns: index of the first event at or after sample to continue playback with, -1 if buffer or
+//          index aren't valid or the command queue is full
+int tsf_bridge_midi_seek(TSFHandle handle, const void* buffer, int size, const void* index, int index_size, unsigned int sample, int flags);
+
+// Save the complete synth state: voices with their envelopes, LFOs and filters, channels, scheduled
+// events, the sample clock and the sequencer position
+// handle: synthesizer instance
+// buffer, size: receives the snapshot if it fits (buffer may be NULL to query the size)
+// The size grows with the number of voices the synth has allocated and the scheduled events, a
+// buffer sized once with some headroom can be reused for every snapshot. Nothing is allocated.
+// Commands sent but not picked up by a render yet aren't part of the snapshot. Must be called between
+// renders on the thread that renders.
+// Returns: size of the snapshot in bytes, 0 while the render thread is running (see tsf_bridge_stream_start)
+int tsf_bridge_snapshot(TSFHandle handle, void* buffer, int size);
+
+// Continue from a snapshot, rendering exactly what the synth rendered after it was taken
+// handle: the synth the snapshot was taken of, or another instance of its font (tsf_bridge_init_font),
+//         with the same output sample rate
+// buffer, size: the snapshot
+// Restoring copies the snapshot into the synth; it only allocates if the synth has fewer voices or
+// channels than the snapshot. The sequencer position is restored if the same sequence load is still
+// in use (not a later load, even of the same notes). The one-shot cache isn't restored: voices
+// whose recording it no longer holds render the rest themselves, matching to float rounding.
+// Snapshots hold pointers into the SoundFont and are only valid in the process that wrote them.
+// Returns: 1 on success, 0 if buffer isn't a snapshot for this synth, allocating failed or the render
+//          thread is running
+int tsf_bridge_restore(TSFHandle handle, const void* buffer, int size);
+
 #ifdef __cplusplus
 }
 #endif
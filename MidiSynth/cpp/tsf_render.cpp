@@ -0,0 +1,319 @@
+// tsf_render.cpp
+// Offline MIDI to WAV renderer on top of the C API in tsf_bridge.h
+//
+// Build (next to tsf_bridge.cpp):
+//   g++ -O3 -std=c++11 tsf_render.cpp tsf_bridge.cpp -o tsf_render -lpthread
+//   cl /O2 /EHsc tsf_render.cpp tsf_bridge.cpp
+//
+// Usage: tsf_render [options] font.sf2 song.mid [more.mid ...]
+//   -o PATH      Output .wav (one input) or directory (default: next to each input)
+//   -r RATE      Sample rate (default 44100)
+//   -j THREADS   Worker threads (default: all cores)
+//   -t SECONDS   Release tail rendered after the last event (default 2)
+//   --stems      Render every MIDI channel of a file on its own synth, in parallel, and write
+//                song.chNN.wav per channel next to the mix
+//   --float      Write 32-bit float WAV instead of 16-bit PCM
+//
+// Every file (or stem) is rendered by a fresh synth sharing the loaded SoundFont, with events
+// applied on their exact frame through tsf_bridge_submit_events. The output doesn't depend on
+// the number of threads or the order in which the workers pick up the jobs.
+
+#include "tsf_bridge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Frames rendered per tsf_bridge_render call
+#define TSF_RENDER_BLOCK 4096
+
+// Events submitted per render call, well below the bridge's command and event queue sizes
+#define TSF_RENDER_MAX_BLOCK_EVENTS 2048
+
+struct MidiSong {
+    std::vector<unsigned char> packed;  // Packed file from tsf_bridge_midi_parse
+    const TSFBridgeMidiEvent* events;   // Sorted by sample time, in file order at the same time
+    int eventCount;
+    long long length;                   // Sample time of the end of the longest track
+    unsigned short usedChannels;        // Bit n set if channel n plays notes
+};
+
+static bool midi_load(const char* path, int sampleRate, MidiSong* song) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    std::vector<unsigned char> data;
+    unsigned char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(file);
+    if (data.empty() || data.size() > 0x7FFFFFFF) return false;
+
+    int size = tsf_bridge_midi_parse(data.data(), (int)data.size(), sampleRate, NULL, 0);
+    if (!size) return false;
+    song->packed.resize(size);
+    if (tsf_bridge_midi_parse(data.data(), (int)data.size(), sampleRate, song->packed.data(), size) != size) return false;
+    song->events = tsf_bridge_midi_events(song->packed.data(), size, &song->eventCount);
+    if (!song->events) return false;
+    const TSFBridgeMidiHeader* header = (const TSFBridgeMidiHeader*)song->packed.data();
+    song->length = header->length;
+    song->usedChannels = header->channels;
+    return true;
+}
+
+// ============================================
+// Rendering
+// ============================================
+
+// Renders the events of the channels in channelMask into out (interleaved stereo float)
+static void render_song(TSFHandle synth, const MidiSong& song, unsigned int channelMask, int sampleRate, long long frames, float* out) {
+    tsf_bridge_set_output(synth, sampleRate, 2);
+    std::vector<TSFBridgeEvent> batch;
+    batch.reserve(TSF_RENDER_MAX_BLOCK_EVENTS);
+
+    // GM setup: preset 0 on every channel, the drum kit on channel 10
+    for (int c = 0; c < 16; c++) {
+        TSFBridgeEvent e = { -1, TSF_BRIDGE_EVENT_PROGRAM_CHANGE, (unsigned char)c, 0, (unsigned short)(c == 9 ? 128 : 0), 0 };
+        batch.push_back(e);
+    }
+    tsf_bridge_submit_events(synth, batch.data(), (int)batch.size());
+    int next = 0;
+
+    for (long long start = 0; start < frames;) {
+        long long blockEnd = start + TSF_RENDER_BLOCK;
+        if (blockEnd > frames) blockEnd = frames;
+
+        batch.clear();
+        for (; next < song.eventCount && song.events[next].sample < blockEnd; next++) {
+            const TSFBridgeMidiEvent& e = song.events[next];
+            if (!(channelMask & (1u << e.channel))) continue;
+            if (batch.size() == TSF_RENDER_MAX_BLOCK_EVENTS) {
+                // Dense passage, end the block at this event (unless it's on the first frame)
+                if (e.sample > start) blockEnd = e.sample;
+                break;
+            }
+            TSFBridgeEvent b = { (int)(e.sample - start), e.type, e.channel, e.data1, e.data2, 0 };
+            batch.push_back(b);
+        }
+        if (!batch.empty()) tsf_bridge_submit_events(synth, batch.data(), (int)batch.size());
+        tsf_bridge_render(synth, out + start * 2, (int)(blockEnd - start));
+        start = blockEnd;
+    }
+}
+
+static void float_to_int16(const float* in, short* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float v = in[i] * 32767.0f;
+        v = (v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v));
+        out[i] = (short)lrintf(v);
+    }
+}
+
+static void write_le(FILE* file, unsigned int value, int bytes) {
+    for (int i = 0; i < bytes; i++) fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+static bool write_wav(const std::string& path, const float* samples, long long frames, int sampleRate, bool asFloat) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    int bytesPerSample = asFloat ? 4 : 2;
+    unsigned int dataBytes = (unsigned int)(frames * 2 * bytesPerSample);
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 36 + dataBytes, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_le(file, 16, 4);
+    write_le(file, asFloat ? 3 : 1, 2);  // IEEE float or PCM
+    write_le(file, 2, 2);
+    write_le(file, sampleRate, 4);
+    write_le(file, sampleRate * 2 * bytesPerSample, 4);
+    write_le(file, 2 * bytesPerSample, 2);
+    write_le(file, bytesPerSample * 8, 2);
+    fwrite("data", 1, 4, file);
+    write_le(file, dataBytes, 4);
+
+    // WAV data is little endian like every platform this builds for
+    size_t count = (size_t)frames * 2;
+    if (asFloat) {
+        fwrite(samples, sizeof(float), count, file);
+    } else {
+        std::vector<short> pcm(TSF_RENDER_BLOCK * 2);
+        for (size_t i = 0; i < count; i += pcm.size()) {
+            size_t n = (count - i < pcm.size()) ? count - i : pcm.size();
+            float_to_int16(samples + i, pcm.data(), n);
+            fwrite(pcm.data(), sizeof(short), n, file);
+        }
+    }
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+// A file to render, or one channel of a file in stem mode
+struct RenderJob {
+    int input;
+    int channel;            // -1 = all channels
+};
+
+struct RenderInput {
+    std::string path;
+    std::string output;     // Output path without the .wav extension
+    MidiSong song;
+    long long frames;
+    std::vector<std::vector<float> > stems;  // Per channel in stem mode
+    bool ok;
+};
+
+// Creating and closing synths that share a SoundFont isn't thread-safe
+static std::mutex synthMutex;
+
+static std::string output_base(const std::string& input, const char* outPath, int inputCount) {
+    std::string name = input;
+    size_t slash = name.find_last_of("/\\");
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+    if (!outPath) return name;
+
+    std::string out = outPath;
+    if (inputCount == 1 && out.size() > 4 && out.compare(out.size() - 4, 4, ".wav") == 0) return out.substr(0, out.size() - 4);
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    if (!out.empty() && out[out.size() - 1] != '/' && out[out.size() - 1] != '\\') out += '/';
+    return out + name;
+}
+
+static void usage() {
+    fprintf(stderr,
+        "Usage: tsf_render [options] font.sf2 song.mid [more.mid ...]\n"
+        "  -o PATH      Output .wav (one input) or directory (default: next to each input)\n"
+        "  -r RATE      Sample rate (default 44100)\n"
+        "  -j THREADS   Worker threads (default: all cores)\n"
+        "  -t SECONDS   Release tail after the last event (default 2)\n"
+        "  --stems      Also write one .chNN.wav per MIDI channel, channels render in parallel\n"
+        "  --float      Write 32-bit float WAV instead of 16-bit PCM\n");
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = NULL;
+    int sampleRate = 44100;
+    int threadCount = (int)std::thread::hardware_concurrency();
+    double tail = 2.0;
+    bool stems = false, asFloat = false;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strcmp(a, "-o") && i + 1 < argc) outPath = argv[++i];
+        else if (!strcmp(a, "-r") && i + 1 < argc) sampleRate = atoi(argv[++i]);
+        else if (!strcmp(a, "-j") && i + 1 < argc) threadCount = atoi(argv[++i]);
+        else if (!strcmp(a, "-t") && i + 1 < argc) tail = atof(argv[++i]);
+        else if (!strcmp(a, "--stems")) stems = true;
+        else if (!strcmp(a, "--float")) asFloat = true;
+        else if (a[0] == '-') { usage(); return 1; }
+        else paths.push_back(a);
+    }
+    if (paths.size() < 2 || sampleRate <= 0) {
+        usage();
+        return 1;
+    }
+    if (threadCount < 1) threadCount = 1;
+
+    TSFHandle font = tsf_bridge_init(paths[0]);
+    if (!font) return 1;
+
+    std::vector<RenderInput> inputs(paths.size() - 1);
+    std::vector<RenderJob> jobs;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        RenderInput& in = inputs[i];
+        in.path = paths[i + 1];
+        in.output = output_base(in.path, outPath, (int)inputs.size());
+        in.ok = midi_load(in.path.c_str(), sampleRate, &in.song);
+        if (!in.ok) {
+            fprintf(stderr, "Failed to load MIDI file: %s\n", in.path.c_str());
+            continue;
+        }
+        in.frames = in.song.length + (long long)(tail * sampleRate) + 1;
+        if (stems) {
+            // One job per channel that plays notes, mixed once all of them are done
+            in.stems.resize(16);
+            for (int c = 0; c < 16; c++) {
+                if (!(in.song.usedChannels & (1 << c))) continue;
+                RenderJob job = { (int)i, c };
+                jobs.push_back(job);
+            }
+        } else {
+            RenderJob job = { (int)i, -1 };
+            jobs.push_back(job);
+        }
+    }
+
+    // Workers take the next job until all are done, longest files are no special case
+    std::atomic<size_t> nextJob(0);
+    std::atomic<bool> failed(false);
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount && t < (int)jobs.size(); t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t j; (j = nextJob.fetch_add(1)) < jobs.size();) {
+                const RenderJob& job = jobs[j];
+                RenderInput& in = inputs[job.input];
+                TSFHandle synth;
+                {
+                    std::lock_guard<std::mutex> lock(synthMutex);
+                    synth = tsf_bridge_init_copy(font);
+                }
+                if (!synth) {
+                    failed = true;
+                    continue;
+                }
+
+                std::vector<float> audio((size_t)in.frames * 2);
+                unsigned int mask = (job.channel < 0) ? 0xFFFFu : (1u << job.channel);
+                render_song(synth, in.song, mask, sampleRate, in.frames, audio.data());
+                {
+                    std::lock_guard<std::mutex> lock(synthMutex);
+                    tsf_bridge_close(synth);
+                }
+
+                if (job.channel >= 0) {
+                    char suffix[32];
+                    snprintf(suffix, sizeof(suffix), ".ch%02d.wav", job.channel + 1);
+                    if (!write_wav(in.output + suffix, audio.data(), in.frames, sampleRate, asFloat)) failed = true;
+                    in.stems[job.channel].swap(audio);
+                } else if (!write_wav(in.output + ".wav", audio.data(), in.frames, sampleRate, asFloat)) {
+                    failed = true;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    // Stem mixes are summed in channel order, so they don't depend on which stem finished first
+    if (stems) {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            RenderInput& in = inputs[i];
+            if (!in.ok) continue;
+            std::vector<float> mix((size_t)in.frames * 2, 0.0f);
+            for (int c = 0; c < 16; c++) {
+                const std::vector<float>& stem = in.stems[c];
+                for (size_t s = 0; s < stem.size(); s++) mix[s] += stem[s];
+            }
+            if (!write_wav(in.output + ".wav", mix.data(), in.frames, sampleRate, asFloat)) failed = true;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    tsf_bridge_close(font);
+
+    double audioSeconds = 0;
+    int rendered = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!inputs[i].ok) continue;
+        audioSeconds += (double)inputs[i].frames / sampleRate;
+        rendered++;
+    }
+    printf("Rendered %d file%s, %.1f s of audio in %.2f s on %d thread%s: %.1fx real time\n",
+           rendered, rendered == 1 ? "" : "s", audioSeconds, seconds, (int)workers.size(), workers.size() == 1 ? "" : "s",
+           seconds > 0 ? audioSeconds / seconds : 0.0);
+    return (failed || rendered != (int)inputs.size()) ? 1 : 0;
+}
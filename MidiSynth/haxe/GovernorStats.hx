@@ -0,0 +1,93 @@
+package;
+
+import haxe.io.Bytes;
+
+/**
+ * What the CPU budget governor measured and decided, see MidiSynth.setCpuBudget
+ * Reuse one instance to poll without allocating:
+ * ```haxe
+ * var stats = new GovernorStats();
+ * synth.getGovernorStats(stats);
+ * trace('level ${stats.level}, load ${stats.averageLoad} of ${stats.budget}');
+ * ```
+ */
+class GovernorStats {
+    // Layout of TSFBridgeGovernorStats in tsf_bridge.h:
+    // float64 lastChangeTime, float64 secondsAtLevel[6], float32 budget, load, averageLoad, peakLoad,
+    // lastChangeLoad, int32 level, maxLevel, effectBlocks, qualityFlags, uint32 degrades, restores,
+    // culledVoices, overBudget, overruns
+    public static inline var SIZE:Int = 112;
+    public static inline var LEVELS:Int = 6;
+
+    /** Raw statistics, written by MidiSynth.getGovernorStats */
+    public var bytes(default, null):Bytes;
+
+    public function new() {
+        bytes = Bytes.alloc(SIZE);
+    }
+
+    /** Sample time of the last level change, -1 if the level never changed */
+    public var lastChangeTime(get, never):Float;
+    inline function get_lastChangeTime():Float return bytes.getDouble(0);
+
+    /** Seconds of audio rendered at a level (0 to LEVELS - 1) */
+    public inline function getSecondsAtLevel(level:Int):Float {
+        return bytes.getDouble(8 + level * 8);
+    }
+
+    /** Fraction of real time rendering may take, 0 = governor off */
+    public var budget(get, never):Float;
+    inline function get_budget():Float return bytes.getFloat(56);
+
+    /** Render time / audio duration of the last measured window */
+    public var load(get, never):Float;
+    inline function get_load():Float return bytes.getFloat(60);
+
+    /** Smoothed load, quality is restored once it is well below the budget */
+    public var averageLoad(get, never):Float;
+    inline function get_averageLoad():Float return bytes.getFloat(64);
+
+    /** Highest window load */
+    public var peakLoad(get, never):Float;
+    inline function get_peakLoad():Float return bytes.getFloat(68);
+
+    /** Load that caused the last level change */
+    public var lastChangeLoad(get, never):Float;
+    inline function get_lastChangeLoad():Float return bytes.getFloat(72);
+
+    /** Current level, 0 = full quality */
+    public var level(get, never):Int;
+    inline function get_level():Int return bytes.getInt32(76);
+
+    /** Highest level reached */
+    public var maxLevel(get, never):Int;
+    inline function get_maxLevel():Int return bytes.getInt32(80);
+
+    /** Effects are updated every effectBlocks * 64 frames at the current level */
+    public var effectBlocks(get, never):Int;
+    inline function get_effectBlocks():Int return bytes.getInt32(84);
+
+    /** TSF_QUALITY_* flags of tsf.h at the current level */
+    public var qualityFlags(get, never):Int;
+    inline function get_qualityFlags():Int return bytes.getInt32(88);
+
+    /** Steps to a lower quality */
+    public var degrades(get, never):Int;
+    inline function get_degrades():Int return bytes.getInt32(92);
+
+    /** Steps back to a higher quality */
+    public var restores(get, never):Int;
+    inline function get_restores():Int return bytes.getInt32(96);
+
+    /** Voices faded out at the last level */
+    public var culledVoices(get, never):Int;
+    inline function get_culledVoices():Int return bytes.getInt32(100);
+
+    /** Windows that took longer than the budget */
+    public var overBudget(get, never):Int;
+    inline function get_overBudget():Int return bytes.getInt32(104);
+
+    /** Windows that took longer than real time, enough to drop out */
+    public var overruns(get, never):Int;
+    inline function get_overruns():Int return bytes.getInt32(108);
+}
@@ -0,0 +1,72 @@
+package;
+
+import haxe.io.Bytes;
+
+/**
+ * Packed batch of MIDI events for MidiSynth.submitEvents
+ * Sends any number of events to the synth with a single native call instead of one call per event.
+ *
+ * Usage:
+ * ```haxe
+ * var batch = new MidiEventBatch();
+ * batch.add(0, MidiSynth.EVENT_NOTE_ON, 0, 60, 100);
+ * batch.add(22050, MidiSynth.EVENT_NOTE_OFF, 0, 60);
+ * synth.submitEvents(batch);
+ * batch.clear();
+ * ```
+ */
+class MidiEventBatch {
+    // Bytes per event, layout of TSFBridgeEvent in tsf_bridge.h:
+    // int32 frameOffset, uint8 type, uint8 channel, uint16 data1, uint16 data2, uint16 reserved
+    public static inline var EVENT_SIZE:Int = 12;
+
+    // Frame offset of events that take effect right away, like noteOn and the other direct calls
+    public static inline var NOW:Int = -1;
+
+    /** Packed events, only the first length * EVENT_SIZE bytes are in use */
+    public var bytes(default, null):Bytes;
+
+    /** Number of events in the batch */
+    public var length(default, null):Int = 0;
+
+    /**
+     * @param capacity Events the batch has room for before it grows
+     */
+    public function new(capacity:Int = 256) {
+        bytes = Bytes.alloc((capacity > 0 ? capacity : 1) * EVENT_SIZE);
+    }
+
+    /**
+     * Append an event
+     * @param frameOffset Frames after the start of the next render, NOW (-1) = right away
+     * @param type One of the MidiSynth.EVENT_* constants
+     * @param channel MIDI channel (0-15)
+     * @param data1 Note, controller, preset or pitch wheel value (see MidiSynth.EVENT_*)
+     * @param data2 Velocity, controller value or bank (see MidiSynth.EVENT_*)
+     */
+    public function add(frameOffset:Int, type:Int, channel:Int, data1:Int, data2:Int = 0):Void {
+        // Same drum bank rule as MidiSynth.setPreset
+        if (type == MidiSynth.EVENT_PROGRAM_CHANGE && channel == 9) data2 = 128;
+
+        var pos = length * EVENT_SIZE;
+        if (pos + EVENT_SIZE > bytes.length) {
+            var grown = Bytes.alloc(bytes.length * 2);
+            grown.blit(0, bytes, 0, pos);
+            bytes = grown;
+        }
+        bytes.setInt32(pos, frameOffset);
+        bytes.set(pos + 4, type);
+        bytes.set(pos + 5, channel);
+        bytes.setUInt16(pos + 6, data1);
+        bytes.setUInt16(pos + 8, data2);
+        bytes.setUInt16(pos + 10, 0);
+        length++;
+    }
+
+    /**
+     * Remove all events, keeps the allocated bytes for reuse
+     */
+    public function clear():Void {
+        length = 0;
+    }
+}
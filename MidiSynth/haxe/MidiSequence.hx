@@ -0,0 +1,68 @@
+package;
+
+import haxe.io.Bytes;
+
+/**
+ * Notes for the sequencer built into the synth (MidiSynth.loadSequence)
+ * Times are in beats, the synth converts them to sample times with the sequence tempo and plays
+ * every note on its exact frame while rendering, no timers involved.
+ *
+ * Usage:
+ * ```haxe
+ * var seq = new MidiSequence();
+ * seq.add(0, 1, 0, 60, 100);    // Middle C for a beat
+ * seq.add(1, 0.5, 9, 36, 110);  // Kick on the drum channel
+ * synth.loadSequence(seq, 4);
+ * synth.setSequenceLoop(true);
+ * synth.startSequence();
+ * ```
+ */
+class MidiSequence {
+    // Bytes per note, layout of TSFBridgeNote in tsf_bridge.h:
+    // float64 start, float64 duration, uint8 channel, uint8 note, uint8 velocity, 5 bytes reserved
+    public static inline var NOTE_SIZE:Int = 24;
+
+    /** Packed notes, only the first length * NOTE_SIZE bytes are in use */
+    public var bytes(default, null):Bytes;
+
+    /** Number of notes in the sequence */
+    public var length(default, null):Int = 0;
+
+    /**
+     * @param capacity Notes the sequence has room for before it grows
+     */
+    public function new(capacity:Int = 256) {
+        bytes = Bytes.alloc((capacity > 0 ? capacity : 1) * NOTE_SIZE);
+    }
+
+    /**
+     * Append a note, in any order
+     * @param startBeat Start of the note in beats from the start of the sequence
+     * @param durationBeats Length of the note in beats
+     * @param channel MIDI channel (0-15)
+     * @param note MIDI note number (0-127)
+     * @param velocity Note velocity (1-127)
+     */
+    public function add(startBeat:Float, durationBeats:Float, channel:Int, note:Int, velocity:Int):Void {
+        var pos = length * NOTE_SIZE;
+        if (pos + NOTE_SIZE > bytes.length) {
+            var grown = Bytes.alloc(bytes.length * 2);
+            grown.blit(0, bytes, 0, pos);
+            bytes = grown;
+        }
+        bytes.setDouble(pos, startBeat);
+        bytes.setDouble(pos + 8, durationBeats);
+        bytes.set(pos + 16, channel);
+        bytes.set(pos + 17, note);
+        bytes.set(pos + 18, velocity);
+        bytes.fill(pos + 19, 5, 0);
+        length++;
+    }
+
+    /**
+     * Remove all notes, keeps the allocated bytes for reuse
+     */
+    public function clear():Void {
+        length = 0;
+    }
+}
@@ -0,0 +1,97 @@
+package;
+
+import haxe.io.Bytes;
+
+/**
+ * MIDI file parsed by MidiSynth.parseMidi into packed events
+ * Tracks are merged and event times are sample times at the synth's sample rate, so playback
+ * reads plain integers instead of parsing or converting anything per event.
+ * The bytes can be saved and loaded back with MidiSong.fromBytes.
+ *
+ * Usage:
+ * ```haxe
+ * var song = synth.parseMidi(File.getBytes("song.mid"));
+ * while (next < song.eventCount && song.getSample(next) < sampleTime + frames) {
+ *     batch.add(song.getSample(next) - sampleTime, song.getType(next), song.getChannel(next),
+ *               song.getData1(next), song.getData2(next));
+ *     next++;
+ * }
+ * ```
+ * To jump into the song, index it once and seek, the returned event is the next one to play:
+ * ```haxe
+ * synth.indexMidi(song);
+ * next = synth.seekMidi(song, sampleTime);
+ * ```
+ */
+class MidiSong {
+    // Layout of TSFBridgeMidiHeader and TSFBridgeMidiEvent in tsf_bridge.h:
+    // header: uint32 magic, version, sampleRate, eventCount, length, uint16 channels, reserved
+    // event: uint32 sample, uint8 type, uint8 channel, uint16 data1, uint16 data2, uint16 reserved
+    public static inline var HEADER_SIZE:Int = 24;
+    public static inline var EVENT_SIZE:Int = 12;
+    static inline var MAGIC:Int = 0x4D465354; // "TSFM"
+    static inline var VERSION:Int = 1;
+
+    /** Packed header and events */
+    public var bytes(default, null):Bytes;
+
+    /** Number of events */
+    public var eventCount(default, null):Int;
+
+    /** Sample rate of the event times */
+    public var sampleRate(default, null):Int;
+
+    /** Sample time of the end of the longest track */
+    public var length(default, null):Int;
+
+    /** Bit n set if MIDI channel n plays notes */
+    public var channels(default, null):Int;
+
+    /** Checkpoints for MidiSynth.seekMidi, made by MidiSynth.indexMidi (null = seek replays from the start) */
+    public var index:Bytes;
+
+    function new(bytes:Bytes) {
+        this.bytes = bytes;
+        sampleRate = bytes.getInt32(8);
+        eventCount = bytes.getInt32(12);
+        length = bytes.getInt32(16);
+        channels = bytes.getUInt16(20);
+    }
+
+    /**
+     * Use packed bytes from MidiSong.bytes, e.g. saved to a file earlier
+     * @return The song, or null if bytes don't hold a packed song of this version
+     */
+    public static function fromBytes(bytes:Bytes):MidiSong {
+        if (bytes == null || bytes.length < HEADER_SIZE) return null;
+        if (bytes.getInt32(0) != MAGIC || bytes.getInt32(4) != VERSION) return null;
+        var count = bytes.getInt32(12);
+        if (count < 0 || count > Std.int((bytes.length - HEADER_SIZE) / EVENT_SIZE)) return null;
+        return new MidiSong(bytes);
+    }
+
+    /** Sample time of event i */
+    public inline function getSample(i:Int):Int {
+        return bytes.getInt32(HEADER_SIZE + i * EVENT_SIZE);
+    }
+
+    /** Type of event i, one of the MidiSynth.EVENT_* constants */
+    public inline function getType(i:Int):Int {
+        return bytes.get(HEADER_SIZE + i * EVENT_SIZE + 4);
+    }
+
+    /** MIDI channel (0-15) of event i */
+    public inline function getChannel(i:Int):Int {
+        return bytes.get(HEADER_SIZE + i * EVENT_SIZE + 5);
+    }
+
+    /** Note, controller, preset or pitch wheel value of event i (see MidiSynth.EVENT_*) */
+    public inline function getData1(i:Int):Int {
+        return bytes.getUInt16(HEADER_SIZE + i * EVENT_SIZE + 6);
+    }
+
+    /** Velocity, controller value or bank of event i (see MidiSynth.EVENT_*) */
+    public inline function getData2(i:Int):Int {
+        return bytes.getUInt16(HEADER_SIZE + i * EVENT_SIZE + 8);
+    }
+}
@@ -27,7 +27,7 @@ import haxe.io.Bytes as HaxeBytes;
  * ```
  */
 #if cpp
-@:headerCode('extern "C" {\n  void* tsf_bridge_init(const char* path);\n  void tsf_bridge_close(void* handle);\n  void tsf_bridge_set_output(void* handle, int sampleRate, int channels);\n  void tsf_bridge_note_on(void* handle, int channel, int note, int velocity);\n  void tsf_bridge_note_off(void* handle, int channel, int note);\n  void tsf_bridge_set_preset(void* handle, int channel, int bank, int preset);\n  void tsf_bridge_pitch_bend(void* handle, int channel, int pitch_wheel);\n  void tsf_bridge_control_change(void* handle, int channel, int controller, int value);\n  void tsf_bridge_channel_set_volume(void* handle, int channel, float volume);\n  int tsf_bridge_render(void* handle, void* buffer, int sampleCount);\n  void tsf_bridge_note_off_all(void* handle);\n  int tsf_bridge_active_voices(void* handle);\n}\n')
+@:headerCode('extern "C" {\n  void* tsf_bridge_init(const char* path);\n  void tsf_bridge_close(void* handle);\n  void tsf_bridge_set_output(void* handle, int sampleRate, int channels);\n  void tsf_bridge_set_output_format(void* handle, int sampleRate, int channels, int format);\n  void tsf_bridge_note_on(void* handle, int channel, int note, int velocity);\n  void tsf_bridge_note_off(void* handle, int channel, int note);\n  void tsf_bridge_set_preset(void* handle, int channel, int bank, int preset);\n  void tsf_bridge_pitch_bend(void* handle, int channel, int pitch_wheel);\n  void tsf_bridge_control_change(void* handle, int channel, int controller, int value);\n  void tsf_bridge_channel_set_volume(void* handle, int channel, float volume);\n  int tsf_bridge_render(void* handle, void* buffer, int sampleCount);\n  void tsf_bridge_note_off_all(void* handle);\n  int tsf_bridge_active_voices(void* handle);\n  int tsf_bridge_set_render_threads(void* handle, int threadCount);\n  int tsf_bridge_schedule_event(void* handle, int frameOffset, int type, int channel, int data1, int data2);\n  int tsf_bridge_schedule_event_at(void* handle, double sampleTime, int type, int channel, int data1, int data2);\n  int tsf_bridge_submit_events(void* handle, const void* events, int count);\n  void tsf_bridge_set_bus_map(void* handle, const void* channelBus, int busCount);\n  int tsf_bridge_render_buses(void* handle, void* buffer, int sampleCount);\n  double tsf_bridge_get_sample_time(void* handle);\n  void tsf_bridge_clear_events(void* handle);\n  int tsf_bridge_dropped_commands(void* handle);\n  int tsf_bridge_stream_start(void* handle, int targetLatencyFrames, int blockFrames);\n  void tsf_bridge_stream_stop(void* handle);\n  int tsf_bridge_stream_set_latency(void* handle, int targetLatencyFrames);\n  int tsf_bridge_stream_read(void* handle, void* buffer, int sampleCount);\n  int tsf_bridge_stream_underruns(void* handle);\n  int tsf_bridge_stream_overruns(void* handle);\n  int tsf_bridge_midi_parse(const void* data, int size, int sampleRate, void* buffer, int bufferSize);\n  int tsf_bridge_sequence_load(void* handle, const void* notes, int count, double lengthBeats);\n  void tsf_bridge_sequence_start(void* handle, double startBeat);\n  void tsf_bridge_sequence_stop(void* handle);\n  void tsf_bridge_sequence_set_loop(void* handle, int loop);\n  void tsf_bridge_sequence_set_tempo(void* handle, double bpm);\n  double tsf_bridge_sequence_get_beat(void* handle);\n  int tsf_bridge_sequence_playing(void* handle);\n  int tsf_bridge_midi_index(const void* song, int size, int interval, void* index, int indexSize);\n  int tsf_bridge_midi_seek(void* handle, const void* song, int size, const void* index, int indexSize, unsigned int sample, int flags);\n  int tsf_bridge_snapshot(void* handle, void* buffer, int size);\n  int tsf_bridge_restore(void* handle, const void* buffer, int size);\n  int tsf_bridge_render_mix(const void* handles, const void* gains, const void* pans, int count, void* buffer, int sampleCount, int flagMixing);\n  int tsf_bridge_set_max_voices(void* handle, int maxVoices);\n  void tsf_bridge_channel_set_polyphony(void* handle, int channel, int maxVoices);\n  void tsf_bridge_channel_set_priority(void* handle, int channel, int priority);\n  void tsf_bridge_set_cpu_budget(void* handle, float budget);\n  int tsf_bridge_get_governor_stats(void* handle, void* stats);\n  void tsf_bridge_set_voice_virtualization(void* handle, float thresholdDb);\n  int tsf_bridge_set_phrase_cache(void* handle, int maxBytes);\n  int tsf_bridge_phrase_define(void* handle, const void* events, int count, int lengthFrames);\n  void tsf_bridge_phrase_release(void* handle, int phrase);\n  int tsf_bridge_phrase_play(void* handle, int phrase, int frameOffset);\n  int tsf_bridge_get_phrase_cache_stats(void* handle, void* stats);\n  int tsf_bridge_set_oneshot_cache(void* handle, int maxBytes);\n}\n')
 #if cpp
 @:cppFileCode('#define TSF_IMPLEMENTATION\n#include "../../../../MidiSynth/cpp/tsf/tsf.h"\nextern "C" {\ntypedef void* TSFHandle;\n}\nstruct TSFSynth { tsf* synth; int sampleRate; int channels; };\nstatic TSFHandle tsf_bridge_init(const char* path) { if (!path) return NULL; tsf* synth = tsf_load_filename(path); if (!synth) return NULL; TSFSynth* handle = (TSFSynth*)malloc(sizeof(TSFSynth)); if (!handle) { tsf_close(synth); return NULL; } handle->synth = synth; handle->sampleRate = 44100; handle->channels = 2; tsf_set_output(synth, TSF_STEREO_INTERLEAVED, 44100, 0.0f); tsf_channel_set_bank_preset(synth, 0, 0, 0); return (TSFHandle)handle; }\nstatic void tsf_bridge_close(TSFHandle handle) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; if (synth->synth) tsf_close(synth->synth); free(synth); }\nstatic void tsf_bridge_set_output(TSFHandle handle, int sample_rate, int channels) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; synth->sampleRate = sample_rate; synth->channels = channels; enum TSFOutputMode mode = (channels == 1) ? TSF_MONO : TSF_STEREO_INTERLEAVED; tsf_set_output(synth->synth, mode, sample_rate, 0.0f); }\nstatic void tsf_bridge_note_on(TSFHandle handle, int channel, int note, int velocity) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; float vel = velocity / 127.0f; tsf_channel_note_on(synth->synth, channel, note, vel); }\nstatic void tsf_bridge_note_off(TSFHandle handle, int channel, int note) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; tsf_channel_note_off(synth->synth, channel, note); }\nstatic void tsf_bridge_set_preset(TSFHandle handle, int channel, int bank, int preset) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; tsf_channel_set_bank_preset(synth->synth, channel, bank, preset); }\nstatic int tsf_bridge_render(TSFHandle handle, void* buffer, int sample_count) { if (!handle || !buffer || sample_count <= 0) return 0; TSFSynth* synth = (TSFSynth*)handle; tsf_render_float(synth->synth, (float*)buffer, sample_count, 0); return sample_count; }\nstatic void tsf_bridge_note_off_all(TSFHandle handle) { if (!handle) return; TSFSynth* synth = (TSFSynth*)handle; tsf_note_off_all(synth->synth); }\nstatic int tsf_bridge_active_voices(TSFHandle handle) { if (!handle) return 0; TSFSynth* synth = (TSFSynth*)handle; return tsf_active_voice_count(synth->synth); }\n')
 #end
@@ -63,10 +63,44 @@ class MidiSynth {
     private var isReady:Bool = false;
     private static var wasmModule:Dynamic = null;
     private static var glue:Dynamic = null;
+    // Byte views over the bytes last passed to renderInto / readStream and over the last rendered
+    // view of the WASM heap, reused while they don't change
+    private var targetBytes:Uint8Array = null;
+    private var sourceView:Dynamic = null;
+    private var sourceBytes:Uint8Array = null;
+    #end
+    #if cpp
+    // Reused by render, which copies into a ByteArray
+    private var renderScratch:HaxeBytes = null;
+    #end
+    #if (cpp || hl)
+    // Gains, pans and (on C++) handles passed to the native mixer by renderMix, grown as needed
+    private static var mixParams:HaxeBytes = null;
+    #end
+    #if hl
+    private static var mixHandles:NativeArray<Dynamic> = null;
     #end
     
     private var sampleRate:Int;
     private var channels:Int;
+    private var outputFormat:Int = FORMAT_FLOAT;
+    private var busCount:Int = 16;
+    
+    // Event types for scheduleEvent / scheduleEventAt (MIDI status bytes without the channel)
+    public static inline var EVENT_NOTE_OFF:Int = 0x80;       // data1: note
+    public static inline var EVENT_NOTE_ON:Int = 0x90;        // data1: note, data2: velocity
+    public static inline var EVENT_CONTROL_CHANGE:Int = 0xB0; // data1: controller, data2: value
+    public static inline var EVENT_PROGRAM_CHANGE:Int = 0xC0; // data1: preset, data2: bank
+    public static inline var EVENT_PITCH_BEND:Int = 0xE0;     // data1: pitch wheel (0-16383)
+    
+    // Sample formats for setOutputFormat
+    public static inline var FORMAT_FLOAT:Int = 0;        // Float32, interleaved stereo if channels=2
+    public static inline var FORMAT_FLOAT_PLANAR:Int = 1; // Float32, all left samples, then all right samples
+    public static inline var FORMAT_INT16:Int = 2;        // Int16, interleaved
+    public static inline var FORMAT_INT16_DITHER:Int = 3; // Int16 with TPDF dither, interleaved
+    
+    // Phrases defined at once with definePhrase (TSF_BRIDGE_MAX_PHRASES)
+    public static inline var MAX_PHRASES:Int = 256;
     #if cpp
     private static var cffiRenderFn:Dynamic = null;
     private static inline function getCffiRender():Dynamic {
@@ -226,8 +260,17 @@ class MidiSynth {
     // ============================================
     
     private function initHashLink(path:String):Void {
-        var fileBytes = sys.io.File.getBytes(path);
-        handle = tsf_init_memory(fileBytes, fileBytes.length);
+        // Synths created from the same path share one copy of the SoundFont, only the first one reads it
+        var name = @:privateAccess path.toUtf8();
+        var font = tsf_font_find(name);
+        if (font == null) {
+            var fileBytes = sys.io.File.getBytes(path);
+            font = tsf_font_load_memory(name, fileBytes, fileBytes.length);
+        }
+        if (font != null) {
+            handle = tsf_init_font(font);
+            tsf_font_release(font);
+        }
         if (handle == null) {
             throw "Failed to load SoundFont (memory): " + path;
         }
@@ -243,6 +286,9 @@ class MidiSynth {
     @:hlNative("tsfhl", "set_output")
     private static function tsf_set_output(handle:Dynamic, sampleRate:Int, channels:Int):Void {}
     
+    @:hlNative("tsfhl", "set_output_format")
+    private static function tsf_set_output_format(handle:Dynamic, sampleRate:Int, channels:Int, format:Int):Void {}
+    
     @:hlNative("tsfhl", "note_on")
     private static function tsf_note_on(handle:Dynamic, channel:Int, note:Int, velocity:Int):Void {}
     
@@ -260,6 +306,126 @@ class MidiSynth {
 
     @:hlNative("tsfhl", "active_voices")
     private static function tsf_active_voices(handle:Dynamic):Int { return 0; }
+
+    @:hlNative("tsfhl", "set_render_threads")
+    private static function tsf_set_render_threads(handle:Dynamic, threadCount:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "schedule_event")
+    private static function tsf_schedule_event(handle:Dynamic, frameOffset:Int, type:Int, channel:Int, data1:Int, data2:Int):Bool { return false; }
+
+    @:hlNative("tsfhl", "schedule_event_at")
+    private static function tsf_schedule_event_at(handle:Dynamic, sampleTime:Float, type:Int, channel:Int, data1:Int, data2:Int):Bool { return false; }
+    
+    @:hlNative("tsfhl", "submit_events")
+    private static function tsf_submit_events(handle:Dynamic, events:Bytes, count:Int):Int { return 0; }
+    
+    @:hlNative("tsfhl", "set_bus_map")
+    private static function tsf_set_bus_map(handle:Dynamic, channelBus:Bytes, busCount:Int):Void {}
+    
+    @:hlNative("tsfhl", "render_buses")
+    private static function tsf_render_buses(handle:Dynamic, buffer:Bytes, sampleCount:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "get_sample_time")
+    private static function tsf_get_sample_time(handle:Dynamic):Float { return 0; }
+
+    @:hlNative("tsfhl", "clear_events")
+    private static function tsf_clear_events(handle:Dynamic):Void {}
+
+    @:hlNative("tsfhl", "dropped_commands")
+    private static function tsf_dropped_commands(handle:Dynamic):Int { return 0; }
+
+    @:hlNative("tsfhl", "stream_start")
+    private static function tsf_stream_start(handle:Dynamic, targetLatencyFrames:Int, blockFrames:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "stream_stop")
+    private static function tsf_stream_stop(handle:Dynamic):Void {}
+
+    @:hlNative("tsfhl", "stream_set_latency")
+    private static function tsf_stream_set_latency(handle:Dynamic, targetLatencyFrames:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "stream_read")
+    private static function tsf_stream_read(handle:Dynamic, buffer:Bytes, samples:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "stream_underruns")
+    private static function tsf_stream_underruns(handle:Dynamic):Int { return 0; }
+
+    @:hlNative("tsfhl", "stream_overruns")
+    private static function tsf_stream_overruns(handle:Dynamic):Int { return 0; }
+
+    @:hlNative("tsfhl", "midi_parse")
+    private static function tsf_midi_parse(data:Bytes, size:Int, sampleRate:Int, buffer:Bytes, bufferSize:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "sequence_load")
+    private static function tsf_sequence_load(handle:Dynamic, notes:Bytes, count:Int, lengthBeats:Float):Int { return 0; }
+
+    @:hlNative("tsfhl", "sequence_start")
+    private static function tsf_sequence_start(handle:Dynamic, startBeat:Float):Void {}
+
+    @:hlNative("tsfhl", "sequence_stop")
+    private static function tsf_sequence_stop(handle:Dynamic):Void {}
+
+    @:hlNative("tsfhl", "sequence_set_loop")
+    private static function tsf_sequence_set_loop(handle:Dynamic, loop:Bool):Void {}
+
+    @:hlNative("tsfhl", "sequence_set_tempo")
+    private static function tsf_sequence_set_tempo(handle:Dynamic, bpm:Float):Void {}
+
+    @:hlNative("tsfhl", "sequence_get_beat")
+    private static function tsf_sequence_get_beat(handle:Dynamic):Float { return 0; }
+
+    @:hlNative("tsfhl", "sequence_playing")
+    private static function tsf_sequence_playing(handle:Dynamic):Bool { return false; }
+
+    @:hlNative("tsfhl", "midi_index")
+    private static function tsf_midi_index(song:Bytes, size:Int, interval:Int, index:Bytes, indexSize:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "midi_seek")
+    private static function tsf_midi_seek(handle:Dynamic, song:Bytes, size:Int, index:Bytes, indexSize:Int, sample:Int, flags:Int):Int { return -1; }
+
+    @:hlNative("tsfhl", "snapshot")
+    private static function tsf_snapshot(handle:Dynamic, buffer:Bytes, size:Int):Int { return 0; }
+
+    @:hlNative("tsfhl", "restore")
+    private static function tsf_restore(handle:Dynamic, buffer:Bytes, size:Int):Bool { return false; }
+
+    @:hlNative("tsfhl", "font_find")
+    private static function tsf_font_find(name:Bytes):Dynamic { return null; }
+
+    @:hlNative("tsfhl", "font_load_memory")
+    private static function tsf_font_load_memory(name:Bytes, buffer:Bytes, size:Int):Dynamic { return null; }
+
+    @:hlNative("tsfhl", "font_release")
+    private static function tsf_font_release(font:Dynamic):Void {}
+
+    @:hlNative("tsfhl", "init_font")
+    private static function tsf_init_font(font:Dynamic):Dynamic { return null; }
+
+    @:hlNative("tsfhl", "render_mix")
+    private static function tsf_render_mix(handles:NativeArray<Dynamic>, gains:Bytes, pans:Bytes, count:Int, buffer:Bytes, samples:Int):Int { return 0; }
+    @:hlNative("tsfhl", "set_max_voices")
+    private static function tsf_set_max_voices(handle:Dynamic, maxVoices:Int):Bool { return false; }
+    @:hlNative("tsfhl", "channel_set_polyphony")
+    private static function tsf_channel_set_polyphony(handle:Dynamic, channel:Int, maxVoices:Int):Void {}
+    @:hlNative("tsfhl", "channel_set_priority")
+    private static function tsf_channel_set_priority(handle:Dynamic, channel:Int, priority:Int):Void {}
+    @:hlNative("tsfhl", "set_cpu_budget")
+    private static function tsf_set_cpu_budget(handle:Dynamic, budget:Float):Void {}
+    @:hlNative("tsfhl", "get_governor_stats")
+    private static function tsf_get_governor_stats(handle:Dynamic, stats:Bytes):Int { return 0; }
+    @:hlNative("tsfhl", "set_voice_virtualization")
+    private static function tsf_set_voice_virtualization(handle:Dynamic, thresholdDb:Float):Void {}
+    @:hlNative("tsfhl", "set_phrase_cache")
+    private static function tsf_set_phrase_cache(handle:Dynamic, maxBytes:Int):Bool { return false; }
+    @:hlNative("tsfhl", "phrase_define")
+    private static function tsf_phrase_define(handle:Dynamic, events:Bytes, count:Int, lengthFrames:Int):Int { return -1; }
+    @:hlNative("tsfhl", "phrase_release")
+    private static function tsf_phrase_release(handle:Dynamic, phrase:Int):Void {}
+    @:hlNative("tsfhl", "phrase_play")
+    private static function tsf_phrase_play(handle:Dynamic, phrase:Int, frameOffset:Int):Bool { return false; }
+    @:hlNative("tsfhl", "get_phrase_cache_stats")
+    private static function tsf_get_phrase_cache_stats(handle:Dynamic, stats:Bytes):Int { return 0; }
+    @:hlNative("tsfhl", "set_oneshot_cache")
+    private static function tsf_set_oneshot_cache(handle:Dynamic, maxBytes:Int):Bool { return false; }
     #end
     
     #if js
@@ -277,23 +443,34 @@ class MidiSynth {
             throw "MidiSynth HTML5: Must call MidiSynth.initializeWasm() before creating instances";
         }
         
+        // Synths created from the same path share one copy of the SoundFont, only the first one loads it
+        handle = untyped glue.initShared(path, null);
+        if (handle != 0) {
+            finishInitHtml5();
+            return;
+        }
+        
         // Load SF2 file asynchronously
         loadSoundFont(path, function(arrayBuffer:js.lib.ArrayBuffer) {
-            handle = untyped glue.initFromBuffer(arrayBuffer);
+            handle = untyped glue.initShared(path, arrayBuffer);
             if (handle == 0) {
                 throw "Failed to initialize SoundFont from: " + path;
             }
-            untyped glue.setOutput(handle, sampleRate, channels);
-            isReady = true;
-            trace("MidiSynth initialized for HTML5");
-            // Execute any pending callbacks
-            for (cb in readyCallbacks) {
-                try { cb(); } catch (e:Dynamic) { trace("Error in ready callback: " + e); }
-            }
-            readyCallbacks = [];
+            finishInitHtml5();
         });
     }
     
+    private function finishInitHtml5():Void {
+        untyped glue.setOutput(handle, sampleRate, channels);
+        isReady = true;
+        trace("MidiSynth initialized for HTML5");
+        // Execute any pending callbacks
+        for (cb in readyCallbacks) {
+            try { cb(); } catch (e:Dynamic) { trace("Error in ready callback: " + e); }
+        }
+        readyCallbacks = [];
+    }
+    
     /**
      * Initialize WASM module (HTML5 only)
      * Must be called once before creating MidiSynth instances
@@ -426,7 +603,8 @@ class MidiSynth {
      * Panic: stop all notes and reset controllers on all channels
      */
     public function panicStopAllNotes():Void {
-        // Stop all notes and reset controllers on all 16 MIDI channels
+        // Drop pending scheduled events, then stop all notes and reset controllers on all 16 MIDI channels
+        clearEvents();
         for (channel in 0...16) {
             noteOffAll();
             resetControllers(channel);
@@ -458,28 +636,61 @@ class MidiSynth {
         #end
     }
     
+    /**
+     * Set the sample format of everything rendered from now on
+     * Converting in native code saves a pass over the audio on the Haxe side when the audio
+     * device or encoder wants int16 or planar samples.
+     * @param format One of the FORMAT_* constants (planar is the same as float for mono)
+     */
+    public function setOutputFormat(format:Int):Void {
+        if (format < FORMAT_FLOAT || format > FORMAT_INT16_DITHER) format = FORMAT_FLOAT;
+        outputFormat = format;
+        #if cpp
+        MidiSynthNative.setOutputFormat(handle, sampleRate, channels, format);
+        #elseif hl
+        tsf_set_output_format(handle, sampleRate, channels, format);
+        #elseif js
+        if (isReady && handle != 0) {
+            untyped glue.setOutputFormat(handle, sampleRate, channels, format);
+        } else {
+            // Defer until ready
+            readyCallbacks.push(function() {
+                untyped glue.setOutputFormat(handle, sampleRate, channels, format);
+            });
+        }
+        #end
+    }
+    
+    /**
+     * Get the number of bytes per rendered frame in the current output format
+     */
+    public function getBytesPerFrame():Int {
+        return channels * ((outputFormat == FORMAT_INT16 || outputFormat == FORMAT_INT16_DITHER) ? 2 : 4);
+    }
+    
     /**
      * Render audio samples
-     * @param buffer Output buffer (Float32 array, interleaved stereo if channels=2)
+     * @param buffer Output buffer (in the output format, Float32 interleaved stereo by default)
      * @param sampleCount Number of samples to render (frames, not total floats)
-     * @return Number of samples actually rendered (or Float32Array for JS)
+     * @return Number of samples actually rendered (or Float32Array for JS, Int16Array for the int16 formats)
      */
     public function render(buffer:Any, sampleCount:Int):Dynamic {
         #if cpp
         // For C++, render via CFFI into a Bytes buffer, then copy to ByteArray
         var ba:openfl.utils.ByteArray = cast buffer;
-        var totalFloats = sampleCount * channels;
-        var bytes:HaxeBytes = HaxeBytes.alloc(totalFloats * 4);
+        var totalBytes = sampleCount * getBytesPerFrame();
+        if (renderScratch == null || renderScratch.length < totalBytes) renderScratch = HaxeBytes.alloc(totalBytes);
+        var bytes:HaxeBytes = renderScratch;
         var rendered:Int = getCffiRender()(handle, bytes, sampleCount);
-        ba.length = totalFloats * 4;
+        ba.length = totalBytes;
         ba.position = 0;
         if (rendered <= 0) {
             // write silence
-            for (i in 0...totalFloats) ba.writeFloat(0.0);
+            for (i in 0...totalBytes) ba.writeByte(0);
             return 0;
         }
-        // Copy raw bytes (float32 PCM) directly
-        ba.writeBytes(bytes, 0, totalFloats * 4);
+        // Copy raw bytes (PCM in the output format) directly
+        ba.writeBytes(bytes, 0, totalBytes);
         ba.position = 0;
         return rendered;
         #elseif hl
@@ -501,14 +712,66 @@ class MidiSynth {
         #end
     }
 
+    /**
+     * Render straight into a caller-owned buffer, meant to be allocated once and reused
+     * No allocations or intermediate copies on C++ and HashLink. On HTML5 the audio is copied
+     * out of the WASM heap once, use renderView to read it in place instead.
+     * @param buffer Output bytes in the output format (see setOutputFormat), at least frameCount frames
+     * @param frameCount Number of frames to render
+     * @return Number of frames rendered
+     */
+    public function renderInto(buffer:HaxeBytes, frameCount:Int):Int {
+        if (frameCount <= 0 || buffer.length < frameCount * getBytesPerFrame()) return 0;
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", buffer);
+        return MidiSynthNative.render(handle, ptr, frameCount);
+        #elseif hl
+        // HashLink's GC doesn't move objects, so the bytes can be written in place
+        return tsf_render(handle, @:privateAccess buffer.b, frameCount);
+        #elseif js
+        if (handle != 0) {
+            var audioData:Dynamic = untyped glue.renderView(handle, frameCount, channels);
+            if (audioData != null) {
+                copyToTarget(audioData, buffer);
+                return frameCount;
+            }
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    #if js
+    /**
+     * Render into a persistent buffer in the WASM heap without allocating or copying
+     * @param frameCount Number of frames to render
+     * @return View of the rendered audio (Float32, interleaved or planar), only valid until the
+     *         next render, renderView or readStream call; null for the int16 formats, use renderInto
+     */
+    public function renderView(frameCount:Int):Float32Array {
+        if (handle == 0 || frameCount <= 0 || getBytesPerFrame() != channels * 4) return null;
+        return untyped glue.renderView(handle, frameCount, channels);
+    }
+    
+    // Copies rendered audio (a Float32Array or Int16Array view) into the bytes, reusing the byte views
+    private function copyToTarget(audioData:Dynamic, buffer:HaxeBytes):Void {
+        if (sourceView != audioData) {
+            sourceView = audioData;
+            sourceBytes = new Uint8Array(audioData.buffer, audioData.byteOffset, audioData.byteLength);
+        }
+        if (targetBytes == null || targetBytes.buffer != buffer.getData()) targetBytes = new Uint8Array(buffer.getData(), 0, buffer.length);
+        targetBytes.set(sourceBytes);
+    }
+    #end
+
     #if cpp
     /**
      * Render audio samples to Bytes (C++ fast path)
      */
     public function renderBytes(sampleCount:Int):HaxeBytes {
         if (sampleCount <= 0) return HaxeBytes.alloc(0);
-        var totalFloats = sampleCount * channels;
-        var bytes:HaxeBytes = HaxeBytes.alloc(totalFloats * 4);
+        var bytes:HaxeBytes = HaxeBytes.alloc(sampleCount * getBytesPerFrame());
         // Get raw pointer to Bytes data using hxcpp API
         var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", bytes);
         var rendered:Int = MidiSynthNative.render(handle, ptr, sampleCount);
@@ -517,6 +780,67 @@ class MidiSynth {
     }
     #end
     
+    /**
+     * Route MIDI channels to the buses of renderBuses (by default one bus per channel, 16 buses)
+     * @param channelBus Bus (0 to busCount - 1) of each of the 16 MIDI channels, null = bus n for channel n
+     * @param busCount Number of buses (1-16)
+     */
+    public function setBusMap(channelBus:Array<Int>, busCount:Int):Void {
+        this.busCount = busCount < 1 ? 1 : (busCount > 16 ? 16 : busCount);
+        #if (cpp || hl)
+        var map:HaxeBytes = null;
+        if (channelBus != null) {
+            map = HaxeBytes.alloc(16);
+            for (i in 0...16) map.set(i, i < channelBus.length ? channelBus[i] : 0);
+        }
+        #end
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = map != null ? untyped __cpp__("(void*)({0}->b->GetBase())", map) : null;
+        MidiSynthNative.setBusMap(handle, ptr, busCount);
+        #elseif hl
+        tsf_set_bus_map(handle, map != null ? @:privateAccess map.b : null, busCount);
+        #elseif js
+        if (isReady && handle != 0) {
+            untyped glue.setBusMap(handle, channelBus, busCount);
+        } else {
+            // Defer until ready
+            readyCallbacks.push(function() {
+                untyped glue.setBusMap(handle, channelBus, busCount);
+            });
+        }
+        #end
+    }
+    
+    /**
+     * Render every bus (see setBusMap) into its own block of the buffer in a single pass over the
+     * voices, e.g. to process the parts of a song separately
+     * @param buffer Output bytes, busCount blocks of frameCount frames one after the other, each
+     *               Float32 interleaved stereo if channels=2 whatever the output format
+     * @param frameCount Number of frames to render per bus
+     * @return Bit mask of the buses with voices playing (bit n = bus n), the other blocks are silent
+     *         and can be skipped; 0 while the stream is running
+     */
+    public function renderBuses(buffer:HaxeBytes, frameCount:Int):Int {
+        if (frameCount <= 0 || buffer.length < frameCount * channels * 4 * busCount) return 0;
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", buffer);
+        return MidiSynthNative.renderBuses(handle, ptr, frameCount);
+        #elseif hl
+        return tsf_render_buses(handle, @:privateAccess buffer.b, frameCount);
+        #elseif js
+        if (handle != 0) {
+            var audioData:Float32Array = untyped glue.renderBusesView(handle, frameCount, channels, busCount);
+            if (audioData != null) {
+                copyToTarget(audioData, buffer);
+                return untyped glue.getActiveBuses();
+            }
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
     /**
      * Get the number of currently active voices
      * @return Active voice count
@@ -536,6 +860,845 @@ class MidiSynth {
         #end
     }
     
+    /**
+     * Render voices on multiple threads
+     * Voices are spread over a persistent worker pool, the output is identical for any thread count >= 1.
+     * HTML5 builds without WebAssembly threads always render serially.
+     * @param threadCount Number of render threads including the audio thread (1-16), 0 to render serially
+     * @return Number of render threads in use (0 = serial)
+     */
+    public function setRenderThreads(threadCount:Int):Int {
+        #if cpp
+        return MidiSynthNative.setRenderThreads(handle, threadCount);
+        #elseif hl
+        return tsf_set_render_threads(handle, threadCount);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.setRenderThreads(handle, threadCount);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Limit the number of voices sounding at once and preallocate them
+     * Past the limit a new note fades out the least important voice instead of allocating one:
+     * voices of lower priority channels first (see setChannelPriority), then quiet, released and
+     * older ones. A note is only dropped when all voices belong to higher priority channels.
+     * A SoundFont note can start several voices. The limit can only be raised once set.
+     * @param maxVoices Voice limit (> 0)
+     * @return True if the voices were allocated
+     */
+    public function setMaxVoices(maxVoices:Int):Bool {
+        #if cpp
+        return MidiSynthNative.setMaxVoices(handle, maxVoices) != 0;
+        #elseif hl
+        return tsf_set_max_voices(handle, maxVoices);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.setMaxVoices(handle, maxVoices);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Limit the voices of a channel, notes over the limit fade out one of the channel's voices
+     * @param channel MIDI channel (0-15)
+     * @param maxVoices Voice limit, 0 = no limit (default)
+     */
+    public function setChannelPolyphony(channel:Int, maxVoices:Int):Void {
+        #if cpp
+        MidiSynthNative.channelSetPolyphony(handle, channel, maxVoices);
+        #elseif hl
+        tsf_channel_set_polyphony(handle, channel, maxVoices);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.channelSetPolyphony(handle, channel, maxVoices);
+        }
+        #end
+    }
+    
+    /**
+     * Set how important a channel's voices are when voices are stolen, e.g. drums and lead above pads
+     * @param channel MIDI channel (0-15)
+     * @param priority 0 (stolen first) to 127 (stolen last), default 64
+     */
+    public function setChannelPriority(channel:Int, priority:Int):Void {
+        #if cpp
+        MidiSynthNative.channelSetPriority(handle, channel, priority);
+        #elseif hl
+        tsf_channel_set_priority(handle, channel, priority);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.channelSetPriority(handle, channel, priority);
+        }
+        #end
+    }
+    
+    /**
+     * Keep rendering below a fraction of real time, e.g. 0.5 = half of the audio duration
+     * When a render takes longer, the governor lowers the quality step by step: effects every 128,
+     * then 256 (static filters) and 512 frames (nearest-sample resampling), filters off, and at the
+     * last level it fades out the least important voices. Quality comes back once the load stays
+     * low for a second of audio.
+     * @param budget Fraction of real time, 0 = off (full quality)
+     */
+    public function setCpuBudget(budget:Float):Void {
+        #if cpp
+        MidiSynthNative.setCpuBudget(handle, budget);
+        #elseif hl
+        tsf_set_cpu_budget(handle, budget);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.setCpuBudget(handle, budget);
+        }
+        #end
+    }
+    
+    /**
+     * Get what the CPU budget governor measured and decided, safe to call from any thread
+     * @param stats Instance to fill, null to allocate one
+     * @return stats with the statistics as of the last render
+     */
+    public function getGovernorStats(?stats:GovernorStats):GovernorStats {
+        if (stats == null) stats = new GovernorStats();
+        #if cpp
+        MidiSynthNative.getGovernorStats(handle, untyped __cpp__("(void*)({0}->b->GetBase())", stats.bytes));
+        #elseif hl
+        tsf_get_governor_stats(handle, @:privateAccess stats.bytes.b);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.getGovernorStats(handle, new Uint8Array(stats.bytes.getData(), 0, GovernorStats.SIZE));
+        }
+        #end
+        return stats;
+    }
+    
+    /**
+     * Stop rendering voices too quiet to hear, e.g. long release tails and notes held by the
+     * sustain pedal that decayed to nearly nothing. Their envelopes, LFOs and sample positions keep
+     * moving, so they continue seamlessly when they get louder again (e.g. channel volume rises).
+     * Released voices that would stay below the threshold even at full channel volume are freed.
+     * @param thresholdDb Level below which voices aren't rendered, e.g. -90 (dB relative to full scale), 0 = off
+     */
+    public function setVoiceVirtualization(thresholdDb:Float):Void {
+        #if cpp
+        MidiSynthNative.setVoiceVirtualization(handle, thresholdDb);
+        #elseif hl
+        tsf_set_voice_virtualization(handle, thresholdDb);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.setVoiceVirtualization(handle, thresholdDb);
+        }
+        #end
+    }
+    
+    /**
+     * Cache the audio of phrases played with playPhrase, so repeated patterns are mixed instead of rendered.
+     * Each phrase plays on voices of its own, starting from silence with a copy of its channels. The
+     * first play records it including its release tail, later plays of the same phrase with the same
+     * channel state (preset, controllers, pitch, volume, pan) are mixed from the recording. A channel
+     * change while a phrase plays reaches the phrase as well and switches it to rendering from where it is.
+     * Must not be called while another thread renders; changing the budget clears the cache.
+     * @param maxBytes Memory the cached audio may take, 0 = off (default); the least recently played phrases are dropped to make room
+     * @return false if the phrase players couldn't be allocated
+     */
+    public function setPhraseCache(maxBytes:Int):Bool {
+        #if cpp
+        return MidiSynthNative.setPhraseCache(handle, maxBytes) != 0;
+        #elseif hl
+        return tsf_set_phrase_cache(handle, maxBytes);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.setPhraseCache(handle, maxBytes);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Define a phrase to play with playPhrase, e.g. a bar of a drum pattern or an arpeggio
+     * Notes still held at the end of the phrase are released there. Controller, program and pitch
+     * bend events of a phrase only change its own copy of the channel when it plays on voices of its
+     * own, but the synth's channel when it's scheduled, so a phrase should leave its channels as it found them.
+     * @param batch Events with frame offsets from the start of the phrase (NOW = 0), the batch can be reused afterwards
+     * @param lengthFrames End of the phrase in frames, later events are dropped; <= 0 = the last event
+     * @return Phrase id, -1 if all MidiSynth.MAX_PHRASES ids are in use
+     */
+    public function definePhrase(batch:MidiEventBatch, lengthFrames:Int = 0):Int {
+        if (batch.length == 0) return -1;
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", batch.bytes);
+        return MidiSynthNative.phraseDefine(handle, ptr, batch.length, lengthFrames);
+        #elseif hl
+        return tsf_phrase_define(handle, @:privateAccess batch.bytes.b, batch.length, lengthFrames);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.phraseDefine(handle, new Uint8Array(batch.bytes.getData()), batch.length, lengthFrames);
+        }
+        return -1;
+        #else
+        return -1;
+        #end
+    }
+    
+    /**
+     * Release a phrase id at the next render, plays that started already play to the end
+     */
+    public function releasePhrase(phrase:Int):Void {
+        #if cpp
+        MidiSynthNative.phraseRelease(handle, phrase);
+        #elseif hl
+        tsf_phrase_release(handle, phrase);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.phraseRelease(handle, phrase);
+        }
+        #end
+    }
+    
+    /**
+     * Play a phrase, without a phrase cache this is the same as scheduling its events
+     * @param phrase Id returned by definePhrase
+     * @param frameOffset Frames after the first frame of the next render (< 0 = right away)
+     * @return false if the command queue is full
+     */
+    public function playPhrase(phrase:Int, frameOffset:Int = -1):Bool {
+        #if cpp
+        return MidiSynthNative.phrasePlay(handle, phrase, frameOffset) != 0;
+        #elseif hl
+        return tsf_phrase_play(handle, phrase, frameOffset);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.phrasePlay(handle, phrase, frameOffset);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Get the phrase cache statistics, safe to call from any thread
+     * @param stats Instance to fill, null to allocate one
+     * @return stats with the statistics as of the last render
+     */
+    public function getPhraseCacheStats(?stats:PhraseCacheStats):PhraseCacheStats {
+        if (stats == null) stats = new PhraseCacheStats();
+        #if cpp
+        MidiSynthNative.getPhraseCacheStats(handle, untyped __cpp__("(void*)({0}->b->GetBase())", stats.bytes));
+        #elseif hl
+        tsf_get_phrase_cache_stats(handle, @:privateAccess stats.bytes.b);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.getPhraseCacheStats(handle, new Uint8Array(stats.bytes.getData(), 0, PhraseCacheStats.SIZE));
+        }
+        #end
+        return stats;
+    }
+    
+    /**
+     * Cache the samples of one-shot drum and percussion notes, so repeated hits are mixed instead of rendered.
+     * Notes of the percussion banks (e.g. channel 9) whose regions don't loop qualify. The first hit of a
+     * note is rendered and recorded, later hits at the same pitch skip resampling and filtering while
+     * velocity, volume, pan and note off apply as before. A pitch bend while a hit plays switches it back
+     * to rendering. The least recently hit notes are dropped to stay within the budget, changing it clears
+     * the cache. The whole budget is allocated here, so playing notes doesn't allocate.
+     * Must not be called while another thread renders.
+     * @param maxBytes Memory the cached samples may take, e.g. 8 * 1024 * 1024, 0 = off (default)
+     * @return false if the cache memory couldn't be allocated
+     */
+    public function setOneshotCache(maxBytes:Int):Bool {
+        #if cpp
+        return MidiSynthNative.setOneshotCache(handle, maxBytes) != 0;
+        #elseif hl
+        return tsf_set_oneshot_cache(handle, maxBytes);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.setOneshotCache(handle, maxBytes);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Schedule an event at a frame offset from the start of the next render call
+     * The render call splits its buffer at scheduled events, so they take effect on the exact
+     * frame independent of the buffer size.
+     * @param frameOffset Frames after the first frame of the next render (<= 0 = right away)
+     * @param type One of the EVENT_* constants
+     * @param channel MIDI channel (0-15)
+     * @param data1 Note, controller, preset or pitch wheel value (see EVENT_*)
+     * @param data2 Velocity, controller value or bank (see EVENT_*)
+     * @return False if the event queue is full
+     */
+    public function scheduleEvent(frameOffset:Int, type:Int, channel:Int, data1:Int, data2:Int = 0):Bool {
+        // Same drum bank rule as setPreset
+        if (type == EVENT_PROGRAM_CHANGE && channel == 9) data2 = 128;
+        #if cpp
+        return MidiSynthNative.scheduleEvent(handle, frameOffset, type, channel, data1, data2) != 0;
+        #elseif hl
+        return tsf_schedule_event(handle, frameOffset, type, channel, data1, data2);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.scheduleEvent(handle, frameOffset, type, channel, data1, data2);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Schedule an event at an absolute sample time (see getSampleTime)
+     * Events in the past take effect at the start of the next render call.
+     * @return False if the event queue is full
+     */
+    public function scheduleEventAt(sampleTime:Float, type:Int, channel:Int, data1:Int, data2:Int = 0):Bool {
+        if (type == EVENT_PROGRAM_CHANGE && channel == 9) data2 = 128;
+        #if cpp
+        return MidiSynthNative.scheduleEventAt(handle, sampleTime, type, channel, data1, data2) != 0;
+        #elseif hl
+        return tsf_schedule_event_at(handle, sampleTime, type, channel, data1, data2);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.scheduleEventAt(handle, sampleTime, type, channel, data1, data2);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Send all events of a batch with a single native call
+     * Much cheaper than one noteOn/scheduleEvent call per event for dense MIDI data.
+     * Events keep their order; ones with a frame offset of MidiEventBatch.NOW take effect
+     * right away, the others like scheduleEvent.
+     * @param batch Events to send, the batch can be cleared and reused afterwards
+     * @return Number of events queued, the rest were dropped because the command queue was full
+     */
+    public function submitEvents(batch:MidiEventBatch):Int {
+        if (batch.length == 0) return 0;
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", batch.bytes);
+        return MidiSynthNative.submitEvents(handle, ptr, batch.length);
+        #elseif hl
+        return tsf_submit_events(handle, @:privateAccess batch.bytes.b, batch.length);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.submitEvents(handle, new Uint8Array(batch.bytes.getData()), batch.length);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Parse a Standard MIDI File (format 0 or 1) natively into packed events
+     * Tracks are merged, the tempo map is applied and event times are converted to sample times
+     * at this synth's sample rate (see MidiSong). Note-ons with velocity 0 become note-offs and
+     * program changes carry the bank from controller 0 (128 on channel 10).
+     * @param data Contents of the .mid file
+     * @return The parsed song, or null if data isn't a valid MIDI file (or the WASM module isn't ready)
+     */
+    public function parseMidi(data:HaxeBytes):MidiSong {
+        if (data == null || data.length == 0) return null;
+        #if cpp
+        var dataPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", data);
+        var size = MidiSynthNative.midiParse(dataPtr, data.length, sampleRate, null, 0);
+        if (size <= 0) return null;
+        var packed = HaxeBytes.alloc(size);
+        var packedPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", packed);
+        if (MidiSynthNative.midiParse(dataPtr, data.length, sampleRate, packedPtr, size) != size) return null;
+        return MidiSong.fromBytes(packed);
+        #elseif hl
+        var size = tsf_midi_parse(@:privateAccess data.b, data.length, sampleRate, null, 0);
+        if (size <= 0) return null;
+        var packed = HaxeBytes.alloc(size);
+        if (tsf_midi_parse(@:privateAccess data.b, data.length, sampleRate, @:privateAccess packed.b, size) != size) return null;
+        return MidiSong.fromBytes(packed);
+        #elseif js
+        if (!isReady) return null;
+        var packed:Uint8Array = untyped glue.midiParse(new Uint8Array(data.getData(), 0, data.length), sampleRate);
+        if (packed == null) return null;
+        return MidiSong.fromBytes(HaxeBytes.ofData(packed.buffer));
+        #else
+        return null;
+        #end
+    }
+
+    /**
+     * Index a parsed song for seekMidi, storing checkpoints of the channel states and sounding
+     * notes in song.index. Seeking then replays at most intervalSeconds of events.
+     * @param song Song from parseMidi
+     * @param intervalSeconds Time between checkpoints, shorter seeks faster but takes more memory
+     * @return False if indexing failed (song.index is then null)
+     */
+    public function indexMidi(song:MidiSong, intervalSeconds:Float = 5):Bool {
+        song.index = null;
+        var interval = Std.int(intervalSeconds * song.sampleRate);
+        if (interval < 1) interval = 1;
+        #if cpp
+        var songPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", song.bytes);
+        var size = MidiSynthNative.midiIndex(songPtr, song.bytes.length, interval, null, 0);
+        if (size <= 0) return false;
+        var index = HaxeBytes.alloc(size);
+        var indexPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", index);
+        if (MidiSynthNative.midiIndex(songPtr, song.bytes.length, interval, indexPtr, size) != size) return false;
+        song.index = index;
+        #elseif hl
+        var size = tsf_midi_index(@:privateAccess song.bytes.b, song.bytes.length, interval, null, 0);
+        if (size <= 0) return false;
+        var index = HaxeBytes.alloc(size);
+        if (tsf_midi_index(@:privateAccess song.bytes.b, song.bytes.length, interval, @:privateAccess index.b, size) != size) return false;
+        song.index = index;
+        #elseif js
+        if (!isReady) return false;
+        var index:Uint8Array = untyped glue.midiIndex(new Uint8Array(song.bytes.getData(), 0, song.bytes.length), interval);
+        if (index == null) return false;
+        song.index = HaxeBytes.ofData(index.buffer);
+        #end
+        return song.index != null;
+    }
+    
+    /**
+     * Jump into a parsed song: set every channel to its state at sampleTime (preset, controllers,
+     * pitch wheel, pedal) and, with restoreNotes, restart the notes that sound there.
+     * What plays now is released first. Uses song.index if indexMidi made one, otherwise replays
+     * the song from the start. The changes are applied at the next render.
+     * @param song Song from parseMidi
+     * @param sampleTime Position in the song in samples at the song's sample rate
+     * @param restoreNotes Also restart the notes held at sampleTime
+     * @return Index of the first event at or after sampleTime to continue playback from, -1 on failure
+     */
+    public function seekMidi(song:MidiSong, sampleTime:Int, restoreNotes:Bool = true):Int {
+        if (sampleTime < 0) sampleTime = 0;
+        var flags = restoreNotes ? 1 : 0;
+        var index = song.index;
+        #if cpp
+        var songPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", song.bytes);
+        var indexPtr:cpp.RawPointer<cpp.Void> = index != null ? untyped __cpp__("(void*)({0}->b->GetBase())", index) : null;
+        return MidiSynthNative.midiSeek(handle, songPtr, song.bytes.length, indexPtr, index != null ? index.length : 0, sampleTime, flags);
+        #elseif hl
+        return tsf_midi_seek(handle, @:privateAccess song.bytes.b, song.bytes.length, index != null ? @:privateAccess index.b : null, index != null ? index.length : 0, sampleTime, flags);
+        #elseif js
+        if (handle != 0) {
+            var indexView = index != null ? new Uint8Array(index.getData(), 0, index.length) : null;
+            return untyped glue.midiSeek(handle, new Uint8Array(song.bytes.getData(), 0, song.bytes.length), indexView, sampleTime, flags);
+        }
+        return -1;
+        #else
+        return -1;
+        #end
+    }
+
+    /**
+     * Load notes into the built-in sequencer, replacing the previous sequence
+     * The notes are copied, the sequence can be reused or cleared afterwards. Playback is
+     * sample-accurate: every note starts and ends on its exact frame inside render.
+     * A playing sequence stops when the new one is picked up at the next render.
+     * @param sequence Notes with start and duration in beats
+     * @param lengthBeats Length of the sequence (and loop), 0 = up to the end of the last note
+     * @return Number of notes loaded
+     */
+    public function loadSequence(sequence:MidiSequence, lengthBeats:Float = 0):Int {
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", sequence.bytes);
+        return MidiSynthNative.sequenceLoad(handle, ptr, sequence.length, lengthBeats);
+        #elseif hl
+        return tsf_sequence_load(handle, @:privateAccess sequence.bytes.b, sequence.length, lengthBeats);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.sequenceLoad(handle, new Uint8Array(sequence.bytes.getData()), sequence.length, lengthBeats);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Start the loaded sequence, from the next render on
+     * Notes that started before startBeat aren't played.
+     * @param startBeat Position to start at in beats
+     */
+    public function startSequence(startBeat:Float = 0):Void {
+        #if cpp
+        MidiSynthNative.sequenceStart(handle, startBeat);
+        #elseif hl
+        tsf_sequence_start(handle, startBeat);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.sequenceStart(handle, startBeat);
+        }
+        #end
+    }
+    
+    /**
+     * Stop the sequence and release the notes it is playing
+     */
+    public function stopSequence():Void {
+        #if cpp
+        MidiSynthNative.sequenceStop(handle);
+        #elseif hl
+        tsf_sequence_stop(handle);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.sequenceStop(handle);
+        }
+        #end
+    }
+    
+    /**
+     * Loop the sequence: at its length it jumps back to beat 0, notes still sounding are released there
+     */
+    public function setSequenceLoop(loop:Bool):Void {
+        #if cpp
+        MidiSynthNative.sequenceSetLoop(handle, loop ? 1 : 0);
+        #elseif hl
+        tsf_sequence_set_loop(handle, loop);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.sequenceSetLoop(handle, loop);
+        }
+        #end
+    }
+    
+    /**
+     * Change the sequence tempo, also while it plays (default 120)
+     * @param bpm Beats per minute
+     */
+    public function setSequenceTempo(bpm:Float):Void {
+        #if cpp
+        MidiSynthNative.sequenceSetTempo(handle, bpm);
+        #elseif hl
+        tsf_sequence_set_tempo(handle, bpm);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.sequenceSetTempo(handle, bpm);
+        }
+        #end
+    }
+    
+    /**
+     * Get the sequence position
+     * @return Beat at the end of the last rendered block
+     */
+    public function getSequenceBeat():Float {
+        #if cpp
+        return MidiSynthNative.sequenceGetBeat(handle);
+        #elseif hl
+        return tsf_sequence_get_beat(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.sequenceGetBeat(handle);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Check whether the sequence is playing, as of the last rendered block
+     * Turns false once a sequence without loop has played its last note-off.
+     */
+    public function isSequencePlaying():Bool {
+        #if cpp
+        return MidiSynthNative.sequencePlaying(handle) != 0;
+        #elseif hl
+        return tsf_sequence_playing(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.sequencePlaying(handle);
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Get the sample clock
+     * @return Frames rendered so far, i.e. the sample time of the next rendered frame
+     */
+    public function getSampleTime():Float {
+        #if cpp
+        return MidiSynthNative.getSampleTime(handle);
+        #elseif hl
+        return tsf_get_sample_time(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.getSampleTime(handle);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Drop all scheduled events that haven't taken effect yet
+     */
+    public function clearEvents():Void {
+        #if cpp
+        MidiSynthNative.clearEvents(handle);
+        #elseif hl
+        tsf_clear_events(handle);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.clearEvents(handle);
+        }
+        #end
+    }
+    
+    /**
+     * Get the number of notes and other commands dropped because the command queue was full
+     * Calls from any thread are queued and applied by the next render, the queue holds 4096 commands.
+     * @return Dropped command count since the synth was created
+     */
+    public function getDroppedCommands():Int {
+        #if cpp
+        return MidiSynthNative.droppedCommands(handle);
+        #elseif hl
+        return tsf_dropped_commands(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.droppedCommands(handle);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Start a native thread that renders ahead into a ring buffer, read with readStream
+     * The audio callback then only copies frames out. Not available in HTML5 builds, where
+     * readStream renders directly instead.
+     * @param targetLatencyFrames Frames kept rendered ahead of the reader
+     * @param blockFrames Frames rendered per pass (0 = 256)
+     * @return Target latency in use, 0 if no thread was started
+     */
+    public function startStream(targetLatencyFrames:Int, blockFrames:Int = 0):Int {
+        #if cpp
+        return MidiSynthNative.streamStart(handle, targetLatencyFrames, blockFrames);
+        #elseif hl
+        return tsf_stream_start(handle, targetLatencyFrames, blockFrames);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.streamStart(handle, targetLatencyFrames, blockFrames);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Stop the render thread started with startStream
+     */
+    public function stopStream():Void {
+        #if cpp
+        MidiSynthNative.streamStop(handle);
+        #elseif hl
+        tsf_stream_stop(handle);
+        #elseif js
+        if (handle != 0) {
+            untyped glue.streamStop(handle);
+        }
+        #end
+    }
+    
+    /**
+     * Change the target latency of the running stream (up to twice the starting latency)
+     * @return Target latency in use, 0 if no stream is running
+     */
+    public function setStreamLatency(targetLatencyFrames:Int):Int {
+        #if cpp
+        return MidiSynthNative.streamSetLatency(handle, targetLatencyFrames);
+        #elseif hl
+        return tsf_stream_set_latency(handle, targetLatencyFrames);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.streamSetLatency(handle, targetLatencyFrames);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Read rendered audio from the stream, missing frames are filled with silence
+     * @param buffer Output bytes in the output format (see setOutputFormat), at least frameCount frames
+     * @param frameCount Number of frames to read
+     * @return Frames that were ready, less than frameCount on an underrun
+     */
+    public function readStream(buffer:HaxeBytes, frameCount:Int):Int {
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", buffer);
+        return MidiSynthNative.streamRead(handle, ptr, frameCount);
+        #elseif hl
+        return tsf_stream_read(handle, @:privateAccess buffer.b, frameCount);
+        #elseif js
+        if (handle != 0) {
+            var audioData:Dynamic = untyped glue.streamReadView(handle, frameCount, channels);
+            if (audioData != null) {
+                copyToTarget(audioData, buffer);
+                return frameCount;
+            }
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Get the number of stream reads that found fewer frames than requested
+     */
+    public function getStreamUnderruns():Int {
+        #if cpp
+        return MidiSynthNative.streamUnderruns(handle);
+        #elseif hl
+        return tsf_stream_underruns(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.streamUnderruns(handle);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Get the number of stream reads that dropped frames after the latency was lowered
+     */
+    public function getStreamOverruns():Int {
+        #if cpp
+        return MidiSynthNative.streamOverruns(handle);
+        #elseif hl
+        return tsf_stream_overruns(handle);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.streamOverruns(handle);
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Save the complete synth state (voices with envelopes, LFOs and filters, channels, scheduled
+     * events, sample clock and sequencer position) into a buffer allocated once and reused.
+     * Call between renders, not while a stream runs. Notes sent since the last render aren't included.
+     * @param buffer Receives the snapshot if it is large enough, null to only get the size
+     * @return Size of the snapshot in bytes (nothing was written if it is larger than buffer), 0 on failure
+     */
+    public function snapshot(buffer:HaxeBytes):Int {
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = buffer != null ? untyped __cpp__("(void*)({0}->b->GetBase())", buffer) : null;
+        return MidiSynthNative.snapshot(handle, ptr, buffer != null ? buffer.length : 0);
+        #elseif hl
+        return tsf_snapshot(handle, buffer != null ? @:privateAccess buffer.b : null, buffer != null ? buffer.length : 0);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.snapshot(handle, buffer != null ? new Uint8Array(buffer.getData(), 0, buffer.length) : new Uint8Array(0));
+        }
+        return 0;
+        #else
+        return 0;
+        #end
+    }
+    
+    /**
+     * Continue from a snapshot: the following renders are bit-identical to the ones after it was taken
+     * The synth must still have the sample rate it had when the snapshot was taken.
+     * Snapshots are only valid while the app runs (they can't be saved to disk).
+     * @param buffer Snapshot from snapshot()
+     * @param size Size returned by snapshot()
+     * @return False if buffer holds no snapshot for this synth
+     */
+    public function restore(buffer:HaxeBytes, size:Int):Bool {
+        if (buffer == null || size > buffer.length) return false;
+        #if cpp
+        var ptr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", buffer);
+        return MidiSynthNative.restore(handle, ptr, size) != 0;
+        #elseif hl
+        return tsf_restore(handle, @:privateAccess buffer.b, size);
+        #elseif js
+        if (handle != 0) {
+            return untyped glue.restore(handle, new Uint8Array(buffer.getData(), 0, size));
+        }
+        return false;
+        #else
+        return false;
+        #end
+    }
+    
+    /**
+     * Render several synths and mix them into one buffer in a single call, e.g. one synth per sound
+     * emitter. Synths created from the same SoundFont path share one copy of it.
+     * Each synth renders what renderInto would render with the Float32 output format.
+     * Synths with a running stream (see startStream) are skipped.
+     * @param synths Synths to mix, all with the same sample rate; null entries are skipped
+     * @param gains Linear gain per synth, null = 1.0 for all
+     * @param pans Pan per synth from 0 (left) to 1 (right), null = 0.5 for all. At 0.5 both sides
+     *             keep their level, towards one side the other side fades out.
+     * @param buffer Output bytes, frameCount frames of Float32 interleaved stereo whatever the output
+     *               format and channel count of the synths
+     * @param frameCount Number of frames to render
+     * @return Number of frames rendered
+     */
+    public static function renderMix(synths:Array<MidiSynth>, gains:Array<Float>, pans:Array<Float>, buffer:HaxeBytes, frameCount:Int):Int {
+        if (frameCount <= 0 || buffer.length < frameCount * 8) return 0;
+        var count = synths.length;
+        #if (cpp || hl)
+        // Gains, then pans, then 8 bytes per handle on C++
+        if (mixParams == null || mixParams.length < count * 16) mixParams = HaxeBytes.alloc(count * 16);
+        for (i in 0...count) {
+            mixParams.setFloat(i * 4, gains != null ? gains[i] : 1.0);
+            mixParams.setFloat((count + i) * 4, pans != null ? pans[i] : 0.5);
+        }
+        #end
+        #if cpp
+        var handles:cpp.RawPointer<cpp.RawPointer<cpp.Void>> = untyped __cpp__("(void**)({0}->b->GetBase() + {1})", mixParams, count * 8);
+        for (i in 0...count) handles[i] = synths[i] != null ? synths[i].handle : null;
+        var base:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", mixParams);
+        var pansPtr:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase() + {1})", mixParams, count * 4);
+        var out:cpp.RawPointer<cpp.Void> = untyped __cpp__("(void*)({0}->b->GetBase())", buffer);
+        return MidiSynthNative.renderMix(cast handles, base, pansPtr, count, out, frameCount, 0);
+        #elseif hl
+        if (mixHandles == null || mixHandles.length < count) mixHandles = new NativeArray<Dynamic>(count);
+        for (i in 0...count) mixHandles[i] = synths[i] != null ? synths[i].handle : null;
+        var params:Bytes = @:privateAccess mixParams.b;
+        return tsf_render_mix(mixHandles, params, params.offset(count * 4), count, @:privateAccess buffer.b, frameCount);
+        #elseif js
+        if (!initialized) return 0;
+        var handles = [for (s in synths) s != null ? s.handle : 0];
+        var audioData:Float32Array = untyped glue.renderMixView(handles, gains, pans, frameCount);
+        if (audioData == null) return 0;
+        new Uint8Array(buffer.getData(), 0, frameCount * 8).set(new Uint8Array(audioData.buffer, audioData.byteOffset, audioData.byteLength));
+        return frameCount;
+        #else
+        return 0;
+        #end
+    }
+    
     /**
      * Clean up and free resources
      */
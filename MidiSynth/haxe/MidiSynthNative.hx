@@ -1,7 +1,7 @@
 
 package;
 
-@:headerCode('extern "C" {\n  void* tsf_bridge_init(const char* path);\n  void tsf_bridge_close(void* handle);\n  void tsf_bridge_set_output(void* handle, int sampleRate, int channels);\n  void tsf_bridge_note_on(void* handle, int channel, int note, int velocity);\n  void tsf_bridge_note_off(void* handle, int channel, int note);\n  void tsf_bridge_set_preset(void* handle, int channel, int bank, int preset);\n  void tsf_bridge_pitch_bend(void* handle, int channel, int pitch_wheel);\n  void tsf_bridge_control_change(void* handle, int channel, int controller, int value);\n  void tsf_bridge_channel_set_volume(void* handle, int channel, float volume);\n  int tsf_bridge_render(void* handle, void* buffer, int sampleCount);\n  void tsf_bridge_note_off_all(void* handle);\n  int tsf_bridge_active_voices(void* handle);\n}\n')
+@:headerCode('extern "C" {\n  void* tsf_bridge_init(const char* path);\n  void tsf_bridge_close(void* handle);\n  void tsf_bridge_set_output(void* handle, int sampleRate, int channels);\n  void tsf_bridge_set_output_format(void* handle, int sampleRate, int channels, int format);\n  void tsf_bridge_note_on(void* handle, int channel, int note, int velocity);\n  void tsf_bridge_note_off(void* handle, int channel, int note);\n  void tsf_bridge_set_preset(void* handle, int channel, int bank, int preset);\n  void tsf_bridge_pitch_bend(void* handle, int channel, int pitch_wheel);\n  void tsf_bridge_control_change(void* handle, int channel, int controller, int value);\n  void tsf_bridge_channel_set_volume(void* handle, int channel, float volume);\n  int tsf_bridge_render(void* handle, void* buffer, int sampleCount);\n  void tsf_bridge_note_off_all(void* handle);\n  int tsf_bridge_active_voices(void* handle);\n  int tsf_bridge_set_render_threads(void* handle, int threadCount);\n  int tsf_bridge_schedule_event(void* handle, int frameOffset, int type, int channel, int data1, int data2);\n  int tsf_bridge_schedule_event_at(void* handle, double sampleTime, int type, int channel, int data1, int data2);\n  int tsf_bridge_submit_events(void* handle, const void* events, int count);\n  void tsf_bridge_set_bus_map(void* handle, const void* channelBus, int busCount);\n  int tsf_bridge_render_buses(void* handle, void* buffer, int sampleCount);\n  double tsf_bridge_get_sample_time(void* handle);\n  void tsf_bridge_clear_events(void* handle);\n  int tsf_bridge_dropped_commands(void* handle);\n  int tsf_bridge_stream_start(void* handle, int targetLatencyFrames, int blockFrames);\n  void tsf_bridge_stream_stop(void* handle);\n  int tsf_bridge_stream_set_latency(void* handle, int targetLatencyFrames);\n  int tsf_bridge_stream_read(void* handle, void* buffer, int sampleCount);\n  int tsf_bridge_stream_underruns(void* handle);\n  int tsf_bridge_stream_overruns(void* handle);\n  int tsf_bridge_midi_parse(const void* data, int size, int sampleRate, void* buffer, int bufferSize);\n  int tsf_bridge_sequence_load(void* handle, const void* notes, int count, double lengthBeats);\n  void tsf_bridge_sequence_start(void* handle, double startBeat);\n  void tsf_bridge_sequence_stop(void* handle);\n  void tsf_bridge_sequence_set_loop(void* handle, int loop);\n  void tsf_bridge_sequence_set_tempo(void* handle, double bpm);\n  double tsf_bridge_sequence_get_beat(void* handle);\n  int tsf_bridge_sequence_playing(void* handle);\n  int tsf_bridge_midi_index(const void* song, int size, int interval, void* index, int indexSize);\n  int tsf_bridge_midi_seek(void* handle, const void* song, int size, const void* index, int indexSize, unsigned int sample, int flags);\n  int tsf_bridge_snapshot(void* handle, void* buffer, int size);\n  int tsf_bridge_restore(void* handle, const void* buffer, int size);\n  int tsf_bridge_render_mix(const void* handles, const void* gains, const void* pans, int count, void* buffer, int sampleCount, int flagMixing);\n  int tsf_bridge_set_max_voices(void* handle, int maxVoices);\n  void tsf_bridge_channel_set_polyphony(void* handle, int channel, int maxVoices);\n  void tsf_bridge_channel_set_priority(void* handle, int channel, int priority);\n  void tsf_bridge_set_cpu_budget(void* handle, float budget);\n  int tsf_bridge_get_governor_stats(void* handle, void* stats);\n  void tsf_bridge_set_voice_virtualization(void* handle, float thresholdDb);\n  int tsf_bridge_set_phrase_cache(void* handle, int maxBytes);\n  int tsf_bridge_phrase_define(void* handle, const void* events, int count, int lengthFrames);\n  void tsf_bridge_phrase_release(void* handle, int phrase);\n  int tsf_bridge_phrase_play(void* handle, int phrase, int frameOffset);\n  int tsf_bridge_get_phrase_cache_stats(void* handle, void* stats);\n  int tsf_bridge_set_oneshot_cache(void* handle, int maxBytes);\n}\n')
 extern class MidiSynthNative {
     @:native("tsf_bridge_channel_set_volume")
     public static function channelSetVolume(handle:cpp.RawPointer<cpp.Void>, channel:Int, volume:Float):Void;
@@ -14,6 +14,9 @@ extern class MidiSynthNative {
     @:native("tsf_bridge_set_output")
     public static function setOutput(handle:cpp.RawPointer<cpp.Void>, sampleRate:Int, channels:Int):Void;
 
+    @:native("tsf_bridge_set_output_format")
+    public static function setOutputFormat(handle:cpp.RawPointer<cpp.Void>, sampleRate:Int, channels:Int, format:Int):Void;
+
     @:native("tsf_bridge_note_on")
     public static function noteOn(handle:cpp.RawPointer<cpp.Void>, channel:Int, note:Int, velocity:Int):Void;
 
@@ -37,5 +40,125 @@ extern class MidiSynthNative {
 
     @:native("tsf_bridge_active_voices")
     public static function activeVoices(handle:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_set_render_threads")
+    public static function setRenderThreads(handle:cpp.RawPointer<cpp.Void>, threadCount:Int):Int;
+
+    @:native("tsf_bridge_schedule_event")
+    public static function scheduleEvent(handle:cpp.RawPointer<cpp.Void>, frameOffset:Int, type:Int, channel:Int, data1:Int, data2:Int):Int;
+
+    @:native("tsf_bridge_schedule_event_at")
+    public static function scheduleEventAt(handle:cpp.RawPointer<cpp.Void>, sampleTime:Float, type:Int, channel:Int, data1:Int, data2:Int):Int;
+
+    @:native("tsf_bridge_submit_events")
+    public static function submitEvents(handle:cpp.RawPointer<cpp.Void>, events:cpp.RawPointer<cpp.Void>, count:Int):Int;
+
+    @:native("tsf_bridge_set_bus_map")
+    public static function setBusMap(handle:cpp.RawPointer<cpp.Void>, channelBus:cpp.RawPointer<cpp.Void>, busCount:Int):Void;
+
+    @:native("tsf_bridge_render_buses")
+    public static function renderBuses(handle:cpp.RawPointer<cpp.Void>, buffer:cpp.RawPointer<cpp.Void>, sampleCount:Int):Int;
+
+    @:native("tsf_bridge_get_sample_time")
+    public static function getSampleTime(handle:cpp.RawPointer<cpp.Void>):Float;
+
+    @:native("tsf_bridge_clear_events")
+    public static function clearEvents(handle:cpp.RawPointer<cpp.Void>):Void;
+
+    @:native("tsf_bridge_dropped_commands")
+    public static function droppedCommands(handle:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_stream_start")
+    public static function streamStart(handle:cpp.RawPointer<cpp.Void>, targetLatencyFrames:Int, blockFrames:Int):Int;
+
+    @:native("tsf_bridge_stream_stop")
+    public static function streamStop(handle:cpp.RawPointer<cpp.Void>):Void;
+
+    @:native("tsf_bridge_stream_set_latency")
+    public static function streamSetLatency(handle:cpp.RawPointer<cpp.Void>, targetLatencyFrames:Int):Int;
+
+    @:native("tsf_bridge_stream_read")
+    public static function streamRead(handle:cpp.RawPointer<cpp.Void>, buffer:cpp.RawPointer<cpp.Void>, sampleCount:Int):Int;
+
+    @:native("tsf_bridge_stream_underruns")
+    public static function streamUnderruns(handle:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_stream_overruns")
+    public static function streamOverruns(handle:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_midi_parse")
+    public static function midiParse(data:cpp.RawPointer<cpp.Void>, size:Int, sampleRate:Int, buffer:cpp.RawPointer<cpp.Void>, bufferSize:Int):Int;
+
+    @:native("tsf_bridge_sequence_load")
+    public static function sequenceLoad(handle:cpp.RawPointer<cpp.Void>, notes:cpp.RawPointer<cpp.Void>, count:Int, lengthBeats:Float):Int;
+
+    @:native("tsf_bridge_sequence_start")
+    public static function sequenceStart(handle:cpp.RawPointer<cpp.Void>, startBeat:Float):Void;
+
+    @:native("tsf_bridge_sequence_stop")
+    public static function sequenceStop(handle:cpp.RawPointer<cpp.Void>):Void;
+
+    @:native("tsf_bridge_sequence_set_loop")
+    public static function sequenceSetLoop(handle:cpp.RawPointer<cpp.Void>, loop:Int):Void;
+
+    @:native("tsf_bridge_sequence_set_tempo")
+    public static function sequenceSetTempo(handle:cpp.RawPointer<cpp.Void>, bpm:Float):Void;
+
+    @:native("tsf_bridge_sequence_get_beat")
+    public static function sequenceGetBeat(handle:cpp.RawPointer<cpp.Void>):Float;
+
+    @:native("tsf_bridge_sequence_playing")
+    public static function sequencePlaying(handle:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_midi_index")
+    public static function midiIndex(song:cpp.RawPointer<cpp.Void>, size:Int, interval:Int, index:cpp.RawPointer<cpp.Void>, indexSize:Int):Int;
+
+    @:native("tsf_bridge_midi_seek")
+    public static function midiSeek(handle:cpp.RawPointer<cpp.Void>, song:cpp.RawPointer<cpp.Void>, size:Int, index:cpp.RawPointer<cpp.Void>, indexSize:Int, sample:Int, flags:Int):Int;
+
+    @:native("tsf_bridge_snapshot")
+    public static function snapshot(handle:cpp.RawPointer<cpp.Void>, buffer:cpp.RawPointer<cpp.Void>, size:Int):Int;
+
+    @:native("tsf_bridge_restore")
+    public static function restore(handle:cpp.RawPointer<cpp.Void>, buffer:cpp.RawPointer<cpp.Void>, size:Int):Int;
+
+    @:native("tsf_bridge_render_mix")
+    public static function renderMix(handles:cpp.RawPointer<cpp.Void>, gains:cpp.RawPointer<cpp.Void>, pans:cpp.RawPointer<cpp.Void>, count:Int, buffer:cpp.RawPointer<cpp.Void>, sampleCount:Int, flagMixing:Int):Int;
+
+    @:native("tsf_bridge_set_max_voices")
+    public static function setMaxVoices(handle:cpp.RawPointer<cpp.Void>, maxVoices:Int):Int;
+
+    @:native("tsf_bridge_channel_set_polyphony")
+    public static function channelSetPolyphony(handle:cpp.RawPointer<cpp.Void>, channel:Int, maxVoices:Int):Void;
+
+    @:native("tsf_bridge_channel_set_priority")
+    public static function channelSetPriority(handle:cpp.RawPointer<cpp.Void>, channel:Int, priority:Int):Void;
+
+    @:native("tsf_bridge_set_cpu_budget")
+    public static function setCpuBudget(handle:cpp.RawPointer<cpp.Void>, budget:Float):Void;
+
+    @:native("tsf_bridge_get_governor_stats")
+    public static function getGovernorStats(handle:cpp.RawPointer<cpp.Void>, stats:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_set_voice_virtualization")
+    public static function setVoiceVirtualization(handle:cpp.RawPointer<cpp.Void>, thresholdDb:Float):Void;
+
+    @:native("tsf_bridge_set_phrase_cache")
+    public static function setPhraseCache(handle:cpp.RawPointer<cpp.Void>, maxBytes:Int):Int;
+
+    @:native("tsf_bridge_phrase_define")
+    public static function phraseDefine(handle:cpp.RawPointer<cpp.Void>, events:cpp.RawPointer<cpp.Void>, count:Int, lengthFrames:Int):Int;
+
+    @:native("tsf_bridge_phrase_release")
+    public static function phraseRelease(handle:cpp.RawPointer<cpp.Void>, phrase:Int):Void;
+
+    @:native("tsf_bridge_phrase_play")
+    public static function phrasePlay(handle:cpp.RawPointer<cpp.Void>, phrase:Int, frameOffset:Int):Int;
+
+    @:native("tsf_bridge_get_phrase_cache_stats")
+    public static function getPhraseCacheStats(handle:cpp.RawPointer<cpp.Void>, stats:cpp.RawPointer<cpp.Void>):Int;
+
+    @:native("tsf_bridge_set_oneshot_cache")
+    public static function setOneshotCache(handle:cpp.RawPointer<cpp.Void>, maxBytes:Int):Int;
 }
 
@@ -0,0 +1,65 @@
+package;
+
+import haxe.io.Bytes;
+
+/**
+ * What the phrase cache holds and how often it was used, see MidiSynth.setPhraseCache
+ * Reuse one instance to poll without allocating:
+ * ```haxe
+ * var stats = new PhraseCacheStats();
+ * synth.getPhraseCacheStats(stats);
+ * trace('${stats.entries} phrases in ${stats.usedBytes} bytes, ${stats.hits} hits, ${stats.misses} misses');
+ * ```
+ */
+class PhraseCacheStats {
+    // Layout of TSFBridgePhraseCacheStats in tsf_bridge.h:
+    // int32 budget, bytes, entries, playing, uint32 hits, misses, stored, evictions, divergences, overflows
+    public static inline var SIZE:Int = 40;
+
+    /** Raw statistics, written by MidiSynth.getPhraseCacheStats */
+    public var bytes(default, null):Bytes;
+
+    public function new() {
+        bytes = Bytes.alloc(SIZE);
+    }
+
+    /** Memory budget in bytes, 0 = cache off */
+    public var budget(get, never):Int;
+    inline function get_budget():Int return bytes.getInt32(0);
+
+    /** Memory used by the cached phrases */
+    public var usedBytes(get, never):Int;
+    inline function get_usedBytes():Int return bytes.getInt32(4);
+
+    /** Phrases cached */
+    public var entries(get, never):Int;
+    inline function get_entries():Int return bytes.getInt32(8);
+
+    /** Phrases playing, from the cache or on voices of their own */
+    public var playing(get, never):Int;
+    inline function get_playing():Int return bytes.getInt32(12);
+
+    /** Plays mixed from the cache */
+    public var hits(get, never):Int;
+    inline function get_hits():Int return bytes.getInt32(16);
+
+    /** Plays rendered, most of them recorded into the cache */
+    public var misses(get, never):Int;
+    inline function get_misses():Int return bytes.getInt32(20);
+
+    /** Recordings added to the cache */
+    public var stored(get, never):Int;
+    inline function get_stored():Int return bytes.getInt32(24);
+
+    /** Cached phrases dropped to stay within the budget */
+    public var evictions(get, never):Int;
+    inline function get_evictions():Int return bytes.getInt32(28);
+
+    /** Plays switched from the cache (or a recording) to rendering by a channel change */
+    public var divergences(get, never):Int;
+    inline function get_divergences():Int return bytes.getInt32(32);
+
+    /** Plays with all phrase players busy, scheduled on the synth's voices instead */
+    public var overflows(get, never):Int;
+    inline function get_overflows():Int return bytes.getInt32(36);
+}
@@ -60,6 +60,14 @@ HL_PRIM void HL_NAME(set_output)(vdynamic* handle, int sample_rate, int channels
 }
 DEFINE_PRIM(_VOID, set_output, _DYN _I32 _I32);
 
+// Set output configuration and sample format (TSF_BRIDGE_FORMAT_*)
+// Haxe signature: function setOutputFormat(handle:TSFHandle, sampleRate:Int, channels:Int, format:Int):Void
+HL_PRIM void HL_NAME(set_output_format)(vdynamic* handle, int sample_rate, int channels, int format) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_set_output_format((TSFHandle)handle->v.ptr, sample_rate, channels, format);
+}
+DEFINE_PRIM(_VOID, set_output_format, _DYN _I32 _I32 _I32);
+
 // Note on
 // Haxe signature: function noteOn(handle:TSFHandle, channel:Int, note:Int, velocity:Int):Void
 HL_PRIM void HL_NAME(note_on)(vdynamic* handle, int channel, int note, int velocity) {
@@ -131,3 +139,375 @@ HL_PRIM void HL_NAME(channel_set_volume)(vdynamic* handle, int channel, double v
     tsf_bridge_channel_set_volume((TSFHandle)handle->v.ptr, channel, (float)volume);
 }
 DEFINE_PRIM(_VOID, channel_set_volume, _DYN _I32 _F64);
+
+// Render voices on multiple threads (0 = serial)
+// Haxe signature: function setRenderThreads(handle:TSFHandle, threadCount:Int):Int
+HL_PRIM int HL_NAME(set_render_threads)(vdynamic* handle, int thread_count) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_set_render_threads((TSFHandle)handle->v.ptr, thread_count);
+}
+DEFINE_PRIM(_I32, set_render_threads, _DYN _I32);
+
+// Schedule an event at a frame offset from the start of the next render
+// Haxe signature: function scheduleEvent(handle:TSFHandle, frameOffset:Int, type:Int, channel:Int, data1:Int, data2:Int):Bool
+HL_PRIM bool HL_NAME(schedule_event)(vdynamic* handle, int frame_offset, int type, int channel, int data1, int data2) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_schedule_event((TSFHandle)handle->v.ptr, frame_offset, type, channel, data1, data2) != 0;
+}
+DEFINE_PRIM(_BOOL, schedule_event, _DYN _I32 _I32 _I32 _I32 _I32);
+
+// Schedule an event at an absolute sample time
+// Haxe signature: function scheduleEventAt(handle:TSFHandle, sampleTime:Float, type:Int, channel:Int, data1:Int, data2:Int):Bool
+HL_PRIM bool HL_NAME(schedule_event_at)(vdynamic* handle, double sample_time, int type, int channel, int data1, int data2) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_schedule_event_at((TSFHandle)handle->v.ptr, sample_time, type, channel, data1, data2) != 0;
+}
+DEFINE_PRIM(_BOOL, schedule_event_at, _DYN _F64 _I32 _I32 _I32 _I32);
+
+// Submit a packed array of 12-byte events (see TSFBridgeEvent) with one call
+// Haxe signature: function submitEvents(handle:TSFHandle, events:hl.Bytes, count:Int):Int
+HL_PRIM int HL_NAME(submit_events)(vdynamic* handle, vbyte* events, int count) {
+    if (!handle || !handle->v.ptr || !events) return 0;
+    return tsf_bridge_submit_events((TSFHandle)handle->v.ptr, (const TSFBridgeEvent*)events, count);
+}
+DEFINE_PRIM(_I32, submit_events, _DYN _BYTES _I32);
+
+// Route the 16 MIDI channels to buses (null = one bus per channel)
+// Haxe signature: function setBusMap(handle:TSFHandle, channelBus:hl.Bytes, busCount:Int):Void
+HL_PRIM void HL_NAME(set_bus_map)(vdynamic* handle, vbyte* channel_bus, int bus_count) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_set_bus_map((TSFHandle)handle->v.ptr, channel_bus, bus_count);
+}
+DEFINE_PRIM(_VOID, set_bus_map, _DYN _BYTES _I32);
+
+// Render every bus into its own block of the buffer, returns the mask of buses with voices playing
+// Haxe signature: function renderBuses(handle:TSFHandle, buffer:hl.Bytes, sampleCount:Int):Int
+HL_PRIM int HL_NAME(render_buses)(vdynamic* handle, vbyte* buffer, int sample_count) {
+    if (!handle || !handle->v.ptr || !buffer) return 0;
+    return tsf_bridge_render_buses((TSFHandle)handle->v.ptr, (float*)buffer, sample_count);
+}
+DEFINE_PRIM(_I32, render_buses, _DYN _BYTES _I32);
+
+// Get the sample clock (frames rendered since init)
+// Haxe signature: function getSampleTime(handle:TSFHandle):Float
+HL_PRIM double HL_NAME(get_sample_time)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return 0.0;
+    return tsf_bridge_get_sample_time((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_F64, get_sample_time, _DYN);
+
+// Drop all scheduled events
+// Haxe signature: function clearEvents(handle:TSFHandle):Void
+HL_PRIM void HL_NAME(clear_events)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_clear_events((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_VOID, clear_events, _DYN);
+
+// Get the number of commands dropped because the command queue was full
+// Haxe signature: function droppedCommands(handle:TSFHandle):Int
+HL_PRIM int HL_NAME(dropped_commands)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_dropped_commands((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_I32, dropped_commands, _DYN);
+
+// Start the render thread feeding the stream ring
+// Haxe signature: function streamStart(handle:TSFHandle, targetLatencyFrames:Int, blockFrames:Int):Int
+HL_PRIM int HL_NAME(stream_start)(vdynamic* handle, int target_latency_frames, int block_frames) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_stream_start((TSFHandle)handle->v.ptr, target_latency_frames, block_frames);
+}
+DEFINE_PRIM(_I32, stream_start, _DYN _I32 _I32);
+
+// Stop the render thread
+// Haxe signature: function streamStop(handle:TSFHandle):Void
+HL_PRIM void HL_NAME(stream_stop)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_stream_stop((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_VOID, stream_stop, _DYN);
+
+// Change the target latency of the running stream
+// Haxe signature: function streamSetLatency(handle:TSFHandle, targetLatencyFrames:Int):Int
+HL_PRIM int HL_NAME(stream_set_latency)(vdynamic* handle, int target_latency_frames) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_stream_set_latency((TSFHandle)handle->v.ptr, target_latency_frames);
+}
+DEFINE_PRIM(_I32, stream_set_latency, _DYN _I32);
+
+// Copy rendered frames out of the stream ring
+// Haxe signature: function streamRead(handle:TSFHandle, buffer:hl.Bytes, sampleCount:Int):Int
+HL_PRIM int HL_NAME(stream_read)(vdynamic* handle, vbyte* buffer, int sample_count) {
+    if (!handle || !handle->v.ptr || !buffer) return 0;
+    return tsf_bridge_stream_read((TSFHandle)handle->v.ptr, buffer, sample_count);
+}
+DEFINE_PRIM(_I32, stream_read, _DYN _BYTES _I32);
+
+// Get the stream underrun count
+// Haxe signature: function streamUnderruns(handle:TSFHandle):Int
+HL_PRIM int HL_NAME(stream_underruns)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_stream_underruns((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_I32, stream_underruns, _DYN);
+
+// Get the stream overrun count
+// Haxe signature: function streamOverruns(handle:TSFHandle):Int
+HL_PRIM int HL_NAME(stream_overruns)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_stream_overruns((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_I32, stream_overruns, _DYN);
+
+// Parse a Standard MIDI File into a packed event array
+// Haxe signature: function midiParse(data:hl.Bytes, size:Int, sampleRate:Int, buffer:hl.Bytes, bufferSize:Int):Int
+HL_PRIM int HL_NAME(midi_parse)(vbyte* data, int size, int sample_rate, vbyte* buffer, int buffer_size) {
+    if (!data) return 0;
+    return tsf_bridge_midi_parse(data, size, sample_rate, buffer, buffer ? buffer_size : 0);
+}
+DEFINE_PRIM(_I32, midi_parse, _BYTES _I32 _I32 _BYTES _I32);
+
+// Load notes for the built-in sequencer
+// Haxe signature: function sequenceLoad(handle:TSFHandle, notes:hl.Bytes, count:Int, lengthBeats:Float):Int
+HL_PRIM int HL_NAME(sequence_load)(vdynamic* handle, vbyte* notes, int count, double length_beats) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_sequence_load((TSFHandle)handle->v.ptr, (const TSFBridgeNote*)notes, notes ? count : 0, length_beats);
+}
+DEFINE_PRIM(_I32, sequence_load, _DYN _BYTES _I32 _F64);
+
+// Start the sequence at a beat
+// Haxe signature: function sequenceStart(handle:TSFHandle, startBeat:Float):Void
+HL_PRIM void HL_NAME(sequence_start)(vdynamic* handle, double start_beat) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_sequence_start((TSFHandle)handle->v.ptr, start_beat);
+}
+DEFINE_PRIM(_VOID, sequence_start, _DYN _F64);
+
+// Stop the sequence and release its notes
+// Haxe signature: function sequenceStop(handle:TSFHandle):Void
+HL_PRIM void HL_NAME(sequence_stop)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_sequence_stop((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_VOID, sequence_stop, _DYN);
+
+// Turn looping of the sequence on or off
+// Haxe signature: function sequenceSetLoop(handle:TSFHandle, loop:Bool):Void
+HL_PRIM void HL_NAME(sequence_set_loop)(vdynamic* handle, bool loop) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_sequence_set_loop((TSFHandle)handle->v.ptr, loop ? 1 : 0);
+}
+DEFINE_PRIM(_VOID, sequence_set_loop, _DYN _BOOL);
+
+// Change the sequence tempo
+// Haxe signature: function sequenceSetTempo(handle:TSFHandle, bpm:Float):Void
+HL_PRIM void HL_NAME(sequence_set_tempo)(vdynamic* handle, double bpm) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_sequence_set_tempo((TSFHandle)handle->v.ptr, bpm);
+}
+DEFINE_PRIM(_VOID, sequence_set_tempo, _DYN _F64);
+
+// Get the sequence position in beats
+// Haxe signature: function sequenceGetBeat(handle:TSFHandle):Float
+HL_PRIM double HL_NAME(sequence_get_beat)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return 0.0;
+    return tsf_bridge_sequence_get_beat((TSFHandle)handle->v.ptr);
+}
+DEFINE_PRIM(_F64, sequence_get_beat, _DYN);
+
+// Check whether the sequence is playing
+// Haxe signature: function sequencePlaying(handle:TSFHandle):Bool
+HL_PRIM bool HL_NAME(sequence_playing)(vdynamic* handle) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_sequence_playing((TSFHandle)handle->v.ptr) != 0;
+}
+DEFINE_PRIM(_BOOL, sequence_playing, _DYN);
+
+// Index a parsed MIDI file with checkpoints, call with a null index first to get the size
+// Haxe signature: function midiIndex(song:hl.Bytes, size:Int, interval:Int, index:hl.Bytes, indexSize:Int):Int
+HL_PRIM int HL_NAME(midi_index)(vbyte* song, int size, int interval, vbyte* index, int index_size) {
+    if (!song) return 0;
+    return tsf_bridge_midi_index(song, size, interval, index, index ? index_size : 0);
+}
+DEFINE_PRIM(_I32, midi_index, _BYTES _I32 _I32 _BYTES _I32);
+
+// Restore the state of a parsed MIDI file at a sample time, index is optional
+// Haxe signature: function midiSeek(handle:TSFHandle, song:hl.Bytes, size:Int, index:hl.Bytes, indexSize:Int, sample:Int, flags:Int):Int
+HL_PRIM int HL_NAME(midi_seek)(vdynamic* handle, vbyte* song, int size, vbyte* index, int index_size, int sample, int flags) {
+    if (!handle || !handle->v.ptr || !song) return -1;
+    return tsf_bridge_midi_seek((TSFHandle)handle->v.ptr, song, size, index, index ? index_size : 0, (unsigned int)sample, flags);
+}
+DEFINE_PRIM(_I32, midi_seek, _DYN _BYTES _I32 _BYTES _I32 _I32 _I32);
+
+// Save the complete synth state, call with a null buffer first to get the size
+// Haxe signature: function snapshot(handle:TSFHandle, buffer:hl.Bytes, size:Int):Int
+HL_PRIM int HL_NAME(snapshot)(vdynamic* handle, vbyte* buffer, int size) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_snapshot((TSFHandle)handle->v.ptr, buffer, buffer ? size : 0);
+}
+DEFINE_PRIM(_I32, snapshot, _DYN _BYTES _I32);
+
+// Continue from a snapshot
+// Haxe signature: function restore(handle:TSFHandle, buffer:hl.Bytes, size:Int):Bool
+HL_PRIM bool HL_NAME(restore)(vdynamic* handle, vbyte* buffer, int size) {
+    if (!handle || !handle->v.ptr || !buffer) return false;
+    return tsf_bridge_restore((TSFHandle)handle->v.ptr, buffer, size) != 0;
+}
+DEFINE_PRIM(_BOOL, restore, _DYN _BYTES _I32);
+
+// Take a reference to the font registered under name, null if there is none
+// Haxe signature: function fontFind(name:hl.Bytes):TSFFontHandle
+HL_PRIM vdynamic* HL_NAME(font_find)(vbyte* name) {
+    TSFFontHandle font = tsf_bridge_font_find((const char*)name);
+    if (!font) return NULL;
+    
+    vdynamic* dyn = hl_alloc_dynamic(&hlt_dyn);
+    dyn->v.ptr = font;
+    return dyn;
+}
+DEFINE_PRIM(_DYN, font_find, _BYTES);
+
+// Load a SoundFont from memory and register it under name (or take a reference if it is registered)
+// Haxe signature: function fontLoadMemory(name:hl.Bytes, buffer:hl.Bytes, size:Int):TSFFontHandle
+HL_PRIM vdynamic* HL_NAME(font_load_memory)(vbyte* name, vbyte* buffer, int size) {
+    TSFFontHandle font = tsf_bridge_font_load_memory((const char*)name, buffer, size);
+    if (!font) return NULL;
+    
+    vdynamic* dyn = hl_alloc_dynamic(&hlt_dyn);
+    dyn->v.ptr = font;
+    return dyn;
+}
+DEFINE_PRIM(_DYN, font_load_memory, _BYTES _BYTES _I32);
+
+// Release a font reference
+// Haxe signature: function fontRelease(font:TSFFontHandle):Void
+HL_PRIM void HL_NAME(font_release)(vdynamic* font) {
+    if (!font || !font->v.ptr) return;
+    tsf_bridge_font_release((TSFFontHandle)font->v.ptr);
+    font->v.ptr = NULL;
+}
+DEFINE_PRIM(_VOID, font_release, _DYN);
+
+// Initialize a synthesizer playing a loaded font
+// Haxe signature: function initFont(font:TSFFontHandle):TSFHandle
+HL_PRIM vdynamic* HL_NAME(init_font)(vdynamic* font) {
+    if (!font || !font->v.ptr) return NULL;
+    TSFHandle handle = tsf_bridge_init_font((TSFFontHandle)font->v.ptr);
+    if (!handle) return NULL;
+    
+    vdynamic* dyn = hl_alloc_dynamic(&hlt_dyn);
+    dyn->v.ptr = handle;
+    return dyn;
+}
+DEFINE_PRIM(_DYN, init_font, _DYN);
+
+// Render several synthesizers and mix them into one float32 interleaved stereo buffer
+// Haxe signature: function renderMix(handles:hl.NativeArray<TSFHandle>, gains:hl.Bytes, pans:hl.Bytes, count:Int, buffer:hl.Bytes, sampleCount:Int):Int
+HL_PRIM int HL_NAME(render_mix)(varray* handles, vbyte* gains, vbyte* pans, int count, vbyte* buffer, int sample_count) {
+    if (!handles || !buffer || count < 0 || count > handles->size) return 0;
+    
+    // Passed on in groups, the later groups are mixed into the output of the first
+    TSFHandle group[64];
+    vdynamic** items = hl_aptr(handles, vdynamic*);
+    int mixing = 0;
+    for (int first = 0; first < count || !mixing; first += 64) {
+        int n = (count - first < 64) ? count - first : 64;
+        for (int i = 0; i < n; i++) group[i] = items[first + i] ? items[first + i]->v.ptr : NULL;
+        tsf_bridge_render_mix(group, gains ? (const float*)gains + first : NULL, pans ? (const float*)pans + first : NULL,
+            n, (float*)buffer, sample_count, mixing);
+        mixing = 1;
+    }
+    return sample_count;
+}
+DEFINE_PRIM(_I32, render_mix, _ARR _BYTES _BYTES _I32 _BYTES _I32);
+
+// Limit the voices sounding at once, new notes steal the least important voice
+// Haxe signature: function setMaxVoices(handle:TSFHandle, maxVoices:Int):Bool
+HL_PRIM bool HL_NAME(set_max_voices)(vdynamic* handle, int max_voices) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_set_max_voices((TSFHandle)handle->v.ptr, max_voices) != 0;
+}
+DEFINE_PRIM(_BOOL, set_max_voices, _DYN _I32);
+
+// Haxe signature: function channelSetPolyphony(handle:TSFHandle, channel:Int, maxVoices:Int):Void
+HL_PRIM void HL_NAME(channel_set_polyphony)(vdynamic* handle, int channel, int max_voices) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_channel_set_polyphony((TSFHandle)handle->v.ptr, channel, max_voices);
+}
+DEFINE_PRIM(_VOID, channel_set_polyphony, _DYN _I32 _I32);
+
+// Haxe signature: function channelSetPriority(handle:TSFHandle, channel:Int, priority:Int):Void
+HL_PRIM void HL_NAME(channel_set_priority)(vdynamic* handle, int channel, int priority) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_channel_set_priority((TSFHandle)handle->v.ptr, channel, priority);
+}
+DEFINE_PRIM(_VOID, channel_set_priority, _DYN _I32 _I32);
+
+// Keep the render time below a fraction of the audio duration (0 = off)
+// Haxe signature: function setCpuBudget(handle:TSFHandle, budget:Float):Void
+HL_PRIM void HL_NAME(set_cpu_budget)(vdynamic* handle, double budget) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_set_cpu_budget((TSFHandle)handle->v.ptr, (float)budget);
+}
+DEFINE_PRIM(_VOID, set_cpu_budget, _DYN _F64);
+
+// Haxe signature: function getGovernorStats(handle:TSFHandle, stats:hl.Bytes):Int
+HL_PRIM int HL_NAME(get_governor_stats)(vdynamic* handle, vbyte* stats) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_get_governor_stats((TSFHandle)handle->v.ptr, (TSFBridgeGovernorStats*)stats);
+}
+DEFINE_PRIM(_I32, get_governor_stats, _DYN _BYTES);
+
+// Stop rendering voices quieter than thresholdDb, 0 = off
+// Haxe signature: function setVoiceVirtualization(handle:TSFHandle, thresholdDb:Float):Void
+HL_PRIM void HL_NAME(set_voice_virtualization)(vdynamic* handle, double threshold_db) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_set_voice_virtualization((TSFHandle)handle->v.ptr, (float)threshold_db);
+}
+DEFINE_PRIM(_VOID, set_voice_virtualization, _DYN _F64);
+
+// Cache the audio of phrases up to maxBytes, 0 = off
+// Haxe signature: function setPhraseCache(handle:TSFHandle, maxBytes:Int):Bool
+HL_PRIM bool HL_NAME(set_phrase_cache)(vdynamic* handle, int max_bytes) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_set_phrase_cache((TSFHandle)handle->v.ptr, max_bytes) != 0;
+}
+DEFINE_PRIM(_BOOL, set_phrase_cache, _DYN _I32);
+
+// Define a phrase from a packed array of 12-byte events (see TSFBridgeEvent), returns its id or -1
+// Haxe signature: function phraseDefine(handle:TSFHandle, events:hl.Bytes, count:Int, lengthFrames:Int):Int
+HL_PRIM int HL_NAME(phrase_define)(vdynamic* handle, vbyte* events, int count, int length_frames) {
+    if (!handle || !handle->v.ptr || !events) return -1;
+    return tsf_bridge_phrase_define((TSFHandle)handle->v.ptr, (const TSFBridgeEvent*)events, count, length_frames);
+}
+DEFINE_PRIM(_I32, phrase_define, _DYN _BYTES _I32 _I32);
+
+// Haxe signature: function phraseRelease(handle:TSFHandle, phrase:Int):Void
+HL_PRIM void HL_NAME(phrase_release)(vdynamic* handle, int phrase) {
+    if (!handle || !handle->v.ptr) return;
+    tsf_bridge_phrase_release((TSFHandle)handle->v.ptr, phrase);
+}
+DEFINE_PRIM(_VOID, phrase_release, _DYN _I32);
+
+// Haxe signature: function phrasePlay(handle:TSFHandle, phrase:Int, frameOffset:Int):Bool
+HL_PRIM bool HL_NAME(phrase_play)(vdynamic* handle, int phrase, int frame_offset) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_phrase_play((TSFHandle)handle->v.ptr, phrase, frame_offset) != 0;
+}
+DEFINE_PRIM(_BOOL, phrase_play, _DYN _I32 _I32);
+
+// Haxe signature: function getPhraseCacheStats(handle:TSFHandle, stats:hl.Bytes):Int
+HL_PRIM int HL_NAME(get_phrase_cache_stats)(vdynamic* handle, vbyte* stats) {
+    if (!handle || !handle->v.ptr) return 0;
+    return tsf_bridge_get_phrase_cache_stats((TSFHandle)handle->v.ptr, (TSFBridgePhraseCacheStats*)stats);
+}
+DEFINE_PRIM(_I32, get_phrase_cache_stats, _DYN _BYTES);
+
+// Cache the samples of one-shot percussion notes up to maxBytes, 0 = off
+// Haxe signature: function setOneshotCache(handle:TSFHandle, maxBytes:Int):Bool
+HL_PRIM bool HL_NAME(set_oneshot_cache)(vdynamic* handle, int max_bytes) {
+    if (!handle || !handle->v.ptr) return false;
+    return tsf_bridge_set_oneshot_cache((TSFHandle)handle->v.ptr, max_bytes) != 0;
+}
+DEFINE_PRIM(_BOOL, set_oneshot_cache, _DYN _I32);
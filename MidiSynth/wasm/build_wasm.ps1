@@ -21,12 +21,14 @@ if (-not (Get-Command emcc -ErrorAction SilentlyContinue)) {
 
 Write-Host "`nBuilding TinySoundFont WASM..." -ForegroundColor Cyan
 
-emcc tsf_wasm.cpp `
+emcc tsf_wasm.cpp ..\cpp\tsf_bridge.cpp `
     -I..\cpp `
     -I..\cpp\tsf `
     -O3 `
+    -msimd128 `
+    -DTSF_BRIDGE_GAIN_DB=0 `
     -s WASM=1 `
-    -s "EXPORTED_FUNCTIONS=['_wasm_tsf_init_memory','_wasm_tsf_close','_wasm_tsf_set_output','_wasm_tsf_note_on','_wasm_tsf_note_off','_wasm_tsf_set_preset','_wasm_tsf_render','_wasm_tsf_note_off_all','_wasm_tsf_active_voices','_malloc','_free']" `
+    -s "EXPORTED_FUNCTIONS=['_wasm_tsf_init_memory','_wasm_tsf_close','_wasm_tsf_set_output','_wasm_tsf_set_output_format','_wasm_tsf_note_on','_wasm_tsf_note_off','_wasm_tsf_set_preset','_wasm_tsf_render','_wasm_tsf_note_off_all','_wasm_tsf_active_voices','_wasm_tsf_set_render_threads','_wasm_tsf_schedule_event','_wasm_tsf_schedule_event_at','_wasm_tsf_submit_events','_wasm_tsf_set_bus_map','_wasm_tsf_render_buses','_wasm_tsf_get_sample_time','_wasm_tsf_clear_events','_wasm_tsf_dropped_commands','_wasm_tsf_stream_start','_wasm_tsf_stream_stop','_wasm_tsf_stream_set_latency','_wasm_tsf_stream_read','_wasm_tsf_stream_underruns','_wasm_tsf_stream_overruns','_wasm_tsf_midi_parse','_wasm_tsf_sequence_load','_wasm_tsf_sequence_start','_wasm_tsf_sequence_stop','_wasm_tsf_sequence_set_loop','_wasm_tsf_sequence_set_tempo','_wasm_tsf_sequence_get_beat','_wasm_tsf_sequence_playing','_wasm_tsf_midi_index','_wasm_tsf_midi_seek','_wasm_tsf_snapshot','_wasm_tsf_restore','_wasm_tsf_font_find','_wasm_tsf_font_load_memory','_wasm_tsf_font_release','_wasm_tsf_init_font','_wasm_tsf_render_mix','_wasm_tsf_set_max_voices','_wasm_tsf_channel_set_polyphony','_wasm_tsf_channel_set_priority','_wasm_tsf_set_cpu_budget','_wasm_tsf_get_governor_stats','_wasm_tsf_set_voice_virtualization','_wasm_tsf_set_phrase_cache','_wasm_tsf_phrase_define','_wasm_tsf_phrase_release','_wasm_tsf_phrase_play','_wasm_tsf_get_phrase_cache_stats','_wasm_tsf_set_oneshot_cache','_malloc','_free']" `
     -s "EXPORTED_RUNTIME_METHODS=['ccall','cwrap','getValue','setValue']" `
     -s ALLOW_MEMORY_GROWTH=1 `
     -s MODULARIZE=1 `
@@ -11,6 +11,108 @@ var TSFGlue = (function() {
     var sf2BufferPtr = null;
     var sf2BufferSize = 0;
     
+    // WASM heap buffer reused by submitEvents and phraseDefine, grown as needed
+    var eventBufferPtr = 0;
+    var eventBufferSize = 0;
+    
+    // WASM heap buffer reused by all render calls, grown as needed
+    var renderBufferPtr = 0;
+    var renderBufferFloats = 0;
+    
+    // Float32Array or Int16Array view over the render buffer handed out by renderView / streamReadView
+    var renderView = null;
+    
+    // 16-byte WASM heap buffer for setBusMap
+    var busMapPtr = 0;
+    
+    // Float32Array view over the render buffer handed out by renderBusesView, and its bus mask
+    var busView = null;
+    var activeBuses = 0;
+    
+    // WASM heap buffer for the handles, gains and pans of renderMixView, and its capacity in instances
+    var mixParamsPtr = 0;
+    var mixParamsCount = 0;
+    var mixView = null;
+    
+    // Output format (TSF_BRIDGE_FORMAT_*) per synth handle, missing = 0 (interleaved float)
+    var outputFormats = {};
+    var FORMAT_INT16 = 2;
+    var FORMAT_INT16_DITHER = 3;
+    
+    // Current Float32Array view of the whole WASM heap (replaced when the memory grows)
+    function getHeapF32() {
+        if (module.HEAPF32 && module.HEAPF32.buffer.byteLength > 0) return module.HEAPF32;
+        if (module.wasmMemory && module.wasmMemory.buffer) return new Float32Array(module.wasmMemory.buffer);
+        if (module.asm && module.asm.memory && module.asm.memory.buffer) return new Float32Array(module.asm.memory.buffer);
+        return null;
+    }
+    
+    // Returns a heap pointer with room for totalFloats floats, 0 on failure
+    function reserveRenderBuffer(totalFloats) {
+        if (totalFloats > renderBufferFloats) {
+            if (renderBufferPtr) module._free(renderBufferPtr);
+            renderBufferFloats = 0;
+            renderView = null;
+            renderBufferPtr = module._malloc(totalFloats * 4); // 4 bytes per float
+            if (renderBufferPtr === 0) {
+                console.error("Failed to allocate render buffer");
+                return 0;
+            }
+            renderBufferFloats = totalFloats;
+        }
+        return renderBufferPtr;
+    }
+    
+    // Copies count packed 12-byte events (Uint8Array) into the event buffer
+    // Returns its heap pointer, 0 on failure
+    function copyEvents(events, count) {
+        var size = count * 12;
+        if (size > eventBufferSize) {
+            if (eventBufferPtr) module._free(eventBufferPtr);
+            eventBufferSize = 0;
+            eventBufferPtr = module._malloc(size);
+            if (eventBufferPtr === 0) {
+                console.error("Failed to allocate event buffer");
+                return 0;
+            }
+            eventBufferSize = size;
+        }
+        module.HEAPU8.set(events.subarray(0, size), eventBufferPtr);
+        return eventBufferPtr;
+    }
+    
+    // Render into the persistent WASM heap buffer with renderFn
+    // Returns a view of the rendered samples, valid until the next render call:
+    // Int16Array for the int16 output formats, otherwise Float32Array
+    function renderToView(renderFn, handle, sampleCount, channels) {
+        var totalSamples = sampleCount * (channels || 2);
+        // Sized in floats, int16 samples need half of it
+        var bufferPtr = reserveRenderBuffer(totalSamples);
+        if (bufferPtr === 0) return null;
+        
+        renderFn(handle, bufferPtr, sampleCount);
+        
+        // Reuse the view unless the heap grew (which detaches the old buffer), the size or the format changed
+        var heapF32 = getHeapF32();
+        if (!heapF32) return null;
+        var format = outputFormats[handle] || 0;
+        var viewType = (format === FORMAT_INT16 || format === FORMAT_INT16_DITHER) ? Int16Array : Float32Array;
+        if (!renderView || renderView.buffer !== heapF32.buffer || renderView.length !== totalSamples ||
+            renderView.constructor !== viewType) {
+            renderView = new viewType(heapF32.buffer, bufferPtr, totalSamples);
+        }
+        return renderView;
+    }
+    
+    // Render with renderFn and copy the output out of the WASM heap
+    // Returns Float32Array (or Int16Array, see renderToView) with rendered audio
+    function renderToArray(renderFn, handle, sampleCount) {
+        // Assuming stereo (2 channels)
+        var view = renderToView(renderFn, handle, sampleCount, 2);
+        if (!view) return null;
+        return new view.constructor(view);
+    }
+    
     return {
         // Initialize the WASM module (call once at startup)
         init: function(wasmModule) {
@@ -108,10 +210,41 @@ var TSFGlue = (function() {
             return handle;
         },
         
+        // Initialize a synth playing the font registered under name, loading it from arrayBuffer
+        // (ArrayBuffer or Uint8Array) if it isn't registered yet; instances created with the same
+        // name share one copy of the font
+        // Returns the synth handle, 0 if the font isn't registered and arrayBuffer is null or invalid
+        initShared: function(name, arrayBuffer) {
+            var nameBytes = new TextEncoder().encode(name);
+            var namePtr = module._malloc(nameBytes.length + 1);
+            if (namePtr === 0) return 0;
+            module.HEAPU8.set(nameBytes, namePtr);
+            module.HEAPU8[namePtr + nameBytes.length] = 0;
+            
+            var font = module._wasm_tsf_font_find(namePtr);
+            if (font === 0 && arrayBuffer) {
+                var buffer = (arrayBuffer instanceof Uint8Array) ? arrayBuffer : new Uint8Array(arrayBuffer);
+                var ptr = module._malloc(buffer.length);
+                if (ptr !== 0) {
+                    module.HEAPU8.set(buffer, ptr);
+                    font = module._wasm_tsf_font_load_memory(namePtr, ptr, buffer.length);
+                    module._free(ptr);
+                }
+            }
+            module._free(namePtr);
+            if (font === 0) return 0;
+            
+            // The synth keeps its own reference to the font
+            var handle = module._wasm_tsf_init_font(font);
+            module._wasm_tsf_font_release(font);
+            return handle;
+        },
+        
         // Close and free synthesizer
         close: function(handle) {
             if (handle && handle !== 0) {
                 module._wasm_tsf_close(handle);
+                delete outputFormats[handle];
             }
             if (sf2BufferPtr) {
                 module._free(sf2BufferPtr);
@@ -122,6 +255,15 @@ var TSFGlue = (function() {
         // Set audio output parameters
         setOutput: function(handle, sampleRate, channels) {
             module._wasm_tsf_set_output(handle, sampleRate, channels);
+            delete outputFormats[handle];
+        },
+        
+        // Set audio output parameters and sample format (0 float, 1 planar float, 2 int16, 3 dithered int16)
+        // The render functions return Int16Array instead of Float32Array for the int16 formats
+        setOutputFormat: function(handle, sampleRate, channels, format) {
+            module._wasm_tsf_set_output_format(handle, sampleRate, channels, format);
+            // Unknown formats fall back to float like in the bridge
+            outputFormats[handle] = (format >= 0 && format <= FORMAT_INT16_DITHER) ? format : 0;
         },
         
         // Trigger note on
@@ -152,64 +294,386 @@ var TSFGlue = (function() {
         // Render audio samples
         // Returns Float32Array with rendered audio
         render: function(handle, sampleCount) {
-            // Calculate total floats needed (samples * channels)
-            // Assuming stereo (2 channels)
-            var totalFloats = sampleCount * 2;
-            var bufferPtr = module._malloc(totalFloats * 4); // 4 bytes per float
-            
-            if (bufferPtr === 0) {
-                console.error("Failed to allocate render buffer");
-                return null;
+            return renderToArray(module._wasm_tsf_render, handle, sampleCount);
+        },
+        
+        // Stop all notes
+        noteOffAll: function(handle) {
+            module._wasm_tsf_note_off_all(handle);
+        },
+        
+        // Get active voice count
+        activeVoices: function(handle) {
+            return module._wasm_tsf_active_voices(handle);
+        },
+        
+        // Set the number of render threads (always 0 = serial in the single-threaded WASM build)
+        setRenderThreads: function(handle, threadCount) {
+            return module._wasm_tsf_set_render_threads(handle, threadCount);
+        },
+        
+        // Limit the voices sounding at once, new notes steal the least important voice
+        setMaxVoices: function(handle, maxVoices) {
+            return module._wasm_tsf_set_max_voices(handle, maxVoices) !== 0;
+        },
+        
+        // Limit the voices of a channel (0 = no limit)
+        channelSetPolyphony: function(handle, channel, maxVoices) {
+            module._wasm_tsf_channel_set_polyphony(handle, channel, maxVoices);
+        },
+        
+        // Priority of a channel's voices when voices are stolen, 0 (first) to 127 (last), default 64
+        channelSetPriority: function(handle, channel, priority) {
+            module._wasm_tsf_channel_set_priority(handle, channel, priority);
+        },
+        
+        // Keep the render time below a fraction of the audio duration (0 = off)
+        setCpuBudget: function(handle, budget) {
+            module._wasm_tsf_set_cpu_budget(handle, budget);
+        },
+        
+        // Copy the governor statistics (TSFBridgeGovernorStats, 112 bytes) into buffer (Uint8Array), may be null
+        // Returns the current quality level
+        getGovernorStats: function(handle, buffer) {
+            if (!buffer) return module._wasm_tsf_get_governor_stats(handle, 0);
+            var ptr = module._malloc(112);
+            if (ptr === 0) return module._wasm_tsf_get_governor_stats(handle, 0);
+            var level = module._wasm_tsf_get_governor_stats(handle, ptr);
+            buffer.set(module.HEAPU8.subarray(ptr, ptr + 112));
+            module._free(ptr);
+            return level;
+        },
+        
+        // Stop rendering voices quieter than thresholdDb (e.g. -90), 0 = off
+        setVoiceVirtualization: function(handle, thresholdDb) {
+            module._wasm_tsf_set_voice_virtualization(handle, thresholdDb);
+        },
+        
+        // Cache the audio of phrases played with phrasePlay, up to maxBytes (0 = off)
+        // Returns false if the phrase players couldn't be allocated
+        setPhraseCache: function(handle, maxBytes) {
+            return module._wasm_tsf_set_phrase_cache(handle, maxBytes) !== 0;
+        },
+        
+        // Define a phrase from packed 12-byte events (Uint8Array, see TSFBridgeEvent), offsets from its start
+        // lengthFrames: end of the phrase, <= 0 = the last event
+        // Returns the phrase id, -1 on failure
+        phraseDefine: function(handle, events, count, lengthFrames) {
+            if (count <= 0) return -1;
+            var ptr = copyEvents(events, count);
+            if (ptr === 0) return -1;
+            return module._wasm_tsf_phrase_define(handle, ptr, count, lengthFrames);
+        },
+        
+        // Release a phrase id, plays that started already play to the end
+        phraseRelease: function(handle, phrase) {
+            module._wasm_tsf_phrase_release(handle, phrase);
+        },
+        
+        // Play a phrase at a frame offset from the start of the next render (negative = as soon as possible)
+        // Returns false if the command queue is full
+        phrasePlay: function(handle, phrase, frameOffset) {
+            return module._wasm_tsf_phrase_play(handle, phrase, frameOffset) !== 0;
+        },
+        
+        // Copy the phrase cache statistics (TSFBridgePhraseCacheStats, 40 bytes) into buffer (Uint8Array), may be null
+        // Returns the memory used by the cached phrases in bytes
+        getPhraseCacheStats: function(handle, buffer) {
+            if (!buffer) return module._wasm_tsf_get_phrase_cache_stats(handle, 0);
+            var ptr = module._malloc(40);
+            if (ptr === 0) return module._wasm_tsf_get_phrase_cache_stats(handle, 0);
+            var bytes = module._wasm_tsf_get_phrase_cache_stats(handle, ptr);
+            buffer.set(module.HEAPU8.subarray(ptr, ptr + 40));
+            module._free(ptr);
+            return bytes;
+        },
+        
+        // Cache the samples of one-shot percussion notes, up to maxBytes (0 = off)
+        // Returns false if the cache memory couldn't be allocated
+        setOneshotCache: function(handle, maxBytes) {
+            return module._wasm_tsf_set_oneshot_cache(handle, maxBytes) !== 0;
+        },
+        
+        // Schedule an event at a frame offset from the start of the next render
+        // Returns false if the event queue is full
+        scheduleEvent: function(handle, frameOffset, type, channel, data1, data2) {
+            return module._wasm_tsf_schedule_event(handle, frameOffset, type, channel, data1, data2) !== 0;
+        },
+        
+        // Schedule an event at an absolute sample time (see getSampleTime)
+        scheduleEventAt: function(handle, sampleTime, type, channel, data1, data2) {
+            return module._wasm_tsf_schedule_event_at(handle, sampleTime, type, channel, data1, data2) !== 0;
+        },
+        
+        // Submit a batch of packed 12-byte events (see TSFBridgeEvent) with one call
+        // events: Uint8Array holding at least count events
+        // Returns the number of events queued
+        submitEvents: function(handle, events, count) {
+            if (count <= 0) return 0;
+            var ptr = copyEvents(events, count);
+            if (ptr === 0) return 0;
+            return module._wasm_tsf_submit_events(handle, ptr, count);
+        },
+        
+        // Route the 16 MIDI channels to buses for renderBusesView
+        // channelBus: 16 bus indices (array or typed array), null = one bus per channel
+        setBusMap: function(handle, channelBus, busCount) {
+            if (!channelBus) {
+                module._wasm_tsf_set_bus_map(handle, 0, busCount);
+                return;
             }
+            if (!busMapPtr) {
+                busMapPtr = module._malloc(16);
+                if (busMapPtr === 0) {
+                    console.error("Failed to allocate bus map buffer");
+                    return;
+                }
+            }
+            for (var i = 0; i < 16; i++) module.HEAPU8[busMapPtr + i] = channelBus[i] || 0;
+            module._wasm_tsf_set_bus_map(handle, busMapPtr, busCount);
+        },
+        
+        // Render every bus into the persistent WASM heap buffer, one block of sampleCount frames per bus
+        // Returns a Float32Array view of all blocks, valid until the next render call;
+        // getActiveBuses tells which buses had voices playing
+        renderBusesView: function(handle, sampleCount, channels, busCount) {
+            var totalFloats = sampleCount * (channels || 2) * busCount;
+            var bufferPtr = reserveRenderBuffer(totalFloats);
+            if (bufferPtr === 0) return null;
             
-            // Render audio into WASM memory
-            var rendered = module._wasm_tsf_render(handle, bufferPtr, sampleCount);
+            activeBuses = module._wasm_tsf_render_buses(handle, bufferPtr, sampleCount);
             
-            // Copy from WASM heap to JavaScript Float32Array
-            // Try to access memory buffer directly for performance
-            var output = new Float32Array(totalFloats);
-            try {
-                // Attempt direct memory access via wasmMemory or HEAPF32
-                var heapF32 = null;
-                if (module.HEAPF32) {
-                    heapF32 = module.HEAPF32;
-                } else if (module.wasmMemory && module.wasmMemory.buffer) {
-                    heapF32 = new Float32Array(module.wasmMemory.buffer);
-                } else if (module.asm && module.asm.memory && module.asm.memory.buffer) {
-                    heapF32 = new Float32Array(module.asm.memory.buffer);
+            var heapF32 = getHeapF32();
+            if (!heapF32) return null;
+            if (!busView || busView.buffer !== heapF32.buffer || busView.byteOffset !== bufferPtr || busView.length !== totalFloats) {
+                busView = new Float32Array(heapF32.buffer, bufferPtr, totalFloats);
+            }
+            return busView;
+        },
+        
+        // Bit mask of the buses with voices playing in the last renderBusesView call (bit n = bus n)
+        getActiveBuses: function() {
+            return activeBuses;
+        },
+        
+        // Get the sample clock (frames rendered so far)
+        getSampleTime: function(handle) {
+            return module._wasm_tsf_get_sample_time(handle);
+        },
+        
+        // Drop all scheduled events
+        clearEvents: function(handle) {
+            module._wasm_tsf_clear_events(handle);
+        },
+        
+        // Get the number of commands dropped because the command queue was full
+        droppedCommands: function(handle) {
+            return module._wasm_tsf_dropped_commands(handle);
+        },
+        
+        // Start the render thread (always 0 = none in the single-threaded WASM build)
+        streamStart: function(handle, targetLatencyFrames, blockFrames) {
+            return module._wasm_tsf_stream_start(handle, targetLatencyFrames, blockFrames);
+        },
+        
+        // Stop the render thread
+        streamStop: function(handle) {
+            module._wasm_tsf_stream_stop(handle);
+        },
+        
+        // Change the target latency of the running stream
+        streamSetLatency: function(handle, targetLatencyFrames) {
+            return module._wasm_tsf_stream_set_latency(handle, targetLatencyFrames);
+        },
+        
+        // Read from the stream, renders directly without a render thread
+        // Returns Float32Array with rendered audio
+        streamRead: function(handle, sampleCount) {
+            return renderToArray(module._wasm_tsf_stream_read, handle, sampleCount);
+        },
+        
+        // Render into a persistent WASM heap buffer without allocating or copying
+        // Returns a Float32Array view of the rendered audio, valid until the next render call
+        renderView: function(handle, sampleCount, channels) {
+            return renderToView(module._wasm_tsf_render, handle, sampleCount, channels);
+        },
+        
+        // Read from the stream into the persistent WASM heap buffer, see renderView
+        streamReadView: function(handle, sampleCount, channels) {
+            return renderToView(module._wasm_tsf_stream_read, handle, sampleCount, channels);
+        },
+        
+        // Get the stream underrun count
+        streamUnderruns: function(handle) {
+            return module._wasm_tsf_stream_underruns(handle);
+        },
+        
+        // Get the stream overrun count
+        streamOverruns: function(handle) {
+            return module._wasm_tsf_stream_overruns(handle);
+        },
+        
+        // Parse a Standard MIDI File into a packed event array (see TSFBridgeMidiHeader)
+        // data: Uint8Array with the .mid file
+        // Returns a Uint8Array with the packed file, null if data isn't a valid MIDI file
+        midiParse: function(data, sampleRate) {
+            var dataPtr = module._malloc(data.length);
+            if (dataPtr === 0) return null;
+            module.HEAPU8.set(data, dataPtr);
+            var result = null;
+            var size = module._wasm_tsf_midi_parse(dataPtr, data.length, sampleRate, 0, 0);
+            var bufferPtr = size > 0 ? module._malloc(size) : 0;
+            if (bufferPtr !== 0) {
+                if (module._wasm_tsf_midi_parse(dataPtr, data.length, sampleRate, bufferPtr, size) === size) {
+                    // Copy out, the heap may grow (and detach views) before the caller is done
+                    result = module.HEAPU8.slice(bufferPtr, bufferPtr + size);
                 }
-                
-                if (heapF32) {
-                    // Fast path: bulk copy from WASM heap
-                    var heapIndex = bufferPtr >> 2; // Divide by 4 (float size)
-                    output.set(heapF32.subarray(heapIndex, heapIndex + totalFloats));
-                } else {
-                    // Fallback: slow getValue loop
-                    for (var i = 0; i < totalFloats; i++) {
-                        output[i] = module.getValue(bufferPtr + (i * 4), 'float');
-                    }
+                module._free(bufferPtr);
+            }
+            module._free(dataPtr);
+            return result;
+        },
+        
+        // Load notes for the built-in sequencer (24 bytes each, see TSFBridgeNote)
+        // notes: Uint8Array, count: number of notes, lengthBeats: loop length, <= 0 = end of the last note
+        // Returns the number of notes loaded
+        sequenceLoad: function(handle, notes, count, lengthBeats) {
+            var notesPtr = count > 0 ? module._malloc(count * 24) : 0;
+            if (count > 0 && notesPtr === 0) return 0;
+            if (notesPtr !== 0) module.HEAPU8.set(notes.subarray(0, count * 24), notesPtr);
+            var loaded = module._wasm_tsf_sequence_load(handle, notesPtr, count, lengthBeats);
+            if (notesPtr !== 0) module._free(notesPtr);
+            return loaded;
+        },
+        
+        // Start the sequence at a beat, on the next render
+        sequenceStart: function(handle, startBeat) {
+            module._wasm_tsf_sequence_start(handle, startBeat);
+        },
+        
+        // Stop the sequence and release its notes
+        sequenceStop: function(handle) {
+            module._wasm_tsf_sequence_stop(handle);
+        },
+        
+        // Turn looping of the sequence on or off
+        sequenceSetLoop: function(handle, loop) {
+            module._wasm_tsf_sequence_set_loop(handle, loop ? 1 : 0);
+        },
+        
+        // Change the sequence tempo in beats per minute
+        sequenceSetTempo: function(handle, bpm) {
+            module._wasm_tsf_sequence_set_tempo(handle, bpm);
+        },
+        
+        // Get the sequence position in beats at the end of the last render
+        sequenceGetBeat: function(handle) {
+            return module._wasm_tsf_sequence_get_beat(handle);
+        },
+        
+        // Check whether the sequence is playing
+        sequencePlaying: function(handle) {
+            return module._wasm_tsf_sequence_playing(handle) !== 0;
+        },
+        
+        // Index a packed MIDI file (from midiParse) with a checkpoint every interval samples
+        // Returns a Uint8Array with the index, null on failure
+        midiIndex: function(song, interval) {
+            var songPtr = module._malloc(song.length);
+            if (songPtr === 0) return null;
+            module.HEAPU8.set(song, songPtr);
+            var result = null;
+            var size = module._wasm_tsf_midi_index(songPtr, song.length, interval, 0, 0);
+            var indexPtr = size > 0 ? module._malloc(size) : 0;
+            if (indexPtr !== 0) {
+                if (module._wasm_tsf_midi_index(songPtr, song.length, interval, indexPtr, size) === size) {
+                    result = module.HEAPU8.slice(indexPtr, indexPtr + size);
                 }
-            } catch (e) {
-                // On error, use slow path
-                for (var i = 0; i < totalFloats; i++) {
-                    output[i] = module.getValue(bufferPtr + (i * 4), 'float');
+                module._free(indexPtr);
+            }
+            module._free(songPtr);
+            return result;
+        },
+        
+        // Restore the channels (and with flags 1 the sounding notes) of a packed MIDI file at a sample
+        // index: Uint8Array from midiIndex, or null to replay from the start
+        // Returns the index of the first event at or after sample, -1 on failure
+        midiSeek: function(handle, song, index, sample, flags) {
+            var songPtr = module._malloc(song.length);
+            if (songPtr === 0) return -1;
+            module.HEAPU8.set(song, songPtr);
+            var indexPtr = index ? module._malloc(index.length) : 0;
+            var next = -1;
+            if (!index || indexPtr !== 0) {
+                if (indexPtr !== 0) module.HEAPU8.set(index, indexPtr);
+                next = module._wasm_tsf_midi_seek(handle, songPtr, song.length, indexPtr, index ? index.length : 0, sample, flags);
+            }
+            if (indexPtr !== 0) module._free(indexPtr);
+            module._free(songPtr);
+            return next;
+        },
+        
+        // Save the complete synth state into buffer (Uint8Array) if it's large enough
+        // Returns the size of the snapshot in bytes, 0 on failure
+        snapshot: function(handle, buffer) {
+            var size = module._wasm_tsf_snapshot(handle, 0, 0);
+            if (size <= 0 || size > buffer.length) return size;
+            var ptr = module._malloc(size);
+            if (ptr === 0) return 0;
+            if (module._wasm_tsf_snapshot(handle, ptr, size) === size) {
+                buffer.set(module.HEAPU8.subarray(ptr, ptr + size));
+            } else {
+                size = 0;
+            }
+            module._free(ptr);
+            return size;
+        },
+        
+        // Render several synths and mix them with a gain (linear) and pan (0 = left, 1 = right) each
+        // handles, gains, pans: arrays of the same length, gains and pans may be null (1.0 and 0.5)
+        // Returns a Float32Array view of the interleaved stereo mix, valid until the next render call
+        renderMixView: function(handles, gains, pans, sampleCount) {
+            var count = handles.length;
+            if (count > mixParamsCount) {
+                if (mixParamsPtr) module._free(mixParamsPtr);
+                mixParamsCount = 0;
+                mixParamsPtr = module._malloc(count * 12); // handle, gain and pan, 4 bytes each
+                if (mixParamsPtr === 0) {
+                    console.error("Failed to allocate mix parameters");
+                    return null;
                 }
+                mixParamsCount = count;
             }
+            var bufferPtr = reserveRenderBuffer(sampleCount * 2);
+            if (bufferPtr === 0) return null;
             
-            // Free temporary buffer
-            module._free(bufferPtr);
+            var heapF32 = getHeapF32();
+            if (!heapF32) return null;
+            var heapI32 = new Int32Array(heapF32.buffer);
+            var base = mixParamsPtr >> 2;
+            for (var i = 0; i < count; i++) {
+                heapI32[base + i] = handles[i] || 0;
+                heapF32[base + count + i] = gains ? gains[i] : 1.0;
+                heapF32[base + 2 * count + i] = pans ? pans[i] : 0.5;
+            }
+            module._wasm_tsf_render_mix(mixParamsPtr, mixParamsPtr + count * 4, mixParamsPtr + count * 8, count, bufferPtr, sampleCount, 0);
             
-            return output;
-        },
-        
-        // Stop all notes
-        noteOffAll: function(handle) {
-            module._wasm_tsf_note_off_all(handle);
+            heapF32 = getHeapF32();
+            if (!heapF32) return null;
+            if (!mixView || mixView.buffer !== heapF32.buffer || mixView.byteOffset !== bufferPtr || mixView.length !== sampleCount * 2) {
+                mixView = new Float32Array(heapF32.buffer, bufferPtr, sampleCount * 2);
+            }
+            return mixView;
         },
         
-        // Get active voice count
-        activeVoices: function(handle) {
-            return module._wasm_tsf_active_voices(handle);
+        // Continue from a snapshot, buffer: Uint8Array holding it
+        restore: function(handle, buffer) {
+            var ptr = module._malloc(buffer.length);
+            if (ptr === 0) return false;
+            module.HEAPU8.set(buffer, ptr);
+            var ok = module._wasm_tsf_restore(handle, ptr, buffer.length) !== 0;
+            module._free(ptr);
+            return ok;
         }
     };
 })();
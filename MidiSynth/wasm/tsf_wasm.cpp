@@ -1,22 +1,16 @@
 // tsf_wasm.cpp
 // WebAssembly wrapper for TinySoundFont
-// Build with Emscripten
+// Build with Emscripten, linked with ../cpp/tsf_bridge.cpp (compiled with -DTSF_BRIDGE_GAIN_DB=0)
 
-#define TSF_IMPLEMENTATION
-#include "../cpp/tsf/tsf.h"
+#include "../cpp/tsf_bridge.h"
 
 #include <emscripten.h>
 #include <emscripten/bind.h>
-#include <stdlib.h>
 
 using namespace emscripten;
 
-// Internal handle structure
-struct TSFSynth {
-    tsf* synth;
-    int sampleRate;
-    int channels;
-};
+// Opaque handle, defined in tsf_bridge.cpp
+struct TSFSynth;
 
 // EMSCRIPTEN_KEEPALIVE ensures these functions are exported to JavaScript
 extern "C" {
@@ -25,95 +19,286 @@ extern "C" {
 // JavaScript will need to load the SF2 file and pass it as a Uint8Array
 EMSCRIPTEN_KEEPALIVE
 TSFSynth* wasm_tsf_init_memory(const void* buffer, int size) {
-    if (!buffer || size <= 0) return nullptr;
-    
-    tsf* synth = tsf_load_memory(buffer, size);
-    if (!synth) return nullptr;
-    
-    TSFSynth* handle = (TSFSynth*)malloc(sizeof(TSFSynth));
-    if (!handle) {
-        tsf_close(synth);
-        return nullptr;
-    }
-    
-    handle->synth = synth;
-    handle->sampleRate = 44100;
-    handle->channels = 2;
-    
-    // Set default output
-    tsf_set_output(synth, TSF_STEREO_INTERLEAVED, 44100, 0.0f);
-    
-    return handle;
+    return (TSFSynth*)tsf_bridge_init_memory(buffer, size);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_close(TSFSynth* handle) {
-    if (!handle) return;
-    if (handle->synth) tsf_close(handle->synth);
-    free(handle);
+    tsf_bridge_close(handle);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_set_output(TSFSynth* handle, int sample_rate, int channels) {
-    if (!handle) return;
-    
-    handle->sampleRate = sample_rate;
-    handle->channels = channels;
-    
-    enum TSFOutputMode mode = (channels == 1) ? TSF_MONO : TSF_STEREO_INTERLEAVED;
-    tsf_set_output(handle->synth, mode, sample_rate, 0.0f);
+    tsf_bridge_set_output(handle, sample_rate, channels);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_set_output_format(TSFSynth* handle, int sample_rate, int channels, int format) {
+    tsf_bridge_set_output_format(handle, sample_rate, channels, format);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_note_on(TSFSynth* handle, int channel, int note, int velocity) {
-    if (!handle) return;
-    float vel = velocity / 127.0f;
-    tsf_channel_note_on(handle->synth, channel, note, vel);
+    tsf_bridge_note_on(handle, channel, note, velocity);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_note_off(TSFSynth* handle, int channel, int note) {
-    if (!handle) return;
-    tsf_channel_note_off(handle->synth, channel, note);
+    tsf_bridge_note_off(handle, channel, note);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_set_preset(TSFSynth* handle, int channel, int bank, int preset) {
-    if (!handle) return;
-    tsf_channel_set_bank_preset(handle->synth, channel, bank, preset);
+    tsf_bridge_set_preset(handle, channel, bank, preset);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_pitch_bend(TSFSynth* handle, int channel, int pitch_wheel) {
-    if (!handle) return;
-    // TinySoundFont expects pitch wheel as -8192 to +8191
-    int bend = pitch_wheel - 8192;
-    tsf_channel_set_pitchwheel(handle->synth, channel, bend);
+    tsf_bridge_pitch_bend(handle, channel, pitch_wheel);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_control_change(TSFSynth* handle, int channel, int controller, int value) {
-    if (!handle) return;
-    tsf_channel_midi_control(handle->synth, channel, controller, value);
+    tsf_bridge_control_change(handle, channel, controller, value);
 }
 
 EMSCRIPTEN_KEEPALIVE
 int wasm_tsf_render(TSFSynth* handle, float* buffer, int sample_count) {
-    if (!handle || !buffer || sample_count <= 0) return 0;
-    tsf_render_float(handle->synth, buffer, sample_count, 0);
-    return sample_count;
+    return tsf_bridge_render(handle, buffer, sample_count);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_tsf_note_off_all(TSFSynth* handle) {
-    if (!handle) return;
-    tsf_note_off_all(handle->synth);
+    tsf_bridge_note_off_all(handle);
 }
 
 EMSCRIPTEN_KEEPALIVE
 int wasm_tsf_active_voices(TSFSynth* handle) {
-    if (!handle) return 0;
-    return tsf_active_voice_count(handle->synth);
+    return tsf_bridge_active_voices(handle);
+}
+
+// The WASM module is built without threads, voices are always rendered on the calling thread
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_set_render_threads(TSFSynth* handle, int thread_count) {
+    return tsf_bridge_set_render_threads(handle, thread_count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_schedule_event(TSFSynth* handle, int frame_offset, int type, int channel, int data1, int data2) {
+    return tsf_bridge_schedule_event(handle, frame_offset, type, channel, data1, data2);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_schedule_event_at(TSFSynth* handle, double sample_time, int type, int channel, int data1, int data2) {
+    return tsf_bridge_schedule_event_at(handle, sample_time, type, channel, data1, data2);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_set_bus_map(TSFSynth* handle, const unsigned char* channel_bus, int bus_count) {
+    tsf_bridge_set_bus_map(handle, channel_bus, bus_count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_render_buses(TSFSynth* handle, float* buffer, int sample_count) {
+    return tsf_bridge_render_buses(handle, buffer, sample_count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_submit_events(TSFSynth* handle, const TSFBridgeEvent* events, int count) {
+    return tsf_bridge_submit_events(handle, events, count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+double wasm_tsf_get_sample_time(TSFSynth* handle) {
+    return tsf_bridge_get_sample_time(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_clear_events(TSFSynth* handle) {
+    tsf_bridge_clear_events(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_dropped_commands(TSFSynth* handle) {
+    return tsf_bridge_dropped_commands(handle);
+}
+
+// Without threads there's no render thread, stream_start returns 0 and stream_read renders directly
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_stream_start(TSFSynth* handle, int target_latency_frames, int block_frames) {
+    return tsf_bridge_stream_start(handle, target_latency_frames, block_frames);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_stream_stop(TSFSynth* handle) {
+    tsf_bridge_stream_stop(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_stream_set_latency(TSFSynth* handle, int target_latency_frames) {
+    return tsf_bridge_stream_set_latency(handle, target_latency_frames);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_stream_read(TSFSynth* handle, float* buffer, int sample_count) {
+    return tsf_bridge_stream_read(handle, buffer, sample_count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_stream_underruns(TSFSynth* handle) {
+    return tsf_bridge_stream_underruns(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_stream_overruns(TSFSynth* handle) {
+    return tsf_bridge_stream_overruns(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_midi_parse(const void* data, int size, int sample_rate, void* buffer, int buffer_size) {
+    return tsf_bridge_midi_parse(data, size, sample_rate, buffer, buffer_size);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_sequence_load(TSFSynth* handle, const void* notes, int count, double length_beats) {
+    return tsf_bridge_sequence_load(handle, (const TSFBridgeNote*)notes, count, length_beats);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_sequence_start(TSFSynth* handle, double start_beat) {
+    tsf_bridge_sequence_start(handle, start_beat);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_sequence_stop(TSFSynth* handle) {
+    tsf_bridge_sequence_stop(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_sequence_set_loop(TSFSynth* handle, int loop) {
+    tsf_bridge_sequence_set_loop(handle, loop);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_sequence_set_tempo(TSFSynth* handle, double bpm) {
+    tsf_bridge_sequence_set_tempo(handle, bpm);
+}
+
+EMSCRIPTEN_KEEPALIVE
+double wasm_tsf_sequence_get_beat(TSFSynth* handle) {
+    return tsf_bridge_sequence_get_beat(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_sequence_playing(TSFSynth* handle) {
+    return tsf_bridge_sequence_playing(handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_midi_index(const void* song, int size, int interval, void* index, int index_size) {
+    return tsf_bridge_midi_index(song, size, interval, index, index_size);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_midi_seek(TSFSynth* handle, const void* song, int size, const void* index, int index_size, unsigned int sample, int flags) {
+    return tsf_bridge_midi_seek(handle, song, size, index, index_size, sample, flags);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_snapshot(TSFSynth* handle, void* buffer, int size) {
+    return tsf_bridge_snapshot(handle, buffer, size);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_restore(TSFSynth* handle, const void* buffer, int size) {
+    return tsf_bridge_restore(handle, buffer, size);
+}
+
+// Take a reference to the font registered under name (UTF-8, null-terminated), 0 if there is none
+EMSCRIPTEN_KEEPALIVE
+void* wasm_tsf_font_find(const char* name) {
+    return tsf_bridge_font_find(name);
+}
+
+// Load a SoundFont and register it under name, the SF2 buffer can be freed afterwards
+EMSCRIPTEN_KEEPALIVE
+void* wasm_tsf_font_load_memory(const char* name, const void* buffer, int size) {
+    return tsf_bridge_font_load_memory(name, buffer, size);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_font_release(void* font) {
+    tsf_bridge_font_release(font);
+}
+
+EMSCRIPTEN_KEEPALIVE
+TSFSynth* wasm_tsf_init_font(void* font) {
+    return (TSFSynth*)tsf_bridge_init_font(font);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_render_mix(const TSFHandle* handles, const float* gains, const float* pans, int count, float* buffer, int sample_count, int flag_mixing) {
+    return tsf_bridge_render_mix(handles, gains, pans, count, buffer, sample_count, flag_mixing);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_set_max_voices(TSFSynth* handle, int max_voices) {
+    return tsf_bridge_set_max_voices(handle, max_voices);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_channel_set_polyphony(TSFSynth* handle, int channel, int max_voices) {
+    tsf_bridge_channel_set_polyphony(handle, channel, max_voices);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_channel_set_priority(TSFSynth* handle, int channel, int priority) {
+    tsf_bridge_channel_set_priority(handle, channel, priority);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_set_cpu_budget(TSFSynth* handle, float budget) {
+    tsf_bridge_set_cpu_budget(handle, budget);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_get_governor_stats(TSFSynth* handle, TSFBridgeGovernorStats* stats) {
+    return tsf_bridge_get_governor_stats(handle, stats);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_set_voice_virtualization(TSFSynth* handle, float threshold_db) {
+    tsf_bridge_set_voice_virtualization(handle, threshold_db);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_set_phrase_cache(TSFSynth* handle, int max_bytes) {
+    return tsf_bridge_set_phrase_cache(handle, max_bytes);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_phrase_define(TSFSynth* handle, const TSFBridgeEvent* events, int count, int length_frames) {
+    return tsf_bridge_phrase_define(handle, events, count, length_frames);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_tsf_phrase_release(TSFSynth* handle, int phrase) {
+    tsf_bridge_phrase_release(handle, phrase);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_phrase_play(TSFSynth* handle, int phrase, int frame_offset) {
+    return tsf_bridge_phrase_play(handle, phrase, frame_offset);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_get_phrase_cache_stats(TSFSynth* handle, TSFBridgePhraseCacheStats* stats) {
+    return tsf_bridge_get_phrase_cache_stats(handle, stats);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_tsf_set_oneshot_cache(TSFSynth* handle, int max_bytes) {
+    return tsf_bridge_set_oneshot_cache(handle, max_bytes);
 }
 
 } // extern "C"
@@ -123,6 +308,7 @@ EMSCRIPTEN_BINDINGS(tsf_module) {
     function("initMemory", &wasm_tsf_init_memory, allow_raw_pointers());
     function("close", &wasm_tsf_close, allow_raw_pointers());
     function("setOutput", &wasm_tsf_set_output, allow_raw_pointers());
+    function("setOutputFormat", &wasm_tsf_set_output_format, allow_raw_pointers());
     function("noteOn", &wasm_tsf_note_on, allow_raw_pointers());
     function("noteOff", &wasm_tsf_note_off, allow_raw_pointers());
     function("setPreset", &wasm_tsf_set_preset, allow_raw_pointers());
@@ -131,4 +317,48 @@ EMSCRIPTEN_BINDINGS(tsf_module) {
     function("render", &wasm_tsf_render, allow_raw_pointers());
     function("noteOffAll", &wasm_tsf_note_off_all, allow_raw_pointers());
     function("activeVoices", &wasm_tsf_active_voices, allow_raw_pointers());
+    function("setRenderThreads", &wasm_tsf_set_render_threads, allow_raw_pointers());
+    function("scheduleEvent", &wasm_tsf_schedule_event, allow_raw_pointers());
+    function("scheduleEventAt", &wasm_tsf_schedule_event_at, allow_raw_pointers());
+    function("submitEvents", &wasm_tsf_submit_events, allow_raw_pointers());
+    function("setBusMap", &wasm_tsf_set_bus_map, allow_raw_pointers());
+    function("renderBuses", &wasm_tsf_render_buses, allow_raw_pointers());
+    function("getSampleTime", &wasm_tsf_get_sample_time, allow_raw_pointers());
+    function("clearEvents", &wasm_tsf_clear_events, allow_raw_pointers());
+    function("droppedCommands", &wasm_tsf_dropped_commands, allow_raw_pointers());
+    function("streamStart", &wasm_tsf_stream_start, allow_raw_pointers());
+    function("streamStop", &wasm_tsf_stream_stop, allow_raw_pointers());
+    function("streamSetLatency", &wasm_tsf_stream_set_latency, allow_raw_pointers());
+    function("streamRead", &wasm_tsf_stream_read, allow_raw_pointers());
+    function("streamUnderruns", &wasm_tsf_stream_underruns, allow_raw_pointers());
+    function("streamOverruns", &wasm_tsf_stream_overruns, allow_raw_pointers());
+    function("midiParse", &wasm_tsf_midi_parse, allow_raw_pointers());
+    function("sequenceLoad", &wasm_tsf_sequence_load, allow_raw_pointers());
+    function("sequenceStart", &wasm_tsf_sequence_start, allow_raw_pointers());
+    function("sequenceStop", &wasm_tsf_sequence_stop, allow_raw_pointers());
+    function("sequenceSetLoop", &wasm_tsf_sequence_set_loop, allow_raw_pointers());
+    function("sequenceSetTempo", &wasm_tsf_sequence_set_tempo, allow_raw_pointers());
+    function("sequenceGetBeat", &wasm_tsf_sequence_get_beat, allow_raw_pointers());
+    function("sequencePlaying", &wasm_tsf_sequence_playing, allow_raw_pointers());
+    function("midiIndex", &wasm_tsf_midi_index, allow_raw_pointers());
+    function("midiSeek", &wasm_tsf_midi_seek, allow_raw_pointers());
+    function("snapshot", &wasm_tsf_snapshot, allow_raw_pointers());
+    function("restore", &wasm_tsf_restore, allow_raw_pointers());
+    function("fontFind", &wasm_tsf_font_find, allow_raw_pointers());
+    function("fontLoadMemory", &wasm_tsf_font_load_memory, allow_raw_pointers());
+    function("fontRelease", &wasm_tsf_font_release, allow_raw_pointers());
+    function("initFont", &wasm_tsf_init_font, allow_raw_pointers());
+    function("renderMix", &wasm_tsf_render_mix, allow_raw_pointers());
+    function("setMaxVoices", &wasm_tsf_set_max_voices, allow_raw_pointers());
+    function("channelSetPolyphony", &wasm_tsf_channel_set_polyphony, allow_raw_pointers());
+    function("channelSetPriority", &wasm_tsf_channel_set_priority, allow_raw_pointers());
+    function("setCpuBudget", &wasm_tsf_set_cpu_budget, allow_raw_pointers());
+    function("getGovernorStats", &wasm_tsf_get_governor_stats, allow_raw_pointers());
+    function("setVoiceVirtualization", &wasm_tsf_set_voice_virtualization, allow_raw_pointers());
+    function("setPhraseCache", &wasm_tsf_set_phrase_cache, allow_raw_pointers());
+    function("phraseDefine", &wasm_tsf_phrase_define, allow_raw_pointers());
+    function("phraseRelease", &wasm_tsf_phrase_release, allow_raw_pointers());
+    function("phrasePlay", &wasm_tsf_phrase_play, allow_raw_pointers());
+    function("getPhraseCacheStats", &wasm_tsf_get_phrase_cache_stats, allow_raw_pointers());
+    function("setOneshotCache", &wasm_tsf_set_oneshot_cache, allow_raw_pointers());
 }
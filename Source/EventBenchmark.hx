@@ -0,0 +1,61 @@
+package;
+
+import haxe.Timer;
+
+/**
+ * Measures how many events per second reach the synth through the per-call API
+ * (one native call per noteOff) versus MidiSynth.submitEvents (one call per batch).
+ *
+ * Sends note offs for a note that isn't playing on channel 15, so nothing is audible.
+ * Rounds stay below the 4096 command queue size and wait for the queue to drain in between,
+ * so no events are dropped and both sides measure the same work.
+ */
+class EventBenchmark {
+    private static inline var CHANNEL:Int = 15;
+    private static inline var NOTE:Int = 0;
+
+    /**
+     * @param synth Synth to send the events to
+     * @param rounds Number of rounds per API
+     * @param eventsPerRound Events per round (at most 4096)
+     * @return Summary line with events/second for both APIs
+     */
+    public static function run(synth:MidiSynth, rounds:Int = 20, eventsPerRound:Int = 2000):String {
+        var batch = new MidiEventBatch(eventsPerRound);
+        for (i in 0...eventsPerRound) batch.add(MidiEventBatch.NOW, MidiSynth.EVENT_NOTE_OFF, CHANNEL, NOTE);
+
+        var droppedBefore = synth.getDroppedCommands();
+        var perCallTime = 0.0;
+        var batchTime = 0.0;
+        for (r in 0...rounds) {
+            var start = Timer.stamp();
+            for (i in 0...eventsPerRound) synth.noteOff(CHANNEL, NOTE);
+            perCallTime += Timer.stamp() - start;
+            drain(synth);
+
+            start = Timer.stamp();
+            synth.submitEvents(batch);
+            batchTime += Timer.stamp() - start;
+            drain(synth);
+        }
+        var dropped = synth.getDroppedCommands() - droppedBefore;
+
+        var events = rounds * eventsPerRound;
+        var perCallRate = perCallTime > 0 ? events / perCallTime : 0;
+        var batchRate = batchTime > 0 ? events / batchTime : 0;
+        return "Events/s per call: " + Math.round(perCallRate) +
+               ", batched: " + Math.round(batchRate) +
+               (perCallRate > 0 ? " (" + Math.round(batchRate / perCallRate * 10) / 10 + "x)" : "") +
+               (dropped > 0 ? ", " + dropped + " dropped" : "");
+    }
+
+    // Lets the render side apply the queued commands before the next round
+    private static function drain(synth:MidiSynth):Void {
+        #if (cpp || hl)
+        // The stream thread drains the queue with every block it renders
+        Sys.sleep(0.02);
+        #else
+        synth.render(null, 64);
+        #end
+    }
+}
@@ -9,7 +9,6 @@ import procedural.generators.RhythmPatternGen;
 import procedural.generators.WeightedMarkovMelodyGen;
 import procedural.rules.ChordProgressionRule;
 import procedural.rules.ArpeggiateRule;
-import moonchart.parsers.MidiParser;
 import openfl.utils.ByteArray;
 import openfl.events.Event;
 import openfl.events.MouseEvent;
@@ -82,19 +81,22 @@ class MidiSynthExample extends Sprite {
     private var infoText:TextField;
     private var renderTimer:Timer;
     private var audioQueue:Array<haxe.io.Bytes> = [];
+    // Buffers onSampleData is done with, reused by renderOneBuffer so rendering doesn't allocate
+    private var freeBuffers:Array<haxe.io.Bytes> = [];
+    #if (cpp || hl)
+    private var streamBuffer:haxe.io.Bytes;
+    #end
     // --- MIDI File Loading and Playback ---
     private var midiLoadButton:openfl.display.SimpleButton;
     // Track active notes during playback for stuck note analysis
     private var playbackActiveNotes:Map<String, Int> = new Map();
-    private var midiEvents:Array<Dynamic> = [];
+    private var midiSong:MidiSong;
     private var midiPlaybackTimer:Timer;
-    private var midiPlaybackPos:Float = 0.0;
+    private var midiPlaybackPos:Int = 0;
     private var midiIsPlaying:Bool = false;
     private var midiStartTime:Float = 0.0;
     private var midiLastTickTime:Float = 0.0; // last wall time in seconds
     private var midiPlaybackTime:Float = 0.0; // running playback time in ms
-    private var midiTempo:Float = 500000.0; // microseconds per quarter note (default 120bpm)
-    private var midiTicksPerQuarter:Int = 480; // default, will be set from file
     private var midiFileLoaded:Bool = false;
     
     // --- Procedural Music Engine ---
@@ -307,6 +309,12 @@ class MidiSynthExample extends Sprite {
     }
     
     private function initializeAudio():Void {
+        #if (cpp || hl)
+        // The bridge renders ahead on its own thread, onSampleData only copies the frames out
+        streamBuffer = haxe.io.Bytes.alloc(BUFFER_SIZE * CHANNELS * 4);
+        synth.startStream(BUFFER_SIZE * 2);
+        #end
+        
         // Create a Sound object for dynamic audio generation
         sound = new Sound();
 
@@ -319,6 +327,7 @@ class MidiSynthExample extends Sprite {
             throw "Failed to start audio playback";
         }
 
+        #if !(cpp || hl)
         // Start a timer to render audio - match callback frequency (not faster)
         // SampleDataEvent typically fires ~20-40 times per second
         var ms = Math.floor(1000 * BUFFER_SIZE / SAMPLE_RATE); // Render at consumption rate
@@ -340,6 +349,7 @@ class MidiSynthExample extends Sprite {
             audioQueue.push(silence);
         }
         #end
+        #end
     }    private var renderCount:Int = 0;
     #if html5
     private static inline var MAX_QUEUE_SIZE:Int = 6; // More buffering for WASM overhead
@@ -367,25 +377,13 @@ class MidiSynthExample extends Sprite {
     private function renderOneBuffer():Void {
         
         try {
-            #if cpp
-            // Render one buffer per tick to match consumption rate
-            var bytes = synth.renderBytes(BUFFER_SIZE);
-            audioQueue.push(bytes);
-            #elseif hl
-            var hlbuf = new hl.Bytes(BUFFER_SIZE * CHANNELS * 4);
-            synth.render(hlbuf, BUFFER_SIZE);
-            var bytes = haxe.io.Bytes.alloc(BUFFER_SIZE * CHANNELS * 4);
-            for (i in 0...BUFFER_SIZE * CHANNELS) bytes.setFloat(i * 4, hlbuf.getF32(i * 4));
-            audioQueue.push(bytes);
-            #elseif js
-            var audioData = synth.render(null, BUFFER_SIZE);
+            #if js
+            var bytes = acquireBuffer();
+            var rendered = synth.renderInto(bytes, BUFFER_SIZE);
             #if debug
-            trace("JS render tick: got " + (audioData != null ? BUFFER_SIZE : 0) + " samples");
+            trace("JS render tick: got " + rendered + " samples");
             #end
-            var bytes = haxe.io.Bytes.alloc(BUFFER_SIZE * CHANNELS * 4);
-            if (audioData != null) {
-                for (i in 0...BUFFER_SIZE * CHANNELS) bytes.setFloat(i * 4, untyped audioData[i]);
-            }
+            if (rendered <= 0) bytes.fill(0, bytes.length, 0);
             audioQueue.push(bytes);
             #if debug
             trace("Queue length after push (js): " + audioQueue.length);
@@ -395,28 +393,29 @@ class MidiSynthExample extends Sprite {
             audioQueue.push(bytes);
             #end
         } catch (err:Dynamic) {
-            // On error, push silence
-            var silence = haxe.io.Bytes.alloc(BUFFER_SIZE * CHANNELS * 4);
-            for (i in 0...BUFFER_SIZE * CHANNELS) silence.setFloat(i * 4, 0.0);
-            audioQueue.push(silence);
-            audioQueue.push(silence);
+            // On error, push silence (separate buffers, they go back to the pool one by one)
+            for (n in 0...2) {
+                var silence = acquireBuffer();
+                silence.fill(0, silence.length, 0);
+                audioQueue.push(silence);
+            }
         }
     }
     
+    private function acquireBuffer():haxe.io.Bytes {
+        var bytes = freeBuffers.pop();
+        return bytes != null ? bytes : haxe.io.Bytes.alloc(BUFFER_SIZE * CHANNELS * 4);
+    }
+    
     private function onSampleData(event:SampleDataEvent):Void {
         #if (cpp || hl)
-        var bytes:Null<haxe.io.Bytes> = audioQueue.length > 0 ? audioQueue.shift() : null;
-
-        if (bytes == null || bytes.length == 0) {
-            // Underrun: write silence
-            for (i in 0...BUFFER_SIZE * CHANNELS) event.data.writeFloat(0.0);
-            return;
-        }
+        // Copy from the stream ring, frames the render thread didn't deliver in time come back as silence
+        synth.readStream(streamBuffer, BUFFER_SIZE);
 
         // Write buffered audio samples (float32 interleaved)
         var MASTER_GAIN = 0.7; // Reduce to 70% to prevent clipping
         for (i in 0...BUFFER_SIZE * CHANNELS) {
-            var sample = bytes.getFloat(i * 4) * MASTER_GAIN;
+            var sample = streamBuffer.getFloat(i * 4) * MASTER_GAIN;
             // Clamp to [-1, 1] just in case
             if (sample > 1.0) sample = 1.0;
             else if (sample < -1.0) sample = -1.0;
@@ -433,6 +432,7 @@ class MidiSynthExample extends Sprite {
         for (i in 0...BUFFER_SIZE * CHANNELS) {
             event.data.writeFloat(bytes.getFloat(i * 4));
         }
+        freeBuffers.push(bytes);
         #else
         // Other targets: consume JS queue if available, else silence
         var bytes:Null<haxe.io.Bytes> = audioQueue.length > 0 ? audioQueue.shift() : null;
@@ -509,6 +509,9 @@ class MidiSynthExample extends Sprite {
             synth.panicStopAllNotes(); // Also resets controllers
             activeNotes = new Map<Int, Bool>();
             updateInfo("PANIC: All notes, sound, and controllers reset");
+        } else if (e.keyCode == Keyboard.F2) {
+            // Compare per-call and batched event submission
+            updateInfo(EventBenchmark.run(synth));
         }
     }
     
@@ -844,117 +847,29 @@ class MidiSynthExample extends Sprite {
 
     private function onMidiFileLoaded(bytes:haxe.io.Bytes):Void {
         updateInfo("MIDI file loaded: " + bytes.length + " bytes\nParsing MIDI file...");
-        try {
-            midiEvents = parseMidiFile(bytes);
-            midiFileLoaded = true;
-            trace('First 10 parsed MIDI events:');
-            for (i in 0...Std.int(Math.min(10, midiEvents.length))) {
-                var ev = midiEvents[i];
-                var msg = '  [' + i + '] time=' + Std.string(ev.time) + ' type=' + Std.string(ev.type) + ' ch=' + Std.string(ev.channel);
-                if (Reflect.hasField(ev, "note")) msg += ' note=' + Std.string(ev.note);
-                if (Reflect.hasField(ev, "velocity")) msg += ' vel=' + Std.string(ev.velocity);
-                if (Reflect.hasField(ev, "program")) msg += ' program=' + Std.string(ev.program);
-                if (Reflect.hasField(ev, "pitchBend")) msg += ' pitchBend=' + Std.string(ev.pitchBend);
-                trace(msg);
-            }
-            updateInfo('MIDI file parsed. Found ' + midiEvents.length + ' note events. Ready to play.');
-        } catch (e:Dynamic) {
+        // Parsed natively: tracks merged, tempo map applied, times in samples
+        midiSong = synth.parseMidi(bytes);
+        if (midiSong == null) {
             midiFileLoaded = false;
-            updateInfo('ERROR parsing MIDI file: ' + Std.string(e));
-            #if debug
-            trace('MIDI parse error: ' + Std.string(e));
-            #end
+            updateInfo('ERROR parsing MIDI file');
+            return;
+        }
+        midiFileLoaded = true;
+        trace('First 10 parsed MIDI events:');
+        for (i in 0...Std.int(Math.min(10, midiSong.eventCount))) {
+            trace('  [' + i + '] sample=' + midiSong.getSample(i) + ' type=0x' + StringTools.hex(midiSong.getType(i)) +
+                ' ch=' + midiSong.getChannel(i) + ' data1=' + midiSong.getData1(i) + ' data2=' + midiSong.getData2(i));
         }
+        updateInfo('MIDI file parsed. Found ' + midiSong.eventCount + ' events. Ready to play.');
         // Optionally, auto-start playback
         //startMidiPlayback();
     }
 
-    // Parse MIDI file and return event list using moonchart
-    private function parseMidiFile(bytes:haxe.io.Bytes):Array<Dynamic> {
-        try {
-            var parser = new MidiParser();
-            var midi = parser.parseBytes(bytes);
-            var events = [];
-            var ticksPerQuarter = midi.division;
-            var tempo = 500000.0; // default 120bpm
-            var usPerTick = tempo / ticksPerQuarter; // microseconds per tick
-            var msPerTick = usPerTick / 1000.0; // milliseconds per tick
-            var currentTime = 0.0;
-            var lastTick = 0;
-            // Find tempo if present
-            for (track in midi.tracks) {
-                for (event in track) {
-                    switch (event) {
-                        case TEMPO_CHANGE(t, tick):
-                            tempo = t;
-                            usPerTick = tempo / ticksPerQuarter;
-                        default:
-                            // ignore
-                    }
-                }
-            }
-            // Parse note, program change, and pitch bend events
-            for (track in midi.tracks) {
-                lastTick = 0;
-                currentTime = 0.0;
-                for (event in track) {
-                    var tick = 0;
-                    switch (event) {
-                        case MESSAGE(bytes, t):
-                            tick = t;
-                            var dt = tick - lastTick;
-                            currentTime += dt * msPerTick; // ms
-                            lastTick = tick;
-                            var status = bytes[0] & 0xF0;
-                            var channel = bytes[0] & 0x0F;
-                            if (status == 0x90 && bytes[2] > 0) {
-                                // Note on
-                                events.push({time: currentTime, type: "on", channel: channel, note: bytes[1], velocity: bytes[2], program: 0, pitchBend: 0});
-                            } else if ((status == 0x80) || (status == 0x90 && bytes[2] == 0)) {
-                                // Note off
-                                events.push({time: currentTime, type: "off", channel: channel, note: bytes[1], velocity: 0, program: 0, pitchBend: 0});
-                            } else if (status == 0xC0) {
-                                // Program change
-                                events.push({time: currentTime, type: "program", channel: channel, note: 0, velocity: 0, program: bytes[1], pitchBend: 0});
-                            } else if (status == 0xE0) {
-                                // Pitch bend (0xE0)
-                                var lsb = bytes[1];
-                                var msb = bytes[2];
-                                var pitchWheel = (msb << 7) | lsb; // 14-bit value
-                                events.push({time: currentTime, type: "pitchbend", channel: channel, note: 0, velocity: 0, program: 0, pitchBend: pitchWheel});
-                            } else if (status == 0xB0) {
-                                // Control change (0xB0)
-                                var controller = bytes[1];
-                                var value = bytes[2];
-                                events.push({
-                                    time: currentTime,
-                                    type: "control",
-                                    channel: channel,
-                                    note: controller, // store controller number in note
-                                    velocity: value,  // controller value
-                                    program: 0,
-                                    pitchBend: 0
-                                });
-                            }
-                        default:
-                            // ignore
-                    }
-                }
-            }
-            return events;
-        } catch (e:Dynamic) {
-            #if debug
-            trace('parseMidiFile error: ' + Std.string(e));
-            #end
-            throw e;
-        }
-    }
-
     // Start MIDI playback
     private function startMidiPlayback():Void {
             // Reset playback note tracking
             playbackActiveNotes = new Map();
-        if (!midiFileLoaded || midiEvents.length == 0) {
+        if (!midiFileLoaded || midiSong.eventCount == 0) {
             updateInfo("No MIDI loaded or no events.");
             return;
         }
@@ -964,28 +879,21 @@ class MidiSynthExample extends Sprite {
         // Default to program 0 (Acoustic Grand Piano) for all channels
         for (ch in 0...16) channelPrograms.set(ch, 0);
         // Scan for first program change per channel
-        for (ev in midiEvents) {
-            if (Reflect.hasField(ev, "type") && ev.type == "program" &&
-                Reflect.hasField(ev, "channel") && Reflect.hasField(ev, "program")) {
-                var ch = ev.channel;
-                var prog = ev.program;
-                if (!channelPrograms.exists(ch) || channelPrograms.get(ch) == 0) {
-                    channelPrograms.set(ch, prog);
-                }
-            }
+        for (i in 0...midiSong.eventCount) {
+            if (midiSong.getType(i) != MidiSynth.EVENT_PROGRAM_CHANGE) continue;
+            var ch = midiSong.getChannel(i);
+            if (channelPrograms.get(ch) == 0) channelPrograms.set(ch, midiSong.getData1(i));
         }
 
         // Set preset for each channel before playback, and log
         for (ch in 0...16) {
-            var progVal = channelPrograms.get(ch);
-            var progMaybe = Std.isOfType(progVal, Int) ? progVal : Std.parseInt(Std.string(progVal));
-            var prog:Int = (progMaybe != null) ? progMaybe : 0;
+            var prog = channelPrograms.get(ch);
             trace('Initial program for channel ' + ch + ': ' + prog);
             synth.setPreset(ch, 0, prog);
         }
 
         midiIsPlaying = true;
-        midiPlaybackPos = 0.0;
+        midiPlaybackPos = 0;
         midiStartTime = haxe.Timer.stamp();
         midiLastTickTime = midiStartTime;
         midiPlaybackTime = 0.0;
@@ -1052,64 +960,51 @@ class MidiSynthExample extends Sprite {
         midiLastTickTime = now;
         midiPlaybackTime += delta;
         // Play all events whose time <= midiPlaybackTime
-        while (midiPlaybackPos < midiEvents.length) {
-            var ev = midiEvents[Std.int(midiPlaybackPos)];
-            var evTime:Float = cast(ev.time, Float);
-            if (evTime > midiPlaybackTime) break;
-            var ch = Std.int(ev.channel);
-            var note = Std.isOfType(ev.note, Int) ? ev.note : Std.parseInt(Std.string(ev.note));
-            var velocity = Std.isOfType(ev.velocity, Int) ? ev.velocity : Std.parseInt(Std.string(ev.velocity));
-            switch (ev.type) {
-                case "on":
-                    if (Reflect.hasField(ev, "note") && Reflect.hasField(ev, "velocity") && Std.isOfType(ev.note, Int) && Std.isOfType(ev.velocity, Int)) {
-                        var key = ch + ":" + note;
-                        if (playbackActiveNotes.exists(key) && playbackActiveNotes.get(key) > 0) {
-                            trace('WARNING: NOTE ON received for already active note: channel=' + ch + ' note=' + note + ' (count=' + playbackActiveNotes.get(key) + ')');
-                            // Workaround: forcibly send NOTE OFF before NOTE ON
-                            synth.noteOff(ch, note);
-                            // Track note-off
-                            var v = playbackActiveNotes.get(key) - 1;
-                            if (v <= 0) playbackActiveNotes.remove(key); else playbackActiveNotes.set(key, v);
-                        }
-                        synth.noteOn(ch, note, velocity);
-                        // Track note-on
-                        playbackActiveNotes.set(key, (playbackActiveNotes.exists(key) ? playbackActiveNotes.get(key) : 0) + 1);
-                    }
-                case "off":
-                    if (Reflect.hasField(ev, "note") && Std.isOfType(ev.note, Int)) {
-                        synth.noteOff(ch, note);
+        var playbackSample = midiPlaybackTime * midiSong.sampleRate / 1000.0;
+        while (midiPlaybackPos < midiSong.eventCount) {
+            var i = midiPlaybackPos;
+            if (midiSong.getSample(i) > playbackSample) break;
+            var ch = midiSong.getChannel(i);
+            var data1 = midiSong.getData1(i);
+            var data2 = midiSong.getData2(i);
+            switch (midiSong.getType(i)) {
+                case MidiSynth.EVENT_NOTE_ON:
+                    var key = ch + ":" + data1;
+                    if (playbackActiveNotes.exists(key) && playbackActiveNotes.get(key) > 0) {
+                        trace('WARNING: NOTE ON received for already active note: channel=' + ch + ' note=' + data1 + ' (count=' + playbackActiveNotes.get(key) + ')');
+                        // Workaround: forcibly send NOTE OFF before NOTE ON
+                        synth.noteOff(ch, data1);
                         // Track note-off
-                        var key = ch + ":" + note;
-                        if (playbackActiveNotes.exists(key)) {
-                            var v = playbackActiveNotes.get(key) - 1;
-                            if (v <= 0) playbackActiveNotes.remove(key); else playbackActiveNotes.set(key, v);
-                        }
-                    }
-                case "program":
-                    if (Reflect.hasField(ev, "program")) {
-                        var progVal = ev.program;
-                        var progMaybe = Std.isOfType(progVal, Int) ? progVal : Std.parseInt(Std.string(progVal));
-                        var prog:Int = (progMaybe != null) ? progMaybe : 0;
-                        trace('Program change: channel ' + ch + ' -> program ' + prog);
-                        synth.setPreset(ch, 0, prog);
+                        var v = playbackActiveNotes.get(key) - 1;
+                        if (v <= 0) playbackActiveNotes.remove(key); else playbackActiveNotes.set(key, v);
                     }
-                case "pitchbend":
-                    if (Reflect.hasField(ev, "pitchBend") && Std.isOfType(ev.pitchBend, Int)) {
-                        synth.pitchBend(ch, ev.pitchBend);
+                    synth.noteOn(ch, data1, data2);
+                    // Track note-on
+                    playbackActiveNotes.set(key, (playbackActiveNotes.exists(key) ? playbackActiveNotes.get(key) : 0) + 1);
+                case MidiSynth.EVENT_NOTE_OFF:
+                    synth.noteOff(ch, data1);
+                    // Track note-off
+                    var key = ch + ":" + data1;
+                    if (playbackActiveNotes.exists(key)) {
+                        var v = playbackActiveNotes.get(key) - 1;
+                        if (v <= 0) playbackActiveNotes.remove(key); else playbackActiveNotes.set(key, v);
                     }
-                case "control":
-                    // Use ev.note as controller number, ev.velocity as value
-                    if (Std.isOfType(ev.note, Int) && Std.isOfType(ev.velocity, Int)) {
-                        if (note == 64) {
-                            trace('SUSTAIN PEDAL: channel=' + ch + ' value=' + velocity);
-                        }
-                        synth.controlChange(ch, note, velocity);
+                case MidiSynth.EVENT_PROGRAM_CHANGE:
+                    trace('Program change: channel ' + ch + ' -> program ' + data1 + ' (bank ' + data2 + ')');
+                    synth.setPreset(ch, data2, data1);
+                case MidiSynth.EVENT_PITCH_BEND:
+                    synth.pitchBend(ch, data1);
+                case MidiSynth.EVENT_CONTROL_CHANGE:
+                    if (data1 == 64) {
+                        trace('SUSTAIN PEDAL: channel=' + ch + ' value=' + data2);
                     }
+                    synth.controlChange(ch, data1, data2);
+                default:
             }
             midiPlaybackPos++;
         }
         // Stop if done
-        if (midiPlaybackPos >= midiEvents.length) {
+        if (midiPlaybackPos >= midiSong.eventCount) {
             stopMidiPlayback();
         }
     }
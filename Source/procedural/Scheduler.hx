@@ -2,29 +2,28 @@ package procedural;
 
 import procedural.StructuredSong;
 import procedural.NoteEvent;
-import openfl.utils.Timer;
-import openfl.events.TimerEvent;
 
 /**
- * Scheduler for real-time playback of a StructuredSong using MidiSynth.
+ * Scheduler for playback of a StructuredSong using MidiSynth.
+ * The notes are loaded into the synth's sequencer once, which plays them on their exact
+ * sample while rendering, so there are no timers here.
  */
 class Scheduler {
     public var song:StructuredSong;
     public var synth:MidiSynth;
     
     private var events:Array<NoteEvent>;
-    private var eventIndex:Int = 0;
-    private var playbackTimer:Timer;
-    private var startTime:Float = 0;
-    private var playbackTime:Float = 0;
-    private var lastTickTime:Float = 0;
-    public var isPlaying:Bool = false;
-    private var activeNotes:Map<String, Bool>;
+    private var sequence:MidiSequence;
+    
+    /** True until the last note ended (as of the last rendered block) or stop() was called */
+    public var isPlaying(get, never):Bool;
+    private var started:Bool = false;
+    private var startSampleTime:Float = 0;
     
     public function new(song:StructuredSong, synth:MidiSynth) {
         this.song = song;
         this.synth = synth;
-        this.activeNotes = new Map();
+        this.sequence = new MidiSequence();
     }
     
     public function play():Void {
@@ -37,34 +36,32 @@ class Scheduler {
         // Set up instruments for each channel
         setupInstruments();
         
-        eventIndex = 0;
-        isPlaying = true;
-        startTime = haxe.Timer.stamp();
-        lastTickTime = startTime;
-        playbackTime = 0;
-        
-        // Start playback timer (5ms intervals for precision)
-        playbackTimer = new Timer(5);
-        playbackTimer.addEventListener(TimerEvent.TIMER, onPlaybackTick);
-        playbackTimer.start();
+        sequence.clear();
+        for (ev in events) {
+            sequence.add(ev.startBeat, ev.durationBeats, ev.channel, ev.note, ev.velocity);
+        }
+        synth.setSequenceTempo(song.bpm);
+        synth.loadSequence(sequence);
+        synth.startSequence();
+        started = true;
+        startSampleTime = synth.getSampleTime();
     }
     
     public function stop():Void {
-        if (!isPlaying) return;
-        
-        isPlaying = false;
-        if (playbackTimer != null) {
-            playbackTimer.stop();
-            playbackTimer = null;
-        }
+        if (!started) return;
         
-        // Stop all active notes
-        synth.panicStopAllNotes();
-        activeNotes = new Map();
+        started = false;
+        synth.stopSequence();
         
         trace('Playback stopped');
     }
     
+    private function get_isPlaying():Bool {
+        // The synth only reports playing once a render picked up the start
+        if (started && synth.getSampleTime() > startSampleTime && !synth.isSequencePlaying()) started = false;
+        return started;
+    }
+    
     private function setupInstruments():Void {
         // Scan for unique channels and set their instruments
         var channelInstruments = new Map<Int, Int>();
@@ -78,47 +75,4 @@ class Scheduler {
             synth.setPreset(ch, 0, channelInstruments.get(ch));
         }
     }
-    
-    private function onPlaybackTick(e:TimerEvent):Void {
-        if (!isPlaying) return;
-        
-        var now = haxe.Timer.stamp();
-        var delta = (now - lastTickTime) * 1000.0; // ms since last tick
-        lastTickTime = now;
-        playbackTime += delta;
-        
-        // Convert beats to milliseconds
-        var beatsPerSecond = song.bpm / 60.0;
-        var currentBeat = playbackTime / 1000.0 * beatsPerSecond;
-        
-        // Process all events up to current time
-        while (eventIndex < events.length) {
-            var ev = events[eventIndex];
-            if (ev.startBeat > currentBeat) break;
-            
-            // Trigger note on
-            synth.noteOn(ev.channel, ev.note, ev.velocity);
-            var key = ev.channel + ":" + ev.note;
-            activeNotes.set(key, true);
-            
-            // Schedule note off
-            var noteOffDelay = Std.int(ev.durationBeats / beatsPerSecond * 1000);
-            scheduleNoteOff(ev.channel, ev.note, noteOffDelay);
-            
-            eventIndex++;
-        }
-        
-        // Stop if done
-        if (eventIndex >= events.length && activeNotes.keys().hasNext() == false) {
-            stop();
-        }
-    }
-    
-    private function scheduleNoteOff(channel:Int, note:Int, delayMs:Int):Void {
-        haxe.Timer.delay(function() {
-            synth.noteOff(channel, note);
-            var key = channel + ":" + note;
-            activeNotes.remove(key);
-        }, delayMs);
-    }
 }